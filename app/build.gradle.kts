@@ -41,6 +41,13 @@ android {
     buildFeatures {
         prefab = true
     }
+    androidResources {
+        // Datasets in assets are read in place through AAsset_openFileDescriptor64, which only
+        // works for entries stored uncompressed. zipalign puts those on a 4 byte boundary; the
+        // chunk sources map from the page below, and fall back from direct I/O if the asset
+        // doesn't start on a page.
+        noCompress += "pcd"
+    }
     externalNativeBuild {
         cmake {
             path = file("src/main/cpp/CMakeLists.txt")
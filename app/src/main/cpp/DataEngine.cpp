@@ -0,0 +1,2166 @@
+#include "DataEngine.h"
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <android/asset_manager.h>
+#include <sys/system_properties.h>
+
+#include "AndroidOut.h"
+#include "glm/glm.hpp"
+#include "glm/ext/matrix_clip_space.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include "PointCloudData.h"
+#include "Crc32c.h"
+#include "PcdFile.h"
+#include "PcdAppender.h"
+#include "Morton.h"
+#include "Octree.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+//! Aligned staging buffers used when chunks are read with O_DIRECT
+static constexpr size_t kDirectReadBuffers = 8;
+
+// Looked up in the APK's assets first, then in the app's files directory
+static const char *kDatasetName = "pointcloud_10m.pcd";
+
+// Live chunks that leave the ring, in the app's files directory
+static const char *kLiveSpillName = "live_spill.pcd";
+
+
+DataEngine::~DataEngine() {
+
+    // The loader thread writes into renderBox's buffer, which is destroyed before it
+    chunkLoader_.reset();
+
+    // The live chunks still on screen, and any waiting for a slot, are kept too
+    if (liveSpillOpen_ && spillLiveChunks(liveChunksHeld_)) {
+        for (const auto &chunk : ingestChunks_) {
+            if (!liveSpill_.appendChunk(chunk.points.get(), chunk.point_count, chunk.bbox)) {
+                break;
+            }
+            liveChunksSpilled_++;
+        }
+        if (liveSpill_.commit()) {
+            aout << "Spilled " << liveChunksSpilled_ << " live chunks to " << kLiveSpillName << "\n";
+        } else {
+            aout << "Failed to commit " << kLiveSpillName << ": " << liveSpill_.error() << "\n";
+        }
+    }
+}
+
+
+void DataEngine::setViewport(int width, int height) {
+
+    width_ = width;
+    height_ = height;
+
+    if (height_ != 0 && width_ != 0) {
+        aout << "Has aspect ratio\n";
+        stateVars.hasAspectRatio = true;
+        camera_.aspectRatio = float(width_) / float(height_);
+        camera_.calcDistScalar();
+    }
+}
+
+
+void DataEngine::load() {
+
+    if (loaded_) {
+        return;
+    }
+
+    // 1. Initialize our 'Camera', which will contain our view matrix
+    initCamera();
+
+    // 2. Open the dataset and stream in the first chunks
+    initData();
+
+    loaded_ = true;
+}
+
+
+bool DataEngine::updateView() {
+
+    if (!updateViewMatrix_) {
+        return false;
+    }
+
+    if (camera_.pos_ == camera_.target_) {
+
+        aout << "(pos and target can't be equal)\n";
+
+        switch (inState.lastKeyPressed) {
+            case AKeyEvent('S'): // 's' key (x--)
+                if (inState.moveCode & 0b1) {
+                    camera_.target_[0]--;
+                    aout << "target.x = " << camera_.target_[0] << "\n";
+                }
+
+                if (inState.moveCode & 0b10) {
+                    camera_.pos_[0]--;
+                    aout << "camera.x = " << camera_.pos_[0] << "\n";
+                }
+
+                aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                     ", " << camera_.pos_.z << ")\n";
+                aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                     ", " << camera_.target_.z << ")\n";
+
+                updateViewMatrix_ = true;
+                stateVars.cameraMoved = true;
+                break;
+            case AKeyEvent('E'): // 'e' key (y++)
+                if (inState.moveCode & 0b1) {
+                    camera_.target_[1]++;
+                    aout << "target.y = " << camera_.target_[1] << "\n";
+                }
+
+                if (inState.moveCode & 0b10) {
+                    camera_.pos_[1]++;
+                    aout << "camera.y = " << camera_.pos_[1] << "\n";
+                }
+
+                aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                     ", " << camera_.pos_.z << ")\n";
+                aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                     ", " << camera_.target_.z << ")\n";
+
+                updateViewMatrix_ = true;
+                stateVars.cameraMoved = true;
+                break;
+            case AKeyEvent('D'): // 'd' key (y--)
+
+                if (inState.moveCode & 0b1) {
+                    camera_.target_[1]--;
+                    aout << "target.y = " << camera_.target_[1] << "\n";
+                }
+
+                if (inState.moveCode & 0b10) {
+                    camera_.pos_[1]--;
+                    aout << "camera.y = " << camera_.pos_[1] << "\n";
+                }
+
+                aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                     ", " << camera_.pos_.z << ")\n";
+                aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                     ", " << camera_.target_.z << ")\n";
+
+                updateViewMatrix_ = true;
+                stateVars.cameraMoved = true;
+                break;
+
+            case AKeyEvent('W'): // 'w' key (z++)
+
+                if (inState.moveCode & 0b1) {
+                    camera_.target_[2]++;
+                    aout << "target.z = " << camera_.target_[2] << "\n";
+                }
+
+                if (inState.moveCode & 0b10) {
+                    camera_.pos_[2]++;
+                    aout << "camera.z = " << camera_.pos_[2] << "\n";
+                }
+
+                aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                     ", " << camera_.pos_.z << ")\n";
+                aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                     ", " << camera_.target_.z << ")\n";
+
+                updateViewMatrix_ = true;
+                stateVars.cameraMoved = true;
+                break;
+            case AKeyEvent('Q'): // 'q' key (z--)
+
+                if (inState.moveCode & 0b1) {
+                    camera_.target_[2]--;
+                    aout << "target.z = " << camera_.target_[2] << "\n";
+                }
+
+                if (inState.moveCode & 0b10) {
+                    camera_.pos_[2]--;
+                    aout << "camera.z = " << camera_.pos_[2] << "\n";
+                }
+
+                aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                     ", " << camera_.pos_.z << ")\n";
+                aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                     ", " << camera_.target_.z << ")\n";
+
+                updateViewMatrix_ = true;
+                stateVars.cameraMoved = true;
+                break;
+        }
+    }
+
+    // Update view matrix
+    camera_.updateViewMatrix();
+
+    glm::mat4 vM = camera_.viewMatrix_;
+
+    glm::vec4 vX = vM[0];
+    glm::vec4 vY = vM[1];
+    glm::vec4 vZ = vM[2];
+    glm::vec4 vO = vM[3];
+
+    // float alpha2 = acos(glm::dot(vX, {1, 0, 0, 0}));
+    // float beta2 = acos(glm::dot(vY, {0, 1, 0, 0}));
+    // float gamma2 = acos(glm::dot(vZ, {0, 0, 1, 0}));
+
+    float vXx2 = pow(vX[0], 2);
+    float vXy2 = pow(vX[1], 2);
+
+    float beta = atan2(-vX[2], sqrt(vXx2 + vXy2));
+    float alpha = atan2(vY[2]/cos(beta), vZ[2]/cos(beta));
+    float gamma = atan2(vX[1]/cos(beta), vX[0]/cos(beta));
+
+    aout << "vX = (" << vX[0] << ", " << vX[1] << ", " << vX[2] << ", " << vX[3] << ")\n";
+    aout << "vY = (" << vY[0] << ", " << vY[1] << ", " << vY[2] << ", " << vY[3] << ")\n";
+    aout << "vZ = (" << vZ[0] << ", " << vZ[1] << ", " << vZ[2] << ", " << vZ[3] << ")\n";
+    aout << "Euler Angles = (" << alpha << ", " << beta << ", " << gamma << ")\n";
+
+
+    updateViewMatrix_ = false;
+    return true;
+}
+
+
+void DataEngine::update() {
+    frameCount_++;
+
+    // Brick visibility first: any read issued this frame reads only the bricks in view
+    if (bricksEnabled_) {
+        cullBricks();
+    }
+
+    // Test loads and draws against this frame's view; on before updateChunks so its reads can be
+    // held back too
+    if (occlusionEnabled_) {
+        cullOccludedChunks();
+    }
+
+    if (cameraPath_.isOpen()) {
+        cameraPath_.record(frameCount_, {{camera_.pos_.x, camera_.pos_.y, camera_.pos_.z},
+                                         {camera_.target_.x, camera_.target_.y, camera_.target_.z}});
+    }
+
+    // Update the rendered chunks if necessary
+    if (stateVars.cameraMoved) {
+        updateChunks();
+        reprioritizeChunkReads();
+        stateVars.cameraMoved = false;
+    }
+
+    if (budgetEnabled_) {
+        scheduleChunks();
+    }
+
+    pollChunkReads();
+
+    if (ingest_) {
+        pollIngest();
+    }
+}
+
+
+const std::vector<SlotDraw> &DataEngine::drawList() {
+
+    drawList_.clear();
+    drawnPoints_ = 0;
+
+    for (int i = 0; i<renderBox.totalSize; i++) {
+        bool hidden = (occlusionEnabled_ && slotOccluded_[i]) ||
+                      (queriesEnabled_ && slotHiddenChunk_[i] != nullptr &&
+                       slotHiddenChunk_[i] == slotHolds_[i]);
+        if (!renderBox.active_indices[i] || hidden) {
+            continue;
+        }
+
+        // Chunks keep their points in Morton order (older files in sampling order). Either way
+        // every n-th point takes one from each run of n, which thins a chunk evenly.
+        uint32_t step = 1;
+        if (budgetEnabled_) {
+            auto num_points = static_cast<uint32_t>(renderBox.num_points_array[i]);
+            uint32_t draw_points = std::min(slotDrawPoints_[i], num_points);
+            if (draw_points == 0) {
+                continue;
+            }
+            // Past the widest attribute stride the GPU takes, a draw would fail and leave the
+            // last slot's pointers in place; a thin slot then draws more than it was given
+            step = std::min((num_points + draw_points - 1) / draw_points, maxDrawStep_);
+        }
+
+        // One draw per run of bricks in view
+        size_t slot = static_cast<size_t>(renderBox.chunk_size) * i;
+        for (size_t r = 0, runs = slotDrawRuns(i); r < runs; r++) {
+            drawList_.push_back({slot + slotRuns_[r].first_point, slotRuns_[r].point_count, step});
+            drawnPoints_ += (slotRuns_[r].point_count + step - 1) / step;
+        }
+    }
+
+    if (budgetEnabled_ && frameCount_ % kBudgetLogInterval == 0) {
+        aout << "[pointBudget] Budget " << pointBudget_.options().budget << ", asked for "
+             << pointBudget_.requestedPoints() << ", scheduled "
+             << pointBudget_.scheduledPoints() << " in " << pointBudget_.scheduledChunks()
+             << " chunks, drew " << drawnPoints_ << "\n";
+    }
+    return drawList_;
+}
+
+
+void DataEngine::slotPoints(int rb_index, size_t &first, uint32_t &count) const {
+
+    first = static_cast<size_t>(renderBox.chunk_size) * rb_index + slotFirstPoint_[rb_index];
+    count = static_cast<uint32_t>(renderBox.num_points_array[rb_index]);
+}
+
+
+/*
+ * dim:
+ * 0 -> x
+ * 1 -> y
+ * 2 -> z
+ *
+ * returns the incremented posCode
+ */
+uint32_t shiftPosCode(uint32_t dim, uint32_t posCodeOld, int maxDepth, bool backwards = false) {
+    return mortonStep(posCodeOld, (int)dim, backwards ? -1 : 1, maxDepth);
+}
+
+
+// Aspect ratio must be known first
+void DataEngine::setRenderBox() {
+
+    // Let's start with four boxes
+
+    float renderDepth = camera_.zFar - camera_.zNear;
+
+    std::vector<float> depths = {
+            camera_.zNear,
+            camera_.zNear + (renderDepth/3.f),
+            camera_.zNear + (2.f*renderDepth/3.f),
+            camera_.zFar
+    };
+
+    for (int i = 0; i<depths.size(); i++) {
+        float vert = (camera_.distScalarY) * depths[i];
+        float horiz = vert*camera_.aspectRatio;
+        // renderBoxes[i]
+    }
+
+    // renderBoxes[0]
+
+}
+
+
+glm::vec<3, uint32_t, glm::defaultp> DataEngine::getIndices(uint32_t posCode) {
+
+    MortonIndices indices = mortonDecode(posCode);
+
+    return {indices.x, indices.y, indices.z};
+}
+
+glm::vec3 DataEngine::getIndicesFloat(glm::vec3 point) {
+
+    BoundingBox aB = octreeData.absoluteBounds;
+    glm::vec3 minPoint = {aB.min_x, aB.min_y, aB.min_z};
+    glm::vec3 unitBox = octreeData.unitBoxDims;
+
+    glm::vec3 indices = {
+            (point.x - minPoint.x)/unitBox.x,
+            (point.y - minPoint.y)/unitBox.y,
+            (point.z - minPoint.z)/unitBox.z
+    };
+
+    return indices;
+}
+
+
+void DataEngine::fetchChunks2() {
+
+    OctreeNode *root = octreeData.root;
+    int maxDepth = octreeData.maxDepth;
+
+    float halfHeight = camera_.zFar * camera_.distScalarY;
+    float halfWidth = halfHeight * camera_.aspectRatio;
+
+    // Let's get the 8 corners
+    // 0 BLN, 1 BRN, 2 TLN, 3 TRN, 4 BLF, 5 BRF, 6 TLF, 7 TRF
+    std::vector<glm::vec3> corners(8);
+    for (int i = 0; i<8; i++) {
+        corners[i].x = camera_.pos_.x + halfWidth*pow(-1, i);
+        corners[i].y = camera_.pos_.y + halfHeight*(((i % 4) < 2)? -1 : 1);
+        corners[i].z = camera_.pos_.z - ((i < 4)? camera_.zFar : 0);
+    }
+
+    /*
+    glm::vec3 botLeftNear = {
+            camera_.pos_.x - halfWidth,
+            camera_.pos_.y - halfHeight,
+            camera_.pos_.z - camera_.zFar
+    };
+
+    glm::vec3 botRightNear = {
+            camera_.pos_.x + halfWidth,
+            camera_.pos_.y - halfHeight,
+            camera_.pos_.z - camera_.zFar
+    };
+
+    glm::vec3 topLeftNear = {
+            camera_.pos_.x - halfWidth,
+            camera_.pos_.y + halfHeight,
+            camera_.pos_.z - camera_.zFar
+    };
+
+    glm::vec3 topRightNear = {
+            camera_.pos_.x + halfWidth,
+            camera_.pos_.y + halfHeight,
+            camera_.pos_.z - camera_.zFar
+    };
+
+
+    glm::vec3 botLeftFar = {
+            camera_.pos_.x - halfWidth,
+            camera_.pos_.y - halfHeight,
+            camera_.pos_.z
+    };
+
+    glm::vec3 botRightFar = {
+            camera_.pos_.x + halfWidth,
+            camera_.pos_.y - halfHeight,
+            camera_.pos_.z
+    };
+
+    glm::vec3 topLeftFar = {
+            camera_.pos_.x - halfWidth,
+            camera_.pos_.y + halfHeight,
+            camera_.pos_.z
+    };
+
+    glm::vec3 topRightFar = {
+            camera_.pos_.x + halfWidth,
+            camera_.pos_.y + halfHeight,
+            camera_.pos_.z
+    };
+    */
+
+
+    /*
+    // These are described in local space, which must be converted to camera
+    // space before performing any operations
+    glm::vec3 sideX = botRightNear - botLeftNear;
+    glm::vec3 sideY = topLeftNear - botLeftNear;
+    glm::vec3 sideZ = botLeftFar - botRightFar;
+
+    glm::mat4 vM = glm::transpose(camera_.viewMatrix_);
+
+
+    aout << "Bottom Left Point: (x, y, z) = (" << botLeftNear.x << ", " <<
+         botLeftNear.y << ", " << botLeftNear.z << ")\n";
+
+    uint32_t posCodeBL = root->getPosCode(botLeftNear, maxDepth);
+    aout << "posCodeBL = " << posCodeBL << "\n";
+    */
+}
+
+void DataEngine::fetchChunks() {
+    // Assume renderBoxes is already filled
+
+    // Maybe for now, just use the far plane as the box bounds
+
+    // The box is laid over the octree by position codes, which only reach cells whose tiles are in
+    openTilesNear();
+
+    OctreeNode *root = octreeData.root;
+    int maxDepth = octreeData.maxDepth;
+
+    float halfHeight = camera_.zFar * camera_.distScalarY;
+    float halfWidth = halfHeight * camera_.aspectRatio;
+
+
+    /*
+    glm::vec3 botLeftPos = {
+            camera_.pos_.x - halfWidth,
+            camera_.pos_.y - halfHeight,
+            camera_.pos_.z - camera_.zFar
+    };
+
+
+    glm::vec3 topRightPos = {
+            camera_.pos_.x + halfWidth,
+            camera_.pos_.y + halfHeight,
+            camera_.pos_.z
+    };
+    */
+
+    glm::vec3 botLeftPos = {
+            camera_.pos_.x - renderBox.cubeSideLength/2,
+            camera_.pos_.y - renderBox.cubeSideLength/2,
+            camera_.pos_.z - renderBox.cubeSideLength
+    };
+
+    glm::vec3 topRightPos = {
+            camera_.pos_.x + renderBox.cubeSideLength/2,
+            camera_.pos_.y + renderBox.cubeSideLength/2,
+            camera_.pos_.z
+    };
+
+    // If the camera is pointing toward the positive x axis, move the render box to the
+    // other side of the z axis relative to the camera
+    if (camera_.pos_.z < camera_.target_.z) {
+        botLeftPos.z += renderBox.cubeSideLength;
+        topRightPos.z += renderBox.cubeSideLength;
+    }
+
+
+    aout << "Bottom Left Point: (x, y, z) = (" << botLeftPos.x << ", " <<
+         botLeftPos.y << ", " << botLeftPos.z << ")\n";
+
+    uint32_t posCodeBL = root->getPosCode(botLeftPos, maxDepth);
+    aout << "posCodeBL = " << posCodeBL << "\n";
+
+
+    uint32_t posCodeTR = root->getPosCode(topRightPos, maxDepth);
+    // aout << "Top Right Point: (x, y, z) = (" << topRightPos.x << ", " <<
+    //      topRightPos.y << ", " << topRightPos.z << ")\n";
+    // aout << "posCodeTR = " << posCodeTR << "\n";
+
+    glm::vec<3, uint32_t, glm::defaultp> indicesBL = getIndices(posCodeBL);
+    glm::vec<3, uint32_t, glm::defaultp> indicesTR = getIndices(posCodeTR);
+
+    // aout << "Bottom Left RenderBox Indicies:\n x = " << indexBL_X <<
+    // "; y = " << indexBL_Y << "; z = " << indexBL_Z << "\n";
+
+    aout << "Top Right RenderBox Indicies:\n x = " << indicesTR.x <<
+         "; y = " << indicesTR.y << "; z = " << indicesTR.z << "\n";
+
+    // Record indices in the corners, which will be used to for comparison
+    // when updating chunks
+    renderBox.posCodeBL = posCodeBL;
+    renderBox.posCodeTR = posCodeTR;
+    renderBox.indicesBL = {indicesBL.x, indicesBL.y, indicesBL.z};
+    renderBox.indicesTR = {indicesTR.x, indicesTR.y, indicesTR.z};
+
+    uint32_t startingIndex = posCodeBL;
+
+    OctreeNode *nodeBL = root->getNodeSoft(posCodeBL, maxDepth);
+
+    // uint32_t bitMaskX
+    int lenX = indicesTR.x - indicesBL.x;
+    int lenY = indicesTR.y - indicesBL.y;
+    int lenZ = indicesTR.z - indicesBL.z;
+
+    uint32_t posCodeTemp = posCodeBL;
+    int rb_index = 0;
+
+    int totalSpan = (lenX+1)*(lenY+1)*(lenZ+1);
+
+    if (totalSpan > renderBox.totalSize) {
+        aout << "Problem: Total Size = " << totalSpan << ", but renderBox.totalSize = "
+        << renderBox.totalSize << "\n";
+
+    } else {
+        aout << "Loading in Chunks: Total Size = " << totalSpan
+        << "; renderBox.totalSize = "
+         << renderBox.totalSize << "\n";
+
+        // Do the loading stuff
+
+        OctreeNode *currNode = nullptr, *prevNode = nullptr;
+
+        int nodes_loaded = 0, nodes_bounced = 0;
+
+        glm::vec<3, uint32_t, glm::defaultp> currIndices = {0, 0, 0};
+        int iX = 0, iY = 0, iZ = 0;
+        int count = 0;
+
+        for (int i = 0; i <= lenZ; i++) {
+            for (int j = 0; j <= lenY; j++) {
+                for (int k = 0; k <= lenX; k ++) {
+
+                    currNode = root->getNodeSoft(posCodeTemp, maxDepth);
+                    currIndices = getIndices(posCodeTemp);
+
+                    iX = currIndices.x % renderBox.bufferDims.x;
+                    iY = currIndices.y % renderBox.bufferDims.y;
+                    iZ = currIndices.z % renderBox.bufferDims.z;
+
+                    rb_index = iX + (renderBox.bufferDims.x * iY)
+                               + (renderBox.bufferDims.y * renderBox.bufferDims.x * iZ);
+
+                    if (currNode != nullptr) {
+
+                        if (prevNode == nullptr ||
+                        (currNode->encodedPosition != prevNode->encodedPosition)) {
+
+                            /*
+                            if (count >= 0) {
+                                aout << "rb_index = " << rb_index <<
+                                "; posCodeTemp = " << posCodeTemp <<
+                                     "; currNode->encPos = " << currNode->encodedPosition << "\n";
+                            }
+                            */
+
+                            // Load the chunk in
+                            queueChunkRead(currNode, rb_index);
+
+                            nodes_loaded++;
+
+                        }
+
+                    }
+
+                    // Update prevNode
+                    prevNode = root->getNodeSoft(posCodeTemp, maxDepth);
+
+                    posCodeTemp = shiftPosCode(0, posCodeTemp, maxDepth);
+
+                    count++;
+                }
+
+                // Shift posCode back to start in the x direction
+                // Yes this kills me to do but... it's simple and will work
+                for (int k = 0; k <= lenX; k ++) {
+                    posCodeTemp = shiftPosCode(0, posCodeTemp, maxDepth, true);
+                }
+
+                posCodeTemp = shiftPosCode(1, posCodeTemp, maxDepth);
+            }
+
+            // Shift posCode back to start in the x direction
+            // Yes this kills me to do but... it's simple and will work
+            for (int j = 0; j <= lenY; j++) {
+                posCodeTemp = shiftPosCode(1, posCodeTemp, maxDepth, true);
+            }
+            posCodeTemp = shiftPosCode(2, posCodeTemp, maxDepth);
+        }
+
+        flushChunkReads();
+
+        nodes_bounced = totalSpan - nodes_loaded;
+
+        aout << "[fetchChunks] Loaded in " << nodes_loaded << " chunks; Bounced " <<
+        nodes_bounced << " chunks.\n";
+    }
+
+}
+
+
+void DataEngine::openChunkLoader(const ChunkFileRange &file, const FileHeader &header) {
+
+    // Switch backends without a rebuild: adb shell setprop debug.rmus.io_backend mmap
+    ChunkSourceKind kind = ChunkSourceKind::PRead;
+    char backend[PROP_VALUE_MAX] = {0};
+    if (__system_property_get("debug.rmus.io_backend", backend) > 0 &&
+        !ChunkSource::parseKind(backend, kind)) {
+        aout << "Unknown io backend '" << backend << "', using pread\n";
+    }
+
+    ChunkSourceOptions options;
+    options.queue_depth = RenderBox::MAX_CAPACITY;
+
+    // Streaming hundreds of MB through the page cache evicts everything else on the device.
+    // Direct reads need page-aligned payloads, so only files written with --align qualify.
+    char direct[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.direct_io", direct);
+    if (std::string(direct) == "1" && kind != ChunkSourceKind::MMap) {
+        if (headerFlags(header) & PCD_FLAG_ALIGNED_PAYLOADS) {
+            options.direct_io = true;
+        } else {
+            aout << "Dataset payloads aren't page aligned, direct I/O disabled\n";
+        }
+    }
+
+    std::unique_ptr<ChunkSource> source = ChunkSource::open(file, kind, options);
+
+    // io_uring is blocked by seccomp for most app processes
+    if (!source && kind != ChunkSourceKind::PRead) {
+        aout << ChunkSource::kindName(kind) << " backend unavailable, falling back to pread\n";
+        source = ChunkSource::open(file, ChunkSourceKind::PRead, options);
+    }
+
+    // Also the case for an asset that doesn't start on a page in the APK
+    if (!source && options.direct_io) {
+        aout << "Direct I/O unavailable, using buffered reads\n";
+        options.direct_io = false;
+        source = ChunkSource::open(file, ChunkSourceKind::PRead, options);
+    }
+
+    if (!source) {
+        aout << "Failed to open the dataset for chunk reads\n";
+        return;
+    }
+
+    startChunkLoader(std::move(source), options.direct_io, header.chunk_size);
+}
+
+
+void DataEngine::openTiledChunkLoader() {
+
+    ChunkSourceOptions options;
+    options.queue_depth = RenderBox::MAX_CAPACITY;
+
+    // One pool of workers serves every tile, so reads from different tiles run side by side
+    char backend[PROP_VALUE_MAX] = {0};
+    if (__system_property_get("debug.rmus.io_backend", backend) > 0 &&
+        std::string(backend) != "pread") {
+        aout << "Tiled datasets are read with pread, ignoring io backend '" << backend << "'\n";
+    }
+
+    // Every tile has to have aligned payloads, and be page aligned in the APK if it's read
+    // from there; openTile() skips one that isn't
+    char direct[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.direct_io", direct);
+    if (std::string(direct) == "1") {
+        if (manifest_.flags & PCD_FLAG_ALIGNED_PAYLOADS) {
+            options.direct_io = true;
+        } else {
+            aout << "Tile payloads aren't page aligned, direct I/O disabled\n";
+        }
+    }
+
+    auto source = std::make_unique<TiledChunkSource>(options);
+    tiledSource_ = source.get();
+    startChunkLoader(std::move(source), options.direct_io, manifest_.chunk_size);
+}
+
+
+void DataEngine::startChunkLoader(std::unique_ptr<ChunkSource> source, bool directIO,
+                                uint32_t chunkSize) {
+
+    ChunkLoaderOptions loaderOptions;
+    loaderOptions.batch_size = RenderBox::MAX_CAPACITY;
+    loaderOptions.direct_io = directIO;
+    loaderOptions.max_read_length = chunkSize * sizeof(cpoint_t);
+    loaderOptions.staging_buffers = kDirectReadBuffers;
+
+    chunkLoader_ = std::make_unique<ChunkLoader>(std::move(source), loaderOptions);
+
+    if (!chunkLoader_->valid()) {
+        aout << "Failed to allocate direct I/O staging buffers\n";
+        chunkLoader_.reset();
+        tiledSource_ = nullptr;
+        return;
+    }
+
+    aout << "Chunk I/O backend: " << chunkLoader_->sourceName()
+         << (chunkLoader_->directIO() ? " (direct)" : "") << "\n";
+
+    // Chunk ids belong to this dataset, so start the tier over. 0 turns it off.
+    size_t tier_bytes = kCompressedTierBytes;
+    char compressed_mb[PROP_VALUE_MAX] = {0};
+    if (__system_property_get("debug.rmus.compressed_mb", compressed_mb) > 0) {
+        tier_bytes = std::strtoul(compressed_mb, nullptr, 10) * 1024 * 1024;
+    }
+    compressedChunks_ = CompressedChunkCache(tier_bytes);
+    aout << "Compressed chunk tier: " << (compressedChunks_.budget() / 1024 / 1024) << " MB\n";
+}
+
+
+void DataEngine::queueChunkRead(OctreeNode *chunk, int rb_index) {
+
+    slotWanted_[rb_index] = chunk;
+    renderBox.active_indices[rb_index] = false;
+
+    // Hidden chunks wait; cullOccludedChunks() reads them once they could be seen. Under a point
+    // budget every read waits for scheduleChunks() to rank it.
+    slotDeferred_[rb_index] = budgetEnabled_ ||
+                              (occlusionEnabled_ && occlusionCuller_.isOccluded(chunk->bbox));
+    if (slotDeferred_[rb_index]) {
+        return;
+    }
+
+    // A read already landing in this slot gets superseded when it completes; if it's still
+    // queued, cancelling it gets the slot to the new chunk sooner
+    if (slotLoading_[rb_index] == nullptr) {
+        issueChunkRead(rb_index);
+    } else if (slotLoading_[rb_index] != chunk && chunkLoader_) {
+        chunkLoader_->cancel(static_cast<uint64_t>(rb_index));
+    }
+}
+
+
+void DataEngine::issueChunkRead(int rb_index) {
+
+    const OctreeNode *chunk = slotWanted_[rb_index];
+
+    // Leaves at the octree's max depth can exceed the target chunk size; never overrun the slot
+    int num_points = std::min<int>(chunk->numPoints, renderBox.chunk_size);
+
+    cpoint_t *buffer_loc = renderBox.pcd_buffer.data() + (renderBox.chunk_size * rb_index);
+
+    ChunkLoadRequest read{chunk->byteOffset, static_cast<uint32_t>(num_points * sizeof(cpoint_t)),
+                          buffer_loc, static_cast<uint64_t>(rb_index)};
+    prioritizeChunkRead(chunk, rb_index, read.priority, read.prefetch);
+
+    if (compressedChunks_.budget() > 0) {
+        // Chunks never change, so one already in the tier doesn't need compressing again, and one
+        // decoded from it goes back as its original blob: the codec is lossy, so decoded points
+        // are never encoded twice. A slot holding part of a chunk has nothing whole to demote.
+        const OctreeNode *previous = slotHolds_[rb_index];
+        if (previous != nullptr && previous != chunk && previous != slotPartial_[rb_index] &&
+            !compressedChunks_.retire(previous->chunkIndex) &&
+            !compressedChunks_.contains(previous->chunkIndex)) {
+            read.demote_chunk = previous->chunkIndex;
+            read.demote_points = std::min<uint32_t>(previous->numPoints, renderBox.chunk_size);
+            read.demote_src = buffer_loc;
+        }
+        read.compressed = compressedChunks_.promote(chunk->chunkIndex);
+    }
+
+    // Only the span of bricks in view, unless the slot already read part of this chunk and then
+    // more of it came into view. A chunk decoded from the tier comes whole anyway.
+    uint32_t first_point = 0;
+    const PcdBrick *bricks = chunkBricks(chunk);
+    bool partial = false;
+    if (bricks != nullptr && !read.compressed && slotPartial_[rb_index] != chunk) {
+        BrickRun span = brickSpan(bricks, bricksPerChunk_, visibleBricks(frustum_, bricks, bricksPerChunk_));
+        auto end = std::min<uint32_t>(span.first_point + span.point_count, num_points);
+        // Direct reads have to start on a page
+        uint32_t begin = span.first_point;
+        if (chunkLoader_ && chunkLoader_->directIO()) {
+            begin -= begin % (PCD_PAYLOAD_ALIGNMENT / sizeof(cpoint_t));
+        }
+        if (span.point_count > 0 && begin < end && end - begin < uint32_t(num_points)) {
+            first_point = begin;
+            num_points = static_cast<int>(end - first_point);
+            partial = true;
+            read.offset += uint64_t(first_point) * sizeof(cpoint_t);
+            read.length = static_cast<uint32_t>(num_points * sizeof(cpoint_t));
+            read.dst = buffer_loc + first_point;
+        }
+    }
+    slotPartial_[rb_index] = partial ? chunk : nullptr;
+    slotFirstPoint_[rb_index] = first_point;
+
+    // The CRC covers the whole payload, so only a read of all of it from disk can be checked
+    if (!read.compressed && !partial && num_points == chunk->numPoints &&
+        chunk->chunkIndex < chunkCrcs_.size()) {
+        read.verify = true;
+        read.crc = chunkCrcs_[chunk->chunkIndex];
+    }
+
+    if (!read.compressed) {
+        chunkTrace_.record(frameCount_, chunk->encodedPosition);
+    }
+
+    pendingReads_.push_back(read);
+
+    slotLoading_[rb_index] = chunk;
+    slotHolds_[rb_index] = nullptr;
+    slotProxies_[rb_index] = OccluderProxy();
+    renderBox.num_points_array[rb_index] = num_points;
+}
+
+
+void DataEngine::flushChunkReads() {
+
+    if (pendingReads_.empty()) {
+        return;
+    }
+
+    if (!chunkLoader_) {
+        for (const auto &read : pendingReads_) {
+            slotLoading_[read.user_data] = nullptr;
+        }
+        pendingReads_.clear();
+        return;
+    }
+
+    chunkLoader_->request(pendingReads_.data(), pendingReads_.size());
+
+    aout << "[flushChunkReads] Queued " << pendingReads_.size() << " chunk reads via "
+         << chunkLoader_->sourceName() << "\n";
+
+    pendingReads_.clear();
+}
+
+
+void DataEngine::prioritizeChunkRead(const OctreeNode *chunk, int rb_index, float &priority,
+                                   bool &prefetch) const {
+
+    const BoundingBox &bbox = chunk->bbox;
+    glm::vec3 min = {bbox.min_x, bbox.min_y, bbox.min_z};
+    glm::vec3 max = {bbox.max_x, bbox.max_y, bbox.max_z};
+    float distance = glm::distance(glm::clamp(camera_.pos_, min, max), camera_.pos_);
+    priority = glm::distance(min, max) / std::max(distance, 1e-3f);
+
+    prefetch = queriesEnabled_ && slotHiddenChunk_[rb_index] != nullptr &&
+               slotHiddenChunk_[rb_index] == chunk;
+}
+
+
+void DataEngine::reprioritizeChunkReads() {
+
+    if (!chunkLoader_) {
+        return;
+    }
+
+    readPriorities_.clear();
+    for (int i = 0; i < renderBox.totalCubeSize; i++) {
+        if (slotLoading_[i] != nullptr) {
+            ChunkLoadPriority update{static_cast<uint64_t>(i), 0.0f, false};
+            prioritizeChunkRead(slotLoading_[i], i, update.priority, update.prefetch);
+            readPriorities_.push_back(update);
+        }
+    }
+    chunkLoader_->reprioritize(readPriorities_.data(), readPriorities_.size());
+}
+
+
+void DataEngine::pollChunkReads() {
+
+    if (!chunkLoader_) {
+        return;
+    }
+
+    landedSlots_.clear();
+    demotedChunks_.clear();
+    chunkLoader_->pollCompressed(demotedChunks_);
+    for (auto &demoted : demotedChunks_) {
+        compressedChunks_.insert(demoted.chunk_id, std::move(demoted.blob));
+    }
+
+    finishedReads_.clear();
+    if (chunkLoader_->poll(finishedReads_) == 0) {
+        return;
+    }
+
+    for (const auto &completion : finishedReads_) {
+        auto rb_index = static_cast<int>(completion.user_data);
+        const OctreeNode *loaded = slotLoading_[rb_index];
+        slotLoading_[rb_index] = nullptr;
+
+        // Superseded reads still fill the buffer, so they can be demoted later too. The read was
+        // the whole chunk, or the bricks in view if slotPartial_ says so.
+        int64_t loaded_bytes = renderBox.num_points_array[rb_index] * sizeof(cpoint_t);
+        slotHolds_[rb_index] = completion.result == loaded_bytes ? loaded : nullptr;
+        if (slotHolds_[rb_index] == nullptr && loaded != nullptr) {
+            // A promotion that didn't land puts its blob back
+            compressedChunks_.retire(loaded->chunkIndex);
+        }
+
+        // The box moved on while this read was in flight, or it was cancelled before the box came
+        // back to it; read what the slot wants now
+        if (loaded != slotWanted_[rb_index] || completion.result == -ECANCELED) {
+            if (slotWanted_[rb_index] != nullptr && !slotDeferred_[rb_index]) {
+                issueChunkRead(rb_index);
+            }
+            continue;
+        }
+
+        int64_t expected = renderBox.num_points_array[rb_index] * sizeof(cpoint_t);
+
+        if (completion.result == -EBADMSG) {
+            aout << "[pollChunkReads] Chunk " << loaded->chunkIndex << " in slot " << rb_index
+                 << " failed its CRC, skipped (" << chunkLoader_->crcRejected() << " so far)\n";
+            continue;
+        }
+        if (completion.result != expected) {
+            aout << "[pollChunkReads] Read for slot " << rb_index << " failed: "
+                 << completion.result << "\n";
+            continue;
+        }
+
+        // The Renderer uploads it after update(); a new one uploads every active slot
+        renderBox.active_indices[rb_index] = true;
+        landedSlots_.push_back(rb_index);
+    }
+
+    // A burst of landed reads, after a jump or on startup, would otherwise build every proxy on
+    // the render thread in one frame
+    if (occlusionEnabled_) {
+        jobs_.parallelFor(0, landedSlots_.size(), 1, [this](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                int rb_index = landedSlots_[i];
+                slotProxies_[rb_index] = buildOccluderProxy(
+                        renderBox.pcd_buffer.data() + (renderBox.chunk_size * rb_index) +
+                        slotFirstPoint_[rb_index],
+                        renderBox.num_points_array[rb_index], occluderOptions_);
+            }
+        });
+    }
+
+    flushChunkReads();
+}
+
+
+void DataEngine::cullOccludedChunks() {
+
+    glm::mat4 viewProj = glm::perspective(camera_.fovy, camera_.aspectRatio,
+                                          camera_.zNear, camera_.zFar) * camera_.viewMatrix_;
+    float eye[3] = {camera_.pos_.x, camera_.pos_.y, camera_.pos_.z};
+    occluderOptions_.focal_length_px = float(height_) / (2.0f * std::tan(camera_.fovy / 2.0f));
+
+    occlusionCuller_.beginFrame(glm::value_ptr(viewProj), eye);
+
+    occluders_.clear();
+    for (size_t i = 0; i < slotProxies_.size(); i++) {
+        if (renderBox.active_indices[i] && !slotProxies_[i].empty()) {
+            occluders_.push_back(&slotProxies_[i]);
+        }
+    }
+    occlusionCuller_.addOccluders(occluders_, occluderOptions_);
+
+    for (size_t i = 0; i < slotOccluded_.size(); i++) {
+        const OctreeNode *held = renderBox.active_indices[i] ? slotHolds_[i] : nullptr;
+        slotOccluded_[i] = held != nullptr && occlusionCuller_.isOccluded(held->bbox);
+
+        bool scheduled = !budgetEnabled_ || slotDrawPoints_[i] > 0;
+        if (slotDeferred_[i] && scheduled && !occlusionCuller_.isOccluded(slotWanted_[i]->bbox)) {
+            slotDeferred_[i] = false;
+            if (slotLoading_[i] == nullptr) {
+                issueChunkRead(static_cast<int>(i));
+            }
+        }
+    }
+
+    flushChunkReads();
+}
+
+
+void DataEngine::scheduleChunks() {
+
+    budgetCandidates_.clear();
+    budgetSlots_.clear();
+    for (int i = 0; i < renderBox.totalCubeSize; i++) {
+        if (slotWanted_[i] != nullptr) {
+            // Chunks past the draw distance are clipped away anyway
+            const BoundingBox &bbox = slotWanted_[i]->bbox;
+            glm::vec3 nearest = glm::clamp(camera_.pos_, glm::vec3(bbox.min_x, bbox.min_y, bbox.min_z),
+                                           glm::vec3(bbox.max_x, bbox.max_y, bbox.max_z));
+            if (glm::distance(nearest, camera_.pos_) > camera_.zFar) {
+                continue;
+            }
+
+            auto points = static_cast<uint32_t>(std::min<int>(slotWanted_[i]->numPoints,
+                                                              renderBox.chunk_size));
+            budgetCandidates_.push_back({slotWanted_[i]->bbox, points});
+            budgetSlots_.push_back(i);
+        }
+    }
+
+    float eye[3] = {camera_.pos_.x, camera_.pos_.y, camera_.pos_.z};
+    pointBudget_.setFocalLength(float(height_) / (2.0f * std::tan(camera_.fovy / 2.0f)));
+
+    std::fill(slotDrawPoints_.begin(), slotDrawPoints_.end(), 0);
+    for (const auto &allocation : pointBudget_.schedule(budgetCandidates_, eye)) {
+        int i = budgetSlots_[allocation.candidate];
+        slotDrawPoints_[i] = allocation.draw_points;
+
+        // Allocations come largest first, so the batch reads what matters most on screen first
+        bool hidden = occlusionEnabled_ && occlusionCuller_.isOccluded(slotWanted_[i]->bbox);
+        if (allocation.draw_points > 0 && slotDeferred_[i] && !hidden) {
+            slotDeferred_[i] = false;
+            if (slotLoading_[i] == nullptr) {
+                issueChunkRead(i);
+            }
+        }
+    }
+
+    flushChunkReads();
+}
+
+
+void DataEngine::cullBricks() {
+
+    glm::mat4 viewProj = glm::perspective(camera_.fovy, camera_.aspectRatio,
+                                          camera_.zNear, camera_.zFar) * camera_.viewMatrix_;
+    frustum_ = frustumFromViewProj(glm::value_ptr(viewProj));
+
+    bool reread = false;
+    for (int i = 0; i < renderBox.totalCubeSize; i++) {
+        const OctreeNode *held = renderBox.active_indices[i] ? slotHolds_[i] : nullptr;
+        const PcdBrick *bricks = chunkBricks(held);
+        slotVisibleBricks_[i] = bricks != nullptr ? visibleBricks(frustum_, bricks, bricksPerChunk_) : 0;
+
+        // A partial read holds the span of bricks that was in view when it was issued. Once a
+        // brick outside it comes into view, the whole chunk is read; the slot goes dark until then.
+        if (bricks == nullptr || held != slotPartial_[i] || held != slotWanted_[i] ||
+            slotLoading_[i] != nullptr) {
+            continue;
+        }
+        BrickRun span = brickSpan(bricks, bricksPerChunk_, slotVisibleBricks_[i]);
+        auto end = std::min<uint32_t>(span.first_point + span.point_count,
+                                      std::min<uint32_t>(held->numPoints, renderBox.chunk_size));
+        uint32_t first = slotFirstPoint_[i];
+        auto count = static_cast<uint32_t>(renderBox.num_points_array[i]);
+        if (span.point_count > 0 && (span.first_point < first || end > first + count)) {
+            renderBox.active_indices[i] = false;
+            issueChunkRead(i);
+            reread = true;
+        }
+    }
+
+    if (reread) {
+        flushChunkReads();
+    }
+
+    if (frameCount_ % kBrickLogInterval == 0) {
+        aout << "[bricks] " << brickCulledPoints_ << " points out of view skipped over the last "
+             << kBrickLogInterval << " frames\n";
+        brickCulledPoints_ = 0;
+    }
+}
+
+
+const PcdBrick *DataEngine::chunkBricks(const OctreeNode *chunk) const {
+
+    if (!bricksEnabled_ || chunk == nullptr ||
+        size_t(chunk->chunkIndex) * bricksPerChunk_ >= chunkBricks_.size()) {
+        return nullptr;
+    }
+    return chunkBricks_.data() + size_t(chunk->chunkIndex) * bricksPerChunk_;
+}
+
+
+size_t DataEngine::slotDrawRuns(int rb_index) {
+
+    uint32_t first = slotFirstPoint_[rb_index];
+    auto count = static_cast<uint32_t>(renderBox.num_points_array[rb_index]);
+    const PcdBrick *bricks = chunkBricks(slotHolds_[rb_index]);
+    if (bricks == nullptr) {
+        slotRuns_[0] = {first, count};
+        return 1;
+    }
+
+    // Runs of bricks in view, cut down to the part of the chunk the slot holds
+    size_t runs = brickRuns(bricks, bricksPerChunk_, slotVisibleBricks_[rb_index], slotRuns_.data());
+    size_t kept = 0;
+    uint32_t drawn = 0;
+    for (size_t r = 0; r < runs; r++) {
+        uint32_t begin = std::max(slotRuns_[r].first_point, first);
+        uint32_t end = std::min(slotRuns_[r].first_point + slotRuns_[r].point_count, first + count);
+        if (begin < end) {
+            slotRuns_[kept++] = {begin, end - begin};
+            drawn += end - begin;
+        }
+    }
+    brickCulledPoints_ += count - drawn;
+    return kept;
+}
+
+
+bool DataEngine::adaptQuality(float frame_ms) {
+
+    if (!quality_.addFrame(frame_ms)) {
+        return false;
+    }
+
+    pointBudget_.setBudget(quality_.pointBudget());
+
+    // The render box keeps its size; chunks past the shorter distance just aren't scheduled
+    camera_.zFar = fullZFar_ * quality_.drawDistance();
+
+    aout << "[adaptQuality] " << quality_.smoothedFrameMs() << " ms against "
+         << quality_.options().target_ms << " ms; quality " << quality_.quality() << ", budget "
+         << quality_.pointBudget() << ", draw distance " << camera_.zFar << ", point size "
+         << quality_.pointSize() << "\n";
+    return true;
+}
+
+
+void DataEngine::updateChunks() {
+    openTilesNear();
+
+    OctreeNode *root = octreeData.root;
+    int maxDepth = octreeData.maxDepth;
+
+    float halfHeight = camera_.zFar * camera_.distScalarY;
+    float halfWidth = halfHeight * camera_.aspectRatio;
+
+
+    glm::vec3 botLeftPos = {
+            camera_.pos_.x - renderBox.cubeSideLength/2,
+            camera_.pos_.y - renderBox.cubeSideLength/2,
+            camera_.pos_.z - renderBox.cubeSideLength
+    };
+
+    glm::vec3 topRightPos = {
+            camera_.pos_.x + renderBox.cubeSideLength/2,
+            camera_.pos_.y + renderBox.cubeSideLength/2,
+            camera_.pos_.z
+    };
+
+    uint32_t posCodeBL = root->getPosCode(botLeftPos, maxDepth);
+    uint32_t posCodeTR = root->getPosCode(topRightPos, maxDepth);
+
+    glm::vec<3, uint32_t, glm::defaultp> indicesBL = getIndices(posCodeBL);
+    glm::vec<3, uint32_t, glm::defaultp> indicesTR = getIndices(posCodeTR);
+
+
+    uint32_t startingIndex = posCodeBL;
+
+    OctreeNode *nodeBL = root->getNodeSoft(posCodeBL, maxDepth);
+
+    // uint32_t bitMaskX
+    int lenX = indicesTR.x - indicesBL.x;
+    int lenY = indicesTR.y - indicesBL.y;
+    int lenZ = indicesTR.z - indicesBL.z;
+
+    uint32_t posCodeTemp = posCodeBL;
+    int rb_index = 0;
+
+    int totalSpan = (lenX+1)*(lenY+1)*(lenZ+1);
+
+    if (totalSpan > renderBox.totalSize) {
+        aout << "Problem: Total Size = " << totalSpan << ", but renderBox.totalSize = "
+             << renderBox.totalSize << "\n";
+
+    } else if ( (renderBox.posCodeBL != posCodeBL) || (renderBox.posCodeTR != posCodeTR) ) {
+
+        // Do the loading stuff
+
+        // Find which chunks are now out of scope, remove those
+        // Find which chunks are now in scope, load those in
+
+        OctreeNode *currNode = nullptr, *prevNode = nullptr;
+
+        int nodes_loaded = 0, nodes_bounced = 0;
+
+        glm::vec<3, uint32_t, glm::defaultp> currIndices = {0, 0, 0};
+        int iX = 0, iY = 0, iZ = 0;
+        int count = 0;
+
+        for (int i = 0; i <= lenZ; i++) {
+            for (int j = 0; j <= lenY; j++) {
+                for (int k = 0; k <= lenX; k ++) {
+
+                    currNode = root->getNodeSoft(posCodeTemp, maxDepth);
+                    currIndices = getIndices(posCodeTemp);
+
+                    iX = currIndices.x % renderBox.bufferDims.x;
+                    iY = currIndices.y % renderBox.bufferDims.y;
+                    iZ = currIndices.z % renderBox.bufferDims.z;
+
+                    rb_index = iX + (renderBox.bufferDims.x * iY)
+                               + (renderBox.bufferDims.y * renderBox.bufferDims.x * iZ);
+
+                    // currIndex falls outside of the previous renderBox bounds -> load the chunk in!
+                    if ( ( (renderBox.indicesBL.x > currIndices.x) || (renderBox.indicesTR.x < currIndices.x) ) ||
+                        ( (renderBox.indicesBL.y > currIndices.y) || (renderBox.indicesTR.y < currIndices.y) ) ||
+                        ( (renderBox.indicesBL.z > currIndices.z) || (renderBox.indicesTR.z < currIndices.z) )
+                    ) {
+
+                    aout << "[updateChunks] Indices = (" <<
+                    currIndices.x << ", " << currIndices.y << ", " <<
+                    currIndices.z << ")\n";
+
+                        if (currNode != nullptr) {
+
+                            if (prevNode == nullptr ||
+                                (currNode->encodedPosition != prevNode->encodedPosition)) {
+
+                                if (count >= 0) {
+                                    aout << "[uC] rb_index = " << rb_index <<
+                                         "; posCodeTemp = " << posCodeTemp <<
+                                         "; currNode->encPos = " << currNode->encodedPosition << "\n";
+                                }
+
+                                // Load the chunk in
+                                queueChunkRead(currNode, rb_index);
+
+                                nodes_loaded++;
+
+                            }
+
+                        }
+
+                    }
+
+                    // Update prevNode
+                    prevNode = root->getNodeSoft(posCodeTemp, maxDepth);
+
+                    posCodeTemp = shiftPosCode(0, posCodeTemp, maxDepth);
+
+                    count++;
+                }
+
+                // Shift posCode back to start in the x direction
+                // Yes this kills me to do but... it's simple and will work
+                for (int k = 0; k <= lenX; k ++) {
+                    posCodeTemp = shiftPosCode(0, posCodeTemp, maxDepth, true);
+                }
+
+                posCodeTemp = shiftPosCode(1, posCodeTemp, maxDepth);
+            }
+
+            // Shift posCode back to start in the x direction
+            // Yes this kills me to do but... it's simple and will work
+            for (int j = 0; j <= lenY; j++) {
+                posCodeTemp = shiftPosCode(1, posCodeTemp, maxDepth, true);
+            }
+            posCodeTemp = shiftPosCode(2, posCodeTemp, maxDepth);
+        }
+
+        flushChunkReads();
+
+        nodes_bounced = totalSpan - nodes_loaded;
+
+        aout << "[updateChunks] Loaded in " << nodes_loaded << " chunks; Bounced " <<
+             nodes_bounced << " chunks.\n";
+
+        // Update renderBox corner indices
+        renderBox.posCodeBL = posCodeBL;
+        renderBox.posCodeTR = posCodeTR;
+        renderBox.indicesBL = {indicesBL.x, indicesBL.y, indicesBL.z};
+        renderBox.indicesTR = {indicesTR.x, indicesTR.y, indicesTR.z};
+    } else {
+        aout << "[uC] No changed needed.\n";
+    }
+}
+
+
+void DataEngine::initRenderBox() {
+
+    float sY = camera_.distScalarY;
+    float sX = sY * camera_.aspectRatio;
+
+    uint32_t max_cap = RenderBox::MAX_CAPACITY;
+
+    float cx = (sX/octreeData.unitBoxDims.x);
+    float cy = (sY/octreeData.unitBoxDims.y);
+    float cz = (1/octreeData.unitBoxDims.z);
+
+    float camZ = 1.f;
+
+    float calc_cap =
+            (ceil(cx*camZ)+1)*(ceil(cy*camZ)+1)*(ceil(cz*camZ)+1);
+
+    bool done = false;
+
+    while (max_cap > calc_cap) {
+        camZ *= 2;
+
+        calc_cap =
+                (ceil(cx*camZ)+1)*(ceil(cy*camZ)+1)*(ceil(cz*camZ)+1);
+    }
+
+    aout << "Bloated camZ = " << camZ << "\n";
+
+    // Now let's find a happy medium
+    float step = camZ/4;
+
+    while (max_cap < calc_cap) {
+        camZ -= step;
+        step /=2;
+
+        calc_cap =
+                (ceil(cx*camZ)+1)*(ceil(cy*camZ)+1)*(ceil(cz*camZ)+1);
+    }
+
+    aout << "Calculated camZ = " << camZ << "\n";
+
+    camera_.zFar = camZ;
+
+    // Update camera target
+    camera_.target_.z = camera_.pos_.z - (camZ/2);
+    camera_.updateViewMatrix();
+
+    float camY = camZ * camera_.distScalarY;
+    float camX = camY * camera_.aspectRatio;
+
+    float CTC_len = sqrt(pow(camX, 2) + pow(camY, 2) + pow(camZ, 2));
+
+    aout << "camX = " << camX << "; camY = " << camY << "; camZ = " << camZ << "\n";
+    // aout << "ratio_x2 = " << ratio_x2 << "; ratio_y2 = " << ratio_y2 << "; ratio_z2 = " << ratio_z2 << "\n";
+    // aout << "Total Cube Size = " << totalCubeSize << "\n";
+
+    renderBox.setDims(camX, camY, camZ, octreeData.unitBoxDims);
+}
+
+
+void DataEngine::initCamera() {
+    // Initialize the Camera
+    glm::vec3 pos = {-15.0f, -15.0f, 8.5f};
+    // glm::vec3 target = {0.0f, 0.0f, 0.0f};
+    // glm::vec3 pos = {-5.0f, -20.0f, 0.f};
+    // glm::vec3 target = {-5.0f, -30.0f, -25.0f};
+    glm::vec3 up = {0.0f, 1.0f, 0.0f};
+    this->camera_ = Camera(pos, up);
+
+    if (stateVars.hasAspectRatio) {
+
+        float ar = float(width_) / float(height_);
+        camera_.setAspectRatio(ar);
+        camera_.calcDistScalar();
+
+        aout << "[initCamera] aspectRatio = " << camera_.aspectRatio
+             << "; distScalar = " << camera_.distScalarY << "\n";
+    }
+}
+
+
+bool DataEngine::openDatasetFile(const std::string &name, ChunkFileRange &file) {
+
+    file = ChunkFileRange();
+    AAsset *asset = AAssetManager_open(app_->activity->assetManager, name.c_str(),
+                                       AASSET_MODE_RANDOM);
+    if (asset != nullptr) {
+        off64_t start = 0, length = 0;
+        file.fd = AAsset_openFileDescriptor64(asset, &start, &length);
+        file.offset = static_cast<uint64_t>(start);
+        file.length = static_cast<uint64_t>(length);
+        AAsset_close(asset);
+        if (file.fd >= 0) {
+            aout << "Reading asset " << name << " in place, at byte " << file.offset
+                 << " of the APK\n";
+            return true;
+        }
+        aout << "Asset " << name << " is compressed; add it to noCompress\n";
+    }
+
+    std::string internal_path(app_->activity->internalDataPath);
+    internal_path.append("/").append(name);
+    aout << "Internal Data Path = " << internal_path << "\n";
+    file = {open(internal_path.c_str(), O_RDONLY | O_CLOEXEC), 0, 0};
+    if (file.fd < 0) {
+        aout << "Failed to open " << internal_path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+
+bool DataEngine::openTileManifest(PcdIndex &index) {
+
+    // Manifests are small and compress well, so unlike the tiles they can be compressed assets
+    std::string error;
+    bool read = false;
+    AAsset *asset = AAssetManager_open(app_->activity->assetManager, datasetName_.c_str(),
+                                       AASSET_MODE_BUFFER);
+    if (asset != nullptr) {
+        const auto *data = static_cast<const char *>(AAsset_getBuffer(asset));
+        if (data != nullptr) {
+            std::istringstream in(std::string(data, AAsset_getLength(asset)));
+            read = readTileManifest(in, manifest_, &error);
+        }
+        AAsset_close(asset);
+    } else {
+        std::string internal_path(app_->activity->internalDataPath);
+        internal_path.append("/").append(datasetName_);
+        read = readTileManifest(internal_path, manifest_, &error);
+    }
+    if (!read) {
+        aout << "Failed to read " << datasetName_ << ": " << error << "\n";
+        return false;
+    }
+
+    tileIndex_ = TileIndex(manifest_);
+    tileOpened_.assign(manifest_.tiles.size(), false);
+    aout << "Tiled dataset: " << manifest_.tiles.size() << " tiles, " << manifest_.chunkCount()
+         << " chunks, " << manifest_.totalPoints() << " points\n";
+
+    FileHeader &header = index.header;
+    header.bounds = manifest_.bounds;
+    header.flags = manifest_.flags;
+    header.total_points = manifest_.totalPoints();
+    header.chunk_count = static_cast<uint32_t>(manifest_.chunkCount());
+    header.chunk_size = manifest_.chunk_size;
+    if (manifest_.flags & PCD_FLAG_BRICKS) {
+        index.bricks_per_chunk = manifest_.bricks_per_chunk;
+        index.bricks.assign(manifest_.chunkCount() * manifest_.bricks_per_chunk, PcdBrick{});
+    }
+    if (manifest_.flags & PCD_FLAG_CHUNK_CRCS) {
+        index.chunk_crcs.assign(manifest_.chunkCount(), 0);
+    }
+
+    openTiledChunkLoader();
+    return true;
+}
+
+
+void DataEngine::openTilesNear() {
+
+    if (manifest_.tiles.empty()) {
+        return;
+    }
+
+    // The box reaches a side ahead of the camera, in front of it or behind
+    float reach = renderBox.cubeSideLength * kTileOpenReach;
+    const glm::vec3 &pos = camera_.pos_;
+    BoundingBox around = {pos.x - reach, pos.y - reach, pos.z - reach,
+                        pos.x + reach, pos.y + reach, pos.z + reach};
+
+    nearTiles_.clear();
+    tileIndex_.query(around, nearTiles_);
+    for (uint32_t tile : nearTiles_) {
+        if (!tileOpened_[tile]) {
+            openTile(tile);
+        }
+    }
+}
+
+
+bool DataEngine::openTile(uint32_t tile) {
+
+    const TileEntry &entry = manifest_.tiles[tile];
+    tileOpened_[tile] = true;
+
+    std::string path = tilePath(datasetName_, entry);
+    ChunkFileRange file;
+    if (!openDatasetFile(path, file)) {
+        return false;
+    }
+
+    // A few KB for a tile's index, read here on the render thread; the payloads stream in
+    // through the loader like any other
+    PcdIndex index;
+    std::string error;
+    bool usable = readPcdIndex(file, index, &error);
+    if (!usable) {
+        aout << "Failed to read " << path << ": " << error << "\n";
+    } else if (index.chunks.size() != entry.chunk_count ||
+               (headerFlags(index.header) & manifest_.flags) != manifest_.flags ||
+               ((manifest_.flags & PCD_FLAG_BRICKS) &&
+                index.bricks_per_chunk != manifest_.bricks_per_chunk)) {
+        aout << path << " doesn't match " << datasetName_ << ", skipped\n";
+        usable = false;
+    } else if (tiledSource_ != nullptr && !tiledSource_->addTile(tile, file)) {
+        aout << "Failed to open " << path << " for chunk reads: " << std::strerror(errno) << "\n";
+        usable = false;
+    }
+    close(file.fd);
+    if (!usable) {
+        return false;
+    }
+
+    OctreeNode *root = octreeData.root;
+    for (const auto &chunk : index.chunks) {
+        root->insert(chunk.bbox, octreeData.absoluteBounds);
+    }
+    root->assignAuxInfo(root, octreeData.maxDepth);
+    root->assignChunkMetadata(index.chunks, octreeData.maxDepth, entry.first_chunk,
+                              tiledOffset(tile, 0));
+
+    // Bricks and CRCs go where the tile's chunk ids say
+    if (bricksEnabled_) {
+        std::copy(index.bricks.begin(), index.bricks.end(),
+                  chunkBricks_.begin() + size_t(entry.first_chunk) * bricksPerChunk_);
+    }
+    if (!chunkCrcs_.empty()) {
+        std::copy(index.chunk_crcs.begin(), index.chunk_crcs.end(),
+                  chunkCrcs_.begin() + entry.first_chunk);
+    }
+
+    aout << "Opened tile " << path << ": " << index.chunks.size() << " chunks ("
+         << (tiledSource_ != nullptr ? tiledSource_->tileCount() : 0) << " of "
+         << manifest_.tiles.size() << " tiles open)\n";
+    return true;
+}
+
+
+void DataEngine::initData() {
+    aout << "Attempting to read in point cloud data...\n";
+
+    // Show another dataset without a rebuild: adb shell setprop debug.rmus.dataset city.tiles.
+    // A tile manifest (see pcd_tile) has its tiles opened as the camera nears them.
+    char dataset[PROP_VALUE_MAX] = {0};
+    datasetName_ = __system_property_get("debug.rmus.dataset", dataset) > 0 ? dataset : kDatasetName;
+    bool tiled = datasetName_.size() > 6 &&
+                 datasetName_.compare(datasetName_.size() - 6, 6, ".tiles") == 0;
+
+    // 1) Open pcd file, or read the tile manifest standing in for it. Chunk payloads are
+    // streamed in batches by the loader thread from here on.
+    PcdIndex index;
+    if (tiled) {
+        if (!openTileManifest(index)) {
+            return;
+        }
+    } else {
+        ChunkFileRange file;
+        if (!openDatasetFile(datasetName_, file)) {
+            return;
+        }
+
+        // 2) Read in file header and chunk metadata. The source keeps its own descriptor.
+        std::string error;
+        if (!readPcdIndex(file, index, &error)) {
+            aout << "Failed to read " << datasetName_ << ": " << error << "\n";
+            close(file.fd);
+            return;
+        }
+        openChunkLoader(file, index.header);
+        close(file.fd);
+    }
+
+    const FileHeader &header = index.header;
+    std::vector<ChunkMetadata> &chunkData = index.chunks;
+    octreeData.absoluteBounds = header.bounds;
+
+    int chunk_count = header.chunk_count;
+    aout << "Initializing dataset... there are [" << chunk_count << "] chunks in the data\n";
+    aout << "Chunk metadata read in... ready to start loading in point cloud data!\n";
+
+    // 3. Build out the Octree structure from the header and chunk metadata. A tiled dataset's
+    // chunks are filed in as their tiles open.
+    OctreeNode *root = new OctreeNode(octreeData.absoluteBounds, 0, 0);
+    octreeData.root = root;
+
+    for (const auto &chunk : chunkData) {
+        root->insert(chunk.bbox, octreeData.absoluteBounds);
+    }
+
+    // 4. Auxilliary data (maxDepth, unitBox, posCodes, num_points, byte_offset)
+    int maxDepth = tiled ? manifest_.depth : root->getMaxDepth(root);
+    aout << "[INIT DATA] maxDepth = " << maxDepth << "\n";
+
+    auto numSlices = (float)exp2(maxDepth);
+    glm::vec3 unitBox = {1,1,1};
+    unitBox.x = (octreeData.absoluteBounds.max_x - octreeData.absoluteBounds.min_x) / numSlices;
+    unitBox.y = (octreeData.absoluteBounds.max_y - octreeData.absoluteBounds.min_y) / numSlices;
+    unitBox.z = (octreeData.absoluteBounds.max_z - octreeData.absoluteBounds.min_z) / numSlices;
+
+    octreeData.maxDepth = maxDepth;
+    octreeData.unitBoxDims = unitBox;
+
+    // Now that the chunks are inserted, let's go back and insert some memory info into them
+    root->assignAuxInfo(root, maxDepth);
+    root->assignChunkMetadata(chunkData, maxDepth);
+
+    // Record chunk reads for pcd_layout: adb shell setprop debug.rmus.trace_loads 1, then pull
+    // chunk_trace.txt from the app's files directory
+    char trace_loads[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.trace_loads", trace_loads);
+    if (std::string(trace_loads) == "1") {
+        std::string trace_path(app_->activity->internalDataPath);
+        trace_path.append("/chunk_trace.txt");
+        if (chunkTrace_.open(trace_path, maxDepth)) {
+            aout << "Recording chunk loads to " << trace_path << "\n";
+        } else {
+            aout << "Failed to open " << trace_path << "\n";
+        }
+    }
+
+    // Draw and read only the bricks of a chunk in view: adb shell setprop debug.rmus.bricks 1.
+    // Needs a dataset written with bricks (point_cloud_generator --bricks).
+    char bricks[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.bricks", bricks);
+    if (std::string(bricks) == "1") {
+        bricksEnabled_ = index.bricks_per_chunk > 0;
+        if (bricksEnabled_) {
+            bricksPerChunk_ = index.bricks_per_chunk;
+            chunkBricks_ = std::move(index.bricks);
+            aout << "Brick culling on, " << bricksPerChunk_ << " bricks per chunk\n";
+        } else {
+            aout << datasetName_ << " has no bricks; brick culling stays off\n";
+        }
+    }
+
+    // Check whole-chunk reads against the file's CRCs unless turned off:
+    // adb shell setprop debug.rmus.verify_crc 0
+    char verify_crc[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.verify_crc", verify_crc);
+    if (!index.chunk_crcs.empty() && std::string(verify_crc) != "0") {
+        chunkCrcs_ = std::move(index.chunk_crcs);
+        aout << "Verifying chunk reads (CRC32C, " << crc32cImplementation() << ")\n";
+    }
+
+    // Skip chunks hidden behind the terrain: adb shell setprop debug.rmus.occlusion 1
+    char occlusion[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.occlusion", occlusion);
+    occlusionEnabled_ = std::string(occlusion) == "1";
+    if (occlusionEnabled_) {
+        aout << "Occlusion culling on, " << occlusionCuller_.width() << "x"
+             << occlusionCuller_.height() << " depth buffer\n";
+    }
+
+    // Skip chunks the GPU finds hidden: adb shell setprop debug.rmus.gl_occlusion 1
+    char gl_occlusion[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.gl_occlusion", gl_occlusion);
+    queriesEnabled_ = std::string(gl_occlusion) == "1";
+
+    // Cap the points drawn per frame: adb shell setprop debug.rmus.point_budget 2000000
+    char point_budget[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.point_budget", point_budget);
+    uint64_t budget = std::strtoull(point_budget, nullptr, 10);
+    budgetEnabled_ = budget > 0;
+    if (budgetEnabled_) {
+        pointBudget_.setBudget(budget);
+        aout << "Point budget on, " << budget << " points per frame\n";
+    }
+
+    // Trade quality for a frame time: adb shell setprop debug.rmus.target_ms 16.6. The point
+    // budget, if set, is the budget at full quality.
+    char target_ms[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.target_ms", target_ms);
+    QualityControllerOptions quality_options;
+    quality_options.target_ms = std::strtof(target_ms, nullptr);
+    adaptiveEnabled_ = quality_options.target_ms > 0.0f;
+    if (adaptiveEnabled_) {
+        if (budgetEnabled_) {
+            quality_options.max_budget = budget;
+            quality_options.min_budget = std::min(quality_options.min_budget, budget);
+        }
+        budgetEnabled_ = true;
+        quality_ = QualityController(quality_options);
+        pointBudget_.setBudget(quality_.pointBudget());
+        aout << "Adaptive quality on, targeting " << quality_options.target_ms << " ms\n";
+    }
+
+    initIngest();
+
+    aout << "Num Slices = " << numSlices << "\n";
+
+
+    aout << "Unit Box Dimensions:\n";
+    aout << "(x, y, z) = (" << unitBox.x << ", " <<
+         unitBox.y << ", " << unitBox.z << ")\n";
+
+
+    // Make sure we have a proper aspect ratio by this point !
+    // Should be taken care of in initCore()
+    initRenderBox();
+    renderBox.initBuffer(header.chunk_size);
+    slotWanted_.assign(renderBox.totalCubeSize, nullptr);
+    slotLoading_.assign(renderBox.totalCubeSize, nullptr);
+    slotHolds_.assign(renderBox.totalCubeSize, nullptr);
+    slotProxies_.assign(renderBox.totalCubeSize, OccluderProxy());
+    slotOccluded_.assign(renderBox.totalCubeSize, false);
+    slotDeferred_.assign(renderBox.totalCubeSize, false);
+    slotDrawPoints_.assign(renderBox.totalCubeSize, 0);
+    slotVisibleBricks_.assign(renderBox.totalCubeSize, 0);
+    slotFirstPoint_.assign(renderBox.totalCubeSize, 0);
+    slotPartial_.assign(renderBox.totalCubeSize, nullptr);
+    slotHiddenChunk_.assign(renderBox.totalCubeSize, nullptr);
+    slotRuns_.resize(bricksPerChunk_ / 2 + 1);
+    fullZFar_ = camera_.zFar;
+
+    // Record the camera's movement for streaming_sim: adb shell setprop debug.rmus.trace_camera 1,
+    // then pull camera_path.txt from the app's files directory
+    char trace_camera[PROP_VALUE_MAX] = {0};
+    __system_property_get("debug.rmus.trace_camera", trace_camera);
+    if (std::string(trace_camera) == "1") {
+        std::string path(app_->activity->internalDataPath);
+        path.append("/camera_path.txt");
+        if (cameraPath_.open(path, renderBox.cubeSideLength)) {
+            aout << "Recording camera path to " << path << "\n";
+        } else {
+            aout << "Failed to open " << path << "\n";
+        }
+    }
+
+    // Fetch chunks, and wait for them so the first frame has something to draw
+    fetchChunks();
+    if (budgetEnabled_) {
+        scheduleChunks();
+    }
+    if (chunkLoader_) {
+        chunkLoader_->waitIdle();
+    }
+    pollChunkReads();
+
+    // 5) Okay, now we get posCode from the target point, and load in
+    // the corresponding node
+
+    aout << "Camera Target: (x, y, z) = (" << camera_.target_.x << ", " <<
+         camera_.target_.y << ", " << camera_.target_.z << ")\n";
+
+    // glm::vec3 target = {-5.0f, -30.0f, -25.0f};
+    uint32_t posCode = root->getPosCode(camera_.target_, maxDepth);
+    aout << "posCode = " << posCode << "\n";
+
+    OctreeNode *desiredNode = root->getNode(posCode, maxDepth);
+    BoundingBox bbox0 = desiredNode->bbox;
+
+
+    // Camera Position = (-5, -20, 0)
+    // Camera Target = (-5, -20, -20)
+    /* Desired Node Box
+     * x -> (-28.30, -2.26)
+     * y -> (-17.89, -13.28)
+     * z -> (-24.16, 1.61)
+    */
+
+    aout << "[initData] node0->BoundingBox: x = ("
+         << bbox0.min_x << ", " << bbox0.max_x
+         << "); y = (" << bbox0.min_y << ", " << bbox0.max_y << ")" <<
+         "; z = (" << bbox0.min_z << ", " << bbox0.max_z << ")\n";
+
+    // Load in this node
+    aout << "Sooooo this OctreeNode here.... octreeNum = " << desiredNode->octantNum
+    << "; depth = " << desiredNode->depth << "\n";
+
+    aout << "OctreeNum Lineage: " << desiredNode->getLineageStr() << "\n";
+
+    desiredNode->printNode();
+
+
+    aout << "We should now have point cloud data\n";
+}
+
+
+void DataEngine::initIngest() {
+
+    char socket_name[PROP_VALUE_MAX] = {0};
+    if (__system_property_get("debug.rmus.ingest", socket_name) <= 0) {
+        return;
+    }
+
+    // The stream's header says where its points are
+    IngestOptions options;
+    ingest_ = std::make_unique<IngestServer>(options);
+    std::string error;
+    if (!ingest_->listen(socket_name, &error)) {
+        aout << "Live ingestion off: " << error << "\n";
+        ingest_.reset();
+        return;
+    }
+
+    liveSlotPoints_ = options.chunk_points;
+    liveChunks_.resize(kLiveChunkSlots);
+    aout << "Live ingestion on " << socket_name << ", " << kLiveChunkSlots << " slots of "
+         << liveSlotPoints_ << " points\n";
+
+    // Chunks leaving the ring are appended to a .pcd that outlives the app, made empty the first
+    // time. Open it as the dataset (debug.rmus.dataset) to look at them again.
+    std::string spill_path(app_->activity->internalDataPath);
+    spill_path.append("/").append(kLiveSpillName);
+    if (access(spill_path.c_str(), F_OK) != 0) {
+        PcdWriter writer;
+        PcdWriteOptions write_options;
+        write_options.chunk_size = options.chunk_points;
+        write_options.chunk_crcs = true;
+        if (!writer.open(spill_path, 0, write_options) || !writer.finish()) {
+            aout << "Failed to create " << spill_path << ": " << writer.error() << "\n";
+        }
+    }
+    liveSpillOpen_ = liveSpill_.open(spill_path);
+    if (liveSpillOpen_) {
+        aout << "Spilling live chunks to " << spill_path << ", which holds "
+             << liveSpill_.index().chunks.size() << " already\n";
+    } else {
+        aout << "Live chunks won't be spilled, so the stream waits once the slots are full: "
+             << liveSpill_.error() << "\n";
+    }
+}
+
+
+void DataEngine::pollIngest() {
+
+    // Chunks that found no slot last frame go first
+    landedLiveSlots_.clear();
+    if (ingestChunks_.size() < kIngestChunksPerFrame) {
+        ingest_->pollChunks(ingestChunks_, kIngestChunksPerFrame - ingestChunks_.size());
+    }
+
+    // No chunk is dropped: the oldest make room by going to the spill file. Without one, the
+    // chunks that don't fit wait here and the rest in the stream, which holds back the sender.
+    uint32_t free_slots = kLiveChunkSlots - liveChunksHeld_;
+    if (ingestChunks_.size() > free_slots && liveSpillOpen_) {
+        spillLiveChunks(static_cast<uint32_t>(ingestChunks_.size()) - free_slots);
+    }
+    size_t taken = std::min<size_t>(ingestChunks_.size(), kLiveChunkSlots - liveChunksHeld_);
+    for (size_t i = 0; i < taken; i++) {
+        liveChunks_[nextLiveSlot_] = std::move(ingestChunks_[i]);
+        landedLiveSlots_.push_back(nextLiveSlot_);
+        nextLiveSlot_ = (nextLiveSlot_ + 1) % kLiveChunkSlots;
+        liveChunksHeld_++;
+    }
+    ingestChunks_.erase(ingestChunks_.begin(), ingestChunks_.begin() + static_cast<ptrdiff_t>(taken));
+
+    if (frameCount_ % kIngestLogInterval == 0) {
+        // Spilled chunks survive a crash from their commit on
+        if (liveSpillOpen_ && !liveSpill_.commit()) {
+            aout << "Stopped spilling live chunks: " << liveSpill_.error() << "\n";
+            liveSpill_.close();
+            liveSpillOpen_ = false;
+        }
+
+        IngestServerStats stats = ingest_->stats();
+        aout << "[ingest] " << stats.ingest.points_in << " points at " << stats.points_per_second
+             << " points/s, " << stats.ingest.chunks_sealed << " chunks sealed, "
+             << stats.ingest.pending_chunks << " pending, " << stats.ingest.stalls << " stalls ("
+             << stats.ingest.stall_seconds << " s), " << liveChunksSpilled_ << " spilled\n";
+    }
+}
+
+
+bool DataEngine::spillLiveChunks(uint32_t count) {
+
+    for (uint32_t i = 0; i < count && liveChunksHeld_ > 0; i++) {
+        uint32_t oldest = (nextLiveSlot_ + kLiveChunkSlots - liveChunksHeld_) % kLiveChunkSlots;
+        IngestChunk &chunk = liveChunks_[oldest];
+        if (!liveSpill_.appendChunk(chunk.points.get(), chunk.point_count, chunk.bbox)) {
+            // Keep what was spilled before this one
+            aout << "Stopped spilling live chunks: " << liveSpill_.error() << "\n";
+            liveSpill_.commit();
+            liveSpill_.close();
+            liveSpillOpen_ = false;
+            return false;
+        }
+        chunk = IngestChunk();
+        liveChunksHeld_--;
+        liveChunksSpilled_++;
+    }
+    return true;
+}
+
+
+void DataEngine::handleInput() {
+    // handle all queued inputs
+    auto *inputBuffer = android_app_swap_input_buffers(app_);
+    if (!inputBuffer) {
+        // no inputs yet.
+        return;
+    }
+
+    // handle motion events (motionEventsCounts can be 0).
+    for (auto i = 0; i < inputBuffer->motionEventsCount; i++) {
+        auto &motionEvent = inputBuffer->motionEvents[i];
+        auto action = motionEvent.action;
+
+        // Find the pointer index, mask and bitshift to turn it into a readable value.
+        auto pointerIndex = (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK)
+                >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+        aout << "Pointer(s): ";
+
+        // get the x and y position of this event if it is not ACTION_MOVE.
+        auto &pointer = motionEvent.pointers[pointerIndex];
+        auto x = GameActivityPointerAxes_getX(&pointer);
+        auto y = GameActivityPointerAxes_getY(&pointer);
+
+        // determine the action type and process the event accordingly.
+        switch (action & AMOTION_EVENT_ACTION_MASK) {
+            case AMOTION_EVENT_ACTION_DOWN:
+            case AMOTION_EVENT_ACTION_POINTER_DOWN:
+                aout << "(" << pointer.id << ", " << x << ", " << y << ") "
+                     << "Pointer Down";
+
+                inState.pPos = {x, y};
+                break;
+
+            case AMOTION_EVENT_ACTION_CANCEL:
+                // treat the CANCEL as an UP event: doing nothing in the app, except
+                // removing the pointer from the cache if pointers are locally saved.
+                // code pass through on purpose.
+            case AMOTION_EVENT_ACTION_UP:
+            case AMOTION_EVENT_ACTION_POINTER_UP:
+                aout << "(" << pointer.id << ", " << x << ", " << y << ") "
+                     << "Pointer Up";
+                break;
+
+            case AMOTION_EVENT_ACTION_MOVE:
+                // There is no pointer index for ACTION_MOVE, only a snapshot of
+                // all active pointers; app needs to cache previous active pointers
+                // to figure out which ones are actually moved.
+                for (auto index = 0; index < motionEvent.pointerCount; index++) {
+                    pointer = motionEvent.pointers[index];
+                    x = GameActivityPointerAxes_getX(&pointer);
+                    y = GameActivityPointerAxes_getY(&pointer);
+                    aout << "(" << pointer.id << ", " << x << ", " << y << ")";
+
+                    if (index != (motionEvent.pointerCount - 1)) aout << ",";
+                    aout << " ";
+                }
+
+                /*
+                if (inState.toggleFlag) {
+                    // Update camera position
+                    float dx = x - inState.pPos[0];
+                    float dy = y - inState.pPos[1];
+
+                    float viewY = camera_.distScalarY * camera_.targetDist;
+                    float viewX = viewY * camera_.aspectRatio;
+
+                    // aout << "[RENDERER] (viewX, viewY) = (" << viewX << ", " << viewY << ")\n";
+                    // aout << "[RENDERER] (dx, dy) = (" << dx << ", " << dy << ")\n";
+
+                    float diffX = (dx/width_);
+                    float diffY = (dy/width_);
+
+                    glm::vec2 tiltVector = {diffX, diffY};
+
+                    // aout << "[RENDERER] (diffX, diffY) = (" << diffX << ", " << diffY << ")\n";
+
+                    // Do the thing
+                    camera_.camTilt(tiltVector);
+                    updateViewMatrix_ = true;
+                }
+                */
+
+                inState.pPos = {x, y};
+
+                aout << "Pointer Move";
+                break;
+            default:
+                aout << "Unknown MotionEvent Action: " << action;
+        }
+        aout << std::endl;
+    }
+    // clear the motion input count in this buffer for main thread to re-use.
+    android_app_clear_motion_events(inputBuffer);
+
+    // handle input key events.
+    for (auto i = 0; i < inputBuffer->keyEventsCount; i++) {
+        auto &keyEvent = inputBuffer->keyEvents[i];
+        aout << "Key: " << keyEvent.keyCode <<" ";
+        switch (keyEvent.action) {
+            case AKEY_EVENT_ACTION_DOWN:
+                aout << "Key Down\n";
+                break;
+            case AKEY_EVENT_ACTION_UP:
+                aout << "Key Up\n";
+
+                switch (keyEvent.keyCode) {
+                    case AKeyEvent('F'): // 'f' key (x++)
+
+                        if (inState.moveCode & 0b1) {
+                            camera_.target_[0]++;
+                            aout << "target.x = " << camera_.target_[0] << "\n";
+                        }
+
+                        if (inState.moveCode & 0b10) {
+                            camera_.pos_[0]++;
+                            aout << "camera.x = " << camera_.pos_[0] << "\n";
+                        }
+
+                        aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                             ", " << camera_.pos_.z << ")\n";
+                        aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                           ", " << camera_.target_.z << ")\n";
+
+                        updateViewMatrix_ = true;
+                        stateVars.cameraMoved = true;
+                        break;
+                    case AKeyEvent('S'): // 's' key (x--)
+                        if (inState.moveCode & 0b1) {
+                            camera_.target_[0]--;
+                            aout << "target.x = " << camera_.target_[0] << "\n";
+                        }
+
+                        if (inState.moveCode & 0b10) {
+                            camera_.pos_[0]--;
+                            aout << "camera.x = " << camera_.pos_[0] << "\n";
+                        }
+
+                        aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                             ", " << camera_.pos_.z << ")\n";
+                        aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                             ", " << camera_.target_.z << ")\n";
+
+                        updateViewMatrix_ = true;
+                        stateVars.cameraMoved = true;
+                        break;
+                    case AKeyEvent('E'): // 'e' key (y++)
+                        if (inState.moveCode & 0b1) {
+                            camera_.target_[1]++;
+                            aout << "target.y = " << camera_.target_[1] << "\n";
+                        }
+
+                        if (inState.moveCode & 0b10) {
+                            camera_.pos_[1]++;
+                            aout << "camera.y = " << camera_.pos_[1] << "\n";
+                        }
+
+                        aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                             ", " << camera_.pos_.z << ")\n";
+                        aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                             ", " << camera_.target_.z << ")\n";
+
+                        updateViewMatrix_ = true;
+                        stateVars.cameraMoved = true;
+                        break;
+                    case AKeyEvent('D'): // 'd' key (y--)
+
+                        if (inState.moveCode & 0b1) {
+                            camera_.target_[1]--;
+                            aout << "target.y = " << camera_.target_[1] << "\n";
+                        }
+
+                        if (inState.moveCode & 0b10) {
+                            camera_.pos_[1]--;
+                            aout << "camera.y = " << camera_.pos_[1] << "\n";
+                        }
+
+                        aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                             ", " << camera_.pos_.z << ")\n";
+                        aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                             ", " << camera_.target_.z << ")\n";
+
+                        updateViewMatrix_ = true;
+                        stateVars.cameraMoved = true;
+                        break;
+                    case AKeyEvent('W'): // 'w' key (z++)
+
+                        if (inState.moveCode & 0b1) {
+                            camera_.target_[2]++;
+                            aout << "target.z = " << camera_.target_[2] << "\n";
+                        }
+
+                        if (inState.moveCode & 0b10) {
+                            camera_.pos_[2]++;
+                            aout << "camera.z = " << camera_.pos_[2] << "\n";
+                        }
+
+                        aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                             ", " << camera_.pos_.z << ")\n";
+                        aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                             ", " << camera_.target_.z << ")\n";
+
+                        updateViewMatrix_ = true;
+                        stateVars.cameraMoved = true;
+                        break;
+                    case AKeyEvent('Q'): // 'q' key (z--)
+
+                        if (inState.moveCode & 0b1) {
+                            camera_.target_[2]--;
+                            aout << "target.z = " << camera_.target_[2] << "\n";
+                        }
+
+                        if (inState.moveCode & 0b10) {
+                            camera_.pos_[2]--;
+                            aout << "camera.z = " << camera_.pos_[2] << "\n";
+                        }
+
+                        aout << "Pos = (" << camera_.pos_.x << ", " << camera_.pos_.y <<
+                             ", " << camera_.pos_.z << ")\n";
+                        aout << "Target = (" << camera_.target_.x << ", " << camera_.target_.y <<
+                             ", " << camera_.target_.z << ")\n";
+
+                        updateViewMatrix_ = true;
+                        stateVars.cameraMoved = true;
+                        break;
+                    case AKeyEvent('T'):
+                        inState.moveTarget = !inState.moveTarget;
+                        inState.moveCode = (inState.moveCode % 0b11)+0b1;
+                        aout << "moveCode = " << (int)inState.moveCode << "\n";
+                        break;
+                    case AKeyEvent('P'):
+                        inState.panFlag = !inState.panFlag;
+                        aout << "Toggling Camera Pan Flag " <<
+                        ((inState.panFlag)? "ON" : "OFF" ) << "\n";
+                        break;
+
+                }
+
+                inState.lastKeyPressed = keyEvent.keyCode;
+
+                break;
+            case AKEY_EVENT_ACTION_MULTIPLE:
+                // Deprecated since Android API level 29.
+                aout << "Multiple Key Actions";
+                break;
+            default:
+                aout << "Unknown KeyEvent Action: " << keyEvent.action;
+        }
+        aout << std::endl;
+    }
+    // clear the key input count too.
+    android_app_clear_key_events(inputBuffer);
+}
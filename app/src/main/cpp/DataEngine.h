@@ -0,0 +1,439 @@
+#ifndef ANDROIDGLINVESTIGATIONS_DATAENGINE_H
+#define ANDROIDGLINVESTIGATIONS_DATAENGINE_H
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+
+#include "RendererState.h"
+#include "OctreeData.h"
+
+#include "PointCloudData.h"
+#include "BrickCulling.h"
+#include "ChunkLoader.h"
+#include "CompressedChunkCache.h"
+#include "ChunkTrace.h"
+#include "CameraPath.h"
+#include "IngestServer.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "PcdAppender.h"
+#include "PointBudget.h"
+#include "QualityController.h"
+#include "RenderBox.h"
+#include "TileManifest.h"
+
+struct android_app;
+
+/*!
+ * One draw out of the render box buffer: @a count points from @a first, of which every
+ * @a step-th is drawn. Points are counted in the buffer, so @a first is also the VBO offset.
+ */
+struct SlotDraw {
+    size_t first;
+    uint32_t count;
+    uint32_t step;
+};
+
+/*!
+ * Everything about the dataset that isn't GL: the camera, the octree and tile index, the render
+ * box and its CPU buffer, the chunk loader and its caches, the culling and budget state, and the
+ * live ingest stream. It lives as long as the activity, so a Renderer made for a new window
+ * uploads what's resident from here instead of reading the file again.
+ */
+class DataEngine {
+public:
+    //! Default budget for the compressed chunk tier, overridden by debug.rmus.compressed_mb
+    static constexpr size_t kCompressedTierBytes = 64 * 1024 * 1024;
+
+    //! Frames between logs of the point budget and the points actually drawn
+    static constexpr uint32_t kBudgetLogInterval = 120;
+
+    //! The widest vertex attribute stride every GLES 3.1 GPU takes, for drawList() until the
+    //! Renderer says otherwise
+    static constexpr size_t kMinVertexAttribStride = 2048;
+
+    //! Live chunks kept on screen from the ingest stream. Once they're all taken, the oldest is
+    //! spilled to kLiveSpillName before the next takes its slot.
+    static constexpr uint32_t kLiveChunkSlots = 256;
+
+    //! Sealed live chunks taken from the stream per frame, so a burst can't stall a frame
+    static constexpr size_t kIngestChunksPerFrame = 8;
+
+    //! Frames between logs of the ingest stream's throughput and backpressure
+    static constexpr uint32_t kIngestLogInterval = 120;
+
+    //! Frames between logs of the points brick culling kept out of the draws
+    static constexpr uint32_t kBrickLogInterval = 120;
+
+    //! Tiles are opened once the camera is this many render box sides from them, so their index
+    //! is in before the box reaches them
+    static constexpr float kTileOpenReach = 1.5f;
+
+    /*!
+     * @param pApp the android_app this engine belongs to, for its assets, files directory and
+     * input queue
+     */
+    inline explicit DataEngine(android_app *pApp) :
+            app_(pApp),
+            camera_(),
+            inState() {
+    }
+
+    ~DataEngine();
+
+    /*!
+     * Handles input from the android_app.
+     *
+     * Note: this will clear the input queue
+     */
+    void handleInput();
+
+    /*!
+     * Sets the size of the window the dataset is drawn to, which the camera's aspect ratio and the
+     * screen space estimates of culling and the point budget go by. Called by each new Renderer
+     * before load(), and whenever the window changes size.
+     */
+    void setViewport(int width, int height);
+
+    /*!
+     * Opens the dataset and streams in the first chunks, waiting for them so the first frame has
+     * something to draw. Nothing here touches GL.
+     */
+    void load();
+
+    [[nodiscard]] bool isLoaded() const { return loaded_; }
+
+    /*!
+     * Applies camera movement from input to the view matrix.
+     * @return true if the view matrix changed
+     */
+    bool updateView();
+
+    /*!
+     * Culls, schedules and streams for this frame's view: issues the reads the camera's movement
+     * calls for and picks up the reads and live chunks that landed. Called once per frame, before
+     * drawList().
+     */
+    void update();
+
+    /*!
+     * Feeds the last frame's time to the quality controller and applies its point budget and draw
+     * distance when they change. Runs every frame when debug.rmus.target_ms is set.
+     * @return true if the draw distance and point size changed
+     */
+    bool adaptQuality(float frame_ms);
+
+    /*!
+     * The draws for this frame: every resident slot that isn't hidden, cut down to the bricks in
+     * view, every n-th point under a point budget.
+     */
+    const std::vector<SlotDraw> &drawList();
+
+    // Slots whose reads landed in the last update(), to be uploaded
+    [[nodiscard]] const std::vector<int> &landedSlots() const { return landedSlots_; }
+
+    [[nodiscard]] const Camera &camera() const { return camera_; }
+    [[nodiscard]] uint32_t frameCount() const { return frameCount_; }
+
+    // The render box buffer: every slot's points, chunk_size apart
+    [[nodiscard]] const cpoint_t *points() const { return renderBox.pcd_buffer.data(); }
+    [[nodiscard]] size_t pointCapacity() const { return renderBox.pcd_buffer.capacity(); }
+    [[nodiscard]] int slotCount() const { return renderBox.totalCubeSize; }
+    [[nodiscard]] bool slotResident(int rb_index) const { return renderBox.active_indices[rb_index]; }
+
+    // The points of slot @a rb_index its chunk filled, @a first counted from the buffer's start
+    void slotPoints(int rb_index, size_t &first, uint32_t &count) const;
+
+    // The chunk slot @a rb_index should hold, nullptr if none
+    [[nodiscard]] const OctreeNode *slotWanted(int rb_index) const { return slotWanted_[rb_index]; }
+
+    // Hardware occlusion queries: the chunk the last answer found hidden in a slot
+    [[nodiscard]] bool queriesEnabled() const { return queriesEnabled_; }
+    [[nodiscard]] const OctreeNode *slotHidden(int rb_index) const { return slotHiddenChunk_[rb_index]; }
+    void setSlotHidden(int rb_index, const OctreeNode *chunk) { slotHiddenChunk_[rb_index] = chunk; }
+
+    /*!
+     * Sets the widest vertex attribute stride the GPU takes, which caps how thin drawList()
+     * makes a slot: every n-th point is drawn with a stride of n points.
+     */
+    void setMaxDrawStride(size_t bytes) {
+        maxDrawStep_ = std::max<uint32_t>(static_cast<uint32_t>(bytes / sizeof(cpoint_t)), 1);
+    }
+
+    [[nodiscard]] bool adaptiveEnabled() const { return adaptiveEnabled_; }
+    [[nodiscard]] float pointSize() const { return adaptiveEnabled_ ? quality_.pointSize() : 1.0f; }
+
+    // Live ingestion: the ring of live chunks, and the ones that landed in the last update()
+    [[nodiscard]] bool ingestEnabled() const { return ingest_ != nullptr; }
+    [[nodiscard]] const std::vector<IngestChunk> &liveChunks() const { return liveChunks_; }
+    [[nodiscard]] uint32_t liveSlotPoints() const { return liveSlotPoints_; }
+    [[nodiscard]] const std::vector<uint32_t> &landedLiveSlots() const { return landedLiveSlots_; }
+
+private:
+
+    void initCamera();
+
+    void initData();
+
+    void setRenderBox();
+
+    void initRenderBox();
+
+    /*!
+     * Opens @a name straight out of the APK if it's stored there uncompressed, so it never has
+     * to be copied out first, and otherwise from the app's files directory.
+     * @return false if neither has it; @a file then holds no descriptor
+     */
+    bool openDatasetFile(const std::string &name, ChunkFileRange &file);
+
+    /*!
+     * Reads the tile manifest named by datasetName_ and opens the loader every tile will share.
+     * @a index stands in for a single file's: the whole dataset's header, no chunks yet, and
+     * bricks and CRCs for every chunk id, filled in by openTile() as tiles open.
+     */
+    bool openTileManifest(PcdIndex &index);
+
+    /*!
+     * Opens the tiles within kTileOpenReach render box sides of the camera that aren't yet:
+     * reads each one's index and files its chunks into the octree. Called before the box is
+     * laid over the octree.
+     */
+    void openTilesNear();
+
+    // @return false if the tile can't be read or doesn't match the manifest; it isn't retried
+    bool openTile(uint32_t tile);
+
+    /*!
+     * Opens the dataset for chunk reads with the backend named by the debug.rmus.io_backend
+     * system property (pread, mmap or io_uring), falling back to pread. Setting
+     * debug.rmus.direct_io to 1 bypasses the page cache for files with aligned payloads.
+     * @a file is the dataset on its own, or its range of the APK.
+     */
+    void openChunkLoader(const ChunkFileRange &file, const FileHeader &header);
+
+    // The pread pool of a tiled dataset, which reads every tile; tiles join it as they open
+    void openTiledChunkLoader();
+
+    // Sets up chunkLoader_ and the compressed tier for reads of at most @a chunkSize points
+    void startChunkLoader(std::unique_ptr<ChunkSource> source, bool directIO, uint32_t chunkSize);
+
+    /*!
+     * Queues a read of @a chunk into render box slot @a rb_index. Nothing is read until
+     * flushChunkReads(), so a whole box update goes to the loader as one batch. If the slot
+     * still has a read in flight, it's cancelled if still queued, and the new chunk is read once
+     * that one lands.
+     * Chunks in the compressed tier are decoded instead of read, and whatever the slot held
+     * before is compressed into the tier on its way out.
+     */
+    void queueChunkRead(OctreeNode *chunk, int rb_index);
+
+    void issueChunkRead(int rb_index);
+
+    void flushChunkReads();
+
+    /*!
+     * Ranks a read by how large its chunk is on screen from where the camera is now, and marks
+     * reads the GPU last found hidden as prefetches, so reads for what's in view go first.
+     */
+    void prioritizeChunkRead(const OctreeNode *chunk, int rb_index, float &priority,
+                             bool &prefetch) const;
+
+    // Reranks the reads still queued in the loader after the camera moves
+    void reprioritizeChunkReads();
+
+    /*!
+     * Activates slots whose reads have landed and lists them in landedSlots_ for the Renderer to
+     * upload. Called every frame, so chunk streaming never stalls rendering.
+     */
+    void pollChunkReads();
+
+    /*!
+     * Rasterizes the occluder proxies of loaded chunks for the current view, marks the slots they
+     * hide so they aren't drawn, and issues reads that were held back while their chunk was
+     * hidden. Runs every frame when debug.rmus.occlusion is set to 1.
+     */
+    void cullOccludedChunks();
+
+    /*!
+     * Ranks the render box's chunks by their size on screen and splits the point budget between
+     * them, then issues the held back reads of the chunks that made the cut, largest first.
+     * Runs every frame when debug.rmus.point_budget is set.
+     */
+    void scheduleChunks();
+
+    /*!
+     * Tests the bricks of every held chunk against this frame's view, so draws skip the ones out
+     * of view, and reads the whole chunk into slots that hold only some of its bricks once the
+     * others come into view. Runs every frame when debug.rmus.bricks is set to 1 and the dataset
+     * has bricks.
+     */
+    void cullBricks();
+
+    // The bricks of @a chunk, or nullptr without brick culling
+    const PcdBrick *chunkBricks(const OctreeNode *chunk) const;
+
+    /*!
+     * Fills slotRuns_ with the point ranges of slot @a rb_index to draw, relative to the slot's
+     * start: the part of its chunk it holds, less the bricks out of view.
+     * @return the number of ranges
+     */
+    size_t slotDrawRuns(int rb_index);
+
+    /*!
+     * Opens the live point stream socket named by the debug.rmus.ingest system property, e.g.
+     * @rmus_ingest for the abstract namespace. Called from initData.
+     */
+    void initIngest();
+
+    /*!
+     * Takes up to kIngestChunksPerFrame sealed chunks from the stream into the live slots after
+     * the last one, spilling the oldest ones first to make room. Without a spill file it takes
+     * only as many as there are free slots, and the rest wait in the stream. Runs every frame
+     * when debug.rmus.ingest is set.
+     */
+    void pollIngest();
+
+    /*!
+     * Appends the @a count oldest live chunks to the spill file and frees their slots.
+     * @return false if the file can't be written; the spill file is closed then and the chunk
+     *         that failed keeps its slot
+     */
+    bool spillLiveChunks(uint32_t count);
+
+    void fetchChunks();
+
+    void updateChunks();
+
+    void fetchChunks2();
+
+    glm::vec<3, uint32_t, glm::defaultp> getIndices(uint32_t posCode);
+
+    glm::vec3 getIndicesFloat(glm::vec3 point);
+
+
+    android_app *app_;
+    Camera camera_;
+    int width_ = 0;
+    int height_ = 0;
+    bool loaded_ = false;
+
+    // Set by input, cleared once updateView() applies it
+    bool updateViewMatrix_ = true;
+    InputEventState inState;
+    RendStateVars stateVars;
+
+    BoundingBox absoluteBounds;
+    std::vector<glm::vec2> renderBoxes;
+    OctreeData octreeData;
+
+    // The .pcd or tile manifest being shown, from debug.rmus.dataset or kDatasetName
+    std::string datasetName_;
+
+    // Tiled datasets: the manifest, the index over its tiles' bounds, the tiles opened (or that
+    // failed to), and the loader's source, which tiles are added to as they open
+    TileManifest manifest_;
+    TileIndex tileIndex_;
+    std::vector<bool> tileOpened_;
+    std::vector<uint32_t> nearTiles_;
+    TiledChunkSource *tiledSource_ = nullptr;
+
+    std::unique_ptr<ChunkLoader> chunkLoader_;
+    std::vector<ChunkLoadRequest> pendingReads_;
+    std::vector<ChunkLoadResult> finishedReads_;
+    std::vector<CompressedChunk> demotedChunks_;
+    std::vector<ChunkLoadPriority> readPriorities_;
+
+    // Per render box slot: the chunk it should hold, the chunk being read into it, and the chunk
+    // whose points are in its buffer now
+    std::vector<const OctreeNode *> slotWanted_;
+    std::vector<const OctreeNode *> slotLoading_;
+    std::vector<const OctreeNode *> slotHolds_;
+
+    // Recently evicted chunks, kept compressed so panning back doesn't go to flash
+    CompressedChunkCache compressedChunks_{kCompressedTierBytes};
+
+    // Per-chunk CPU work spread over the big cores; the render thread helps while it waits
+    JobSystem jobs_;
+
+    // Slots whose read landed in the last poll, waiting on an upload and a proxy
+    std::vector<int> landedSlots_;
+
+    // Software occlusion culling: a proxy per loaded slot, the slots hidden this frame, and the
+    // slots whose read waits until their chunk comes out from behind the terrain
+    bool occlusionEnabled_ = false;
+    OcclusionCuller occlusionCuller_;
+    OccluderOptions occluderOptions_;
+    std::vector<OccluderProxy> slotProxies_;
+    std::vector<const OccluderProxy *> occluders_;
+    std::vector<bool> slotOccluded_;
+    std::vector<bool> slotDeferred_;
+
+    // Hardware occlusion queries, which the Renderer runs: per slot the chunk the last answer
+    // found hidden
+    bool queriesEnabled_ = false;
+    std::vector<const OctreeNode *> slotHiddenChunk_;
+
+    // Point budget: per slot the points to draw, 0 for chunks that didn't make the cut and aren't
+    // read, and the slot behind each candidate handed to the scheduler
+    bool budgetEnabled_ = false;
+    PointBudgetScheduler pointBudget_;
+    std::vector<uint32_t> slotDrawPoints_;
+    std::vector<BudgetCandidate> budgetCandidates_;
+    std::vector<int> budgetSlots_;
+    uint64_t drawnPoints_ = 0;
+    uint32_t maxDrawStep_ = kMinVertexAttribStride / sizeof(cpoint_t);
+
+    // Brick culling: every chunk's bricks from the file, this frame's view, and per slot the
+    // held chunk's bricks in view. A chunk coming into the box reads only the bricks in view
+    // then; the slot remembers which point of its chunk the read started at, and that it holds
+    // part of it.
+    bool bricksEnabled_ = false;
+    uint32_t bricksPerChunk_ = 0;
+    std::vector<PcdBrick> chunkBricks_;
+    ViewFrustum frustum_{};
+    std::vector<uint64_t> slotVisibleBricks_;
+    std::vector<uint32_t> slotFirstPoint_;
+    std::vector<const OctreeNode *> slotPartial_;
+    std::vector<BrickRun> slotRuns_;
+    uint64_t brickCulledPoints_ = 0;  // Since the last log
+
+    std::vector<SlotDraw> drawList_;
+
+    // Every chunk's CRC32C from the file, checked by the loader on whole-chunk reads. Empty if
+    // the file has none or checking is off.
+    std::vector<uint32_t> chunkCrcs_;
+
+    // Adaptive quality: the controller and the draw distance it scales
+    bool adaptiveEnabled_ = false;
+    QualityController quality_;
+    float fullZFar_ = 0.0f;
+
+    // Live ingestion: the stream's server, and a ring of live slots with their chunks kept on
+    // the CPU so a new Renderer can upload them again. Chunks leaving the ring are appended to
+    // the spill file, committed every kIngestLogInterval frames and when the engine goes.
+    std::unique_ptr<IngestServer> ingest_;
+    std::vector<IngestChunk> ingestChunks_;
+    std::vector<IngestChunk> liveChunks_;
+    std::vector<uint32_t> landedLiveSlots_;
+    uint32_t liveSlotPoints_ = 0;
+    uint32_t nextLiveSlot_ = 0;
+    uint32_t liveChunksHeld_ = 0;
+    PcdAppender liveSpill_;
+    bool liveSpillOpen_ = false;
+    uint64_t liveChunksSpilled_ = 0;
+
+    // Chunk reads by frame, when debug.rmus.trace_loads is set
+    ChunkTraceWriter chunkTrace_;
+
+    // Camera poses as it moves, when debug.rmus.trace_camera is set
+    CameraPathWriter cameraPath_;
+    uint32_t frameCount_ = 0;
+
+    RenderBox renderBox;
+};
+
+#endif //ANDROIDGLINVESTIGATIONS_DATAENGINE_H
@@ -4,6 +4,7 @@
 
 #include "Octree.h"
 #include "AndroidOut.h"
+#include "Morton.h"
 
 #include <sstream>
 #include <iterator>
@@ -60,7 +61,8 @@ void OctreeNode::assignAuxInfo(OctreeNode *node, int maxDepth) {
 }
 
 
-void OctreeNode::assignChunkMetadata(std::vector<ChunkMetadata> chunkData, int maxDepth) {
+void OctreeNode::assignChunkMetadata(const std::vector<ChunkMetadata> &chunkData, int maxDepth,
+                                     uint32_t firstChunk, uint64_t offsetBase) {
 
     for (int i = 0; i<chunkData.size(); i++) {
         glm::vec3 chunkCenter;
@@ -70,8 +72,9 @@ void OctreeNode::assignChunkMetadata(std::vector<ChunkMetadata> chunkData, int m
 
         OctreeNode *node = getNodeSoft(posCode, maxDepth);
 
-        node->byteOffset = chunkData[i].file_offset;
+        node->byteOffset = offsetBase + chunkData[i].file_offset;
         node->numPoints = chunkData[i].point_count;
+        node->chunkIndex = firstChunk + i;
     }
 
 }
@@ -299,36 +302,7 @@ uint32_t OctreeNode::getPosCode(glm::vec3 point, int maxDepth) {
 
 
 uint32_t OctreeNode::getPosCodeExact(glm::vec3 point, BoundingBox absoluteBounds, int maxDepth) {
-
-    uint32_t posCode = 0;
-
-    auto numSlices = (float)exp2(maxDepth);
-
-    glm::vec3 unitBox;
-    unitBox.x = (absoluteBounds.max_x - absoluteBounds.min_x) / numSlices;
-    unitBox.y = (absoluteBounds.max_y - absoluteBounds.min_y) / numSlices;
-    unitBox.z = (absoluteBounds.max_z - absoluteBounds.min_z) / numSlices;
-
-    auto unitsX = (uint32_t)floor((point.x - absoluteBounds.min_x)/unitBox.x);
-    auto unitsY = (uint32_t)floor((point.y - absoluteBounds.min_y)/unitBox.y);
-    auto unitsZ = (uint32_t)floor((point.z - absoluteBounds.min_z)/unitBox.z);
-
-    // aout << "getPCE() :: (ux, uy, uz) = (" << unitsX << ", " << unitsY
-    // << ", " << unitsZ << ")\n";
-
-    for (int i = 0; i<maxDepth; i++) {
-
-        uint32_t bitX = unitsX & ( 1 << (maxDepth - i - 1) );
-        uint32_t bitY = unitsY & ( 1 << (maxDepth - i - 1) );
-        uint32_t bitZ = unitsZ & ( 1 << (maxDepth - i - 1) );
-
-        uint32_t octant = (bitZ << 2) | (bitY << 1) | bitX;
-
-        posCode |= (octant) << ( 2*(maxDepth - i - 1) );
-
-    }
-
-    return posCode;
+    return mortonCell(point.x, point.y, point.z, absoluteBounds, maxDepth);
 }
 
 
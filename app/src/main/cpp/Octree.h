@@ -8,7 +8,7 @@
 #include <vector>
 #include "glm/glm.hpp"
 
-#include "../../../../tools/PointCloudData.h"
+#include "PointCloudData.h"
 
 // Octree node for spatial organization
 struct OctreeNode {
@@ -25,6 +25,7 @@ struct OctreeNode {
     // Put these in aux info
     uint64_t byteOffset;
     uint32_t numPoints;
+    uint32_t chunkIndex = UINT32_MAX;  // Position in the file's chunk index, or its global id in a tiled dataset
 
     // Must be called on by the root node, which has the full bounding box
     uint32_t getPosCode(glm::vec3 point, int maxDepth);
@@ -37,7 +38,10 @@ struct OctreeNode {
 
     void assignAuxInfo(OctreeNode *node, int maxDepth);
 
-    void assignChunkMetadata(std::vector<ChunkMetadata> chunkData, int maxDepth);
+    // Chunk i of @a chunkData gets chunk id firstChunk + i and byte offset offsetBase plus its
+    // own, for the chunks of one tile of a tiled dataset
+    void assignChunkMetadata(const std::vector<ChunkMetadata> &chunkData, int maxDepth,
+                             uint32_t firstChunk = 0, uint64_t offsetBase = 0);
 
     int getMaxDepth(OctreeNode *node);
 
@@ -9,7 +9,7 @@
 
 #include "Octree.h"
 
-#include "../../../../tools/PointCloudData.h"
+#include "PointCloudData.h"
 
 class OctreeData {
 
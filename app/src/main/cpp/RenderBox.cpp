@@ -35,11 +35,8 @@ void RenderBox::setDims(float camX, float camY, float camZ, glm::vec3 unitBox) {
 
     aout << "[setDims] Total Cube Volume = " << totalCubeSize << "\n";
 
-    active_indices.reserve(totalCubeSize);
-    std::fill(active_indices.begin(), active_indices.end(), false);
-
-    num_points_array.reserve(totalCubeSize);
-    std::fill(num_points_array.begin(), num_points_array.end(), 0);
+    active_indices.assign(totalCubeSize, false);
+    num_points_array.assign(totalCubeSize, 0);
 
     // pcd_buffer.reserve(totalSize);
     setBitMasks();
@@ -7,7 +7,7 @@
 
 #include <vector>
 
-#include "../../../../tools/PointCloudData.h"
+#include "PointCloudData.h"
 #include "glm/vec3.hpp"
 
 using cpoint_t = struct Point;
@@ -3,29 +3,37 @@
 
 #include <EGL/egl.h>
 #include <memory>
-
-#include <fstream>
+#include <vector>
 
 #include "Model.h"
 #include "Shader.h"
 
-#include "Camera.h"
-
-#include "RendererState.h"
-#include "OctreeData.h"
-
-
-#include "../../../../tools/PointCloudData.h"
-#include "RenderBox.h"
+#include "DataEngine.h"
 
 struct android_app;
 
+/*!
+ * Draws what a DataEngine holds into one window. A Renderer lives as long as its window: it's
+ * made on APP_CMD_INIT_WINDOW with a fresh EGL context and deleted on APP_CMD_TERM_WINDOW, while
+ * the engine, with the dataset and everything streamed in, carries on to the next one.
+ */
 class Renderer {
 public:
+    //! Frames between occlusion queries for chunks that were visible; hidden ones are queried
+    //! every frame
+    static constexpr uint32_t kVisibleQueryInterval = 8;
+
+    //! GPU timer queries in flight; a frame's GPU time is read this many frames later
+    static constexpr uint32_t kFrameTimerQueries = 4;
+
     /*!
+     * Creates the context for the app's current window and uploads the engine's resident chunks
+     * into it, opening the engine first if this is the first window.
      * @param pApp the android_app this Renderer belongs to, needed to configure GL
+     * @param engine the dataset to draw; it must outlive the Renderer
      */
-    inline explicit Renderer(android_app *pApp) :
+    inline Renderer(android_app *pApp, DataEngine &engine) :
+            engine_(engine),
             app_(pApp),
             display_(EGL_NO_DISPLAY),
             surface_(EGL_NO_SURFACE),
@@ -36,21 +44,12 @@ public:
             updateViewMatrix_(true),
             shader_program_(0),
             vao_(0),
-            vbo_(0),
-            camera_(),
-            inState() {
+            vbo_(0) {
         initRenderer();
     }
 
     virtual ~Renderer();
 
-    /*!
-     * Handles input from the android_app.
-     *
-     * Note: this will clear the input queue
-     */
-    void handleInput();
-
     /*!
      * Renders all the models in the renderer
      */
@@ -58,13 +57,24 @@ public:
 
 private:
 
+    /*!
+     * Creates the display, the window surface and a GLES 3 context, and makes them current.
+     */
     void initCore();
 
     void initShaders();
 
-    void initCamera();
+    /*!
+     * Creates the VAO, VBO, occlusion queries and frame timers in the current context, sets the
+     * uniforms that don't change per frame and uploads what the engine has resident.
+     */
+    void initGpuResources();
+
+    // Copies each of the engine's active slots from its CPU buffer into the bound VBO
+    void uploadResidentSlots();
 
-    void initData();
+    // Copies the slots whose reads landed in the engine's last update() into the VBO
+    void uploadLandedSlots();
 
     /*!
      * Performs necessary OpenGL initialization. Customize this if you want to change your EGL
@@ -78,51 +88,90 @@ private:
      */
     void updateRenderArea();
 
+    /*!
+     * Creates the bounding box program, the unit cube and a query object per render box slot.
+     * Called from initGpuResources when the engine has debug.rmus.gl_occlusion on.
+     */
+    void initOcclusionQueries();
 
-    void setRenderBox();
+    /*!
+     * Picks up the answers of earlier occlusion queries that are ready, without waiting for the
+     * ones that aren't, so a query's answer lands a frame or more after it was issued.
+     */
+    void collectOcclusionQueries();
 
-    void initRenderBox();
+    /*!
+     * Draws the bounding boxes of chunks that weren't drawn this frame inside occlusion queries,
+     * against the depth the drawn chunks left. Visible chunks are rechecked every
+     * kVisibleQueryInterval frames, staggered across slots.
+     */
+    void issueOcclusionQueries();
 
-    void loadChunk(OctreeNode *chunk);
+    /*!
+     * Creates the GPU timer queries if GL_EXT_disjoint_timer_query is there. Without them only
+     * the CPU side of a frame is measured.
+     */
+    void initFrameTimers();
 
-    void fetchChunks();
+    /*!
+     * Hands the last frame's time, the longer of @a cpu_ms and the newest GPU time available, to
+     * the engine's quality controller, and applies its draw distance and point size when they
+     * change. Runs every frame when debug.rmus.target_ms is set.
+     */
+    void adaptQuality(float cpu_ms);
 
-    void updateChunks();
+    // Creates the live chunk VBO and uploads the live chunks the engine keeps on the CPU
+    void initLiveBuffer();
 
-    void fetchChunks2();
+    // Uploads the live chunks that landed in the engine's last update()
+    void uploadLiveChunks();
 
-    glm::vec<3, uint32_t, glm::defaultp> getIndices(uint32_t posCode);
+    void drawLiveChunks();
 
-    glm::vec3 getIndicesFloat(glm::vec3 point);
 
+    DataEngine &engine_;
 
     android_app *app_;
     EGLDisplay display_;
+    EGLConfig config_ = nullptr;
     EGLSurface surface_;
     EGLContext context_;
     EGLint width_;
     EGLint height_;
-    Camera camera_;
 
 
     bool shaderNeedsNewProjectionMatrix_;
     bool updateViewMatrix_;
-    InputEventState inState;
-    RendStateVars stateVars;
-    
+
     // Example: Simple triangle rendering
     GLuint shader_program_;
     GLuint vao_;
     GLuint vbo_;
 
-    BoundingBox absoluteBounds;
-    std::vector<glm::vec2> renderBoxes;
-    OctreeData octreeData;
-
-    std::ifstream pcd_file;
-    std::ifstream pcd_file_dbg;
-
-    RenderBox renderBox;
+    // Hardware occlusion queries: per slot, the query object and the chunk the query in flight
+    // was issued for. The answers go to the engine.
+    bool queriesEnabled_ = false;
+    GLuint box_program_ = 0;
+    GLuint boxVao_ = 0;
+    GLuint boxVbo_ = 0;
+    std::vector<GLuint> slotQueries_;
+    std::vector<const OctreeNode *> slotQueryChunk_;
+
+    // Chunks are drawn as line strips, or as points sized by the engine's quality controller when
+    // it's on, so that thinning them can be made up for with larger points
+    GLenum chunkDrawMode_ = GL_LINE_STRIP;
+
+    // A ring of GPU timer queries for adaptive quality, with the newest GPU frame time they
+    // produced
+    bool timersEnabled_ = false;
+    GLuint frameTimers_[kFrameTimerQueries] = {};
+    bool frameTimerIssued_[kFrameTimerQueries] = {};
+    uint32_t frameTimerNext_ = 0;
+    float gpuFrameMs_ = 0.0f;
+
+    // The engine's live chunks, one slot of its ring after another
+    GLuint liveVao_ = 0;
+    GLuint liveVbo_ = 0;
 };
 
-#endif //ANDROIDGLINVESTIGATIONS_RENDERER_H
\ No newline at end of file
+#endif //ANDROIDGLINVESTIGATIONS_RENDERER_H
@@ -1,12 +1,23 @@
 #include <jni.h>
 
 #include "AndroidOut.h"
+#include "DataEngine.h"
 #include "Renderer.h"
 
 #include <game-activity/GameActivity.cpp>
 #include <game-text-input/gametextinput.cpp>
 
 #include <fstream>
+#include <memory>
+
+/*!
+ * What android_main keeps in userData: the engine, made once and kept for the whole activity,
+ * and a renderer for the current window, if there is one.
+ */
+struct AppState {
+    std::unique_ptr<DataEngine> engine;
+    std::unique_ptr<Renderer> renderer;
+};
 
 extern "C" {
 
@@ -19,25 +30,20 @@ extern "C" {
  * @param cmd the command to handle
  */
 void handle_cmd(android_app *pApp, int32_t cmd) {
+    // Remember to change all instances of userData if you change the class here as a
+    // reinterpret_cast is dangerous this in the android_main function.
+    auto *state = reinterpret_cast<AppState *>(pApp->userData);
     switch (cmd) {
         case APP_CMD_INIT_WINDOW:
-            // A new window is created, associate a renderer with it. You may replace this with a
-            // "game" class if that suits your needs. Remember to change all instances of userData
-            // if you change the class here as a reinterpret_cast is dangerous this in the
-            // android_main function and the APP_CMD_TERM_WINDOW handler case.
-            pApp->userData = new Renderer(pApp);
+            // A new window is created. Its renderer opens the dataset the first time; after that
+            // it uploads what the engine already has.
+            state->renderer = std::make_unique<Renderer>(pApp, *state->engine);
             break;
         case APP_CMD_TERM_WINDOW:
-            // The window is being destroyed. Use this to clean up your userData to avoid leaking
-            // resources.
-            //
-            // We have to check if userData is assigned just in case this comes in really quickly
-            if (pApp->userData) {
-                //
-                auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
-                pApp->userData = nullptr;
-                delete pRenderer;
-            }
+            // The window is being destroyed, on every app switch and screen off. The renderer and
+            // its context go with it; the engine keeps the dataset, caches and loader threads so
+            // coming back doesn't reload them.
+            state->renderer.reset();
             break;
         default:
             break;
@@ -66,6 +72,11 @@ void android_main(struct android_app *pApp) {
     // Can be removed, useful to ensure your code is running
     aout << "Welcome to android_main" << std::endl;
 
+    // The engine outlives every window; handle_cmd makes a renderer for each
+    AppState state;
+    state.engine = std::make_unique<DataEngine>(pApp);
+    pApp->userData = &state;
+
     // Register an event handler for Android events
     pApp->onAppCmd = handle_cmd;
 
@@ -82,8 +93,9 @@ void android_main(struct android_app *pApp) {
         // Process all pending events before running game logic.
         bool done = false;
         while (!done) {
-            // 0 is non-blocking.
-            int timeout = 0;
+            // 0 is non-blocking. Without a window there's nothing to draw, so wait for the next
+            // event instead of spinning.
+            int timeout = !state.renderer && !pApp->destroyRequested ? -1 : 0;
             int events;
             android_poll_source *pSource;
             int result = ALooper_pollOnce(timeout, nullptr, &events,
@@ -107,19 +119,20 @@ void android_main(struct android_app *pApp) {
             }
         }
 
-        // Check if any user data is associated. This is assigned in handle_cmd
-        if (pApp->userData) {
-            // We know that our user data is a Renderer, so reinterpret cast it. If you change your
-            // user data remember to change it here
-            auto *pRenderer = reinterpret_cast<Renderer *>(pApp->userData);
-
-            // Process game input
-            pRenderer->handleInput();
+        // Process game input
+        state.engine->handleInput();
 
-            // Render a frame
-            pRenderer->render();
+        // Render a frame, if there's a window to render it to. The renderer is made in
+        // handle_cmd, and so is the dataset the first time.
+        if (state.renderer) {
+            state.renderer->render();
         }
     } while (!pApp->destroyRequested);
 
+    // The renderer draws from the engine, so it goes first
+    state.renderer.reset();
+    state.engine.reset();
+    pApp->userData = nullptr;
+
 }
 }
\ No newline at end of file
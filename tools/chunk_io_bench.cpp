@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "ChunkSource.h"
+#include "AlignedBufferPool.h"
+#include "Crc32c.h"
+#include "ChunkLoader.h"
+
+struct BenchResult {
+    size_t reads = 0;
+    size_t errors = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    double crc_seconds = 0.0;  // Of seconds, spent checking CRCs on the reaping thread
+    size_t crc_errors = 0;     // Also counted in errors
+};
+
+// Evict the file from the page cache so every backend starts cold
+void dropFromPageCache(const std::string& filename) {
+#ifdef POSIX_FADV_DONTNEED
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
+// Direct I/O has to read whole aligned extents, so the padding comes along with the payload
+uint32_t readLength(const FileHeader& header, const ChunkMetadata& chunk, bool direct_io) {
+    uint32_t length = chunk.point_count * sizeof(Point);
+    if (direct_io) {
+        length += payloadPadding(header, chunk);
+    }
+    return length;
+}
+
+// A read that landed at the wrong offset shows up as points outside the chunk's box
+bool pointsInside(const ChunkMetadata& chunk, const char* buffer) {
+    const auto* points = reinterpret_cast<const Point*>(buffer);
+    for (uint32_t i = 0; i < chunk.point_count; ++i) {
+        if (!chunk.bbox.contains(points[i].x, points[i].y, points[i].z)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// @a range is the .pcd's place inside @a filename when it's embedded in a container
+bool runBackend(const std::string& filename, const ChunkFileRange* range, ChunkSourceKind kind,
+                const FileHeader& header, const std::vector<ChunkMetadata>& chunks,
+                const std::vector<uint32_t>& reads, uint32_t queue_depth, bool direct_io,
+                bool verify, const std::vector<uint32_t>* crcs, BenchResult& result) {
+    ChunkSourceOptions options;
+    options.queue_depth = queue_depth;
+    options.threads = queue_depth;
+    options.direct_io = direct_io;
+
+    auto source = range != nullptr ? ChunkSource::open(*range, kind, options)
+                                   : ChunkSource::open(filename, kind, options);
+    if (!source) {
+        std::cout << std::setw(10) << ChunkSource::kindName(kind)
+                  << "  unavailable (" << std::strerror(errno) << ")" << std::endl;
+        return false;
+    }
+
+    uint32_t max_length = 0;
+    for (const auto& chunk : chunks) {
+        max_length = std::max(max_length, readLength(header, chunk, direct_io));
+    }
+
+    AlignedBufferPool pool(max_length, queue_depth, PCD_PAYLOAD_ALIGNMENT);
+    if (!pool.valid()) {
+        std::cerr << "Failed to allocate " << queue_depth << " read buffers" << std::endl;
+        return false;
+    }
+    source->registerBuffers(pool.base(), pool.totalBytes());
+
+    std::vector<ChunkReadRequest> batch;
+    std::vector<ChunkReadCompletion> completions(queue_depth);
+    std::vector<uint32_t> buffer_chunk(queue_depth);
+    size_t issued = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (result.reads < reads.size()) {
+        // Refill every free slot so the queue stays as deep as requested
+        batch.clear();
+        while (issued + batch.size() < reads.size()) {
+            char* buffer = pool.acquire();
+            if (buffer == nullptr) {
+                break;
+            }
+
+            uint32_t chunk_id = reads[issued + batch.size()];
+            const ChunkMetadata& chunk = chunks[chunk_id];
+            buffer_chunk[pool.indexOf(buffer)] = chunk_id;
+            batch.push_back({chunk.file_offset, readLength(header, chunk, direct_io),
+                             buffer, pool.indexOf(buffer)});
+        }
+
+        size_t accepted = source->submit(batch.data(), batch.size());
+        issued += accepted;
+        for (size_t i = accepted; i < batch.size(); ++i) {
+            pool.release(static_cast<char*>(batch[i].dst));
+        }
+
+        if (source->inFlight() == 0) {
+            std::cerr << "Backend " << source->name() << " stopped accepting requests" << std::endl;
+            return false;
+        }
+
+        size_t n = source->reap(completions.data(), completions.size(), 1);
+        for (size_t i = 0; i < n; ++i) {
+            char* buffer = pool.buffer(completions[i].user_data);
+            uint32_t chunk_id = buffer_chunk[completions[i].user_data];
+            const ChunkMetadata& chunk = chunks[chunk_id];
+            if (completions[i].result < 0) {
+                result.errors++;
+            } else {
+                result.bytes += completions[i].result;
+                if (verify && (completions[i].result < int64_t(chunk.point_count * sizeof(Point)) ||
+                               !pointsInside(chunk, buffer))) {
+                    result.errors++;
+                }
+                // What the loader does before handing a payload over, timed on its own
+                if (crcs != nullptr && completions[i].result >= int64_t(chunk.point_count * sizeof(Point))) {
+                    auto crc_start = std::chrono::steady_clock::now();
+                    bool match = crc32c(buffer, chunk.point_count * sizeof(Point)) == (*crcs)[chunk_id];
+                    result.crc_seconds += std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - crc_start).count();
+                    if (!match) {
+                        result.crc_errors++;
+                        result.errors++;
+                    }
+                }
+            }
+            pool.release(buffer);
+        }
+        result.reads += n;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return true;
+}
+
+// Makes the same reads through a ChunkLoader, which checks CRCs on its workers while its I/O
+// thread reads the next batch, so the cost is what's left once the checks overlap the reads
+bool runLoader(const std::string& filename, const ChunkFileRange* range, ChunkSourceKind kind,
+               const std::vector<ChunkMetadata>& chunks, const std::vector<uint32_t>& reads,
+               uint32_t queue_depth, bool direct_io, const std::vector<uint32_t>* crcs,
+               BenchResult& result) {
+    ChunkSourceOptions source_options;
+    source_options.queue_depth = queue_depth;
+    source_options.threads = queue_depth;
+    source_options.direct_io = direct_io;
+
+    auto source = range != nullptr ? ChunkSource::open(*range, kind, source_options)
+                                   : ChunkSource::open(filename, kind, source_options);
+    if (!source) {
+        return false;
+    }
+
+    uint32_t max_length = 0;
+    for (const auto& chunk : chunks) {
+        max_length = std::max<uint32_t>(max_length, chunk.point_count * sizeof(Point));
+    }
+
+    ChunkLoaderOptions options;
+    options.batch_size = queue_depth;
+    options.direct_io = direct_io;
+    options.max_read_length = max_length;
+    options.staging_buffers = queue_depth;
+    ChunkLoader loader(std::move(source), options);
+    if (!loader.valid()) {
+        return false;
+    }
+
+    // Two batches' worth of destinations: one being read while the other is checked
+    size_t window = size_t(queue_depth) * 2;
+    std::vector<char> buffers(size_t(max_length) * window);
+    std::vector<uint64_t> free_buffers;
+    for (size_t i = 0; i < window; ++i) {
+        free_buffers.push_back(i);
+    }
+
+    std::vector<ChunkLoadRequest> requests;
+    std::vector<ChunkLoadResult> results;
+    size_t issued = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (result.reads < reads.size()) {
+        requests.clear();
+        while (issued < reads.size() && !free_buffers.empty()) {
+            uint32_t chunk_id = reads[issued++];
+            const ChunkMetadata& chunk = chunks[chunk_id];
+            ChunkLoadRequest request;
+            request.offset = chunk.file_offset;
+            request.length = chunk.point_count * sizeof(Point);
+            request.dst = buffers.data() + free_buffers.back() * max_length;
+            request.user_data = free_buffers.back();
+            request.verify = crcs != nullptr;
+            request.crc = crcs != nullptr ? (*crcs)[chunk_id] : 0;
+            requests.push_back(request);
+            free_buffers.pop_back();
+        }
+        loader.request(requests.data(), requests.size());
+
+        results.clear();
+        if (loader.poll(results) == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            continue;
+        }
+        for (const auto& read : results) {
+            if (read.result < 0) {
+                result.errors++;
+                result.crc_errors += read.result == -EBADMSG;
+            } else {
+                result.bytes += read.result;
+            }
+            free_buffers.push_back(read.user_data);
+        }
+        result.reads += results.size();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return true;
+}
+
+void printResult(ChunkSourceKind kind, const BenchResult& result, bool crc) {
+    double iops = result.reads / result.seconds;
+    double mbps = (result.bytes / 1024.0 / 1024.0) / result.seconds;
+
+    std::cout << std::setw(10) << ChunkSource::kindName(kind)
+              << std::setw(10) << result.reads
+              << std::setw(12) << std::fixed << std::setprecision(1) << iops
+              << std::setw(12) << mbps
+              << std::setw(10) << std::setprecision(3) << result.seconds
+              << std::setw(8) << result.errors;
+    if (crc) {
+        // Share of the run spent on CRCs, and what it costs the reads alone
+        double io_seconds = result.seconds - result.crc_seconds;
+        std::cout << std::setw(10) << std::setprecision(1) << 100.0 * result.crc_seconds / result.seconds
+                  << std::setw(10) << 100.0 * result.crc_seconds / std::max(io_seconds, 1e-9)
+                  << std::setw(8) << result.crc_errors;
+    }
+    std::cout << std::endl;
+}
+
+// In-memory CRC32C throughput in MB/s over a buffer the size of @a bytes, cache effects included
+double crcThroughput(uint32_t (*crc)(const void*, size_t, uint32_t), size_t bytes) {
+    std::vector<uint8_t> data(bytes);
+    std::mt19937 rng(1);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(rng());
+    }
+
+    uint32_t sink = 0;
+    int passes = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do {
+        sink ^= crc(data.data(), data.size(), 0);
+        passes++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.25);
+
+    volatile uint32_t keep = sink;
+    (void)keep;
+    return (double(bytes) * passes / 1024.0 / 1024.0) / seconds;
+}
+
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    bool direct_io = false;
+    bool verify = false;
+    bool crc = false;
+    bool embedded = false;
+    uint64_t offset = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--direct") {
+            direct_io = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (arg == "--crc") {
+            crc = true;
+        } else if (arg == "--offset" && i + 1 < argc) {
+            offset = std::strtoull(argv[++i], nullptr, 10);
+            embedded = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <pointcloud_file> [pread|mmap|io_uring|all] [num_reads] [queue_depth]"
+                  << " [--direct] [--verify] [--crc] [--offset BYTES]" << std::endl;
+        return 1;
+    }
+
+    std::string filename = args[0];
+    std::string backend = (args.size() > 1) ? args[1] : "all";
+    size_t num_reads = (args.size() > 2) ? std::strtoul(args[2].c_str(), nullptr, 10) : 1000;
+    uint32_t queue_depth = (args.size() > 3) ? std::strtoul(args[3].c_str(), nullptr, 10) : 32;
+
+    if (queue_depth == 0) {
+        queue_depth = 1;
+    }
+
+    std::vector<ChunkSourceKind> kinds;
+    if (backend == "all") {
+        kinds = {ChunkSourceKind::PRead, ChunkSourceKind::MMap, ChunkSourceKind::IOUring};
+        if (direct_io) {
+            kinds = {ChunkSourceKind::PRead, ChunkSourceKind::IOUring};
+        }
+    } else {
+        ChunkSourceKind kind;
+        if (!ChunkSource::parseKind(backend, kind)) {
+            std::cerr << "Unknown backend: " << backend << std::endl;
+            return 1;
+        }
+        kinds.push_back(kind);
+    }
+
+    // An embedded .pcd is read through a descriptor of the whole container, the way the app
+    // reads one stored in its APK
+    int container_fd = -1;
+    ChunkFileRange range;
+    if (embedded) {
+        container_fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (container_fd < 0) {
+            std::cerr << "Failed to open " << filename << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        range = {container_fd, offset, 0};
+    }
+
+    PcdIndex index;
+    std::string error;
+    if (!(embedded ? readPcdIndex(range, index, &error) : readPcdIndex(filename, index, &error))) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    const FileHeader& header = index.header;
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
+
+    if (chunks.empty()) {
+        std::cerr << "No chunks found!" << std::endl;
+        return 1;
+    }
+
+    if (direct_io && !(headerFlags(header) & PCD_FLAG_ALIGNED_PAYLOADS)) {
+        std::cerr << "--direct needs a file generated with --align" << std::endl;
+        return 1;
+    }
+
+    if (crc && index.chunk_crcs.empty()) {
+        std::cerr << "--crc needs a file with chunk CRCs (point_cloud_generator without --no-crc)" << std::endl;
+        return 1;
+    }
+
+    // Same random chunk sequence for every backend
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<uint32_t> chunk_dist(0, header.chunk_count - 1);
+    std::vector<uint32_t> reads(num_reads);
+    for (auto& read : reads) {
+        read = chunk_dist(rng);
+    }
+
+    std::cout << "Random chunk reads: " << num_reads << " of " << header.chunk_count
+              << " chunks, queue depth " << queue_depth
+              << (direct_io ? ", direct I/O" : "")
+              << (embedded ? ", embedded at byte " + std::to_string(offset) : "") << std::endl;
+    std::cout << std::setw(10) << "Backend"
+              << std::setw(10) << "Reads"
+              << std::setw(12) << "IOPS"
+              << std::setw(12) << "MB/s"
+              << std::setw(10) << "Seconds"
+              << std::setw(8) << "Errors";
+    if (crc) {
+        std::cout << std::setw(10) << "CRC %" << std::setw(10) << "+I/O %" << std::setw(8) << "Bad";
+    }
+    std::cout << std::endl;
+    std::cout << std::string(crc ? 90 : 62, '-') << std::endl;
+
+    for (ChunkSourceKind kind : kinds) {
+        dropFromPageCache(filename);
+
+        BenchResult result;
+        if (runBackend(filename, embedded ? &range : nullptr, kind, header, chunks, reads,
+                       queue_depth, direct_io, verify, crc ? &index.chunk_crcs : nullptr, result)) {
+            printResult(kind, result, crc);
+        }
+    }
+
+    if (crc) {
+        // The serial cost above is the ceiling; the loader hides what it can behind its reads
+        std::cout << "\nThrough ChunkLoader, CRCs checked on its workers during the next batch's reads"
+                  << std::endl;
+        std::cout << std::setw(10) << "Backend"
+                  << std::setw(12) << "No CRC s"
+                  << std::setw(12) << "CRC s"
+                  << std::setw(10) << "+I/O %"
+                  << std::setw(8) << "Bad" << std::endl;
+        std::cout << std::string(52, '-') << std::endl;
+
+        for (ChunkSourceKind kind : kinds) {
+            BenchResult raw;
+            BenchResult checked;
+            dropFromPageCache(filename);
+            bool ok = runLoader(filename, embedded ? &range : nullptr, kind, chunks, reads,
+                                queue_depth, direct_io, nullptr, raw);
+            dropFromPageCache(filename);
+            ok = ok && runLoader(filename, embedded ? &range : nullptr, kind, chunks, reads,
+                                 queue_depth, direct_io, &index.chunk_crcs, checked);
+            if (!ok) {
+                continue;
+            }
+            std::cout << std::setw(10) << ChunkSource::kindName(kind)
+                      << std::setw(12) << std::setprecision(3) << raw.seconds
+                      << std::setw(12) << checked.seconds
+                      << std::setw(10) << std::setprecision(1)
+                      << 100.0 * (checked.seconds - raw.seconds) / std::max(raw.seconds, 1e-9)
+                      << std::setw(8) << checked.crc_errors << std::endl;
+        }
+
+        // One chunk's worth, as the loader sees it
+        uint32_t max_points = 0;
+        for (const auto& chunk : chunks) {
+            max_points = std::max(max_points, chunk.point_count);
+        }
+        size_t bytes = std::max<size_t>(max_points * sizeof(Point), 4096);
+        std::cout << "\nCRC32C in memory, " << (bytes / 1024) << " KB buffers: "
+                  << std::setprecision(0) << crcThroughput(crc32c, bytes) << " MB/s ("
+                  << crc32cImplementation() << "), "
+                  << crcThroughput(crc32cSoftware, bytes) << " MB/s (software)" << std::endl;
+    }
+
+    if (container_fd >= 0) {
+        close(container_fd);
+    }
+    return 0;
+}
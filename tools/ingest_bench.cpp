@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "PointCloudData.h"
+#include "IngestServer.h"
+
+// Receives a live point stream, from pcd_replay or a real sensor, and plays the renderer's part:
+// every frame it takes at most a few sealed chunks and copies them into a ring of fixed size
+// slots, as the app uploads them to its live buffer. Reports ingest throughput, how often and for
+// how long the sender was held back, and the per-frame cost of taking the chunks.
+//
+// ex:
+//  ./ingest_bench @bench &
+//  ./pcd_replay pointcloud.pcd @bench --shuffle
+// or
+//  ./pcd_replay pointcloud.pcd - | ./ingest_bench -
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    IngestOptions options;
+    double fps = 60.0;
+    size_t chunks_per_frame = 8;
+    size_t slots = 256;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fps" && i + 1 < argc) {
+            fps = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--chunks-per-frame" && i + 1 < argc) {
+            chunks_per_frame = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--chunk-points" && i + 1 < argc) {
+            options.chunk_points = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--pending" && i + 1 < argc) {
+            options.max_pending_chunks = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--depth" && i + 1 < argc) {
+            options.depth = std::atoi(argv[++i]);
+        } else if (arg == "--max-open-ms" && i + 1 < argc) {
+            options.max_open_ms = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <socket|-> [--fps N] [--chunks-per-frame N]"
+                  << " [--chunk-points N] [--pending N] [--depth N] [--max-open-ms N]" << std::endl;
+        return 1;
+    }
+
+    IngestServer server(options);
+    std::string error;
+    bool started = args[0] == "-" ? server.attach(dup(STDIN_FILENO), &error)
+                                  : server.listen(args[0], &error);
+    if (!started) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (args[0] != "-") {
+        std::cout << "Listening on " << args[0] << std::endl;
+    }
+
+    // The live buffer the chunks are copied into, one slot per chunk, reused round robin
+    std::vector<Point> live(slots * std::max(1u, options.chunk_points));
+    size_t next_slot = 0;
+
+    std::vector<IngestChunk> chunks;
+    std::vector<double> frame_ms;
+    uint64_t chunks_taken = 0, points_taken = 0;
+    uint32_t max_pending = 0;
+    auto frame = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+    auto next_frame = std::chrono::steady_clock::now();
+
+    while (true) {
+        // Read first, so the chunks sealed by the end of the stream are still taken below
+        IngestServerStats stats = server.stats();
+        max_pending = std::max(max_pending, stats.ingest.pending_chunks);
+
+        auto start = std::chrono::steady_clock::now();
+        chunks.clear();
+        server.pollChunks(chunks, chunks_per_frame);
+        for (const auto& chunk : chunks) {
+            std::memcpy(live.data() + next_slot * options.chunk_points, chunk.points.get(),
+                        chunk.point_count * sizeof(Point));
+            next_slot = (next_slot + 1) % slots;
+            points_taken += chunk.point_count;
+        }
+        chunks_taken += chunks.size();
+        if (!chunks.empty()) {
+            frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+
+        if (stats.streams_ended > 0 && chunks.empty() && stats.ingest.pending_chunks == 0) {
+            break;
+        }
+
+        next_frame += frame;
+        std::this_thread::sleep_until(next_frame);
+    }
+
+    IngestServerStats stats = server.stats();
+    if (stats.bad_streams > 0) {
+        std::cerr << "Stream had a bad header" << std::endl;
+        return 1;
+    }
+
+    std::sort(frame_ms.begin(), frame_ms.end());
+    auto percentile = [&](int p) {
+        return frame_ms.empty() ? 0.0 : frame_ms[std::min(frame_ms.size() - 1, frame_ms.size() * p / 100)];
+    };
+
+    const IngestOptions& used = server.ingestor() ? server.ingestor()->options() : options;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Ingested " << stats.ingest.points_in << " points (" << stats.ingest.points_dropped
+              << " outside the bounds), " << stats.bytes_in / (1024.0 * 1024.0) << " MB in "
+              << stats.seconds << " s: " << std::setprecision(0) << stats.points_per_second
+              << " points/s" << std::endl;
+    std::cout << "Cells: " << (1u << used.depth) << "^3, " << used.chunk_points << " points per chunk"
+              << std::endl;
+    std::cout << "Chunks: " << stats.ingest.chunks_sealed << " sealed, " << chunks_taken << " taken ("
+              << points_taken << " points), at most " << max_pending << " of "
+              << used.max_pending_chunks << " pending" << std::endl;
+    std::cout << std::setprecision(2) << "Backpressure: " << stats.ingest.stalls << " stalls, "
+              << stats.ingest.stall_seconds << " s held back" << std::endl;
+    std::cout << std::setprecision(3) << "Frame work at " << std::setprecision(0) << fps << " fps, "
+              << chunks_per_frame << " chunks per frame: p50 " << std::setprecision(3) << percentile(50)
+              << " ms, p95 " << percentile(95) << " ms, max " << percentile(100) << " ms" << std::endl;
+
+    return points_taken == stats.ingest.points_in ? 0 : 1;
+}
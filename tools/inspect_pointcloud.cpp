@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -5,11 +8,33 @@
 #include <vector>
 
 #include "PointCloudData.h"
+#include "PcdFile.h"
+#include "PcdScan.h"
+#include "JobSystem.h"
 
-void printHeader(const FileHeader& header) {
+void printHeader(const PcdIndex& index) {
+    const FileHeader& header = index.header;
     std::cout << "\n=== Point Cloud File Info ===" << std::endl;
     std::cout << "Magic: " << std::string(header.magic, 7) << std::endl;
     std::cout << "Version: " << header.version << std::endl;
+    if (headerFlags(header) & PCD_FLAG_INDEX_POINTER) {
+        std::cout << "Index Generation: " << index.generation;
+        if (index.generation > 0) {
+            std::cout << " (index at byte " << index.index_offset << ")";
+        }
+        if (!(headerFlags(header) & PCD_FLAG_POINTER_SLOTS)) {
+            std::cout << " (no pointer slots, can't be appended to)";
+        }
+        std::cout << std::endl;
+    } else {
+        std::cout << "Index Generation: none (no index pointer, can't be appended to)" << std::endl;
+    }
+    std::cout << "Payload Alignment: "
+              << ((headerFlags(header) & PCD_FLAG_ALIGNED_PAYLOADS)
+                  ? std::to_string(PCD_PAYLOAD_ALIGNMENT) + " bytes" : "none") << std::endl;
+    std::cout << "Bricks per Chunk: "
+              << (index.bricks_per_chunk > 0 ? std::to_string(index.bricks_per_chunk) : "none") << std::endl;
+    std::cout << "Chunk CRCs: " << (index.chunk_crcs.empty() ? "none" : "CRC32C") << std::endl;
     std::cout << "Total Points: " << header.total_points << std::endl;
     std::cout << "Chunk Count: " << header.chunk_count << std::endl;
     std::cout << "Target Chunk Size: " << header.chunk_size << std::endl;
@@ -62,6 +87,47 @@ void printChunkStats(const std::vector<ChunkMetadata>& chunks) {
     std::cout << "  Avg: " << ((min_size + max_size) / 2.0f) << std::endl;
 }
 
+static double volume(const BoundingBox& box) {
+    return double(box.max_x - box.min_x) * double(box.max_y - box.min_y) * double(box.max_z - box.min_z);
+}
+
+// How much of each chunk's box its bricks actually fill; the rest is space a view can cull
+void printBrickStats(const PcdIndex& index) {
+    if (index.bricks_per_chunk == 0 || index.chunks.empty()) {
+        return;
+    }
+
+    uint64_t filled = 0;
+    double fill_sum = 0.0;
+    size_t measured = 0;
+    for (uint32_t i = 0; i < index.chunks.size(); ++i) {
+        const PcdBrick* bricks = index.chunkBricks(i);
+        double brick_volume = 0.0;
+        for (uint32_t b = 0; b < index.bricks_per_chunk; ++b) {
+            if (bricks[b].point_count > 0) {
+                filled++;
+                brick_volume += volume(bricks[b].bbox);
+            }
+        }
+        double chunk_volume = volume(index.chunks[i].bbox);
+        if (chunk_volume > 0.0) {
+            fill_sum += brick_volume / chunk_volume;
+            measured++;
+        }
+    }
+
+    std::cout << "\n=== Brick Statistics ===" << std::endl;
+    std::cout << "Bricks with points: " << filled << " of " << index.bricks.size() << " ("
+              << std::fixed << std::setprecision(1)
+              << (double(filled) / double(index.chunks.size())) << " per chunk)" << std::endl;
+    if (measured > 0) {
+        std::cout << "Brick boxes fill " << (100.0 * fill_sum / double(measured))
+                  << "% of their chunk's box on average" << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
 void printDetailedChunks(const std::vector<ChunkMetadata>& chunks, int max_display = 10) {
     std::cout << "\n=== Chunk Details (first " << max_display << ") ===" << std::endl;
     std::cout << std::setw(5) << "ID" 
@@ -92,67 +158,253 @@ void printDetailedChunks(const std::vector<ChunkMetadata>& chunks, int max_displ
 void printMemoryEstimate(const FileHeader& header, const std::vector<ChunkMetadata>& chunks) {
     std::cout << "\n=== Memory Estimates ===" << std::endl;
     
-    uint64_t total_file_size = sizeof(FileHeader) + 
-                               chunks.size() * sizeof(ChunkMetadata) +
-                               header.total_points * sizeof(Point);
+    uint64_t padding_size = 0;
+    for (const auto& chunk : chunks) {
+        padding_size += payloadPadding(header, chunk);
+    }
     
     uint64_t index_size = sizeof(FileHeader) + chunks.size() * sizeof(ChunkMetadata);
     uint64_t point_data_size = header.total_points * sizeof(Point);
+    uint64_t total_file_size = index_size + point_data_size + padding_size;
+    if (!chunks.empty()) {
+        // Also counts the gap between the index and the first (aligned) payload. Payloads needn't
+        // be in index order (pcd_layout reorders them), so end at the last one in the file.
+        const ChunkMetadata& last = *std::max_element(
+                chunks.begin(), chunks.end(),
+                [](const ChunkMetadata& a, const ChunkMetadata& b) {
+                    return a.file_offset < b.file_offset;
+                });
+        total_file_size = last.file_offset + last.point_count * sizeof(Point) +
+                          payloadPadding(header, last);
+    }
     
     std::cout << "File Structure:" << std::endl;
     std::cout << "  Header: " << sizeof(FileHeader) << " bytes" << std::endl;
     std::cout << "  Index: " << (chunks.size() * sizeof(ChunkMetadata) / 1024) << " KB" << std::endl;
     std::cout << "  Point Data: " << (point_data_size / 1024 / 1024) << " MB" << std::endl;
+    if (padding_size > 0) {
+        std::cout << "  Alignment Padding: " << (padding_size / 1024) << " KB" << std::endl;
+    }
     std::cout << "  Total File: " << (total_file_size / 1024 / 1024) << " MB" << std::endl;
     
     std::cout << "\nRuntime Memory (if all loaded):" << std::endl;
     std::cout << "  CPU: ~" << (point_data_size / 1024 / 1024) << " MB" << std::endl;
     std::cout << "  GPU (VBOs): ~" << (point_data_size / 1024 / 1024) << " MB" << std::endl;
     
-    // Estimate streaming memory with typical cache
+    if (chunks.empty()) {
+        return;
+    }
+
+    // Cache slots are sized for the largest chunk, as streaming_bench sizes them. --scan
+    // simulates what a camera actually keeps loaded.
     uint64_t cache_size_mb = 100; // Assume 100MB cache
-    uint64_t chunks_in_cache = (cache_size_mb * 1024 * 1024) / (chunks[0].point_count * sizeof(Point));
+    uint32_t slot_points = header.chunk_size;
+    for (const auto& chunk : chunks) {
+        slot_points = std::max(slot_points, chunk.point_count);
+    }
+    uint64_t chunks_in_cache = (cache_size_mb * 1024 * 1024) / (uint64_t(slot_points) * sizeof(Point));
     
     std::cout << "\nStreaming Mode (100 MB cache):" << std::endl;
     std::cout << "  ~" << chunks_in_cache << " chunks in memory" << std::endl;
-    std::cout << "  ~" << (chunks_in_cache * chunks[0].point_count) << " points loaded" << std::endl;
+    std::cout << "  ~" << (chunks_in_cache * (header.total_points / chunks.size())) << " points loaded" << std::endl;
     std::cout << "  ~" << cache_size_mb << " MB CPU + " << cache_size_mb << " MB GPU" << std::endl;
 }
 
+void printHistogram(const Log2Histogram& histogram, const char* unit) {
+    uint64_t total = histogram.total();
+    uint64_t largest = *std::max_element(histogram.counts, histogram.counts + Log2Histogram::kBuckets);
+    if (total == 0) {
+        return;
+    }
+    for (int b = 0; b < Log2Histogram::kBuckets; ++b) {
+        if (histogram.counts[b] == 0) {
+            continue;
+        }
+        std::cout << "  " << std::setw(12) << Log2Histogram::bucketLow(b) << " " << unit << "  "
+                  << std::setw(6) << std::fixed << std::setprecision(2)
+                  << (100.0 * double(histogram.counts[b]) / double(total)) << "%  "
+                  << std::string(static_cast<size_t>(40 * histogram.counts[b] / largest), '#') << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << std::setprecision(6);
+    }
+}
+
+// Flies the camera loop streaming_bench uses and counts what a view cube around it keeps
+// resident each frame, using the chunk boxes the scan measured
+void printStreamingFootprint(const PcdIndex& index, const PcdScanReport& report, float view_fraction) {
+    constexpr int kFrames = 600;
+    const BoundingBox& bounds = index.header.bounds;
+    float cx, cy, cz;
+    bounds.getCenter(cx, cy, cz);
+    float half = 0.5f * view_fraction * bounds.maxDimension();
+
+    uint32_t slot_points = index.header.chunk_size;
+    for (const auto& chunk : index.chunks) {
+        slot_points = std::max(slot_points, chunk.point_count);
+    }
+
+    uint32_t peak_chunks = 0;
+    uint64_t peak_bytes = 0;
+    double chunk_sum = 0.0, byte_sum = 0.0;
+    for (int frame = 0; frame < kFrames; ++frame) {
+        float t = 2.0f * 3.14159265f * float(frame) / float(kFrames);
+        float x = cx + 0.4f * (bounds.max_x - bounds.min_x) * std::cos(t);
+        float y = cy + 0.2f * (bounds.max_y - bounds.min_y) * std::sin(2.0f * t);
+        float z = cz + 0.4f * (bounds.max_z - bounds.min_z) * std::sin(t);
+        BoundingBox view{x - half, y - half, z - half, x + half, y + half, z + half};
+
+        uint32_t resident = 0;
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < index.chunks.size(); ++i) {
+            const BoundingBox& box = report.chunks[i].tight;
+            if (box.min_x <= view.max_x && box.max_x >= view.min_x && box.min_y <= view.max_y &&
+                box.max_y >= view.min_y && box.min_z <= view.max_z && box.max_z >= view.min_z) {
+                resident++;
+                bytes += uint64_t(index.chunks[i].point_count) * sizeof(Point);
+            }
+        }
+        peak_chunks = std::max(peak_chunks, resident);
+        peak_bytes = std::max(peak_bytes, bytes);
+        chunk_sum += resident;
+        byte_sum += double(bytes);
+    }
+
+    double mb = 1024.0 * 1024.0;
+    std::cout << "\nStreaming Footprint (view cube " << std::fixed << std::setprecision(1) << (2.0f * half)
+              << " units, " << kFrames << " frames):" << std::endl;
+    std::cout << "  Chunks resident: " << (chunk_sum / kFrames) << " avg, " << peak_chunks << " peak"
+              << std::endl;
+    std::cout << "  Point data: " << (byte_sum / kFrames / mb) << " MB avg, " << (double(peak_bytes) / mb)
+              << " MB peak (" << (100.0 * double(peak_bytes) / double(std::max<uint64_t>(report.bytes_scanned, 1)))
+              << "% of the dataset)" << std::endl;
+    std::cout << "  Fixed slots of " << slot_points << " points: "
+              << (double(peak_chunks) * slot_points * sizeof(Point) / mb) << " MB CPU + the same in VBOs"
+              << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+// Reads every payload; returns false if the file doesn't hold what its index says
+bool printScan(const std::string& filename, const PcdIndex& index, uint32_t threads, float view_fraction) {
+    JobSystem jobs(threads > 0 ? threads - 1 : JobSystem::kAutoWorkers);
+    PcdScanReport report;
+    std::string error;
+    if (!scanPcd(filename, index, &jobs, report, &error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+
+    double mb = 1024.0 * 1024.0;
+    std::cout << "\n=== Full Scan ===" << std::endl;
+    std::cout << "Scanned " << report.points_scanned << " points (" << std::fixed << std::setprecision(1)
+              << (double(report.bytes_scanned) / mb) << " MB) in " << std::setprecision(3) << report.seconds
+              << " s on " << report.threads << " threads, " << std::setprecision(0)
+              << (double(report.bytes_scanned) / mb / std::max(report.seconds, 1e-9)) << " MB/s" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+
+    std::cout << "\nPayload Ranges:" << std::endl;
+    std::cout << "  Overlapping: " << report.overlaps << std::endl;
+    std::cout << "  Past end of file: " << report.past_end << std::endl;
+    std::cout << "  Point counts " << (report.total_points_match ? "match" : "don't match")
+              << " the header total" << std::endl;
+    std::cout << "  Unreferenced: " << report.gap_bytes << " bytes in " << report.gaps
+              << " gaps, largest " << report.largest_gap
+              << " (reserved index space, replaced indexes, alignment)" << std::endl;
+
+    float min_tightness = 1.0f;
+    double tightness_sum = 0.0;
+    size_t measured = 0;
+    for (const auto& chunk : report.chunks) {
+        if (chunk.tight.min_x <= chunk.tight.max_x) {
+            min_tightness = std::min(min_tightness, chunk.tightness);
+            tightness_sum += chunk.tightness;
+            measured++;
+        }
+    }
+
+    std::cout << "\nPoints:" << std::endl;
+    std::cout << "  Outside their chunk's bbox: " << report.points_outside << " in "
+              << report.chunks_outside << " chunks" << std::endl;
+    if (index.bricks_per_chunk > 0) {
+        std::cout << "  Outside their brick's bbox: " << report.brick_points_outside << std::endl;
+    }
+    std::cout << "  Chunks with a loose bbox: " << report.loose_chunks << std::endl;
+    if (!index.chunk_crcs.empty()) {
+        std::cout << "  Chunks not matching their CRC: " << report.crc_mismatches << std::endl;
+    }
+    if (measured > 0) {
+        std::cout << "  Bbox tightness (points' box over stored box, by volume): " << std::fixed
+                  << std::setprecision(1) << (100.0 * tightness_sum / double(measured)) << "% avg, "
+                  << (100.0 * min_tightness) << "% min" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << std::setprecision(6);
+    }
+
+    std::cout << "\nChunk Density (points per unit^3):" << std::endl;
+    printHistogram(report.density, "+");
+    if (report.flat_chunks > 0) {
+        std::cout << "  " << report.flat_chunks << " flat chunks left out" << std::endl;
+    }
+
+    std::cout << "\nPoint Spacing (to the nearest point in the chunk, units):" << std::endl;
+    printHistogram(report.spacing, "+");
+    std::cout << "  Median: ~" << report.spacing.quantile(0.5) << ", 90th percentile: ~"
+              << report.spacing.quantile(0.9) << std::endl;
+
+    printStreamingFootprint(index, report, view_fraction);
+
+    if (!report.problems.empty()) {
+        std::cout << "\nProblems (first " << PcdScanReport::kMaxProblems << "):" << std::endl;
+        for (const auto& problem : report.problems) {
+            std::cout << "  " << problem << std::endl;
+        }
+    }
+    std::cout << "\nScan " << (report.ok() ? "passed" : "FAILED") << std::endl;
+    return report.ok();
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <pointcloud_file> [--detailed]" << std::endl;
-        return 1;
+    std::string filename;
+    bool detailed = false;
+    bool scan = false;
+    uint32_t threads = 0;
+    float view_fraction = 0.25f;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--detailed") {
+            detailed = true;
+        } else if (arg == "--scan") {
+            scan = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--view" && i + 1 < argc) {
+            view_fraction = std::strtof(argv[++i], nullptr);
+        } else if (filename.empty()) {
+            filename = arg;
+        }
     }
-    
-    std::string filename = argv[1];
-    bool detailed = (argc > 2 && std::string(argv[2]) == "--detailed");
-    
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file: " << filename << std::endl;
+
+    if (filename.empty()) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <pointcloud_file> [--detailed] [--scan [--threads N] [--view F]]" << std::endl;
         return 1;
     }
     
-    // Read header
-    FileHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
-    
-    if (std::string(header.magic, 7) != "PCLOUD1") {
-        std::cerr << "Invalid file format! Magic: " << std::string(header.magic, 7) << std::endl;
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(filename, index, &error)) {
+        std::cerr << error << std::endl;
         return 1;
     }
     
-    // Read chunk metadata
-    std::vector<ChunkMetadata> chunks(header.chunk_count);
-    file.read(reinterpret_cast<char*>(chunks.data()), 
-              header.chunk_count * sizeof(ChunkMetadata));
-    
-    file.close();
+    const FileHeader& header = index.header;
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
     
     // Print information
-    printHeader(header);
+    printHeader(index);
     printChunkStats(chunks);
+    printBrickStats(index);
     
     if (detailed) {
         printDetailedChunks(chunks, 20);
@@ -161,9 +413,11 @@ int main(int argc, char* argv[]) {
     }
     
     printMemoryEstimate(header, chunks);
+
+    bool passed = !scan || printScan(filename, index, threads, view_fraction);
     
     std::cout << "\n=== End of Report ===" << std::endl;
     
-    return 0;
+    return passed ? 0 : 2;
 }
 
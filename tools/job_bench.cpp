@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "ChunkCodec.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "PointBudget.h"
+
+// Runs the per-frame and per-chunk CPU work the app and tools split across the job system, with
+// 1 to N threads, and reports how each workload scales:
+//  cull    - frustum tests of every chunk's bounds, for a batch of views
+//  lod     - screen space ranking and point budget split, for the same views
+//  decode  - decoding every chunk from the compressed tier's format
+//  bounds  - recomputing every chunk's bounding box from its points
+//  proxies - building occluder proxies for every chunk
+//  frame   - a task graph of cull -> lod, with bounds alongside, as one frame would chain them
+
+struct Mat4 {
+    float m[16];  // Column major, OpenGL conventions
+};
+
+Mat4 multiply(const Mat4& a, const Mat4& b) {
+    Mat4 r{};
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+            }
+            r.m[col * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+Mat4 perspective(float fovy, float aspect, float z_near, float z_far) {
+    float f = 1.0f / std::tan(fovy / 2.0f);
+    Mat4 r{};
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (z_far + z_near) / (z_near - z_far);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * z_far * z_near / (z_near - z_far);
+    return r;
+}
+
+Mat4 lookAt(const float eye[3], const float target[3]) {
+    float f[3] = {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+    float fl = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (float& c : f) c /= fl;
+
+    float s[3] = {-f[2], 0.0f, f[0]};
+    float sl = std::sqrt(s[0] * s[0] + s[2] * s[2]);
+    for (float& c : s) c /= sl;
+
+    float u[3] = {s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0]};
+
+    Mat4 r{};
+    r.m[0] = s[0]; r.m[4] = s[1]; r.m[8] = s[2];
+    r.m[1] = u[0]; r.m[5] = u[1]; r.m[9] = u[2];
+    r.m[2] = -f[0]; r.m[6] = -f[1]; r.m[10] = -f[2];
+    r.m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    r.m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    r.m[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+    r.m[15] = 1.0f;
+    return r;
+}
+
+// Conservative: false only if all eight corners are outside the same clip plane
+bool inFrustum(const Mat4& view_proj, const BoundingBox& box) {
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 8; ++i) {
+        float x = i & 1 ? box.max_x : box.min_x;
+        float y = i & 2 ? box.max_y : box.min_y;
+        float z = i & 4 ? box.max_z : box.min_z;
+        float c[4];
+        for (int row = 0; row < 4; ++row) {
+            c[row] = view_proj.m[row] * x + view_proj.m[4 + row] * y + view_proj.m[8 + row] * z +
+                     view_proj.m[12 + row];
+        }
+        outside[0] += c[0] < -c[3];
+        outside[1] += c[0] > c[3];
+        outside[2] += c[1] < -c[3];
+        outside[3] += c[1] > c[3];
+        outside[4] += c[2] < -c[3];
+        outside[5] += c[2] > c[3];
+    }
+    return std::none_of(outside, outside + 6, [](int n) { return n == 8; });
+}
+
+struct View {
+    Mat4 view_proj;
+    float eye[3];
+};
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    uint32_t max_threads = 0;
+    int repeats = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            max_threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--repeats" && i + 1 < argc) {
+            repeats = std::max(1, std::atoi(argv[++i]));
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <pointcloud_file> [views] [--threads N] [--repeats N]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string filename = args[0];
+    int view_count = (args.size() > 1) ? std::atoi(args[1].c_str()) : 4096;
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(filename, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
+    if (chunks.empty() || view_count <= 0) {
+        std::cerr << "Nothing to run" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(filename, std::ios::binary);
+    std::vector<std::vector<Point>> points(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        points[i].resize(chunks[i].point_count);
+        file.seekg(static_cast<std::streamoff>(chunks[i].file_offset));
+        file.read(reinterpret_cast<char*>(points[i].data()),
+                  static_cast<std::streamsize>(chunks[i].point_count * sizeof(Point)));
+    }
+    if (!file) {
+        std::cerr << "Failed to read points" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> encoded(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        encodeChunk(points[i].data(), chunks[i].point_count, encoded[i]);
+    }
+
+    // Views circle the dataset looking at its center, so every one sees a different subset
+    const BoundingBox& bounds = index.header.bounds;
+    float cx, cy, cz;
+    bounds.getCenter(cx, cy, cz);
+    float radius = 0.6f * bounds.maxDimension();
+    Mat4 projection = perspective(1.0f, 16.0f / 9.0f, 0.1f, 4.0f * radius);
+    std::vector<View> views(view_count);
+    for (int v = 0; v < view_count; ++v) {
+        float t = 2.0f * 3.14159265f * float(v) / float(view_count);
+        View& view = views[v];
+        view.eye[0] = cx + radius * std::cos(t);
+        view.eye[1] = cy + 0.3f * radius * std::sin(3.0f * t);
+        view.eye[2] = cz + radius * std::sin(t);
+        float target[3] = {cx + 0.3f * radius * std::sin(5.0f * t), cy, cz};
+        view.view_proj = multiply(projection, lookAt(view.eye, target));
+    }
+
+    std::vector<BudgetCandidate> candidates;
+    for (const auto& chunk : chunks) {
+        candidates.push_back({chunk.bbox, chunk.point_count});
+    }
+
+    // Outputs are kept so the work can't be optimized away, and checked against one thread
+    std::vector<uint32_t> visible(views.size());
+    std::vector<uint64_t> scheduled(views.size());
+    std::vector<std::vector<Point>> decoded(chunks.size());
+    std::vector<BoundingBox> boxes(chunks.size());
+    std::vector<OccluderProxy> proxies(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        decoded[i].resize(chunks[i].point_count);
+    }
+
+    auto cull = [&](size_t first, size_t last) {
+        for (size_t v = first; v < last; ++v) {
+            uint32_t n = 0;
+            for (const auto& chunk : chunks) {
+                n += inFrustum(views[v].view_proj, chunk.bbox);
+            }
+            visible[v] = n;
+        }
+    };
+    auto lod = [&](size_t first, size_t last) {
+        PointBudgetOptions options;
+        options.budget = 1000000;
+        PointBudgetScheduler scheduler(options);
+        for (size_t v = first; v < last; ++v) {
+            scheduler.schedule(candidates, views[v].eye);
+            scheduled[v] = scheduler.scheduledPoints();
+        }
+    };
+    auto decode = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            decodeChunk(encoded[i].data(), encoded[i].size(), decoded[i].data(), chunks[i].point_count);
+        }
+    };
+    auto recomputeBounds = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            boxes[i] = computeBounds(points[i].data(), points[i].size());
+        }
+    };
+    auto buildProxies = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            proxies[i] = buildOccluderProxy(points[i].data(), chunks[i].point_count);
+        }
+    };
+
+    CoreTopology topology = detectCores();
+    if (max_threads == 0) {
+        max_threads = topology.cores;
+    }
+
+    std::cout << "Job system scaling over " << chunks.size() << " chunks and " << views.size()
+              << " views; " << topology.cores << " cores, " << topology.big_cores << " big"
+              << std::endl;
+
+    const char* names[] = {"cull", "lod", "decode", "bounds", "proxies", "frame"};
+    constexpr int kWorkloads = 6;
+    double single[kWorkloads] = {};
+    uint64_t reference_visible = 0, reference_scheduled = 0;
+
+    std::cout << "\n" << std::left << std::setw(9) << "threads";
+    for (const char* name : names) {
+        std::cout << std::right << std::setw(16) << name;
+    }
+    std::cout << std::endl;
+
+    for (uint32_t threads = 1; threads <= max_threads; threads = threads < 4 ? threads + 1 : threads * 2) {
+        JobSystem jobs(threads - 1);
+
+        std::function<void()> workloads[kWorkloads] = {
+                [&] { jobs.parallelFor(0, views.size(), 64, cull); },
+                [&] { jobs.parallelFor(0, views.size(), 64, lod); },
+                [&] { jobs.parallelFor(0, chunks.size(), 1, decode); },
+                [&] { jobs.parallelFor(0, chunks.size(), 1, recomputeBounds); },
+                [&] { jobs.parallelFor(0, chunks.size(), 1, buildProxies); },
+                [&] {
+                    TaskGraph graph;
+                    auto c = graph.add([&] { jobs.parallelFor(0, views.size(), 64, cull); });
+                    auto l = graph.add([&] { jobs.parallelFor(0, views.size(), 64, lod); });
+                    graph.add([&] { jobs.parallelFor(0, chunks.size(), 1, recomputeBounds); });
+                    graph.precede(c, l);
+                    jobs.run(graph);
+                },
+        };
+
+        std::cout << std::left << std::setw(9) << threads;
+        for (int w = 0; w < kWorkloads; ++w) {
+            double best = 1e30;
+            for (int r = 0; r < repeats; ++r) {
+                auto start = std::chrono::steady_clock::now();
+                workloads[w]();
+                best = std::min(best, std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count());
+            }
+            if (threads == 1) {
+                single[w] = best;
+            }
+
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(1) << best << " ms";
+            if (threads > 1) {
+                cell << " x" << std::setprecision(1) << (single[w] / best);
+            }
+            std::cout << std::right << std::setw(16) << cell.str();
+        }
+        std::cout << std::endl;
+
+        uint64_t total_visible = 0, total_scheduled = 0;
+        for (size_t v = 0; v < views.size(); ++v) {
+            total_visible += visible[v];
+            total_scheduled += scheduled[v];
+        }
+        if (threads == 1) {
+            reference_visible = total_visible;
+            reference_scheduled = total_scheduled;
+        } else if (total_visible != reference_visible || total_scheduled != reference_scheduled) {
+            std::cerr << "Results differ from the single threaded run" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
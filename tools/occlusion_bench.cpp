@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "OcclusionCuller.h"
+
+// Flies low over the terrain looking across it, and reports how many chunks in the frustum the
+// software occlusion culler hides and what that costs. With --verify every point of the frustum's
+// chunks is splatted into a full resolution reference depth buffer: chunks with no point left
+// visible there are the most any culler could hide, and culled chunks with a visible point are
+// counted as false culls.
+
+struct Mat4 {
+    float m[16];  // Column major, OpenGL conventions
+};
+
+Mat4 multiply(const Mat4& a, const Mat4& b) {
+    Mat4 r{};
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+            }
+            r.m[col * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+Mat4 perspective(float fovy, float aspect, float z_near, float z_far) {
+    float f = 1.0f / std::tan(fovy / 2.0f);
+    Mat4 r{};
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (z_far + z_near) / (z_near - z_far);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * z_far * z_near / (z_near - z_far);
+    return r;
+}
+
+Mat4 lookAt(const float eye[3], const float target[3]) {
+    float f[3] = {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+    float fl = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (float& c : f) c /= fl;
+
+    // side = f x up, with y up
+    float s[3] = {-f[2], 0.0f, f[0]};
+    float sl = std::sqrt(s[0] * s[0] + s[2] * s[2]);
+    for (float& c : s) c /= sl;
+
+    float u[3] = {s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0]};
+
+    Mat4 r{};
+    r.m[0] = s[0]; r.m[4] = s[1]; r.m[8] = s[2];
+    r.m[1] = u[0]; r.m[5] = u[1]; r.m[9] = u[2];
+    r.m[2] = -f[0]; r.m[6] = -f[1]; r.m[10] = -f[2];
+    r.m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    r.m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    r.m[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+    r.m[15] = 1.0f;
+    return r;
+}
+
+void toClip(const Mat4& m, float x, float y, float z, float clip[4]) {
+    for (int row = 0; row < 4; ++row) {
+        clip[row] = m.m[row] * x + m.m[4 + row] * y + m.m[8 + row] * z + m.m[12 + row];
+    }
+}
+
+// Conservative: false only if all eight corners are outside the same clip plane
+bool inFrustum(const Mat4& view_proj, const BoundingBox& box) {
+    int outside[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 8; ++i) {
+        float c[4];
+        toClip(view_proj, i & 1 ? box.max_x : box.min_x, i & 2 ? box.max_y : box.min_y,
+               i & 4 ? box.max_z : box.min_z, c);
+        outside[0] += c[0] < -c[3];
+        outside[1] += c[0] > c[3];
+        outside[2] += c[1] < -c[3];
+        outside[3] += c[1] > c[3];
+        outside[4] += c[2] < -c[3];
+        outside[5] += c[2] > c[3];
+    }
+    return std::none_of(outside, outside + 6, [](int n) { return n == 8; });
+}
+
+// Full resolution point splatting, for checking the culler's answers
+class ReferenceDepth {
+public:
+    ReferenceDepth(int width, int height, int point_size)
+            : width_(width), height_(height), point_size_(point_size),
+              depth_(size_t(width) * height, 1.0f) {}
+
+    void clear() { std::fill(depth_.begin(), depth_.end(), 1.0f); }
+
+    // Calls fn(pixel index, depth) for every pixel the point's square covers
+    template <typename Fn>
+    void forEachPixel(const Mat4& view_proj, const Point& p, Fn fn) const {
+        float c[4];
+        toClip(view_proj, p.x, p.y, p.z, c);
+        if (c[3] <= 1e-6f || c[2] < -c[3] || c[2] > c[3]) {
+            return;
+        }
+        float z = c[2] / c[3];
+        int px = static_cast<int>(std::floor((c[0] / c[3] * 0.5f + 0.5f) * width_)) - point_size_ / 2;
+        int py = static_cast<int>(std::floor((c[1] / c[3] * 0.5f + 0.5f) * height_)) - point_size_ / 2;
+        for (int y = std::max(py, 0); y < std::min(py + point_size_, height_); ++y) {
+            for (int x = std::max(px, 0); x < std::min(px + point_size_, width_); ++x) {
+                fn(size_t(y) * width_ + x, z);
+            }
+        }
+    }
+
+    void splat(const Mat4& view_proj, const Point& p) {
+        forEachPixel(view_proj, p, [&](size_t i, float z) { depth_[i] = std::min(depth_[i], z); });
+    }
+
+    [[nodiscard]] bool visible(const Mat4& view_proj, const Point& p) const {
+        bool seen = false;
+        forEachPixel(view_proj, p, [&](size_t i, float z) { seen |= z <= depth_[i]; });
+        return seen;
+    }
+
+private:
+    int width_, height_, point_size_;
+    std::vector<float> depth_;
+};
+
+// Median height of the points within reach of (x, z). Ground points outnumber whatever floats
+// above them, so it lands on the terrain; a camera placed over it can't end up underground.
+float groundHeight(const std::vector<std::vector<Point>>& points, float x, float z, float reach,
+                   float fallback) {
+    std::vector<float> heights;
+    for (const auto& chunk : points) {
+        for (const Point& p : chunk) {
+            if (std::fabs(p.x - x) <= reach && std::fabs(p.z - z) <= reach) {
+                heights.push_back(p.y);
+            }
+        }
+    }
+    if (heights.empty()) {
+        return fallback;
+    }
+    auto middle = heights.begin() + heights.size() / 2;
+    std::nth_element(heights.begin(), middle, heights.end());
+    return *middle;
+}
+
+bool parseSize(const std::string& text, int& width, int& height) {
+    return std::sscanf(text.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    int cull_width = 256, cull_height = 128;
+    int screen_width = 1280, screen_height = 640;
+    bool verify = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--verify") {
+            verify = true;
+        } else if (arg == "--res" && i + 1 < argc) {
+            if (!parseSize(argv[++i], cull_width, cull_height)) {
+                std::cerr << "--res expects WIDTHxHEIGHT" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--screen" && i + 1 < argc) {
+            if (!parseSize(argv[++i], screen_width, screen_height)) {
+                std::cerr << "--screen expects WIDTHxHEIGHT" << std::endl;
+                return 1;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <pointcloud_file> [views] [--res WxH] [--screen WxH] [--verify]" << std::endl;
+        return 1;
+    }
+
+    std::string filename = args[0];
+    int views = (args.size() > 1) ? std::atoi(args[1].c_str()) : 16;
+    if (views <= 0) {
+        std::cerr << "views must be positive" << std::endl;
+        return 1;
+    }
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(filename, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    const FileHeader& header = index.header;
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
+    if (chunks.empty()) {
+        std::cerr << "No chunks found!" << std::endl;
+        return 1;
+    }
+
+    // Proxies come from the points, as the app builds them when a chunk lands
+    std::vector<std::vector<Point>> points(chunks.size());
+    std::ifstream file(filename, std::ios::binary);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        points[i].resize(chunks[i].point_count);
+        file.seekg(static_cast<std::streamoff>(chunks[i].file_offset));
+        file.read(reinterpret_cast<char*>(points[i].data()),
+                  static_cast<std::streamsize>(chunks[i].point_count * sizeof(Point)));
+    }
+    if (!file) {
+        std::cerr << "Failed to read the point data" << std::endl;
+        return 1;
+    }
+
+    const float fovy = 3.14159265f / 3.0f;
+    const BoundingBox& b = header.bounds;
+    float cx, cy, cz;
+    b.getCenter(cx, cy, cz);
+    float radius = 0.45f * std::max(b.max_x - b.min_x, b.max_z - b.min_z);
+
+    Mat4 projection = perspective(fovy, float(screen_width) / float(screen_height), 0.1f,
+                                  4.0f * b.maxDimension());
+
+    OccluderOptions options;
+    options.focal_length_px = screen_height / (2.0f * std::tan(fovy / 2.0f));
+
+    auto build_start = std::chrono::steady_clock::now();
+    std::vector<OccluderProxy> proxies(chunks.size());
+    size_t solid_proxies = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        proxies[i] = buildOccluderProxy(points[i].data(), chunks[i].point_count, options);
+        solid_proxies += !proxies[i].empty();
+    }
+    double build_seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+    OcclusionCuller culler(cull_width, cull_height);
+    ReferenceDepth reference(screen_width, screen_height, 2);
+    std::vector<const OccluderProxy*> candidates;
+    std::vector<uint32_t> frustum;
+
+    uint64_t in_frustum = 0, occluded = 0, occluders = 0, points_in_frustum = 0, points_culled = 0;
+    uint64_t false_culls = 0, visible_points_culled = 0, hidden = 0;
+    double seconds = 0.0;
+
+    for (int v = 0; v < views; ++v) {
+        // Low over one side of the dataset, looking across and slightly down at the other
+        float angle = 2.0f * 3.14159265f * float(v) / float(views);
+        float eye[3] = {cx + radius * std::cos(angle), 0.0f, cz + radius * std::sin(angle)};
+        eye[1] = groundHeight(points, eye[0], eye[2], 0.05f * radius, b.min_y) + 0.1f * radius;
+        float target[3] = {cx - 0.5f * radius * std::cos(angle), eye[1] - 0.2f * radius,
+                           cz - 0.5f * radius * std::sin(angle)};
+        Mat4 view_proj = multiply(projection, lookAt(eye, target));
+
+        frustum.clear();
+        candidates.clear();
+        for (uint32_t i = 0; i < chunks.size(); ++i) {
+            if (inFrustum(view_proj, chunks[i].bbox)) {
+                frustum.push_back(i);
+                if (!proxies[i].empty()) {
+                    candidates.push_back(&proxies[i]);
+                }
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        culler.beginFrame(view_proj.m, eye);
+        occluders += culler.addOccluders(candidates, options);
+        std::vector<uint32_t> culled;
+        for (uint32_t chunk_id : frustum) {
+            if (culler.isOccluded(chunks[chunk_id].bbox)) {
+                culled.push_back(chunk_id);
+            }
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        in_frustum += frustum.size();
+        occluded += culled.size();
+        for (uint32_t chunk_id : frustum) {
+            points_in_frustum += chunks[chunk_id].point_count;
+        }
+        for (uint32_t chunk_id : culled) {
+            points_culled += chunks[chunk_id].point_count;
+        }
+
+        if (verify) {
+            reference.clear();
+            for (uint32_t chunk_id : frustum) {
+                for (const Point& p : points[chunk_id]) {
+                    reference.splat(view_proj, p);
+                }
+            }
+            for (uint32_t chunk_id : frustum) {
+                uint64_t seen = 0;
+                for (const Point& p : points[chunk_id]) {
+                    seen += reference.visible(view_proj, p);
+                }
+                hidden += seen == 0;
+                if (seen > 0 && std::find(culled.begin(), culled.end(), chunk_id) != culled.end()) {
+                    false_culls++;
+                    visible_points_culled += seen;
+                }
+            }
+        }
+    }
+
+    std::cout << "Occlusion culling over " << views << " views, " << chunks.size() << " chunks, "
+              << culler.width() << "x" << culler.height() << " depth buffer" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Chunks with an occluder proxy: " << solid_proxies << " (built in "
+              << (build_seconds * 1000.0) << " ms)" << std::endl;
+    std::cout << "Chunks in frustum per view: " << double(in_frustum) / views << std::endl;
+    std::cout << "Occluders rasterized per view: " << double(occluders) / views << " ("
+              << double(culler.trianglesDrawn()) / views << " triangles)" << std::endl;
+    std::cout << "Chunks occluded: " << occluded << " of " << in_frustum << " ("
+              << (100.0 * occluded / std::max<uint64_t>(in_frustum, 1)) << "%)" << std::endl;
+    std::cout << "Points skipped: " << (100.0 * points_culled / std::max<uint64_t>(points_in_frustum, 1))
+              << "% of those in the frustum" << std::endl;
+    std::cout << std::setprecision(3) << "Culler time per view: " << (seconds / views * 1000.0)
+              << " ms" << std::endl;
+    if (verify) {
+        std::cout << "Chunks hidden in the reference render: " << hidden << " ("
+                  << (100.0 * hidden / std::max<uint64_t>(in_frustum, 1)) << "%)" << std::endl;
+        std::cout << "False culls (culled chunks with visible points): " << false_culls << " ("
+                  << visible_points_culled << " points)" << std::endl;
+    }
+
+    return 0;
+}
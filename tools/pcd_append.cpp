@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "PcdAppender.h"
+#include "Crc32c.h"
+
+// Appends the chunks of one .pcd to another in place: only the new payloads, a new index and the
+// index pointer are written, however large the dataset is. With --verify the file is opened
+// again afterwards and the appended chunks are read back and compared.
+
+bool readChunk(std::ifstream& file, const ChunkMetadata& chunk, std::vector<Point>& points) {
+    points.resize(chunk.point_count);
+    file.seekg(static_cast<std::streamoff>(chunk.file_offset));
+    file.read(reinterpret_cast<char*>(points.data()),
+              static_cast<std::streamsize>(chunk.point_count * sizeof(Point)));
+    return static_cast<bool>(file);
+}
+
+uint64_t fileSize(const std::string& path) {
+    struct stat st{};
+    return stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    bool verify = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--verify") {
+            verify = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 2) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_file> <chunks_file> [--verify]" << std::endl;
+        return 1;
+    }
+
+    const std::string& dataset = args[0];
+    const std::string& source = args[1];
+
+    PcdIndex added;
+    std::string error;
+    if (!readPcdIndex(source, added, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    PcdAppender appender;
+    if (!appender.open(dataset)) {
+        std::cerr << appender.error() << std::endl;
+        return 1;
+    }
+    auto first_new = static_cast<uint32_t>(appender.index().chunks.size());
+    uint64_t size_before = fileSize(dataset);
+
+    std::ifstream in(source, std::ios::binary);
+    std::vector<Point> points;
+    for (const auto& chunk : added.chunks) {
+        if (!readChunk(in, chunk, points)) {
+            std::cerr << "Failed to read points from " << source << std::endl;
+            return 1;
+        }
+        if (!appender.appendChunk(points.data(), chunk.point_count, chunk.bbox)) {
+            std::cerr << appender.error() << std::endl;
+            return 1;
+        }
+    }
+    if (!appender.commit()) {
+        std::cerr << appender.error() << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const PcdIndex& index = appender.index();
+    uint64_t bytes = appender.bytesWritten();
+    appender.close();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Appended " << added.chunks.size() << " chunks (" << added.header.total_points
+              << " points) to " << dataset << " in " << seconds * 1000.0 << " ms" << std::endl;
+    std::cout << "Generation " << index.generation << ": " << index.chunks.size() << " chunks, "
+              << index.header.total_points << " points" << std::endl;
+    std::cout << "Wrote " << bytes / (1024.0 * 1024.0) << " MB; a rewrite would write "
+              << fileSize(dataset) / (1024.0 * 1024.0) << " MB (file was "
+              << size_before / (1024.0 * 1024.0) << " MB)" << std::endl;
+
+    if (verify) {
+        PcdIndex reread;
+        if (!readPcdIndex(dataset, reread, &error)) {
+            std::cerr << "Verify: " << error << std::endl;
+            return 1;
+        }
+        if (reread.generation != index.generation || reread.chunks.size() != first_new + added.chunks.size()) {
+            std::cerr << "Verify: the file's index doesn't match the commit" << std::endl;
+            return 1;
+        }
+
+        std::ifstream check(dataset, std::ios::binary);
+        std::vector<Point> expected, grouped;
+        std::vector<PcdBrick> bricks(reread.bricks_per_chunk);
+        for (size_t i = 0; i < added.chunks.size(); ++i) {
+            auto chunk_id = static_cast<uint32_t>(first_new + i);
+            if (!readChunk(in, added.chunks[i], expected) || !readChunk(check, reread.chunks[chunk_id], points)) {
+                std::cerr << "Verify: chunk " << chunk_id << " can't be read" << std::endl;
+                return 1;
+            }
+
+            // A dataset with bricks stores the points grouped by brick
+            bool same_bricks = true;
+            if (reread.bricks_per_chunk > 0) {
+                grouped.resize(expected.size());
+                buildChunkBricks(expected.data(), added.chunks[i].point_count, added.chunks[i].bbox,
+                                 reread.bricks_per_chunk, grouped.data(), bricks.data());
+                expected.swap(grouped);
+                same_bricks = std::memcmp(bricks.data(), reread.chunkBricks(chunk_id),
+                                          bricks.size() * sizeof(PcdBrick)) == 0;
+            }
+            if (!same_bricks || std::memcmp(points.data(), expected.data(), points.size() * sizeof(Point)) != 0) {
+                std::cerr << "Verify: chunk " << chunk_id << " differs" << std::endl;
+                return 1;
+            }
+            if (!reread.chunk_crcs.empty() &&
+                crc32c(points.data(), points.size() * sizeof(Point)) != reread.chunk_crcs[chunk_id]) {
+                std::cerr << "Verify: chunk " << chunk_id << " doesn't match its CRC" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "Verified " << added.chunks.size() << " appended chunks" << std::endl;
+    }
+
+    return 0;
+}
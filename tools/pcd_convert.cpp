@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "Morton.h"
+#include "OctreeBuilder.h"
+#include "JobSystem.h"
+#include "PointImport.h"
+
+// Converts a PLY, XYZ or LAS point cloud to .pcd in bounded memory. Input that fits the budget
+// is chunked in memory like the generator does. Anything bigger is spilled to disk as it's
+// parsed, counted per octree cell, split into parts of whole cells that fit, and each part is
+// chunked on its own; the parts come out as exactly the chunks an in-memory build would make.
+
+// Memory an in-memory build needs per point: the points and their codes, and the radix sort's
+// scratch copy of both
+constexpr size_t kBuildBytesPerPoint = 2 * (sizeof(Point) + sizeof(uint32_t));
+
+// Depth the spilled points are counted at: 8^6 cells, 2 MB of counts. A part can't be smaller
+// than one cell.
+constexpr int kCellDepth = 6;
+
+// Points per block read from the input or a spill file
+constexpr size_t kBlockPoints = 1 << 20;
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool writePoints(std::ofstream& out, const Point* points, size_t count) {
+    out.write(reinterpret_cast<const char*>(points), static_cast<std::streamsize>(count * sizeof(Point)));
+    return out.good();
+}
+
+// Reads up to @a max points into @a points, replacing what it held; false at the end
+bool readPoints(std::ifstream& in, std::vector<Point>& points, size_t max) {
+    points.resize(max);
+    in.read(reinterpret_cast<char*>(points.data()), static_cast<std::streamsize>(max * sizeof(Point)));
+    points.resize(static_cast<size_t>(in.gcount()) / sizeof(Point));
+    return !points.empty();
+}
+
+// Cell of each point at @a depth, the top bits of the code buildOctreeChunkRanges() sorts by
+void computeCells(const std::vector<Point>& points, const BoundingBox& bounds, int max_depth, int depth,
+                  std::vector<uint32_t>& cells, JobSystem& jobs) {
+    cells.resize(points.size());
+    int shift = 3 * (max_depth - depth);
+    jobs.parallelFor(0, points.size(), 64 * 1024, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            cells[i] = mortonCell(points[i].x, points[i].y, points[i].z, bounds, max_depth) >> shift;
+        }
+    });
+}
+
+bool writeChunks(PcdWriter& writer, const OctreeChunks& octree, JobSystem& jobs) {
+    std::vector<BoundingBox> chunk_bounds(octree.chunks.size());
+    jobs.parallelFor(0, octree.chunks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            chunk_bounds[i] = computeBounds(&octree.points[octree.chunks[i].first], octree.chunks[i].count);
+        }
+    });
+
+    for (size_t i = 0; i < octree.chunks.size(); ++i) {
+        if (!writer.writeChunk(&octree.points[octree.chunks[i].first], octree.chunks[i].count, chunk_bounds[i])) {
+            std::cerr << writer.error() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Removes the files it's given when it goes out of scope, so a failed conversion cleans up
+struct TempFiles {
+    std::vector<std::string> paths;
+
+    ~TempFiles() {
+        for (const auto& path : paths) {
+            std::remove(path.c_str());
+        }
+    }
+};
+
+bool parseShift(const std::string& value, PointImportOptions& options) {
+    if (value == "auto") {
+        options.shift_mode = PointShift::Auto;
+    } else if (value == "none") {
+        options.shift_mode = PointShift::None;
+    } else {
+        char* end = nullptr;
+        const char* p = value.c_str();
+        for (int a = 0; a < 3; ++a) {
+            options.shift[a] = std::strtod(p, &end);
+            if (end == p || (a < 2 && *end != ',')) {
+                return false;
+            }
+            p = end + 1;
+        }
+        options.shift_mode = PointShift::Fixed;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    PointImportOptions import_options;
+    OctreeBuildOptions octree_options;
+    octree_options.min_points = 0;  // Real data shouldn't lose its sparse corners
+    PcdWriteOptions write_options;
+    write_options.bricks_per_chunk = 8;
+    write_options.chunk_crcs = true;
+    uint64_t memory_mb = 1024;
+    std::string temp_dir;
+    uint32_t threads = 0;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            usage |= !PointReader::parseFormat(argv[++i], import_options.format);
+        } else if (arg == "--shift" && i + 1 < argc) {
+            usage |= !parseShift(argv[++i], import_options);
+        } else if (arg == "--memory-mb" && i + 1 < argc) {
+            memory_mb = std::max<uint64_t>(16, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--tmp" && i + 1 < argc) {
+            temp_dir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--leaf-points" && i + 1 < argc) {
+            octree_options.max_points_per_leaf = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            octree_options.max_depth = std::clamp(std::atoi(argv[++i]), 0, MORTON_MAX_DEPTH);
+        } else if (arg == "--min-points" && i + 1 < argc) {
+            octree_options.min_points = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--align") {
+            write_options.align_payloads = true;
+        } else if (arg == "--bricks" && i + 1 < argc) {
+            write_options.bricks_per_chunk = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-crc") {
+            write_options.chunk_crcs = false;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (usage || args.size() != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input> <output.pcd> [--format auto|ply|xyz|las]"
+                  << " [--shift auto|none|X,Y,Z] [--memory-mb N] [--tmp DIR] [--threads N]"
+                  << " [--leaf-points N] [--max-depth N] [--min-points N] [--align] [--bricks 0|8|64]"
+                  << " [--no-crc]" << std::endl;
+        return 1;
+    }
+    const std::string& input = args[0];
+    const std::string& output = args[1];
+    write_options.chunk_size = octree_options.max_points_per_leaf;
+
+    std::string error;
+    std::unique_ptr<PointReader> reader = PointReader::open(input, import_options, &error);
+    if (!reader) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    JobSystem jobs(threads > 0 ? threads - 1 : JobSystem::kAutoWorkers);
+    uint64_t budget_points = std::max<uint64_t>(kBlockPoints, memory_mb * 1024 * 1024 / kBuildBytesPerPoint);
+
+    std::cout << "Converting " << input << " (" << reader->description() << ", "
+              << reader->fileSize() / (1024 * 1024) << " MB";
+    if (reader->expectedPoints() > 0) {
+        std::cout << ", " << reader->expectedPoints() << " points";
+    }
+    std::cout << ") on " << jobs.concurrency() << " threads, " << memory_mb << " MB budget" << std::endl;
+
+    // Parse. Points stay in memory until they outgrow the budget, then everything goes to a
+    // spill file.
+    std::string temp_base = temp_dir.empty() ? output : temp_dir + "/" + output.substr(output.find_last_of('/') + 1);
+    TempFiles temps;
+    std::string spill_path = temp_base + ".spill";
+    std::ofstream spill;
+    std::vector<Point> resident;
+    std::vector<Point> block;
+    BoundingBox bounds = BoundingBox::empty();
+    uint64_t total_points = 0;
+    auto start = Clock::now();
+
+    while (reader->read(block, kBlockPoints, &jobs)) {
+        if (!block.empty()) {
+            bounds.expand(computeBounds(block.data(), block.size()));
+        }
+        total_points += block.size();
+
+        if (!spill.is_open() && resident.size() + block.size() > budget_points) {
+            temps.paths.push_back(spill_path);
+            spill.open(spill_path, std::ios::binary | std::ios::trunc);
+            if (!spill || !writePoints(spill, resident.data(), resident.size())) {
+                std::cerr << "Failed to write " << spill_path << std::endl;
+                return 1;
+            }
+            std::vector<Point>().swap(resident);
+        }
+        if (spill.is_open()) {
+            if (!writePoints(spill, block.data(), block.size())) {
+                std::cerr << "Failed to write " << spill_path << std::endl;
+                return 1;
+            }
+        } else {
+            resident.insert(resident.end(), block.begin(), block.end());
+        }
+        block.clear();
+    }
+    if (!reader->error().empty()) {
+        std::cerr << input << ": " << reader->error() << std::endl;
+        return 1;
+    }
+    if (total_points == 0) {
+        std::cerr << "No points in " << input << std::endl;
+        return 1;
+    }
+    double parse_seconds = secondsSince(start);
+
+    const double* shift = reader->shift();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Parsed " << total_points << " points in " << parse_seconds << " s ("
+              << reader->bytesRead() / (1024.0 * 1024.0) / std::max(parse_seconds, 1e-9) << " MB/s)";
+    if (reader->skipped() > 0) {
+        std::cout << ", skipped " << reader->skipped() << " lines";
+    }
+    std::cout << std::endl;
+    if (shift[0] != 0.0 || shift[1] != 0.0 || shift[2] != 0.0) {
+        std::cout << "Subtracted (" << shift[0] << ", " << shift[1] << ", " << shift[2]
+                  << ") from every point; add it back for the original coordinates" << std::endl;
+    }
+    std::cout << std::setprecision(3) << "Bounds: (" << bounds.min_x << ", " << bounds.min_y << ", "
+              << bounds.min_z << ") to (" << bounds.max_x << ", " << bounds.max_y << ", " << bounds.max_z << ")"
+              << std::endl;
+
+    PcdWriter writer;
+    auto build_start = Clock::now();
+    size_t parts = 1;
+
+    if (!spill.is_open()) {
+        OctreeChunks octree = buildOctreeChunkRanges(std::move(resident), bounds, octree_options, &jobs);
+        if (!writer.open(output, static_cast<uint32_t>(octree.chunks.size()), write_options)) {
+            std::cerr << writer.error() << std::endl;
+            return 1;
+        }
+        if (!writeChunks(writer, octree, jobs)) {
+            return 1;
+        }
+    } else {
+        spill.close();
+        if (!spill) {
+            std::cerr << "Failed to write " << spill_path << std::endl;
+            return 1;
+        }
+
+        // Count the spilled points per cell, then split the cells into parts that fit
+        int max_depth = std::clamp(octree_options.max_depth, 0, MORTON_MAX_DEPTH);
+        int cell_depth = std::min(kCellDepth, max_depth);
+        OctreeCellCounts totals;
+        totals.reset(cell_depth);
+        std::vector<uint32_t> cells;
+        std::ifstream in(spill_path, std::ios::binary);
+        while (readPoints(in, block, kBlockPoints)) {
+            computeCells(block, bounds, max_depth, cell_depth, cells, jobs);
+            for (uint32_t cell : cells) {
+                totals.prefix[cell + 1]++;
+            }
+        }
+        totals.accumulate();
+
+        std::vector<OctreePart> plan = planOctreeParts(totals, octree_options, budget_points);
+        parts = plan.size();
+        std::vector<uint32_t> cell_part(size_t(1) << (3 * cell_depth), 0);
+        uint64_t max_chunks = 0;
+        for (size_t p = 0; p < plan.size(); ++p) {
+            std::fill(cell_part.begin() + plan[p].first_cell, cell_part.begin() + plan[p].last_cell,
+                      static_cast<uint32_t>(p));
+            max_chunks += plan[p].max_chunks;
+        }
+
+        // Scatter the points to a file per part, keeping their order
+        std::vector<std::string> part_paths(plan.size());
+        std::vector<std::ofstream> part_files(plan.size());
+        std::vector<std::vector<Point>> part_buffers(plan.size());
+        for (size_t p = 0; p < plan.size(); ++p) {
+            part_paths[p] = temp_base + ".part" + std::to_string(p);
+            temps.paths.push_back(part_paths[p]);
+            part_files[p].open(part_paths[p], std::ios::binary | std::ios::trunc);
+            if (!part_files[p]) {
+                std::cerr << "Failed to create " << part_paths[p] << std::endl;
+                return 1;
+            }
+        }
+        const size_t flush_points = std::max<size_t>(1024, kBlockPoints / plan.size());
+        in.clear();
+        in.seekg(0);
+        while (readPoints(in, block, kBlockPoints)) {
+            computeCells(block, bounds, max_depth, cell_depth, cells, jobs);
+            for (size_t i = 0; i < block.size(); ++i) {
+                uint32_t p = cell_part[cells[i]];
+                part_buffers[p].push_back(block[i]);
+                if (part_buffers[p].size() >= flush_points) {
+                    if (!writePoints(part_files[p], part_buffers[p].data(), part_buffers[p].size())) {
+                        std::cerr << "Failed to write " << part_paths[p] << std::endl;
+                        return 1;
+                    }
+                    part_buffers[p].clear();
+                }
+            }
+        }
+        in.close();
+        std::remove(spill_path.c_str());
+        for (size_t p = 0; p < plan.size(); ++p) {
+            writePoints(part_files[p], part_buffers[p].data(), part_buffers[p].size());
+            part_files[p].close();
+            if (!part_files[p]) {
+                std::cerr << "Failed to write " << part_paths[p] << std::endl;
+                return 1;
+            }
+            std::vector<Point>().swap(part_buffers[p]);
+        }
+
+        if (max_chunks > UINT32_MAX) {
+            std::cerr << "Too many chunks; raise --leaf-points or --min-points" << std::endl;
+            return 1;
+        }
+        if (!writer.open(output, static_cast<uint32_t>(max_chunks), write_options)) {
+            std::cerr << writer.error() << std::endl;
+            return 1;
+        }
+
+        // Chunk each part in Morton order, so the file comes out as a single build would write it
+        for (size_t p = 0; p < plan.size(); ++p) {
+            std::ifstream part(part_paths[p], std::ios::binary);
+            std::vector<Point> points;
+            if (!readPoints(part, points, plan[p].points) || points.size() != plan[p].points) {
+                std::cerr << "Failed to read back " << part_paths[p] << std::endl;
+                return 1;
+            }
+            part.close();
+            std::remove(part_paths[p].c_str());
+
+            OctreeChunks octree = buildOctreePart(std::move(points), bounds, octree_options, totals, &jobs);
+            if (!writeChunks(writer, octree, jobs)) {
+                return 1;
+            }
+        }
+    }
+
+    writer.setBounds(bounds);
+    if (!writer.finish()) {
+        std::cerr << writer.error() << std::endl;
+        return 1;
+    }
+    double build_seconds = secondsSince(build_start);
+    double total_seconds = secondsSince(start);
+
+    uint64_t dropped = total_points - writer.totalPoints();
+    std::cout << std::setprecision(1);
+    std::cout << "Chunked in " << build_seconds << " s";
+    if (parts > 1) {
+        std::cout << ", through " << parts << " parts on disk";
+    }
+    std::cout << std::endl;
+    std::cout << "Wrote " << output << ": " << writer.chunks().size() << " chunks, " << writer.totalPoints()
+              << " points";
+    if (dropped > 0) {
+        std::cout << " (" << dropped << " in leaves under --min-points dropped)";
+    }
+    std::cout << ", " << writer.fileSize() / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout << "Total " << total_seconds << " s, " << reader->bytesRead() / (1024.0 * 1024.0) / total_seconds
+              << " MB/s of input" << std::endl;
+    return 0;
+}
@@ -0,0 +1,482 @@
+// 64-bit file offsets on 32-bit hosts; datasets routinely exceed 2 GB
+#define _FILE_OFFSET_BITS 64
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "BrickCulling.h"
+#include "PointRegion.h"
+#include "JobSystem.h"
+#include "Crc32c.h"
+
+// Cuts a box, sphere or view frustum out of a .pcd, reading only what it has to. Each chunk is
+// classified by its bounding box first:
+//  - chunks wholly inside are copied with copy_file_range, which never brings the payload into
+//    user space and on filesystems that share extents (btrfs, XFS) doesn't copy it at all; their
+//    bounding box, bricks and CRC carry over unchanged
+//  - chunks on the boundary are read, checked against their CRC and filtered, a brick at a time
+//    where the file has bricks, on the job system
+//  - chunks outside are never touched
+// The output has the input's flags and a freshly computed header and index.
+
+// Boundary payloads read and filtered at once, before the chunks they belong to are written
+constexpr uint64_t kWindowBytes = 256ull * 1024 * 1024;
+
+// Buffer for copies the kernel can't do
+constexpr size_t kCopyBufferBytes = 4 * 1024 * 1024;
+
+using Clock = std::chrono::steady_clock;
+
+struct Mat4 {
+    float m[16];  // Column major, OpenGL conventions
+};
+
+Mat4 multiply(const Mat4& a, const Mat4& b) {
+    Mat4 r{};
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+            }
+            r.m[col * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+Mat4 perspective(float fovy, float aspect, float z_near, float z_far) {
+    float f = 1.0f / std::tan(fovy / 2.0f);
+    Mat4 r{};
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (z_far + z_near) / (z_near - z_far);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * z_far * z_near / (z_near - z_far);
+    return r;
+}
+
+Mat4 lookAt(const float eye[3], const float target[3]) {
+    float f[3] = {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+    float fl = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (float& c : f) c /= fl;
+
+    // side = f x up, with y up
+    float s[3] = {-f[2], 0.0f, f[0]};
+    float sl = std::sqrt(s[0] * s[0] + s[2] * s[2]);
+    for (float& c : s) c /= sl;
+
+    float u[3] = {s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0]};
+
+    Mat4 r{};
+    r.m[0] = s[0]; r.m[4] = s[1]; r.m[8] = s[2];
+    r.m[1] = u[0]; r.m[5] = u[1]; r.m[9] = u[2];
+    r.m[2] = -f[0]; r.m[6] = -f[1]; r.m[10] = -f[2];
+    r.m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    r.m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    r.m[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+    r.m[15] = 1.0f;
+    return r;
+}
+
+// Parses exactly @a count comma separated numbers
+bool parseFloats(const std::string& value, float* out, int count) {
+    const char* p = value.c_str();
+    for (int i = 0; i < count; ++i) {
+        char* end = nullptr;
+        out[i] = std::strtof(p, &end);
+        if (end == p || *end != (i + 1 < count ? ',' : '\0')) {
+            return false;
+        }
+        p = end + 1;
+    }
+    return true;
+}
+
+bool parseRegion(const std::string& kind, const std::string& value, std::vector<PointRegion>& regions) {
+    float v[10];
+    if (kind == "--box" && parseFloats(value, v, 6)) {
+        BoundingBox box{std::min(v[0], v[3]), std::min(v[1], v[4]), std::min(v[2], v[5]),
+                        std::max(v[0], v[3]), std::max(v[1], v[4]), std::max(v[2], v[5])};
+        regions.push_back(PointRegion::box(box));
+    } else if (kind == "--sphere" && parseFloats(value, v, 4) && v[3] >= 0.0f) {
+        regions.push_back(PointRegion::sphere(v[0], v[1], v[2], v[3]));
+    } else if (kind == "--frustum" && parseFloats(value, v, 10) && v[6] > 0.0f && v[7] > 0.0f &&
+               v[8] > 0.0f && v[9] > v[8]) {
+        // Eye, target, vertical field of view in degrees, aspect, near and far
+        Mat4 projection = perspective(v[6] * float(M_PI) / 180.0f, v[7], v[8], v[9]);
+        Mat4 view_proj = multiply(projection, lookAt(v, v + 3));
+        regions.push_back(PointRegion::frustum(frustumFromViewProj(view_proj.m)));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool readAt(int fd, void* data, size_t length, uint64_t offset) {
+    auto* bytes = static_cast<char*>(data);
+    while (length > 0) {
+        ssize_t n = pread(fd, bytes, length, static_cast<off_t>(offset));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool writeAt(int fd, const void* data, size_t length, uint64_t offset) {
+    const auto* bytes = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = pwrite(fd, bytes, length, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Copies byte ranges between two files, in the kernel while it can
+class RangeCopier {
+public:
+    RangeCopier(int in_fd, int out_fd, bool use_kernel) : in_fd_(in_fd), out_fd_(out_fd), use_kernel_(use_kernel) {}
+
+    bool copy(uint64_t in_offset, uint64_t out_offset, uint64_t length) {
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 27)
+        while (use_kernel_ && length > 0) {
+            auto in = static_cast<off_t>(in_offset);
+            auto out = static_cast<off_t>(out_offset);
+            ssize_t n = copy_file_range(in_fd_, &in, out_fd_, &out, length, 0);
+            if (n > 0) {
+                in_offset += static_cast<uint64_t>(n);
+                out_offset += static_cast<uint64_t>(n);
+                length -= static_cast<uint64_t>(n);
+                kernel_bytes_ += static_cast<uint64_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                                 errno == EOPNOTSUPP || errno == EBADF)) {
+                // Older kernels, copies across filesystems, filesystems without support
+                use_kernel_ = false;
+            } else {
+                return false;
+            }
+        }
+#endif
+        if (length > 0) {
+            buffer_.resize(kCopyBufferBytes);
+        }
+        while (length > 0) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(length, buffer_.size()));
+            if (!readAt(in_fd_, buffer_.data(), n, in_offset) || !writeAt(out_fd_, buffer_.data(), n, out_offset)) {
+                return false;
+            }
+            in_offset += n;
+            out_offset += n;
+            length -= n;
+            buffered_bytes_ += n;
+        }
+        return true;
+    }
+
+    [[nodiscard]] uint64_t kernelBytes() const { return kernel_bytes_; }
+
+    [[nodiscard]] uint64_t bufferedBytes() const { return buffered_bytes_; }
+
+private:
+    int in_fd_;
+    int out_fd_;
+    bool use_kernel_;
+    std::vector<char> buffer_;
+    uint64_t kernel_bytes_ = 0;
+    uint64_t buffered_bytes_ = 0;
+};
+
+// A boundary chunk on its way through: read, checked, then filtered in place
+struct BoundaryChunk {
+    uint32_t chunk_id = 0;
+    std::vector<Point> points;
+    uint32_t kept = 0;
+    uint32_t bricks_copied = 0;    // Inside the region, kept without testing their points
+    uint32_t bricks_filtered = 0;
+    uint64_t points_tested = 0;
+    bool read_failed = false;
+    bool crc_mismatch = false;
+};
+
+void cropChunk(int fd, const PcdIndex& index, const PointRegion& region, BoundaryChunk& boundary) {
+    const ChunkMetadata& chunk = index.chunks[boundary.chunk_id];
+    size_t payload = size_t(chunk.point_count) * sizeof(Point);
+    boundary.points.resize(chunk.point_count);
+    if (!readAt(fd, boundary.points.data(), payload, chunk.file_offset)) {
+        boundary.read_failed = true;
+        return;
+    }
+    if (!index.chunk_crcs.empty() &&
+        crc32c(boundary.points.data(), payload) != index.chunk_crcs[boundary.chunk_id]) {
+        boundary.crc_mismatch = true;
+        return;
+    }
+
+    Point* points = boundary.points.data();
+    const PcdBrick* bricks = index.chunkBricks(boundary.chunk_id);
+    if (bricks == nullptr) {
+        boundary.kept = static_cast<uint32_t>(region.filter(points, chunk.point_count, points));
+        boundary.points_tested = chunk.point_count;
+        return;
+    }
+
+    // Bricks are contiguous runs of the payload, so kept points can be compacted in place
+    uint32_t kept = 0;
+    for (uint32_t b = 0; b < index.bricks_per_chunk; ++b) {
+        const PcdBrick& brick = bricks[b];
+        if (brick.point_count == 0 || brick.first_point + uint64_t(brick.point_count) > chunk.point_count) {
+            continue;
+        }
+        switch (region.classify(brick.bbox)) {
+            case RegionOverlap::Outside:
+                break;
+            case RegionOverlap::Inside:
+                std::copy(points + brick.first_point, points + brick.first_point + brick.point_count, points + kept);
+                kept += brick.point_count;
+                boundary.bricks_copied++;
+                break;
+            case RegionOverlap::Partial:
+                kept += static_cast<uint32_t>(region.filter(points + brick.first_point, brick.point_count, points + kept));
+                boundary.points_tested += brick.point_count;
+                boundary.bricks_filtered++;
+                break;
+        }
+    }
+    boundary.kept = kept;
+}
+
+bool sameFile(const std::string& a, const std::string& b) {
+    struct stat sa{}, sb{};
+    return stat(a.c_str(), &sa) == 0 && stat(b.c_str(), &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+double megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    std::vector<PointRegion> regions;
+    uint32_t threads = 0;
+    bool use_kernel = true;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--box" || arg == "--sphere" || arg == "--frustum") && i + 1 < argc) {
+            usage |= !parseRegion(arg, argv[++i], regions);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-copy-range") {
+            use_kernel = false;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (usage || args.size() != 2 || regions.size() != 1) {
+        std::cerr << "Usage: " << argv[0] << " <input.pcd> <output.pcd>"
+                  << " (--box X0,Y0,Z0,X1,Y1,Z1 | --sphere X,Y,Z,R"
+                  << " | --frustum EX,EY,EZ,TX,TY,TZ,FOV,ASPECT,NEAR,FAR)"
+                  << " [--threads N] [--no-copy-range]" << std::endl;
+        return 1;
+    }
+    const std::string& input = args[0];
+    const std::string& output = args[1];
+    const PointRegion& region = regions[0];
+
+    if (sameFile(input, output)) {
+        std::cerr << "The output would overwrite the input" << std::endl;
+        return 1;
+    }
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(input, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    auto start = Clock::now();
+    auto chunk_count = static_cast<uint32_t>(index.chunks.size());
+
+    // 1) Classify every chunk by its bounding box
+    std::vector<RegionOverlap> overlap(chunk_count);
+    uint32_t inside = 0, partial = 0;
+    uint64_t inside_points = 0;
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        overlap[i] = index.chunks[i].point_count > 0 ? region.classify(index.chunks[i].bbox) : RegionOverlap::Outside;
+        if (overlap[i] == RegionOverlap::Inside) {
+            inside++;
+            inside_points += index.chunks[i].point_count;
+        } else if (overlap[i] == RegionOverlap::Partial) {
+            partial++;
+        }
+    }
+
+    std::cout << "Cropping " << input << " (" << chunk_count << " chunks, " << index.header.total_points
+              << " points) to a " << PointRegion::kindName(region.kind()) << ": " << inside << " chunks inside, "
+              << partial << " on the boundary" << std::endl;
+    if (inside + partial == 0) {
+        std::cerr << "No chunk reaches into the region" << std::endl;
+        return 1;
+    }
+
+    // 2) Write the chunks in index order. The output keeps the input's flags, so copied chunks
+    //    keep their padding, bricks and CRC as they are.
+    uint32_t flags = headerFlags(index.header);
+    PcdWriteOptions options;
+    options.align_payloads = flags & PCD_FLAG_ALIGNED_PAYLOADS;
+    options.chunk_size = index.header.chunk_size;
+    options.bricks_per_chunk = index.bricks_per_chunk;
+    options.chunk_crcs = !index.chunk_crcs.empty();
+
+    PcdWriter writer;
+    if (!writer.open(output, inside + partial, options)) {
+        std::cerr << writer.error() << std::endl;
+        return 1;
+    }
+
+    int in_fd = open(input.c_str(), O_RDONLY | O_CLOEXEC);
+    int out_fd = open(output.c_str(), O_WRONLY | O_CLOEXEC);
+    if (in_fd < 0 || out_fd < 0) {
+        std::cerr << "Failed to open " << (in_fd < 0 ? input : output) << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    JobSystem jobs(threads > 0 ? threads - 1 : JobSystem::kAutoWorkers);
+    RangeCopier copier(in_fd, out_fd, use_kernel);
+    std::vector<BoundaryChunk> window;
+    uint64_t points_tested = 0, bytes_read = 0;
+    uint32_t bricks_copied = 0, bricks_filtered = 0, emptied = 0;
+    bool ok = true;
+
+    for (uint32_t first = 0; first < chunk_count && ok;) {
+        // Boundary chunks up to the window's size, at least one
+        uint32_t last = first;
+        uint64_t window_bytes = 0;
+        window.clear();
+        for (; last < chunk_count; ++last) {
+            if (overlap[last] != RegionOverlap::Partial) {
+                continue;
+            }
+            uint64_t bytes = uint64_t(index.chunks[last].point_count) * sizeof(Point);
+            if (!window.empty() && window_bytes + bytes > kWindowBytes) {
+                break;
+            }
+            window_bytes += bytes;
+            window.emplace_back();
+            window.back().chunk_id = last;
+        }
+
+        jobs.parallelFor(0, window.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t w = begin; w < end; ++w) {
+                cropChunk(in_fd, index, region, window[w]);
+            }
+        });
+        bytes_read += window_bytes;
+
+        size_t next_boundary = 0;
+        for (uint32_t i = first; i < last && ok; ++i) {
+            const ChunkMetadata& chunk = index.chunks[i];
+            if (overlap[i] == RegionOverlap::Inside) {
+                uint64_t offset = 0;
+                uint64_t length = uint64_t(chunk.point_count) * sizeof(Point) + payloadPadding(index.header, chunk);
+                uint32_t crc = options.chunk_crcs ? index.chunk_crcs[i] : 0;
+                if (!writer.reserveChunk(chunk, index.chunkBricks(i), crc, offset)) {
+                    std::cerr << writer.error() << std::endl;
+                    ok = false;
+                } else if (!copier.copy(chunk.file_offset, offset, length)) {
+                    std::cerr << "Failed to copy chunk " << i << ": " << std::strerror(errno) << std::endl;
+                    ok = false;
+                }
+            } else if (overlap[i] == RegionOverlap::Partial) {
+                BoundaryChunk& boundary = window[next_boundary++];
+                if (boundary.read_failed || boundary.crc_mismatch) {
+                    // Don't carry corruption into the output
+                    std::cerr << "Chunk " << i << " of " << input
+                              << (boundary.read_failed ? " can't be read" : " doesn't match its CRC") << std::endl;
+                    ok = false;
+                    break;
+                }
+                points_tested += boundary.points_tested;
+                bricks_copied += boundary.bricks_copied;
+                bricks_filtered += boundary.bricks_filtered;
+                if (boundary.kept == 0) {
+                    emptied++;
+                } else if (!writer.writeChunk(boundary.points.data(), boundary.kept)) {
+                    std::cerr << writer.error() << std::endl;
+                    ok = false;
+                }
+                boundary.points = {};
+            }
+        }
+        first = last;
+    }
+
+    close(in_fd);
+    close(out_fd);
+    if (!ok || !writer.finish()) {
+        if (ok) {
+            std::cerr << writer.error() << std::endl;
+        }
+        unlink(output.c_str());
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t copied_bytes = copier.kernelBytes() + copier.bufferedBytes();
+    uint64_t filtered_points = writer.totalPoints() - inside_points;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Copied " << inside << " chunks (" << inside_points << " points, " << megabytes(copied_bytes)
+              << " MB, " << megabytes(copier.kernelBytes()) << " MB with copy_file_range)" << std::endl;
+    std::cout << "Filtered " << partial << " chunks: read " << megabytes(bytes_read) << " MB, tested "
+              << points_tested << " points, kept " << filtered_points;
+    if (index.bricks_per_chunk > 0) {
+        std::cout << " (" << bricks_copied << " bricks kept whole, " << bricks_filtered << " filtered)";
+    }
+    if (emptied > 0) {
+        std::cout << "; " << emptied << " chunks had none left";
+    }
+    std::cout << std::endl;
+
+    uint32_t written = inside + partial - emptied;
+    std::cout << "Wrote " << output << ": " << written << " chunks, " << writer.totalPoints() << " points, "
+              << megabytes(writer.fileSize()) << " MB in " << std::setprecision(3) << seconds << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "PointDecimation.h"
+#include "JobSystem.h"
+#include "Crc32c.h"
+
+// Thins a .pcd out to a coarser spacing or a point budget, for devices that can't take the full
+// density. Chunks are streamed through a window that fits the memory budget: read in index
+// order, decimated in parallel on the job system, then written in the same order, so the output
+// has the input's chunks (same count, same order, same octree cells) with fewer points in each.
+// Its header's chunk_size is the largest decimated chunk, which shrinks the app's per-slot
+// buffers to match.
+
+// Memory per point in the window: the points read, the voxel sort's (code, index) pairs or the
+// Poisson grid, and the points kept
+constexpr size_t kBytesPerPoint = 48;
+
+// Chunks decimated at each candidate spacing when --points picks one
+constexpr uint32_t kSampleChunks = 32;
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Reads chunk @a chunk_id and checks it against its CRC; false with a message if it can't
+bool readChunk(std::ifstream& in, const PcdIndex& index, uint32_t chunk_id, Point* points) {
+    const ChunkMetadata& chunk = index.chunks[chunk_id];
+    size_t bytes = size_t(chunk.point_count) * sizeof(Point);
+    in.seekg(static_cast<std::streamoff>(chunk.file_offset));
+    if (!in.read(reinterpret_cast<char*>(points), static_cast<std::streamsize>(bytes))) {
+        std::cerr << "Failed to read chunk " << chunk_id << std::endl;
+        return false;
+    }
+    // Don't carry corruption into a file with fresh CRCs
+    if (!index.chunk_crcs.empty() && crc32c(points, bytes) != index.chunk_crcs[chunk_id]) {
+        std::cerr << "Chunk " << chunk_id << " doesn't match its CRC" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Streams every chunk through windows of at most @a budget points, a bigger chunk getting one of
+ * its own: reads them in index order, then calls fn(first_chunk, chunks, points, offsets), where
+ * chunk first_chunk + i is points[offsets[i], offsets[i + 1]).
+ */
+template <typename Fn>
+bool forEachWindow(std::ifstream& in, const PcdIndex& index, uint64_t budget, Fn fn) {
+    auto chunk_count = static_cast<uint32_t>(index.chunks.size());
+    std::vector<Point> window;
+    std::vector<size_t> offsets;
+    for (uint32_t first = 0; first < chunk_count;) {
+        uint32_t last = first;
+        uint64_t points = 0;
+        while (last < chunk_count && (last == first || points + index.chunks[last].point_count <= budget)) {
+            points += index.chunks[last++].point_count;
+        }
+
+        window.resize(points);
+        offsets.assign(1, 0);
+        for (uint32_t chunk_id = first; chunk_id < last; ++chunk_id) {
+            if (!readChunk(in, index, chunk_id, window.data() + offsets.back())) {
+                return false;
+            }
+            offsets.push_back(offsets.back() + index.chunks[chunk_id].point_count);
+        }
+        if (!fn(first, last - first, window.data(), offsets)) {
+            return false;
+        }
+        first = last;
+    }
+    return true;
+}
+
+/*!
+ * Finds the spacing that leaves about @a target points. A pass over the file counts the voxels
+ * every chunk has on a ladder of spacings that double from the finest grid (countVoxels), which
+ * is exact at those spacings. Between them the count is bisected on an evenly spread sample of
+ * chunks, scaled to the whole file by the ladder step below, so the sample only has to get the
+ * shape of the curve right, not the file's density.
+ */
+bool pickSpacing(std::ifstream& in, const PcdIndex& index, DecimationOptions& options, uint64_t target,
+                 uint64_t budget, JobSystem& jobs) {
+    constexpr int kLevels = 21;
+    const BoundingBox& b = index.header.bounds;
+    double extent = std::max({b.max_x - b.min_x, b.max_y - b.min_y, b.max_z - b.min_z, 1e-6f});
+
+    DecimationOptions ladder = options;
+    ladder.spacing = static_cast<float>(extent / double(kDecimationGridCells / 2));
+
+    uint64_t file_counts[kLevels] = {};
+    std::vector<std::array<uint64_t, kLevels>> chunk_counts;
+    bool read = forEachWindow(in, index, budget, [&](uint32_t, uint32_t chunks, const Point* points,
+                                                     const std::vector<size_t>& offsets) {
+        chunk_counts.assign(chunks, {});
+        jobs.parallelFor(0, chunks, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; ++c) {
+                countVoxels(points + offsets[c], offsets[c + 1] - offsets[c], ladder, kLevels, chunk_counts[c].data());
+            }
+        });
+        for (const auto& counts : chunk_counts) {
+            for (int level = 0; level < kLevels; ++level) {
+                file_counts[level] += counts[level];
+            }
+        }
+        return true;
+    });
+    if (!read) {
+        return false;
+    }
+
+    auto chunk_count = static_cast<uint32_t>(index.chunks.size());
+    uint32_t step = std::max<uint32_t>(1, chunk_count / kSampleChunks);
+    std::vector<uint32_t> sample;
+    std::vector<std::vector<Point>> points;
+    uint64_t sample_counts[kLevels] = {};
+    for (uint32_t chunk_id = step / 2; chunk_id < chunk_count; chunk_id += step) {
+        if (index.chunks[chunk_id].point_count == 0) {
+            continue;
+        }
+        points.emplace_back(index.chunks[chunk_id].point_count);
+        if (!readChunk(in, index, chunk_id, points.back().data())) {
+            return false;
+        }
+        countVoxels(points.back().data(), points.back().size(), ladder, kLevels, sample_counts);
+        sample.push_back(chunk_id);
+    }
+
+    std::vector<uint64_t> kept(sample.size());
+    auto estimate = [&](double spacing) {
+        DecimationOptions trial = options;
+        trial.spacing = static_cast<float>(spacing);
+        jobs.parallelFor(0, sample.size(), 1, [&](size_t first, size_t last) {
+            std::vector<Point> out;
+            for (size_t s = first; s < last; ++s) {
+                out.clear();
+                kept[s] = decimatePoints(points[s].data(), points[s].size(), trial, sample[s], out);
+            }
+        });
+        uint64_t total = 0;
+        for (uint64_t k : kept) {
+            total += k;
+        }
+        // The file's count over the sample's on the ladder, interpolated between the rungs around
+        auto scale = [&](int level) {
+            return double(file_counts[level]) / double(std::max<uint64_t>(1, sample_counts[level]));
+        };
+        double rung = std::clamp(std::log2(spacing / ladder.spacing), 0.0, double(kLevels - 1));
+        int level = std::min(static_cast<int>(rung), kLevels - 2);
+        double t = rung - level;
+        return double(total) * std::pow(scale(level), 1.0 - t) * std::pow(scale(level + 1), t);
+    };
+
+    // Fewer points the coarser the spacing
+    double lo = ladder.spacing;
+    double hi = extent;
+    for (int iteration = 0; iteration < 24 && hi / lo > 1.001; ++iteration) {
+        double mid = std::sqrt(lo * hi);
+        if (estimate(mid) > double(target)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    options.spacing = static_cast<float>(hi);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    DecimationOptions options;
+    options.spacing = 0.0f;
+    uint64_t target_points = 0;
+    uint64_t memory_mb = 512;
+    uint32_t threads = 0;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--method" && i + 1 < argc) {
+            usage |= !parseDecimationMethod(argv[++i], options.method);
+        } else if (arg == "--spacing" && i + 1 < argc) {
+            options.spacing = std::strtof(argv[++i], nullptr);
+            usage |= !(options.spacing > 0.0f);
+        } else if (arg == "--points" && i + 1 < argc) {
+            target_points = std::strtoull(argv[++i], nullptr, 10);
+            usage |= target_points == 0;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--memory-mb" && i + 1 < argc) {
+            memory_mb = std::max<uint64_t>(16, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (usage || args.size() != 2 || (options.spacing > 0.0f) == (target_points > 0)) {
+        std::cerr << "Usage: " << argv[0] << " <input.pcd> <output.pcd> (--spacing S | --points N)"
+                  << " [--method voxel|poisson] [--seed N] [--memory-mb N] [--threads N]" << std::endl;
+        return 1;
+    }
+    const std::string& input = args[0];
+    const std::string& output = args[1];
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(input, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open " << input << std::endl;
+        return 1;
+    }
+
+    // Every chunk uses the same grid, anchored at the dataset's corner
+    const BoundingBox& bounds = index.header.bounds;
+    options.origin[0] = bounds.min_x;
+    options.origin[1] = bounds.min_y;
+    options.origin[2] = bounds.min_z;
+
+    JobSystem jobs(threads > 0 ? threads - 1 : JobSystem::kAutoWorkers);
+    uint64_t window_points = std::max<uint64_t>(1, memory_mb * 1024 * 1024 / kBytesPerPoint);
+    auto start = Clock::now();
+
+    if (target_points > 0) {
+        if (target_points >= index.header.total_points) {
+            std::cerr << input << " has only " << index.header.total_points << " points" << std::endl;
+            return 1;
+        }
+        if (!pickSpacing(in, index, options, target_points, window_points, jobs)) {
+            return 1;
+        }
+        std::cout << "Spacing " << options.spacing << " for about " << target_points << " points (picked in "
+                  << std::lround(secondsSince(start) * 1000.0) << " ms)" << std::endl;
+    }
+
+    float extent = std::max({bounds.max_x - bounds.min_x, bounds.max_y - bounds.min_y, bounds.max_z - bounds.min_z});
+    if (extent / options.spacing >= float(kDecimationGridCells)) {
+        std::cerr << "Spacing " << options.spacing << " is too fine for a dataset " << extent
+                  << " across; the grid has " << kDecimationGridCells << " cells a side" << std::endl;
+        return 1;
+    }
+
+    // The output keeps the input's payload alignment, bricks and CRCs
+    PcdWriteOptions write_options;
+    write_options.align_payloads = headerFlags(index.header) & PCD_FLAG_ALIGNED_PAYLOADS;
+    write_options.chunk_size = index.header.chunk_size;
+    write_options.bricks_per_chunk = index.bricks_per_chunk;
+    write_options.chunk_crcs = !index.chunk_crcs.empty();
+
+    auto chunk_count = static_cast<uint32_t>(index.chunks.size());
+    PcdWriter writer;
+    if (!writer.open(output, chunk_count, write_options)) {
+        std::cerr << writer.error() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Decimating " << input << " (" << chunk_count << " chunks, " << index.header.total_points
+              << " points) with a " << decimationMethodName(options.method) << " spacing of " << options.spacing
+              << " on " << jobs.concurrency() << " threads, " << memory_mb << " MB budget" << std::endl;
+
+    // Stream windows of whole chunks: read, decimate in parallel, write in index order
+    std::vector<std::vector<Point>> kept;
+    uint32_t largest = 0;
+    bool written = forEachWindow(in, index, window_points, [&](uint32_t first, uint32_t chunks, const Point* points,
+                                                               const std::vector<size_t>& offsets) {
+        kept.resize(chunks);
+        jobs.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                kept[c].clear();
+                decimatePoints(points + offsets[c], offsets[c + 1] - offsets[c], options, first + c, kept[c]);
+            }
+        });
+
+        for (auto& chunk : kept) {
+            auto count = static_cast<uint32_t>(chunk.size());
+            if (!writer.writeChunk(chunk.data(), count)) {
+                std::cerr << writer.error() << std::endl;
+                return false;
+            }
+            largest = std::max(largest, count);
+            chunk = {};
+        }
+        return true;
+    });
+    if (!written) {
+        return 1;
+    }
+
+    writer.setChunkSize(std::max<uint32_t>(largest, 1));
+    if (!writer.finish()) {
+        std::cerr << writer.error() << std::endl;
+        return 1;
+    }
+
+    double seconds = secondsSince(start);
+    uint64_t total = writer.totalPoints();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Kept " << total << " of " << index.header.total_points << " points ("
+              << 100.0 * double(total) / double(std::max<uint64_t>(1, index.header.total_points))
+              << "%), largest chunk " << largest << " points (was " << index.header.chunk_size << ")" << std::endl;
+    std::cout << "Wrote " << output << ": " << writer.fileSize() / (1024.0 * 1024.0) << " MB in " << seconds
+              << " s, " << double(index.header.total_points) / seconds / 1e6 << " M points/s" << std::endl;
+    return 0;
+}
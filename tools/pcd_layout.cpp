@@ -0,0 +1,431 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "ChunkTrace.h"
+#include "Crc32c.h"
+
+// Rewrites a .pcd with chunk payloads ordered so that chunks loaded together sit next to each
+// other on disk, using chunk load traces recorded by the app or streaming_bench. The index keeps
+// its order, so chunk ids and traces stay valid; only file_offset changes.
+
+// Chunks loaded in one frame: the runtime hands them to the loader as one batch
+using Batch = std::vector<uint32_t>;
+
+struct ReplayResult {
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+};
+
+// Where a chunk's bytes live, padding included, so adjacency can be judged from offsets alone
+struct Extent {
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Evict the file from the page cache so both layouts are replayed cold
+void dropFromPageCache(const std::string& filename) {
+#ifdef POSIX_FADV_DONTNEED
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
+std::vector<Extent> fileExtents(const PcdIndex& index) {
+    std::vector<Extent> extents;
+    extents.reserve(index.chunks.size());
+    for (const auto& chunk : index.chunks) {
+        extents.push_back({chunk.file_offset,
+                           uint64_t(chunk.point_count) * sizeof(Point) +
+                           payloadPadding(index.header, chunk)});
+    }
+    return extents;
+}
+
+// Extents the chunks would get if written in @a order, relative to the first payload
+std::vector<Extent> plannedExtents(const PcdIndex& index, const std::vector<uint32_t>& order) {
+    bool aligned = headerFlags(index.header) & PCD_FLAG_ALIGNED_PAYLOADS;
+    std::vector<Extent> extents(index.chunks.size());
+    uint64_t offset = 0;
+    for (uint32_t chunk_id : order) {
+        uint64_t payload = uint64_t(index.chunks[chunk_id].point_count) * sizeof(Point);
+        uint64_t length = aligned ? alignUp(payload, PCD_PAYLOAD_ALIGNMENT) : payload;
+        extents[chunk_id] = {offset, length};
+        offset += length;
+    }
+    return extents;
+}
+
+// Merges a batch into as few reads as possible: chunks separated by at most max_gap bytes are
+// read in one request, gap included
+std::vector<Extent> coalesce(const Batch& batch, const std::vector<Extent>& extents,
+                             uint64_t max_gap) {
+    std::vector<Extent> ranges;
+    ranges.reserve(batch.size());
+    for (uint32_t chunk_id : batch) {
+        ranges.push_back(extents[chunk_id]);
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const Extent& a, const Extent& b) { return a.offset < b.offset; });
+
+    std::vector<Extent> merged;
+    for (const Extent& range : ranges) {
+        if (!merged.empty()) {
+            Extent& last = merged.back();
+            uint64_t end = last.offset + last.length;
+            if (range.offset <= end + max_gap) {
+                last.length = std::max(end, range.offset + range.length) - last.offset;
+                continue;
+            }
+        }
+        merged.push_back(range);
+    }
+    return merged;
+}
+
+uint64_t countRequests(const std::vector<Batch>& batches, const std::vector<Extent>& extents,
+                       uint64_t max_gap) {
+    uint64_t requests = 0;
+    for (const auto& batch : batches) {
+        requests += coalesce(batch, extents, max_gap).size();
+    }
+    return requests;
+}
+
+// Reads every batch from the file the way the predicted count assumes, one pread per range, and
+// times it. The request count is the prediction's by construction, so only bytes and time are
+// measured.
+bool replay(const std::string& filename, const std::vector<Batch>& batches,
+            const std::vector<Extent>& extents, uint64_t max_gap, ReplayResult& result) {
+    dropFromPageCache(filename);
+
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << filename << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::vector<char> buffer;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& batch : batches) {
+        for (const Extent& range : coalesce(batch, extents, max_gap)) {
+            buffer.resize(std::max<size_t>(buffer.size(), range.length));
+            ssize_t n = pread(fd, buffer.data(), range.length, static_cast<off_t>(range.offset));
+            if (n < 0) {
+                std::cerr << "Read failed: " << std::strerror(errno) << std::endl;
+                close(fd);
+                return false;
+            }
+            result.bytes += n;
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(fd);
+    return true;
+}
+
+/*!
+ * Pettis-Hansen style chain merging: edges are taken heaviest first, and two chains are joined
+ * when the edge connects an end of one to an end of the other. Chains are then laid out in the
+ * order the traces first touched them; chunks no trace loaded keep their original order at the
+ * end of the file.
+ */
+std::vector<uint32_t> layoutChunks(const PcdIndex& index,
+                                   const std::unordered_map<uint64_t, uint32_t>& edges,
+                                   const std::vector<uint64_t>& first_use) {
+    auto chunk_count = static_cast<uint32_t>(index.chunks.size());
+
+    std::vector<std::pair<uint64_t, uint32_t>> sorted(edges.begin(), edges.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+
+    // Each chunk starts as its own chain; chain_of points at the chain's slot in chains
+    std::vector<std::vector<uint32_t>> chains(chunk_count);
+    std::vector<uint32_t> chain_of(chunk_count);
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        chains[i] = {i};
+        chain_of[i] = i;
+    }
+
+    for (const auto& [key, weight] : sorted) {
+        auto a = static_cast<uint32_t>(key >> 32);
+        auto b = static_cast<uint32_t>(key & 0xffffffffu);
+        uint32_t ca = chain_of[a];
+        uint32_t cb = chain_of[b];
+        if (ca == cb) {
+            continue;
+        }
+
+        std::vector<uint32_t>& left = chains[ca];
+        std::vector<uint32_t>& right = chains[cb];
+        bool a_end = left.back() == a || left.front() == a;
+        bool b_end = right.back() == b || right.front() == b;
+        if (!a_end || !b_end) {
+            continue;
+        }
+
+        // Orient so the chains meet at a and b
+        if (left.back() != a) {
+            std::reverse(left.begin(), left.end());
+        }
+        if (right.front() != b) {
+            std::reverse(right.begin(), right.end());
+        }
+
+        for (uint32_t chunk_id : right) {
+            chain_of[chunk_id] = ca;
+        }
+        left.insert(left.end(), right.begin(), right.end());
+        right.clear();
+    }
+
+    std::vector<uint32_t> heads;
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        if (!chains[i].empty()) {
+            heads.push_back(i);
+        }
+    }
+
+    auto chainFirstUse = [&](uint32_t chain) {
+        uint64_t first = UINT64_MAX;
+        for (uint32_t chunk_id : chains[chain]) {
+            first = std::min(first, first_use[chunk_id]);
+        }
+        return first;
+    };
+
+    std::vector<uint64_t> chain_first(chunk_count, UINT64_MAX);
+    for (uint32_t chain : heads) {
+        chain_first[chain] = chainFirstUse(chain);
+    }
+
+    // Untouched singletons sort last, by chunk id, which is their original order for files
+    // written by the generator
+    std::stable_sort(heads.begin(), heads.end(), [&](uint32_t a, uint32_t b) {
+        return chain_first[a] < chain_first[b];
+    });
+
+    std::vector<uint32_t> order;
+    order.reserve(chunk_count);
+    for (uint32_t chain : heads) {
+        order.insert(order.end(), chains[chain].begin(), chains[chain].end());
+    }
+    return order;
+}
+
+bool writeLayout(const std::string& input, const std::string& output, const PcdIndex& index,
+                 const std::vector<uint32_t>& order) {
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open " << input << std::endl;
+        return false;
+    }
+
+    PcdWriteOptions options;
+    options.align_payloads = headerFlags(index.header) & PCD_FLAG_ALIGNED_PAYLOADS;
+    options.chunk_size = index.header.chunk_size;
+    // Payloads are already grouped by brick, so the writer finds the same bricks again
+    options.bricks_per_chunk = index.bricks_per_chunk;
+    options.chunk_crcs = !index.chunk_crcs.empty();
+
+    PcdWriter writer;
+    if (!writer.open(output, static_cast<uint32_t>(index.chunks.size()), options)) {
+        std::cerr << writer.error() << std::endl;
+        return false;
+    }
+
+    std::vector<Point> points;
+    for (uint32_t chunk_id : order) {
+        const ChunkMetadata& chunk = index.chunks[chunk_id];
+        points.resize(chunk.point_count);
+        in.seekg(static_cast<std::streamoff>(chunk.file_offset));
+        if (!in.read(reinterpret_cast<char*>(points.data()),
+                     static_cast<std::streamsize>(chunk.point_count * sizeof(Point)))) {
+            std::cerr << "Failed to read chunk " << chunk_id << " from " << input << std::endl;
+            return false;
+        }
+        // Don't carry corruption into a file with fresh CRCs
+        if (options.chunk_crcs &&
+            crc32c(points.data(), chunk.point_count * sizeof(Point)) != index.chunk_crcs[chunk_id]) {
+            std::cerr << "Chunk " << chunk_id << " of " << input << " doesn't match its CRC" << std::endl;
+            return false;
+        }
+        if (!writer.writeChunk(points.data(), chunk.point_count, chunk.bbox)) {
+            std::cerr << writer.error() << std::endl;
+            return false;
+        }
+    }
+
+    writer.setIndexOrder(order);
+    writer.setBounds(index.header.bounds);
+    if (!writer.finish()) {
+        std::cerr << writer.error() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double reduction(uint64_t before, uint64_t after) {
+    return before > 0 ? 100.0 * (1.0 - double(after) / double(before)) : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    uint32_t window = 1;
+    uint64_t max_gap = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--window" && i + 1 < argc) {
+            window = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--gap-kb" && i + 1 < argc) {
+            max_gap = std::strtoull(argv[++i], nullptr, 10) * 1024;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <input.pcd> <output.pcd> <trace> [trace...] [--window N] [--gap-kb N]"
+                  << std::endl;
+        return 1;
+    }
+
+    const std::string& input = args[0];
+    const std::string& output = args[1];
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(input, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    auto chunk_count = static_cast<uint32_t>(index.chunks.size());
+    if (chunk_count == 0) {
+        std::cerr << "No chunks found!" << std::endl;
+        return 1;
+    }
+
+    // 1) Group each trace's loads into per-frame batches of chunk ids
+    std::vector<Batch> batches;
+    std::vector<uint64_t> first_use(chunk_count, UINT64_MAX);
+    uint64_t loads = 0, unmapped = 0, sequence = 0;
+
+    for (size_t t = 2; t < args.size(); ++t) {
+        ChunkTrace trace;
+        if (!readChunkTrace(args[t], trace, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+
+        ChunkCodeMap codes(index, trace.depth);
+        uint32_t frame = UINT32_MAX;
+        for (const auto& load : trace.loads) {
+            uint32_t chunk_id = codes.find(load.pos_code);
+            loads++;
+            if (chunk_id == UINT32_MAX) {
+                unmapped++;
+                continue;
+            }
+
+            if (batches.empty() || load.frame != frame) {
+                batches.emplace_back();
+                frame = load.frame;
+            }
+            Batch& batch = batches.back();
+            if (std::find(batch.begin(), batch.end(), chunk_id) == batch.end()) {
+                batch.push_back(chunk_id);
+            }
+            first_use[chunk_id] = std::min(first_use[chunk_id], sequence++);
+        }
+    }
+
+    if (batches.empty()) {
+        std::cerr << "The traces hold no loads of chunks in " << input << std::endl;
+        return 1;
+    }
+
+    // 2) Co-access graph: chunks loaded in the same batch, or within window batches of each
+    //    other, get an edge weighted by how often that happened
+    std::unordered_map<uint64_t, uint32_t> edges;
+    for (size_t i = 0; i < batches.size(); ++i) {
+        for (size_t j = i; j <= std::min(batches.size() - 1, i + window); ++j) {
+            for (uint32_t a : batches[i]) {
+                for (uint32_t b : batches[j]) {
+                    if (a != b) {
+                        uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+                        edges[key] += j == i ? 2 : 1;
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "Traces: " << (args.size() - 2) << ", " << loads << " loads in " << batches.size()
+              << " batches";
+    if (unmapped > 0) {
+        std::cout << " (" << unmapped << " unmatched loads skipped)";
+    }
+    std::cout << std::endl;
+    std::cout << "Co-access graph: " << edges.size() << " edges" << std::endl;
+
+    // 3) Lay the chains out and predict what the traces cost against each layout
+    std::vector<uint32_t> order = layoutChunks(index, edges, first_use);
+
+    std::vector<uint32_t> original_order(chunk_count);
+    std::iota(original_order.begin(), original_order.end(), 0);
+    std::sort(original_order.begin(), original_order.end(), [&](uint32_t a, uint32_t b) {
+        return index.chunks[a].file_offset < index.chunks[b].file_offset;
+    });
+
+    uint64_t predicted_before = countRequests(batches, plannedExtents(index, original_order), max_gap);
+    uint64_t predicted_after = countRequests(batches, plannedExtents(index, order), max_gap);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Predicted read requests: " << predicted_before << " -> " << predicted_after
+              << " (" << reduction(predicted_before, predicted_after) << "% fewer)" << std::endl;
+
+    // 4) Rewrite, then replay the traces against both files
+    if (!writeLayout(input, output, index, order)) {
+        return 1;
+    }
+
+    PcdIndex rewritten;
+    if (!readPcdIndex(output, rewritten, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << output << std::endl;
+
+    ReplayResult before, after;
+    if (!replay(input, batches, fileExtents(index), max_gap, before) ||
+        !replay(output, batches, fileExtents(rewritten), max_gap, after)) {
+        return 1;
+    }
+
+    std::cout << std::setprecision(3) << "Replay time: " << before.seconds << " s -> "
+              << after.seconds << " s (" << (before.bytes / 1024 / 1024) << " MB -> "
+              << (after.bytes / 1024 / 1024) << " MB read)" << std::endl;
+
+    return 0;
+}
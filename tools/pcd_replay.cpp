@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "PointIngest.h"
+
+// Plays a .pcd back as a live point stream, standing in for a sensor: the stream header with
+// the file's bounds, then every point, optionally paced to a fixed rate. Messages go to stderr,
+// since with '-' the stream itself goes to stdout.
+
+// Connects to the UNIX socket at @a path; a leading '@' names one in the abstract namespace
+int connectSocket(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    bool abstract = path[0] == '@';
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    if (abstract) {
+        addr.sun_path[0] = '\0';
+    }
+    auto length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + (abstract ? 0 : 1));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), length) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+bool writeFully(int fd, const void* data, size_t length) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    double rate = 0.0;
+    bool shuffle = false;
+    size_t batch = 4096;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rate" && i + 1 < argc) {
+            rate = std::atof(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--shuffle") {
+            shuffle = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <pointcloud_file> <socket|-> [--rate points/s] [--batch N] [--shuffle]" << std::endl;
+        return 1;
+    }
+
+    const std::string& filename = args[0];
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(filename, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    // In chunk order a stream fills one cell at a time; shuffled, every cell fills at once,
+    // like a sensor sweeping the whole scene
+    std::ifstream file(filename, std::ios::binary);
+    std::vector<Point> points;
+    points.reserve(index.header.total_points);
+    for (const auto& chunk : index.chunks) {
+        size_t first = points.size();
+        points.resize(first + chunk.point_count);
+        file.seekg(static_cast<std::streamoff>(chunk.file_offset));
+        file.read(reinterpret_cast<char*>(points.data() + first),
+                  static_cast<std::streamsize>(chunk.point_count * sizeof(Point)));
+    }
+    if (!file) {
+        std::cerr << "Failed to read points" << std::endl;
+        return 1;
+    }
+    if (shuffle) {
+        std::shuffle(points.begin(), points.end(), std::mt19937(1));
+    }
+
+    int fd = STDOUT_FILENO;
+    if (args[1] != "-") {
+        fd = connectSocket(args[1]);
+        if (fd < 0) {
+            std::cerr << "Failed to connect to " << args[1] << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    // A receiver that goes away shows up as a failed write rather than a signal
+    std::signal(SIGPIPE, SIG_IGN);
+
+    PointStreamHeader header{};
+    std::memcpy(header.magic, PCD_STREAM_MAGIC, sizeof(PCD_STREAM_MAGIC));
+    header.bounds = index.header.bounds;
+    if (!writeFully(fd, &header, sizeof(header))) {
+        std::cerr << "Write failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    while (sent < points.size()) {
+        size_t n = std::min(batch, points.size() - sent);
+        if (!writeFully(fd, points.data() + sent, n * sizeof(Point))) {
+            std::cerr << "Write failed after " << sent << " points: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        sent += n;
+
+        if (rate > 0.0) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(double(sent) / rate)));
+        }
+    }
+    if (fd != STDOUT_FILENO) {
+        close(fd);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Sent " << sent << " points in " << std::fixed << std::setprecision(2) << seconds
+              << " s (" << std::setprecision(0) << double(sent) / std::max(seconds, 1e-9)
+              << " points/s)" << std::endl;
+    return 0;
+}
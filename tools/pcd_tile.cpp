@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "TileManifest.h"
+#include "Morton.h"
+#include "Crc32c.h"
+
+// Splits a .pcd into tiles, one .pcd per octree cell at a chosen level, and writes a manifest
+// listing them with their bounds (see TileManifest.h). Chunks are never split: each goes to the
+// tile holding its center, payload byte for byte, so the tiles' chunks together make up the
+// same octree as the input and the app can open tiles as the camera nears them. Tiles are
+// written next to the manifest, named after it and their cell.
+
+using Clock = std::chrono::steady_clock;
+
+// Octree cell at @a level holding the center of every chunk
+std::vector<uint32_t> chunkCells(const PcdIndex& index, int level) {
+    std::vector<uint32_t> cells;
+    cells.reserve(index.chunks.size());
+    for (const ChunkMetadata& chunk : index.chunks) {
+        float cx, cy, cz;
+        chunk.bbox.getCenter(cx, cy, cz);
+        cells.push_back(mortonCell(cx, cy, cz, index.header.bounds, level));
+    }
+    return cells;
+}
+
+// Payload bytes of the biggest tile at @a level
+uint64_t largestTile(const PcdIndex& index, int level) {
+    std::vector<uint32_t> cells = chunkCells(index, level);
+    std::map<uint32_t, uint64_t> bytes;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        bytes[cells[i]] += uint64_t(index.chunks[i].point_count) * sizeof(Point);
+    }
+    uint64_t largest = 0;
+    for (const auto& tile : bytes) {
+        largest = std::max(largest, tile.second);
+    }
+    return largest;
+}
+
+// Copies @a chunks of the input into a new .pcd with the input's alignment, bricks and CRCs
+bool writeTile(std::ifstream& in, const PcdIndex& index, const std::vector<uint32_t>& chunks,
+               const std::string& path, std::vector<Point>& points) {
+    PcdWriteOptions options;
+    options.align_payloads = headerFlags(index.header) & PCD_FLAG_ALIGNED_PAYLOADS;
+    options.chunk_size = index.header.chunk_size;
+    // Payloads are already grouped by brick, so the writer finds the same bricks again
+    options.bricks_per_chunk = index.bricks_per_chunk;
+    options.chunk_crcs = !index.chunk_crcs.empty();
+
+    PcdWriter writer;
+    if (!writer.open(path, static_cast<uint32_t>(chunks.size()), options)) {
+        std::cerr << writer.error() << std::endl;
+        return false;
+    }
+
+    for (uint32_t chunk_id : chunks) {
+        const ChunkMetadata& chunk = index.chunks[chunk_id];
+        size_t bytes = size_t(chunk.point_count) * sizeof(Point);
+        points.resize(chunk.point_count);
+        in.seekg(static_cast<std::streamoff>(chunk.file_offset));
+        if (!in.read(reinterpret_cast<char*>(points.data()), static_cast<std::streamsize>(bytes))) {
+            std::cerr << "Failed to read chunk " << chunk_id << std::endl;
+            return false;
+        }
+        // Don't carry corruption into a file with fresh CRCs
+        if (options.chunk_crcs && crc32c(points.data(), bytes) != index.chunk_crcs[chunk_id]) {
+            std::cerr << "Chunk " << chunk_id << " doesn't match its CRC" << std::endl;
+            return false;
+        }
+        if (!writer.writeChunk(points.data(), chunk.point_count, chunk.bbox)) {
+            std::cerr << writer.error() << std::endl;
+            return false;
+        }
+    }
+
+    if (!writer.finish()) {
+        std::cerr << writer.error() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    int level = 0;
+    uint64_t tile_mb = 256;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--level" && i + 1 < argc) {
+            level = std::atoi(argv[++i]);
+            usage |= level < 1 || level > MORTON_MAX_DEPTH;
+        } else if (arg == "--tile-mb" && i + 1 < argc) {
+            tile_mb = std::strtoull(argv[++i], nullptr, 10);
+            usage |= tile_mb == 0;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (usage || args.size() != 2) {
+        std::cerr << "Usage: " << argv[0] << " <input.pcd> <output.tiles> [--level N | --tile-mb N]" << std::endl;
+        return 1;
+    }
+    const std::string& input = args[0];
+    const std::string& output = args[1];
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(input, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (index.chunks.empty()) {
+        std::cerr << "No chunks found!" << std::endl;
+        return 1;
+    }
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open " << input << std::endl;
+        return 1;
+    }
+    auto start = Clock::now();
+
+    TileManifest manifest;
+    manifest.bounds = index.header.bounds;
+    manifest.depth = 1;
+    for (const ChunkMetadata& chunk : index.chunks) {
+        manifest.depth = std::max(manifest.depth, chunkOctreeDepth(chunk.bbox, index.header.bounds));
+    }
+
+    // The coarsest level whose tiles all fit, never finer than the chunks themselves
+    if (level == 0) {
+        level = 1;
+        while (level < manifest.depth && largestTile(index, level) > tile_mb * 1024 * 1024) {
+            level++;
+        }
+    }
+
+    // Tiles in Morton order, chunks in input order within each
+    std::vector<uint32_t> cells = chunkCells(index, level);
+    std::map<uint32_t, std::vector<uint32_t>> tiles;
+    for (uint32_t chunk_id = 0; chunk_id < cells.size(); ++chunk_id) {
+        tiles[cells[chunk_id]].push_back(chunk_id);
+    }
+
+    std::cout << "Splitting " << input << " (" << index.chunks.size() << " chunks, " << index.header.total_points
+              << " points) into " << tiles.size() << " tiles at level " << level << " of " << manifest.depth
+              << std::endl;
+
+    // Tiles are named after the manifest, without its extension, and their cell
+    std::string stem = output.substr(output.find_last_of("/\\") + 1);
+    stem = stem.substr(0, stem.rfind('.'));
+
+    manifest.flags = PCD_FLAG_ALIGNED_PAYLOADS | PCD_FLAG_BRICKS | PCD_FLAG_CHUNK_CRCS;
+    std::vector<Point> points;
+    uint64_t bytes = 0;
+    for (const auto& cell : tiles) {
+        MortonIndices indices = mortonDecode(cell.first);
+        TileEntry tile;
+        tile.path = stem + "_" + std::to_string(indices.x) + "_" + std::to_string(indices.y) + "_" +
+                    std::to_string(indices.z) + ".pcd";
+        std::string path = tilePath(output, tile);
+        if (!writeTile(in, index, cell.second, path, points)) {
+            return 1;
+        }
+
+        // Read back what was written, so the manifest describes the tile as readers will see it
+        PcdIndex written;
+        if (!readPcdIndex(path, written, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        tile.bounds = written.header.bounds;
+        tile.chunk_count = written.header.chunk_count;
+        tile.total_points = written.header.total_points;
+        manifest.tiles.push_back(tile);
+        manifest.chunk_size = std::max(manifest.chunk_size, written.header.chunk_size);
+        manifest.flags &= headerFlags(written.header);
+        manifest.bricks_per_chunk = written.bricks_per_chunk;
+        for (const ChunkMetadata& chunk : written.chunks) {
+            bytes += uint64_t(chunk.point_count) * sizeof(Point);
+        }
+    }
+    if (!(manifest.flags & PCD_FLAG_BRICKS)) {
+        manifest.bricks_per_chunk = 0;
+    }
+
+    if (!manifest.assignChunkIds() || !writeTileManifest(output, manifest, &error)) {
+        std::cerr << (error.empty() ? "Too many chunks" : error) << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Wrote " << output << " and " << manifest.tiles.size() << " tiles: " << bytes / (1024.0 * 1024.0)
+              << " MB of payloads in " << seconds << " s" << std::endl;
+    return 0;
+}
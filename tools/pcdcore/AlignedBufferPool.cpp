@@ -0,0 +1,41 @@
+#include "AlignedBufferPool.h"
+
+#include <cstdlib>
+
+AlignedBufferPool::AlignedBufferPool(size_t buffer_size, size_t count, size_t alignment)
+        : buffer_size_((buffer_size + alignment - 1) / alignment * alignment),
+          count_(count) {
+    void* block = nullptr;
+    if (buffer_size_ == 0 || count_ == 0 ||
+        posix_memalign(&block, alignment, buffer_size_ * count_) != 0) {
+        count_ = 0;
+        return;
+    }
+
+    base_ = static_cast<char*>(block);
+
+    // Hand buffers out lowest address first
+    free_.reserve(count_);
+    for (size_t i = count_; i > 0; --i) {
+        free_.push_back(buffer(i - 1));
+    }
+}
+
+AlignedBufferPool::~AlignedBufferPool() {
+    free(base_);
+}
+
+char* AlignedBufferPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        return nullptr;
+    }
+    char* buffer = free_.back();
+    free_.pop_back();
+    return buffer;
+}
+
+void AlignedBufferPool::release(char* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(buffer);
+}
@@ -0,0 +1,58 @@
+#ifndef ALIGNEDBUFFERPOOL_H
+#define ALIGNEDBUFFERPOOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/*!
+ * Fixed set of equally sized buffers carved from one aligned allocation. The buffers satisfy
+ * O_DIRECT's address and length alignment, and the single backing block can be handed to
+ * ChunkSource::registerBuffers() in one go. acquire() and release() are thread-safe.
+ */
+class AlignedBufferPool {
+public:
+    /*!
+     * @param buffer_size minimum size of each buffer; rounded up to @a alignment
+     * @param count number of buffers
+     * @param alignment buffer address and size alignment, a power of two
+     */
+    AlignedBufferPool(size_t buffer_size, size_t count, size_t alignment);
+
+    ~AlignedBufferPool();
+
+    AlignedBufferPool(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+
+    // False if the backing allocation failed
+    [[nodiscard]] bool valid() const { return base_ != nullptr; }
+
+    // Returns a free buffer, or null if all are in use
+    char* acquire();
+
+    void release(char* buffer);
+
+    [[nodiscard]] char* buffer(size_t index) const { return base_ + index * buffer_size_; }
+
+    [[nodiscard]] size_t indexOf(const char* buffer) const {
+        return static_cast<size_t>(buffer - base_) / buffer_size_;
+    }
+
+    [[nodiscard]] size_t bufferSize() const { return buffer_size_; }
+
+    [[nodiscard]] size_t count() const { return count_; }
+
+    [[nodiscard]] char* base() const { return base_; }
+
+    [[nodiscard]] size_t totalBytes() const { return buffer_size_ * count_; }
+
+private:
+    char* base_ = nullptr;
+    size_t buffer_size_ = 0;
+    size_t count_ = 0;
+
+    std::mutex mutex_;
+    std::vector<char*> free_;
+};
+
+#endif //ALIGNEDBUFFERPOOL_H
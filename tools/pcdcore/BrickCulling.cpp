@@ -0,0 +1,80 @@
+#include "BrickCulling.h"
+
+ViewFrustum frustumFromViewProj(const float *view_proj) {
+    // Rows of the matrix; each plane is the last row plus or minus one of the others
+    float row[4][4];
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            row[r][c] = view_proj[c * 4 + r];
+        }
+    }
+
+    ViewFrustum frustum{};
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int c = 0; c < 4; ++c) {
+            frustum.planes[axis * 2][c] = row[3][c] + row[axis][c];
+            frustum.planes[axis * 2 + 1][c] = row[3][c] - row[axis][c];
+        }
+    }
+    return frustum;
+}
+
+bool intersectsFrustum(const ViewFrustum &frustum, const BoundingBox &box) {
+    for (const auto &plane : frustum.planes) {
+        // The corner furthest along the plane's normal
+        float x = plane[0] >= 0.0f ? box.max_x : box.min_x;
+        float y = plane[1] >= 0.0f ? box.max_y : box.min_y;
+        float z = plane[2] >= 0.0f ? box.max_z : box.min_z;
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t visibleBricks(const ViewFrustum &frustum, const PcdBrick *bricks, uint32_t count) {
+    uint64_t mask = 0;
+    for (uint32_t b = 0; b < count && b < 64; ++b) {
+        if (bricks[b].point_count > 0 && intersectsFrustum(frustum, bricks[b].bbox)) {
+            mask |= uint64_t(1) << b;
+        }
+    }
+    return mask;
+}
+
+size_t brickRuns(const PcdBrick *bricks, uint32_t count, uint64_t mask, BrickRun *runs) {
+    size_t n = 0;
+    bool open = false;
+    for (uint32_t b = 0; b < count && b < 64; ++b) {
+        if (bricks[b].point_count == 0) {
+            continue;
+        }
+        if (!(mask >> b & 1)) {
+            open = false;
+            continue;
+        }
+        if (open) {
+            runs[n - 1].point_count = bricks[b].first_point + bricks[b].point_count - runs[n - 1].first_point;
+        } else {
+            runs[n++] = {bricks[b].first_point, bricks[b].point_count};
+            open = true;
+        }
+    }
+    return n;
+}
+
+BrickRun brickSpan(const PcdBrick *bricks, uint32_t count, uint64_t mask) {
+    BrickRun span{0, 0};
+    bool found = false;
+    for (uint32_t b = 0; b < count && b < 64; ++b) {
+        if (!(mask >> b & 1) || bricks[b].point_count == 0) {
+            continue;
+        }
+        if (!found) {
+            span.first_point = bricks[b].first_point;
+            found = true;
+        }
+        span.point_count = bricks[b].first_point + bricks[b].point_count - span.first_point;
+    }
+    return span;
+}
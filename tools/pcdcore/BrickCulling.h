@@ -0,0 +1,43 @@
+#ifndef BRICKCULLING_H
+#define BRICKCULLING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PointCloudData.h"
+
+// The six clip planes of a view, each a * x + b * y + c * z + d >= 0 on the inside
+struct ViewFrustum {
+    float planes[6][4];
+};
+
+// Extracts the planes of a column-major (OpenGL) view projection matrix
+ViewFrustum frustumFromViewProj(const float *view_proj);
+
+// Conservative: false only if the box is wholly outside one of the planes
+[[nodiscard]] bool intersectsFrustum(const ViewFrustum &frustum, const BoundingBox &box);
+
+/*!
+ * The bricks of a chunk that @a frustum can see, one bit each. Empty bricks are never visible.
+ * @param count at most 64
+ */
+[[nodiscard]] uint64_t visibleBricks(const ViewFrustum &frustum, const PcdBrick *bricks, uint32_t count);
+
+// Points [first_point, first_point + point_count) of a chunk's payload
+struct BrickRun {
+    uint32_t first_point;
+    uint32_t point_count;
+};
+
+/*!
+ * Merges the bricks in @a mask into runs of consecutive points, one draw call or read each.
+ * Empty bricks between two visible ones don't split a run.
+ * @param runs room for count / 2 + 1 runs
+ * @return the number of runs
+ */
+size_t brickRuns(const PcdBrick *bricks, uint32_t count, uint64_t mask, BrickRun *runs);
+
+// The single run covering every brick in @a mask; point_count is 0 if none has points
+[[nodiscard]] BrickRun brickSpan(const PcdBrick *bricks, uint32_t count, uint64_t mask);
+
+#endif //BRICKCULLING_H
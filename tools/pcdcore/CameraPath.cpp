@@ -0,0 +1,118 @@
+#include "CameraPath.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+static bool setError(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+bool readCameraPath(const std::string& path, CameraPath& camera_path, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        return setError(error, "Failed to open camera path: " + path);
+    }
+
+    camera_path = CameraPath();
+
+    uint32_t first_frame = 0;
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+        std::istringstream in(line);
+        std::string first;
+        if (!(in >> first) || first[0] == '#') {
+            continue;
+        }
+        std::string where = path + ":" + std::to_string(line_number) + ": ";
+
+        if (first == "view") {
+            if (!(in >> camera_path.view_size) || !(camera_path.view_size > 0.0f)) {
+                return setError(error, where + "bad view");
+            }
+            continue;
+        }
+
+        uint32_t frame = 0;
+        CameraPose pose{};
+        std::istringstream frame_in(first);
+        if (!(frame_in >> frame) ||
+            !(in >> pose.eye[0] >> pose.eye[1] >> pose.eye[2] >> pose.target[0] >> pose.target[1] >> pose.target[2])) {
+            return setError(error, where + "expected '<frame> <eye x y z> <target x y z>'");
+        }
+
+        if (camera_path.poses.empty()) {
+            first_frame = frame;
+        } else if (frame < first_frame + camera_path.poses.size()) {
+            return setError(error, where + "frames out of order");
+        }
+        // Frames the camera sat still for hold the last pose
+        while (!camera_path.poses.empty() && first_frame + camera_path.poses.size() < frame) {
+            camera_path.poses.push_back(camera_path.poses.back());
+        }
+        camera_path.poses.push_back(pose);
+    }
+
+    if (camera_path.poses.empty()) {
+        return setError(error, path + ": no poses");
+    }
+    return true;
+}
+
+CameraPath loopCameraPath(const BoundingBox& bounds, int frames) {
+    float cx, cy, cz;
+    bounds.getCenter(cx, cy, cz);
+    auto position = [&](int frame, float* p) {
+        float t = 2.0f * 3.14159265f * static_cast<float>(frame) / static_cast<float>(frames);
+        p[0] = cx + 0.4f * (bounds.max_x - bounds.min_x) * std::cos(t);
+        p[1] = cy + 0.2f * (bounds.max_y - bounds.min_y) * std::sin(2.0f * t);
+        p[2] = cz + 0.4f * (bounds.max_z - bounds.min_z) * std::sin(t);
+    };
+
+    CameraPath path;
+    path.poses.resize(frames > 0 ? frames : 0);
+    for (int frame = 0; frame < frames; ++frame) {
+        position(frame + 1, path.poses[frame].eye);
+        position(frame + 2, path.poses[frame].target);
+    }
+    return path;
+}
+
+bool CameraPathWriter::open(const std::string& path, float view_size) {
+    file_.open(path, std::ios::out | std::ios::trunc);
+    if (!file_) {
+        return false;
+    }
+
+    // Enough digits that the poses read back bit for bit
+    file_.precision(std::numeric_limits<float>::max_digits10);
+    file_ << "# frame eye_x eye_y eye_z target_x target_y target_z\n";
+    if (view_size > 0.0f) {
+        file_ << "view " << view_size << "\n";
+    }
+    recorded_ = false;
+    return file_.good();
+}
+
+void CameraPathWriter::record(uint32_t frame, const CameraPose& pose) {
+    if (!file_.is_open() || (recorded_ && std::memcmp(&pose, &last_, sizeof(pose)) == 0)) {
+        return;
+    }
+
+    file_ << frame << ' ' << pose.eye[0] << ' ' << pose.eye[1] << ' ' << pose.eye[2] << ' '
+          << pose.target[0] << ' ' << pose.target[1] << ' ' << pose.target[2] << '\n';
+    // Apps are usually killed rather than shut down; poses only come when the camera moves
+    file_.flush();
+    last_ = pose;
+    recorded_ = true;
+}
+
+void CameraPathWriter::close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+
+// Where the camera is and what it looks at
+struct CameraPose {
+    float eye[3];
+    float target[3];
+};
+
+/*!
+ * Camera poses recorded by the runtime, one per frame, for replaying its movement offline
+ * (streaming_sim). Stored as text like chunk traces:
+ *
+ *  # comment
+ *  view <render box side>
+ *  <frame> <eye_x> <eye_y> <eye_z> <target_x> <target_y> <target_z>
+ *  ...
+ *
+ * Only frames where the camera moved are recorded; the ones between hold the pose before them.
+ * The view line is optional and gives the side of the box the runtime streamed chunks for.
+ */
+struct CameraPath {
+    float view_size = 0.0f;          // 0 if not recorded
+    std::vector<CameraPose> poses;   // By frame, the first recorded frame first
+};
+
+bool readCameraPath(const std::string& path, CameraPath& camera_path, std::string* error = nullptr);
+
+/*!
+ * @a frames poses flying the closed loop streaming_bench uses through @a bounds, each looking
+ * at the next
+ */
+CameraPath loopCameraPath(const BoundingBox& bounds, int frames);
+
+// Appends poses to a camera path file as the camera moves
+class CameraPathWriter {
+public:
+    bool open(const std::string& path, float view_size);
+
+    // Records the pose of @a frame if it differs from the last one recorded
+    void record(uint32_t frame, const CameraPose& pose);
+
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return file_.is_open(); }
+
+private:
+    std::ofstream file_;
+    CameraPose last_{};
+    bool recorded_ = false;
+};
+
+#endif //CAMERAPATH_H
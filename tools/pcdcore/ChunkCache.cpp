@@ -0,0 +1,131 @@
+#include "ChunkCache.h"
+
+ChunkCache::ChunkCache(uint32_t slot_count, uint32_t slot_points)
+        : slots_(slot_count), points_(size_t(slot_count) * slot_points), slot_points_(slot_points) {
+    map_.reserve(slot_count);
+
+    // Every slot starts free at the cold end of the list
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        pushBack(i);
+    }
+}
+
+uint32_t ChunkCache::lookup(uint32_t chunk_id, uint64_t frame) {
+    auto it = map_.find(chunk_id);
+    if (it == map_.end()) {
+        misses_++;
+        return kNoSlot;
+    }
+
+    hits_++;
+    uint32_t slot = it->second;
+    slots_[slot].last_used = frame;
+    unlink(slot);
+    pushFront(slot);
+    return slot;
+}
+
+uint32_t ChunkCache::allocate(uint32_t chunk_id, uint64_t frame, uint32_t* evicted) {
+    if (evicted != nullptr) {
+        *evicted = kNoSlot;
+    }
+
+    // Walk up from the cold end past slots that are still being read into; they can't be
+    // handed out until their read lands
+    uint32_t slot = tail_;
+    while (slot != kNoSlot && slots_[slot].chunk_id != kNoSlot && !slots_[slot].loaded) {
+        slot = slots_[slot].prev;
+    }
+    if (slot == kNoSlot) {
+        return kNoSlot;
+    }
+
+    Slot& victim = slots_[slot];
+    if (victim.chunk_id != kNoSlot) {
+        // Everything colder than this slot is loading, so nothing older is left to evict
+        if (victim.last_used == frame) {
+            return kNoSlot;
+        }
+
+        map_.erase(victim.chunk_id);
+        evictions_++;
+        if (evicted != nullptr) {
+            *evicted = victim.chunk_id;
+        }
+    }
+
+    victim.chunk_id = chunk_id;
+    victim.points = 0;
+    victim.loaded = false;
+    victim.last_used = frame;
+    map_[chunk_id] = slot;
+
+    unlink(slot);
+    pushFront(slot);
+    return slot;
+}
+
+void ChunkCache::markLoaded(uint32_t slot, uint32_t points) {
+    slots_[slot].points = points < slot_points_ ? points : slot_points_;
+    slots_[slot].loaded = true;
+}
+
+void ChunkCache::release(uint32_t slot) {
+    Slot& s = slots_[slot];
+    if (s.chunk_id != kNoSlot) {
+        map_.erase(s.chunk_id);
+    }
+
+    s.chunk_id = kNoSlot;
+    s.points = 0;
+    s.loaded = false;
+    s.last_used = 0;
+
+    // Free slots are the first to be reused
+    unlink(slot);
+    pushBack(slot);
+}
+
+void ChunkCache::unlink(uint32_t slot) {
+    Slot& s = slots_[slot];
+    if (s.prev != kNoSlot) {
+        slots_[s.prev].next = s.next;
+    } else {
+        head_ = s.next;
+    }
+
+    if (s.next != kNoSlot) {
+        slots_[s.next].prev = s.prev;
+    } else {
+        tail_ = s.prev;
+    }
+
+    s.prev = kNoSlot;
+    s.next = kNoSlot;
+}
+
+void ChunkCache::pushFront(uint32_t slot) {
+    Slot& s = slots_[slot];
+    s.prev = kNoSlot;
+    s.next = head_;
+    if (head_ != kNoSlot) {
+        slots_[head_].prev = slot;
+    }
+    head_ = slot;
+    if (tail_ == kNoSlot) {
+        tail_ = slot;
+    }
+}
+
+void ChunkCache::pushBack(uint32_t slot) {
+    Slot& s = slots_[slot];
+    s.next = kNoSlot;
+    s.prev = tail_;
+    if (tail_ != kNoSlot) {
+        slots_[tail_].next = slot;
+    }
+    tail_ = slot;
+    if (head_ == kNoSlot) {
+        head_ = slot;
+    }
+}
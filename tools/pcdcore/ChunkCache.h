@@ -0,0 +1,105 @@
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "PointCloudData.h"
+
+/*!
+ * Fixed number of equally sized point slots holding decoded chunks, recycled least recently used
+ * first. A slot is allocated when a read is issued and marked loaded when it lands. Slots that are
+ * still loading or were touched in the current frame are never evicted, so reads never land in a
+ * recycled slot and a frame's working set stays put while it draws.
+ *
+ * Not thread-safe: owned by the thread that schedules loads.
+ */
+class ChunkCache {
+public:
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    /*!
+     * @param slot_count number of resident chunks
+     * @param slot_points capacity of each slot in points (normally FileHeader::chunk_size)
+     */
+    ChunkCache(uint32_t slot_count, uint32_t slot_points);
+
+    /*!
+     * Finds the slot holding @a chunk_id, loaded or still loading, and marks it used in @a frame.
+     * @return the slot, or kNoSlot on a miss
+     */
+    uint32_t lookup(uint32_t chunk_id, uint64_t frame);
+
+    /*!
+     * Assigns a slot to @a chunk_id, evicting the least recently used loaded chunk not touched
+     * in @a frame. The slot starts out loading.
+     * @param evicted set to the chunk that was dropped, or kNoSlot
+     * @return the slot, or kNoSlot if no slot can be evicted
+     */
+    uint32_t allocate(uint32_t chunk_id, uint64_t frame, uint32_t* evicted = nullptr);
+
+    // The slot's read finished with @a points valid points
+    void markLoaded(uint32_t slot, uint32_t points);
+
+    // Drops whatever the slot holds, e.g. after a failed read
+    void release(uint32_t slot);
+
+    [[nodiscard]] bool isLoaded(uint32_t slot) const { return slots_[slot].loaded; }
+
+    [[nodiscard]] bool isResident(uint32_t chunk_id) const {
+        return map_.find(chunk_id) != map_.end();
+    }
+
+    [[nodiscard]] Point* slotData(uint32_t slot) { return points_.data() + size_t(slot) * slot_points_; }
+
+    [[nodiscard]] uint32_t slotPoints(uint32_t slot) const { return slots_[slot].points; }
+
+    [[nodiscard]] uint32_t slotChunk(uint32_t slot) const { return slots_[slot].chunk_id; }
+
+    [[nodiscard]] uint32_t slotCount() const { return static_cast<uint32_t>(slots_.size()); }
+
+    [[nodiscard]] uint32_t slotCapacity() const { return slot_points_; }
+
+    // Backing store of all slots, slot i at offset i * slotCapacity()
+    [[nodiscard]] Point* data() { return points_.data(); }
+
+    [[nodiscard]] uint64_t hits() const { return hits_; }
+
+    [[nodiscard]] uint64_t misses() const { return misses_; }
+
+    [[nodiscard]] uint64_t evictions() const { return evictions_; }
+
+private:
+    struct Slot {
+        uint32_t chunk_id = kNoSlot;
+        uint32_t points = 0;
+        uint64_t last_used = 0;
+        bool loaded = false;
+
+        // Intrusive LRU list, most recently used at the head
+        uint32_t prev = kNoSlot;
+        uint32_t next = kNoSlot;
+    };
+
+    void unlink(uint32_t slot);
+
+    void pushFront(uint32_t slot);
+
+    void pushBack(uint32_t slot);
+
+    std::vector<Slot> slots_;
+    std::vector<Point> points_;
+    uint32_t slot_points_;
+
+    std::unordered_map<uint32_t, uint32_t> map_;
+    uint32_t head_ = kNoSlot;
+    uint32_t tail_ = kNoSlot;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+#endif //CHUNKCACHE_H
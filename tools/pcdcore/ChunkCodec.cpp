@@ -0,0 +1,293 @@
+#include "ChunkCodec.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "PcdFile.h"
+
+// Encoded layout:
+//   uint32 point count | uint8 position bits | BoundingBox bounds (24 bytes)
+//   per block of kBlockPoints points (the last one may be shorter), per component x, y, z
+//   (quantized), r, g, b:
+//     uint8 mode | uint8 exception count | the block's residuals' low bits, bit packed at the
+//     mode's width | per exception: uint8 index in the block, varint of the residual's high bits
+// Residuals are zigzag encoded. The mode's low 6 bits are the width, and the top bit picks the
+// predictor: the previous value, or the line through the previous two (rows of terrain and runs
+// along a helix step evenly, so the residual is near zero). Each block of each component takes
+// whichever predictor and width pack smallest, so noisy stretches don't pay for extrapolating
+// noise and the jump to the next run doesn't widen the whole block. Packing is LSB first, and
+// each block's residuals start on a byte.
+
+static constexpr uint32_t kBlockPoints = 64;
+static constexpr uint8_t kLinear = 0x80;
+static constexpr uint8_t kWidthMask = 0x3f;
+
+static constexpr size_t kHeaderSize = sizeof(uint32_t) + 1 + sizeof(BoundingBox);
+
+static inline uint32_t zigzag(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+}
+
+static inline uint8_t bitWidth(uint32_t v) {
+    return v == 0 ? 0 : static_cast<uint8_t>(32 - __builtin_clz(v));
+}
+
+// Zigzag encoded residuals of @a values against their prediction, carrying on from @a prev and
+// @a prev2, the two values before them. Returns the width of the largest.
+static uint8_t residuals(const uint32_t* values, uint32_t count, uint32_t prev, uint32_t prev2, bool linear,
+                         uint32_t* out) {
+    uint32_t all = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t predicted = linear ? prev + (prev - prev2) : prev;
+        out[i] = zigzag(static_cast<int32_t>(values[i] - predicted));
+        all |= out[i];
+        prev2 = prev;
+        prev = values[i];
+    }
+    return bitWidth(all);
+}
+
+static inline void putVarint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+static inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        uint8_t byte = *p++;
+        v |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The packing width that stores @a values smallest, the ones that don't fit as exceptions. Sized
+// from how many values need each width, so the search doesn't depend on the block's length.
+static uint8_t bestWidth(const uint32_t* values, uint32_t count, uint8_t max_width, size_t& best_size) {
+    uint32_t needing[33] = {};
+    for (uint32_t i = 0; i < count; ++i) {
+        needing[bitWidth(values[i])]++;
+    }
+
+    uint8_t best = max_width;
+    best_size = (size_t(count) * max_width + 7) / 8;
+    for (uint8_t width = 0; width < max_width; ++width) {
+        size_t size = (size_t(count) * width + 7) / 8;
+        for (uint8_t wider = width + 1; wider <= max_width; ++wider) {
+            // Index byte, and a varint of the bits above width
+            size += size_t(needing[wider]) * (1 + (wider - width + 6) / 7);
+        }
+        if (size < best_size) {
+            best = width;
+            best_size = size;
+        }
+    }
+    return best;
+}
+
+static void packBits(const uint32_t* values, uint32_t count, uint8_t width, std::vector<uint8_t>& out) {
+    uint64_t buffer = 0;
+    int filled = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t low = width < 32 ? values[i] & ((1u << width) - 1) : values[i];
+        buffer |= static_cast<uint64_t>(low) << filled;
+        filled += width;
+        while (filled >= 8) {
+            out.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            filled -= 8;
+        }
+    }
+    if (filled > 0) {
+        out.push_back(static_cast<uint8_t>(buffer));
+    }
+}
+
+static inline uint32_t quantize(float value, float min, float scale, uint32_t max_q) {
+    float q = std::round((value - min) * scale);
+    if (!(q > 0.0f)) {
+        return 0;
+    }
+    return q >= static_cast<float>(max_q) ? max_q : static_cast<uint32_t>(q);
+}
+
+void encodeChunk(const Point* points, uint32_t count, std::vector<uint8_t>& out,
+                 const ChunkCodecOptions& options) {
+    int bits = options.position_bits < 8 ? 8 : (options.position_bits > 24 ? 24 : options.position_bits);
+    uint32_t max_q = (1u << bits) - 1;
+    BoundingBox bounds = count > 0 ? computeBounds(points, count) : BoundingBox{0, 0, 0, 0, 0, 0};
+
+    float extent[3] = {bounds.max_x - bounds.min_x, bounds.max_y - bounds.min_y,
+                       bounds.max_z - bounds.min_z};
+    float scale[3];
+    for (int i = 0; i < 3; ++i) {
+        scale[i] = extent[i] > 0.0f ? static_cast<float>(max_q) / extent[i] : 0.0f;
+    }
+
+    out.clear();
+    out.reserve(kHeaderSize + size_t(count) * 6);
+    out.resize(kHeaderSize);
+    std::memcpy(out.data(), &count, sizeof(uint32_t));
+    out[sizeof(uint32_t)] = static_cast<uint8_t>(bits);
+    std::memcpy(out.data() + sizeof(uint32_t) + 1, &bounds, sizeof(BoundingBox));
+
+    // The two values before the block, per component
+    uint32_t prev[6] = {0, 0, 0, 0, 0, 0};
+    uint32_t prev2[6] = {0, 0, 0, 0, 0, 0};
+    uint32_t values[6][kBlockPoints];
+    uint32_t delta[kBlockPoints];
+    uint32_t linear[kBlockPoints];
+
+    for (uint32_t first = 0; first < count; first += kBlockPoints) {
+        uint32_t n = count - first < kBlockPoints ? count - first : kBlockPoints;
+        for (uint32_t i = 0; i < n; ++i) {
+            const Point& p = points[first + i];
+            values[0][i] = quantize(p.x, bounds.min_x, scale[0], max_q);
+            values[1][i] = quantize(p.y, bounds.min_y, scale[1], max_q);
+            values[2][i] = quantize(p.z, bounds.min_z, scale[2], max_q);
+            values[3][i] = p.r;
+            values[4][i] = p.g;
+            values[5][i] = p.b;
+        }
+
+        for (int c = 0; c < 6; ++c) {
+            size_t delta_size, linear_size;
+            uint8_t delta_width = residuals(values[c], n, prev[c], prev2[c], false, delta);
+            uint8_t linear_width = residuals(values[c], n, prev[c], prev2[c], true, linear);
+            delta_width = bestWidth(delta, n, delta_width, delta_size);
+            linear_width = bestWidth(linear, n, linear_width, linear_size);
+            bool use_linear = linear_size < delta_size;
+            const uint32_t* block = use_linear ? linear : delta;
+            uint8_t width = use_linear ? linear_width : delta_width;
+
+            out.push_back(static_cast<uint8_t>((use_linear ? kLinear : 0) | width));
+            size_t exceptions = out.size();
+            out.push_back(0);
+            packBits(block, n, width, out);
+            for (uint32_t i = 0; i < n; ++i) {
+                uint32_t high = width < 32 ? block[i] >> width : 0;
+                if (high != 0) {
+                    out[exceptions]++;
+                    out.push_back(static_cast<uint8_t>(i));
+                    putVarint(out, high);
+                }
+            }
+            prev2[c] = n > 1 ? values[c][n - 2] : prev[c];
+            prev[c] = values[c][n - 1];
+        }
+    }
+}
+
+uint32_t encodedPointCount(const uint8_t* data, size_t size) {
+    if (size < kHeaderSize) {
+        return 0;
+    }
+
+    uint32_t count;
+    std::memcpy(&count, data, sizeof(uint32_t));
+    return count;
+}
+
+int64_t decodeChunk(const uint8_t* data, size_t size, Point* points, uint32_t capacity) {
+    if (size < kHeaderSize) {
+        return -1;
+    }
+
+    uint32_t count;
+    BoundingBox bounds;
+    std::memcpy(&count, data, sizeof(uint32_t));
+    int bits = data[sizeof(uint32_t)];
+    std::memcpy(&bounds, data + sizeof(uint32_t) + 1, sizeof(BoundingBox));
+
+    if (count > capacity || bits < 8 || bits > 24) {
+        return -1;
+    }
+
+    uint32_t max_q = (1u << bits) - 1;
+    float step[3] = {(bounds.max_x - bounds.min_x) / static_cast<float>(max_q),
+                     (bounds.max_y - bounds.min_y) / static_cast<float>(max_q),
+                     (bounds.max_z - bounds.min_z) / static_cast<float>(max_q)};
+
+    const uint8_t* p = data + kHeaderSize;
+    const uint8_t* end = data + size;
+    uint32_t prev[6] = {0, 0, 0, 0, 0, 0};
+    uint32_t prev2[6] = {0, 0, 0, 0, 0, 0};
+    uint32_t values[6][kBlockPoints];
+    uint32_t residual[kBlockPoints];
+
+    for (uint32_t first = 0; first < count; first += kBlockPoints) {
+        uint32_t n = count - first < kBlockPoints ? count - first : kBlockPoints;
+
+        for (int c = 0; c < 6; ++c) {
+            if (end - p < 2) {
+                return -1;
+            }
+            uint8_t mode = *p++;
+            uint8_t exceptions = *p++;
+            uint8_t width = mode & kWidthMask;
+            size_t bytes = (size_t(n) * width + 7) / 8;
+            if (width > 32 || size_t(end - p) < bytes) {
+                return -1;
+            }
+
+            uint64_t buffer = 0;
+            int filled = 0;
+            uint32_t mask = width == 32 ? 0xffffffffu : (1u << width) - 1;
+            for (uint32_t i = 0; i < n; ++i) {
+                while (filled < width) {
+                    buffer |= static_cast<uint64_t>(*p++) << filled;
+                    filled += 8;
+                }
+                residual[i] = static_cast<uint32_t>(buffer) & mask;
+                buffer = width == 32 ? buffer >> 32 : buffer >> width;
+                filled -= width;
+            }
+
+            for (uint8_t e = 0; e < exceptions; ++e) {
+                uint32_t high;
+                if (p == end || *p >= n || width >= 32) {
+                    return -1;
+                }
+                uint8_t i = *p++;
+                if (!getVarint(p, end, high)) {
+                    return -1;
+                }
+                residual[i] |= high << width;
+            }
+
+            bool linear = (mode & kLinear) != 0;
+            for (uint32_t i = 0; i < n; ++i) {
+                uint32_t predicted = linear ? prev[c] + (prev[c] - prev2[c]) : prev[c];
+                values[c][i] = predicted + static_cast<uint32_t>(unzigzag(residual[i]));
+                prev2[c] = prev[c];
+                prev[c] = values[c][i];
+            }
+        }
+
+        for (uint32_t i = 0; i < n; ++i) {
+            Point& point = points[first + i];
+            point.x = bounds.min_x + static_cast<float>(values[0][i]) * step[0];
+            point.y = bounds.min_y + static_cast<float>(values[1][i]) * step[1];
+            point.z = bounds.min_z + static_cast<float>(values[2][i]) * step[2];
+            point.r = static_cast<uint8_t>(values[3][i]);
+            point.g = static_cast<uint8_t>(values[4][i]);
+            point.b = static_cast<uint8_t>(values[5][i]);
+            point.padding = 0;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,43 @@
+#ifndef CHUNKCODEC_H
+#define CHUNKCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PointCloudData.h"
+
+// Immutable compressed chunk, shared between the compressed cache and in-flight decodes
+using ChunkBlob = std::shared_ptr<const std::vector<uint8_t>>;
+
+struct ChunkCodecOptions {
+    // Positions are quantized to this many bits per axis within the chunk's bounding box, so the
+    // error is at most half a step, extent / (2^bits - 1) / 2, plus float rounding of the decoded
+    // value. Between 8 and 24.
+    int position_bits = 14;
+};
+
+/*!
+ * Compresses a chunk for the in-RAM compressed tier. Positions are quantized against the chunk's
+ * bounds, then the residuals against a prediction from the points before each are bit packed in
+ * blocks. Generated datasets come out at 3 to 4 times smaller than decoded with the default 14
+ * bits, and about 3 times with 16.
+ *
+ * Lossy in position only (see ChunkCodecOptions); point order and colors are preserved. The loss
+ * compounds if decoded points are encoded again, so a chunk promoted from the tier should go
+ * back to it as the blob it came from (see CompressedChunkCache::promote()).
+ */
+void encodeChunk(const Point* points, uint32_t count, std::vector<uint8_t>& out,
+                 const ChunkCodecOptions& options = {});
+
+// Number of points in an encoded chunk, or 0 if the header is invalid
+[[nodiscard]] uint32_t encodedPointCount(const uint8_t* data, size_t size);
+
+/*!
+ * Decodes into @a points, which holds up to @a capacity points.
+ * @return the number of points decoded, or -1 if the data is corrupt or doesn't fit
+ */
+int64_t decodeChunk(const uint8_t* data, size_t size, Point* points, uint32_t capacity);
+
+#endif //CHUNKCODEC_H
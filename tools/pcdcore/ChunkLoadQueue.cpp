@@ -0,0 +1,82 @@
+#include "ChunkLoadQueue.h"
+
+#include <algorithm>
+
+bool ChunkLoadQueue::after(const Entry &a, const Entry &b) {
+    if (a.request.prefetch != b.request.prefetch) {
+        return a.request.prefetch;
+    }
+    if (a.request.priority != b.request.priority) {
+        return a.request.priority < b.request.priority;
+    }
+    return a.sequence > b.sequence;
+}
+
+void ChunkLoadQueue::push(const ChunkLoadRequest &request) {
+    heap_.push_back({request, next_sequence_++});
+    std::push_heap(heap_.begin(), heap_.end(), after);
+}
+
+void ChunkLoadQueue::pop(size_t max, size_t max_prefetch, ChunkLoadClock::time_point now,
+                         std::vector<ChunkLoadRequest> &batch,
+                         std::vector<ChunkLoadRequest> &expired) {
+    size_t taken = 0;
+    bool prefetching = false;
+    while (!heap_.empty() && taken < max) {
+        const ChunkLoadRequest &front = heap_.front().request;
+        if (front.deadline >= now) {
+            if (taken == 0) {
+                prefetching = front.prefetch;
+                max = prefetching ? std::min(max, std::max<size_t>(max_prefetch, 1)) : max;
+            }
+            taken++;
+        }
+
+        std::pop_heap(heap_.begin(), heap_.end(), after);
+        ChunkLoadRequest &request = heap_.back().request;
+        (request.deadline < now ? expired : batch).push_back(std::move(request));
+        heap_.pop_back();
+    }
+}
+
+size_t ChunkLoadQueue::cancel(uint64_t user_data, std::vector<ChunkLoadRequest> &cancelled) {
+    auto keep = std::partition(heap_.begin(), heap_.end(),
+                               [user_data](const Entry &e) { return e.request.user_data != user_data; });
+    size_t n = heap_.end() - keep;
+    if (n == 0) {
+        return 0;
+    }
+
+    for (auto it = keep; it != heap_.end(); ++it) {
+        cancelled.push_back(std::move(it->request));
+    }
+    heap_.erase(keep, heap_.end());
+    std::make_heap(heap_.begin(), heap_.end(), after);
+    return n;
+}
+
+size_t ChunkLoadQueue::reprioritize(const ChunkLoadPriority *updates, size_t count) {
+    if (count == 0 || heap_.empty()) {
+        return 0;
+    }
+
+    updates_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        updates_[updates[i].user_data] = &updates[i];
+    }
+
+    size_t n = 0;
+    for (auto &entry : heap_) {
+        auto it = updates_.find(entry.request.user_data);
+        if (it != updates_.end()) {
+            entry.request.priority = it->second->priority;
+            entry.request.prefetch = it->second->prefetch;
+            n++;
+        }
+    }
+
+    if (n > 0) {
+        std::make_heap(heap_.begin(), heap_.end(), after);
+    }
+    return n;
+}
@@ -0,0 +1,108 @@
+#ifndef CHUNKLOADQUEUE_H
+#define CHUNKLOADQUEUE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ChunkCodec.h"
+
+using ChunkLoadClock = std::chrono::steady_clock;
+
+struct ChunkLoadRequest {
+    uint64_t offset;     // Absolute file offset of the payload
+    uint32_t length;     // Payload bytes, without padding
+    void *dst;           // Destination; must stay valid until the result is polled
+    uint64_t user_data;  // Echoed back in the result
+
+    // Promotes a chunk from the compressed tier: it's decoded into dst on a worker thread instead
+    // of read from disk, and offset is ignored. length must cover the decoded chunk.
+    ChunkBlob compressed = nullptr;
+
+    // Demotes what dst holds before it's overwritten: the first demote_points points are
+    // compressed and handed back through pollCompressed() tagged with demote_chunk. demote_src
+    // moves that to another address, for reads landing partway into the buffer being reused.
+    uint32_t demote_chunk = UINT32_MAX;
+    uint32_t demote_points = 0;
+    const void *demote_src = nullptr;
+
+    // Higher is served first; equal priorities in the order they were requested
+    float priority = 0.0f;
+
+    // Speculative reads wait until no read for something on screen does
+    bool prefetch = false;
+
+    // A request still queued at its deadline is dropped and fails with -ETIMEDOUT
+    ChunkLoadClock::time_point deadline = ChunkLoadClock::time_point::max();
+
+    // Checks the payload read against crc (the file's CRC32C of it) before the result is posted.
+    // Only for reads of a whole chunk from disk; partial reads and promotions aren't covered.
+    bool verify = false;
+    uint32_t crc = 0;
+};
+
+struct ChunkLoadResult {
+    uint64_t user_data;
+    int64_t result;      // Payload bytes read or decoded, or -errno on failure
+};
+
+// New standing for the queued requests tagged with user_data
+struct ChunkLoadPriority {
+    uint64_t user_data;
+    float priority;
+    bool prefetch;
+};
+
+/*!
+ * Chunk load requests ordered for serving: reads for what's on screen before prefetches, then by
+ * priority, then first come first served. Requests can be reprioritized or cancelled while they
+ * wait, and ones that outlive their deadline are dropped when they reach the front.
+ *
+ * Not thread-safe: ChunkLoader guards it with its own lock.
+ */
+class ChunkLoadQueue {
+public:
+    void push(const ChunkLoadRequest &request);
+
+    /*!
+     * Moves up to @a max requests into @a batch, best first. Requests whose deadline is before
+     * @a now go to @a expired instead and don't count towards @a max. A batch that starts with a
+     * prefetch stops at @a max_prefetch, so reads for the screen that arrive meanwhile don't
+     * wait long behind it.
+     */
+    void pop(size_t max, size_t max_prefetch, ChunkLoadClock::time_point now,
+             std::vector<ChunkLoadRequest> &batch, std::vector<ChunkLoadRequest> &expired);
+
+    /*!
+     * Removes every request tagged with @a user_data, appending them to @a cancelled.
+     * @return the number removed
+     */
+    size_t cancel(uint64_t user_data, std::vector<ChunkLoadRequest> &cancelled);
+
+    /*!
+     * Applies new priorities to the queued requests they name; ones not queued are ignored.
+     * @return the number of requests updated
+     */
+    size_t reprioritize(const ChunkLoadPriority *updates, size_t count);
+
+    [[nodiscard]] size_t size() const { return heap_.size(); }
+
+    [[nodiscard]] bool empty() const { return heap_.empty(); }
+
+private:
+    struct Entry {
+        ChunkLoadRequest request;
+        uint64_t sequence;
+    };
+
+    // Heap order: true if a is served after b
+    static bool after(const Entry &a, const Entry &b);
+
+    std::vector<Entry> heap_;
+    std::unordered_map<uint64_t, const ChunkLoadPriority *> updates_;
+    uint64_t next_sequence_ = 0;
+};
+
+#endif //CHUNKLOADQUEUE_H
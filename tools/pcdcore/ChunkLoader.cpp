@@ -0,0 +1,398 @@
+#include "ChunkLoader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "Crc32c.h"
+#include "PointCloudData.h"
+
+ChunkLoader::ChunkLoader(std::unique_ptr<ChunkSource> source, const ChunkLoaderOptions &options)
+        : source_(std::move(source)), options_(options) {
+    if (options_.batch_size == 0) {
+        options_.batch_size = 1;
+    }
+
+    if (source_ && options_.direct_io) {
+        uint64_t length = alignUp(options_.max_read_length, PCD_PAYLOAD_ALIGNMENT);
+        staging_ = std::make_unique<AlignedBufferPool>(length, std::max(1u, options_.staging_buffers),
+                                                       PCD_PAYLOAD_ALIGNMENT);
+        if (!staging_->valid()) {
+            source_.reset();
+            return;
+        }
+        source_->registerBuffers(staging_->base(), staging_->totalBytes());
+    }
+
+    if (source_) {
+        thread_ = std::thread(&ChunkLoader::run, this);
+        for (uint32_t i = 0; i < std::max(1u, options_.decode_threads); ++i) {
+            decoders_.emplace_back(&ChunkLoader::runDecoder, this);
+        }
+    }
+}
+
+ChunkLoader::~ChunkLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    decode_cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    for (auto &decoder : decoders_) {
+        decoder.join();
+    }
+}
+
+void ChunkLoader::request(const ChunkLoadRequest &request) {
+    this->request(&request, 1);
+}
+
+void ChunkLoader::request(const ChunkLoadRequest *requests, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!source_) {
+            // Fail them right away so callers don't wait forever
+            for (size_t i = 0; i < count; ++i) {
+                results_.push_back({requests[i].user_data, -EBADF});
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            (requests[i].compressed ? decode_queue_ : queue_).push(requests[i]);
+        }
+    }
+    work_cv_.notify_one();
+    decode_cv_.notify_all();
+}
+
+size_t ChunkLoader::cancel(uint64_t user_data) {
+    std::vector<ChunkLoadRequest> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.cancel(user_data, cancelled);
+        decode_queue_.cancel(user_data, cancelled);
+        for (const auto &request : cancelled) {
+            results_.push_back({request.user_data, -ECANCELED});
+        }
+    }
+    if (!cancelled.empty()) {
+        idle_cv_.notify_all();
+    }
+    return cancelled.size();
+}
+
+void ChunkLoader::reprioritize(const ChunkLoadPriority *updates, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.reprioritize(updates, count);
+    decode_queue_.reprioritize(updates, count);
+}
+
+size_t ChunkLoader::poll(std::vector<ChunkLoadResult> &results) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = results_.size();
+    results.insert(results.end(), results_.begin(), results_.end());
+    results_.clear();
+    return n;
+}
+
+size_t ChunkLoader::pollCompressed(std::vector<CompressedChunk> &chunks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = compressed_.size();
+    chunks.insert(chunks.end(), std::make_move_iterator(compressed_.begin()),
+                  std::make_move_iterator(compressed_.end()));
+    compressed_.clear();
+    return n;
+}
+
+void ChunkLoader::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] {
+        return queue_.empty() && decode_queue_.empty() && active_ == 0;
+    });
+}
+
+size_t ChunkLoader::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size() + decode_queue_.size() + active_ + results_.size();
+}
+
+void ChunkLoader::run() {
+    std::vector<ChunkLoadRequest> batch;
+    std::vector<uint32_t> rereads;
+    std::vector<ChunkLoadRequest> expired;
+    std::vector<ChunkLoadResult> out;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] {
+                return stop_ || !queue_.empty() || !reread_queue_.empty();
+            });
+            if (stop_) {
+                return;
+            }
+
+            // Reads that failed their CRC go first; their requests are already counted in active_
+            batch.clear();
+            rereads.clear();
+            while (!reread_queue_.empty() && batch.size() < options_.batch_size) {
+                batch.push_back(std::move(reread_queue_.front().request));
+                rereads.push_back(reread_queue_.front().rereads);
+                reread_queue_.pop_front();
+            }
+            size_t taken = batch.size();
+
+            expired.clear();
+            queue_.pop(options_.batch_size - taken, options_.prefetch_batch_size,
+                       ChunkLoadClock::now(), batch, expired);
+            for (const auto &request : expired) {
+                results_.push_back({request.user_data, -ETIMEDOUT});
+            }
+            active_ += batch.size() - taken;
+            rereads.resize(batch.size(), 0);
+        }
+
+        if (batch.empty()) {
+            idle_cv_.notify_all();
+            continue;
+        }
+
+        // Each slot's old contents have to be compressed before its read lands on top of them
+        if (!demoteBatch(batch)) {
+            return;
+        }
+
+        if (staging_) {
+            readBatchDirect(batch, out);
+        } else {
+            readBatch(batch, out);
+        }
+
+        // Whole reads with a CRC wait for a worker to check them while this thread goes on to the
+        // next batch; the rest are done
+        bool verifying = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (batch[i].verify && out[i].result == batch[i].length) {
+                    verify_queue_.push_back({std::move(batch[i]), rereads[i]});
+                    verifying = true;
+                } else {
+                    results_.push_back(out[i]);
+                    active_--;
+                }
+            }
+        }
+        if (verifying) {
+            decode_cv_.notify_all();
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+bool ChunkLoader::demoteBatch(const std::vector<ChunkLoadRequest> &batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stop_) {
+        // The decoders may be gone already
+        return false;
+    }
+    for (const auto &request : batch) {
+        if (request.demote_chunk != UINT32_MAX && request.demote_points > 0) {
+            demote_queue_.push_back(&request);
+            demotes_outstanding_++;
+        }
+    }
+
+    if (demotes_outstanding_ == 0) {
+        return true;
+    }
+
+    // Queued before stop_ was set, so the decoders finish these before they exit
+    decode_cv_.notify_all();
+    demote_cv_.wait(lock, [this] { return demotes_outstanding_ == 0; });
+    return !stop_;
+}
+
+void ChunkLoader::runDecoder() {
+    std::vector<ChunkLoadRequest> promotions;
+    std::vector<ChunkLoadRequest> expired;
+
+    while (true) {
+        const ChunkLoadRequest *demotion = nullptr;
+        ChunkLoadRequest promotion{};
+        bool verifying = false;
+        PendingVerify pending{};
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            decode_cv_.wait(lock, [this] {
+                return stop_ || !demote_queue_.empty() || !verify_queue_.empty() ||
+                       !decode_queue_.empty();
+            });
+            // The I/O thread waits on queued demotions even when stopping, so they're drained first
+            if (stop_ && demote_queue_.empty()) {
+                return;
+            }
+
+            // Demotions first: the I/O thread is waiting on them
+            if (!demote_queue_.empty()) {
+                demotion = demote_queue_.front();
+                demote_queue_.pop_front();
+            } else if (!verify_queue_.empty()) {
+                // Then CRCs, which hold back results that are already read
+                pending = std::move(verify_queue_.front());
+                verify_queue_.pop_front();
+                verifying = true;
+            } else {
+                promotions.clear();
+                expired.clear();
+                decode_queue_.pop(1, 1, ChunkLoadClock::now(), promotions, expired);
+                for (const auto &request : expired) {
+                    results_.push_back({request.user_data, -ETIMEDOUT});
+                }
+                if (promotions.empty()) {
+                    idle_cv_.notify_all();
+                    continue;
+                }
+                promotion = std::move(promotions.front());
+                active_++;
+            }
+        }
+
+        if (demotion != nullptr) {
+            ChunkBlob blob = demote(*demotion);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            compressed_.push_back({demotion->demote_chunk, std::move(blob)});
+            if (--demotes_outstanding_ == 0) {
+                demote_cv_.notify_all();
+            }
+            continue;
+        }
+
+        if (verifying) {
+            verify(pending);
+            continue;
+        }
+
+        ChunkBlob blob = demote(promotion);
+        ChunkLoadResult result = promote(promotion);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_.push_back(result);
+            if (blob) {
+                compressed_.push_back({promotion.demote_chunk, std::move(blob)});
+            }
+            active_--;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+ChunkBlob ChunkLoader::demote(const ChunkLoadRequest &request) {
+    if (request.demote_chunk == UINT32_MAX || request.demote_points == 0) {
+        return nullptr;
+    }
+
+    auto blob = std::make_shared<std::vector<uint8_t>>();
+    const void *src = request.demote_src != nullptr ? request.demote_src : request.dst;
+    encodeChunk(static_cast<const Point *>(src), request.demote_points, *blob, options_.codec);
+    blob->shrink_to_fit();
+    return blob;
+}
+
+ChunkLoadResult ChunkLoader::promote(const ChunkLoadRequest &request) {
+    const std::vector<uint8_t> &blob = *request.compressed;
+    int64_t points = decodeChunk(blob.data(), blob.size(), static_cast<Point *>(request.dst),
+                                 request.length / sizeof(Point));
+    if (points < 0) {
+        return {request.user_data, -EINVAL};
+    }
+    return {request.user_data, points * int64_t(sizeof(Point))};
+}
+
+void ChunkLoader::readBatch(const std::vector<ChunkLoadRequest> &batch,
+                            std::vector<ChunkLoadResult> &out) {
+    std::vector<ChunkReadRequest> requests(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        requests[i] = {batch[i].offset, batch[i].length, batch[i].dst, i};
+    }
+
+    std::vector<ChunkReadCompletion> completions(batch.size());
+    source_->readBatch(requests.data(), requests.size(), completions.data());
+
+    out.resize(batch.size());
+    for (const auto &completion : completions) {
+        out[completion.user_data] = {batch[completion.user_data].user_data, completion.result};
+    }
+}
+
+// O_DIRECT can't target the callers' buffers (unaligned addresses and lengths), so the batch
+// goes through the staging buffers a group at a time and each payload is copied into place.
+void ChunkLoader::readBatchDirect(const std::vector<ChunkLoadRequest> &batch,
+                                  std::vector<ChunkLoadResult> &out) {
+    size_t group = staging_->count();
+    std::vector<ChunkReadRequest> requests;
+    std::vector<ChunkReadCompletion> completions(group);
+    out.resize(batch.size());
+
+    for (size_t first = 0; first < batch.size(); first += group) {
+        size_t n = std::min(group, batch.size() - first);
+
+        requests.clear();
+        for (size_t i = 0; i < n; ++i) {
+            const ChunkLoadRequest &pending = batch[first + i];
+            auto length = static_cast<uint32_t>(alignUp(pending.length, PCD_PAYLOAD_ALIGNMENT));
+            requests.push_back({pending.offset, std::min<uint32_t>(length, staging_->bufferSize()),
+                                staging_->buffer(i), first + i});
+        }
+
+        source_->readBatch(requests.data(), n, completions.data());
+
+        for (size_t i = 0; i < n; ++i) {
+            size_t index = completions[i].user_data;
+            const ChunkLoadRequest &pending = batch[index];
+            int64_t result = completions[i].result;
+
+            if (result >= pending.length) {
+                std::memcpy(pending.dst, staging_->buffer(index - first), pending.length);
+                result = pending.length;
+            } else if (result >= 0) {
+                result = -EIO;
+            }
+            out[index] = {pending.user_data, result};
+        }
+    }
+}
+
+void ChunkLoader::verify(PendingVerify &pending) {
+    const ChunkLoadRequest &request = pending.request;
+    bytes_verified_.fetch_add(request.length, std::memory_order_relaxed);
+    bool match = crc32c(request.dst, request.length) == request.crc;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!match) {
+            crc_mismatches_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!match && pending.rereads < options_.crc_rereads) {
+            // Its old contents were demoted before the first read
+            pending.rereads++;
+            pending.request.demote_chunk = UINT32_MAX;
+            reread_queue_.push_back(std::move(pending));
+            work_cv_.notify_one();
+            return;
+        }
+        if (!match) {
+            crc_rejected_.fetch_add(1, std::memory_order_relaxed);
+        }
+        results_.push_back({request.user_data, match ? int64_t(request.length) : -EBADMSG});
+        active_--;
+    }
+    idle_cv_.notify_all();
+}
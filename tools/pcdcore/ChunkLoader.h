@@ -0,0 +1,169 @@
+#ifndef CHUNKLOADER_H
+#define CHUNKLOADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ChunkSource.h"
+#include "AlignedBufferPool.h"
+#include "ChunkCodec.h"
+#include "ChunkLoadQueue.h"
+
+struct CompressedChunk {
+    uint32_t chunk_id;
+    ChunkBlob blob;
+};
+
+struct ChunkLoaderOptions {
+    // Requests handed to the ChunkSource per batch, and per batch of prefetches
+    uint32_t batch_size = 32;
+    uint32_t prefetch_batch_size = 4;
+
+    // The source was opened with direct_io. Reads then go through aligned staging buffers and
+    // are copied to the destination, since callers' buffers are rarely page aligned.
+    bool direct_io = false;
+    uint32_t max_read_length = 0;  // Largest request length; sizes the staging buffers
+    uint32_t staging_buffers = 8;
+
+    // Threads compressing demotions and decoding promotions
+    uint32_t decode_threads = 2;
+    ChunkCodecOptions codec;
+
+    // Times a read failing its CRC is retried before it fails with -EBADMSG; a retry gets past a
+    // bad transfer, not a corrupt file
+    uint32_t crc_rereads = 1;
+};
+
+/*!
+ * Runs chunk reads on a background thread so the caller never blocks on storage. Requests are
+ * served in ChunkLoadQueue order, in batches of up to batch_size, and can be reprioritized or
+ * cancelled until a thread takes them; finished reads are collected with poll(). The lock is only
+ * held to move requests and results in and out, never across I/O or decoding.
+ * Promotions from the compressed tier skip the I/O queue and are decoded by a small worker pool,
+ * which also compresses each batch's demotions before its reads are issued and checks the CRCs of
+ * its reads while the next batch is read; a read that fails its check is read again ahead of the
+ * queue.
+ * request() and the poll functions may be called from any thread.
+ */
+class ChunkLoader {
+public:
+    ChunkLoader(std::unique_ptr<ChunkSource> source, const ChunkLoaderOptions &options);
+
+    ~ChunkLoader();
+
+    ChunkLoader(const ChunkLoader&) = delete;
+    ChunkLoader& operator=(const ChunkLoader&) = delete;
+
+    // False if direct I/O staging buffers couldn't be allocated
+    [[nodiscard]] bool valid() const { return source_ != nullptr; }
+
+    void request(const ChunkLoadRequest &request);
+
+    void request(const ChunkLoadRequest *requests, size_t count);
+
+    /*!
+     * Drops the queued requests tagged with @a user_data; each gets a -ECANCELED result. Ones a
+     * thread has already taken still complete.
+     * @return the number cancelled
+     */
+    size_t cancel(uint64_t user_data);
+
+    // Updates the priority of queued requests, typically every frame as the camera moves
+    void reprioritize(const ChunkLoadPriority *updates, size_t count);
+
+    /*!
+     * Appends every result finished since the last call to @a results.
+     * @return the number appended
+     */
+    size_t poll(std::vector<ChunkLoadResult> &results);
+
+    /*!
+     * Appends the compressed copies of demoted chunks made since the last call to @a chunks.
+     * @return the number appended
+     */
+    size_t pollCompressed(std::vector<CompressedChunk> &chunks);
+
+    // Blocks until every request made so far has a result waiting in poll()
+    void waitIdle();
+
+    // Requests not yet polled
+    [[nodiscard]] size_t pending() const;
+
+    [[nodiscard]] const char *sourceName() const { return source_ ? source_->name() : "none"; }
+
+    [[nodiscard]] bool directIO() const { return staging_ != nullptr; }
+
+    // Reads that didn't match their CRC, retries included, and those that still didn't after them
+    [[nodiscard]] uint64_t crcMismatches() const { return crc_mismatches_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] uint64_t crcRejected() const { return crc_rejected_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] uint64_t bytesVerified() const { return bytes_verified_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    void runDecoder();
+
+    /*!
+     * Compresses what the batch's destinations hold on the workers, returning once all are done.
+     * @return false if the loader is stopping and the batch should be abandoned
+     */
+    bool demoteBatch(const std::vector<ChunkLoadRequest> &batch);
+
+    // Compresses what the request's destination holds, if it asks for it
+    ChunkBlob demote(const ChunkLoadRequest &request);
+
+    ChunkLoadResult promote(const ChunkLoadRequest &request);
+
+    // Both leave @a out holding one result per request, in batch order
+    void readBatch(const std::vector<ChunkLoadRequest> &batch, std::vector<ChunkLoadResult> &out);
+
+    void readBatchDirect(const std::vector<ChunkLoadRequest> &batch,
+                         std::vector<ChunkLoadResult> &out);
+
+    // A whole read waiting on a worker to check its CRC, or on the I/O thread to read it again
+    struct PendingVerify {
+        ChunkLoadRequest request;
+        uint32_t rereads;
+    };
+
+    // Checks a read's CRC on a worker, then posts its result or queues it to be read again
+    void verify(PendingVerify &pending);
+
+    std::unique_ptr<ChunkSource> source_;
+    std::unique_ptr<AlignedBufferPool> staging_;
+    ChunkLoaderOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::condition_variable decode_cv_;
+    ChunkLoadQueue queue_;
+    ChunkLoadQueue decode_queue_;
+    std::deque<const ChunkLoadRequest *> demote_queue_;
+    size_t demotes_outstanding_ = 0;
+    std::condition_variable demote_cv_;
+    std::deque<PendingVerify> verify_queue_;
+    std::deque<PendingVerify> reread_queue_;
+    std::vector<ChunkLoadResult> results_;
+    std::vector<CompressedChunk> compressed_;
+    size_t active_ = 0;  // Requests taken by a thread but not yet in results_
+    bool stop_ = false;
+
+    std::atomic<uint64_t> crc_mismatches_{0};
+    std::atomic<uint64_t> crc_rejected_{0};
+    std::atomic<uint64_t> bytes_verified_{0};
+
+    std::thread thread_;
+    std::vector<std::thread> decoders_;
+};
+
+#endif //CHUNKLOADER_H
@@ -0,0 +1,868 @@
+// 64-bit file offsets on 32-bit Android ABIs; datasets routinely exceed 2 GB
+#define _FILE_OFFSET_BITS 64
+
+#include "ChunkSource.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TileManifest.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define CHUNKSOURCE_HAS_IO_URING 1
+#endif
+
+// Reads exactly length bytes unless EOF is hit first
+static int64_t preadFully(int fd, void *dst, uint32_t length, uint64_t offset) {
+    uint32_t total = 0;
+    while (total < length) {
+        ssize_t n = ::pread(fd, static_cast<char *>(dst) + total, length - total,
+                            static_cast<off_t>(offset + total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<uint32_t>(n);
+    }
+    return total;
+}
+
+// Bytes of a read at @a offset that fall inside the first @a limit bytes of the source
+static uint32_t clampLength(uint64_t offset, uint32_t length, uint64_t limit) {
+    if (offset >= limit) {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(length, limit - offset));
+}
+
+
+// A descriptor of its own for @a range's file. A duplicate shares the caller's file status flags,
+// so O_DIRECT needs a fresh open of the same file.
+static int duplicateDescriptor(const ChunkFileRange &range, bool direct_io) {
+#ifdef O_DIRECT
+    if (direct_io) {
+        return ::open(("/proc/self/fd/" + std::to_string(range.fd)).c_str(),
+                      O_RDONLY | O_CLOEXEC | O_DIRECT);
+    }
+#endif
+    return fcntl(range.fd, F_DUPFD_CLOEXEC, 0);
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// pread pool
+// ---------------------------------------------------------------------------------------------
+
+class PReadChunkSource : public ChunkSource {
+public:
+    PReadChunkSource(int fd, uint64_t base, uint64_t limit, uint32_t threads)
+            : fd_(fd), base_(base), limit_(limit) {
+        threads = std::max(1u, threads);
+        for (uint32_t i = 0; i < threads; i++) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~PReadChunkSource() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+        ::close(fd_);
+    }
+
+    size_t submit(const ChunkReadRequest *requests, size_t count) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.insert(pending_.end(), requests, requests + count);
+            in_flight_ += count;
+        }
+        work_cv_.notify_all();
+        return count;
+    }
+
+    size_t reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t wanted = std::min(min_complete, in_flight_);
+        done_cv_.wait(lock, [&] { return done_.size() >= wanted; });
+
+        size_t n = std::min(max, done_.size());
+        for (size_t i = 0; i < n; i++) {
+            completions[i] = done_.front();
+            done_.pop_front();
+        }
+        in_flight_ -= n;
+        return n;
+    }
+
+    size_t inFlight() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return in_flight_;
+    }
+
+    const char *name() const override { return "pread"; }
+
+private:
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (stopping_) {
+                return;
+            }
+
+            ChunkReadRequest request = pending_.front();
+            pending_.pop_front();
+
+            lock.unlock();
+            int64_t result = preadFully(fd_, request.dst,
+                                        clampLength(request.offset, request.length, limit_),
+                                        base_ + request.offset);
+            lock.lock();
+
+            done_.push_back({request.user_data, result});
+            done_cv_.notify_all();
+        }
+    }
+
+    int fd_;
+    uint64_t base_;
+    uint64_t limit_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::deque<ChunkReadRequest> pending_;
+    std::deque<ChunkReadCompletion> done_;
+    size_t in_flight_ = 0;
+    bool stopping_ = false;
+};
+
+
+// ---------------------------------------------------------------------------------------------
+// mmap + madvise
+// ---------------------------------------------------------------------------------------------
+
+class MMapChunkSource : public ChunkSource {
+public:
+    static std::unique_ptr<ChunkSource> create(int fd, uint64_t base, uint64_t limit) {
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) <= base) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        // Mappings start on a page; an embedded .pcd usually doesn't
+        auto size = static_cast<size_t>(std::min<uint64_t>(limit, st.st_size - base));
+        uint64_t map_offset = base & ~(pageSize() - 1);
+        auto map_size = static_cast<size_t>(size + (base - map_offset));
+        void *map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd,
+                         static_cast<off_t>(map_offset));
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        // Chunk access is scattered; kernel readahead around each fault only wastes bandwidth
+        madvise(map, map_size, MADV_RANDOM);
+
+        return std::unique_ptr<ChunkSource>(
+                new MMapChunkSource(fd, map, map_size, static_cast<char *>(map) + (base - map_offset), size));
+    }
+
+    ~MMapChunkSource() override {
+        munmap(map_, map_size_);
+        ::close(fd_);
+    }
+
+    size_t submit(const ChunkReadRequest *requests, size_t count) override {
+        // Announce the whole batch first so the kernel can read the ranges in parallel, then
+        // copy them out in order; the copies fault on whatever hasn't arrived yet.
+        for (size_t i = 0; i < count; i++) {
+            const ChunkReadRequest &request = requests[i];
+            if (request.offset >= size_) {
+                continue;
+            }
+            auto begin = reinterpret_cast<uintptr_t>(base_ + request.offset) & ~(pageSize() - 1);
+            auto end = reinterpret_cast<uintptr_t>(base_ + std::min<uint64_t>(
+                    request.offset + request.length, size_));
+            madvise(reinterpret_cast<void *>(begin), end - begin, MADV_WILLNEED);
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const ChunkReadRequest &request = requests[i];
+            int64_t result = 0;
+            if (request.offset < size_) {
+                result = std::min<uint64_t>(request.length, size_ - request.offset);
+                std::memcpy(request.dst, base_ + request.offset, static_cast<size_t>(result));
+            }
+            done_.push_back({request.user_data, result});
+        }
+        return count;
+    }
+
+    size_t reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) override {
+        size_t n = std::min(max, done_.size());
+        for (size_t i = 0; i < n; i++) {
+            completions[i] = done_.front();
+            done_.pop_front();
+        }
+        return n;
+    }
+
+    size_t inFlight() const override { return done_.size(); }
+
+    const char *name() const override { return "mmap"; }
+
+private:
+    MMapChunkSource(int fd, void *map, size_t map_size, char *base, size_t size)
+            : fd_(fd), map_(map), map_size_(map_size), base_(base), size_(size) {}
+
+    static uint64_t pageSize() {
+        static const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        return page_size;
+    }
+
+    int fd_;
+    void *map_;
+    size_t map_size_;
+    char *base_;  // Start of the .pcd inside the mapping
+    size_t size_;
+    std::deque<ChunkReadCompletion> done_;
+};
+
+
+// ---------------------------------------------------------------------------------------------
+// io_uring (raw syscalls; liburing isn't available in the NDK)
+// ---------------------------------------------------------------------------------------------
+
+#ifdef CHUNKSOURCE_HAS_IO_URING
+
+class IOUringChunkSource : public ChunkSource {
+public:
+    static std::unique_ptr<ChunkSource> create(int fd, uint64_t base, uint64_t limit,
+                                               uint32_t queue_depth) {
+        io_uring_params params{};
+        int ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, std::max(1u, queue_depth),
+                                               &params));
+        if (ring_fd < 0) {
+            // ENOSYS on old kernels, EPERM where seccomp blocks it (Android apps)
+            int err = errno;
+            ::close(fd);
+            errno = err;
+            return nullptr;
+        }
+
+        // IORING_OP_READ needs 5.6, which is also the first kernel to report RW_CUR_POS
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            ::close(ring_fd);
+            ::close(fd);
+            errno = ENOSYS;
+            return nullptr;
+        }
+
+        std::unique_ptr<IOUringChunkSource> source(new IOUringChunkSource(fd, ring_fd, base, limit));
+        if (!source->mapRings(params)) {
+            return nullptr;
+        }
+
+        // A registered file skips the per-request fget/fput; not fatal if it fails
+        int fds[1] = {fd};
+        if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_FILES, fds, 1) == 0) {
+            source->fixed_file_ = true;
+        }
+
+        return source;
+    }
+
+    ~IOUringChunkSource() override {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+            munmap(cq_ptr_, cq_size_);
+        }
+        if (sq_ptr_ != MAP_FAILED) {
+            munmap(sq_ptr_, sq_size_);
+        }
+        ::close(ring_fd_);
+        ::close(fd_);
+    }
+
+    size_t submit(const ChunkReadRequest *requests, size_t count) override {
+        unsigned tail = *sq_tail_;
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+        size_t sq_space = sq_entries_ - (tail - head);
+        size_t cq_space = cq_entries_ - in_flight_;
+        size_t n = std::min({count, sq_space, cq_space});
+
+        for (size_t i = 0; i < n; i++) {
+            const ChunkReadRequest &request = requests[i];
+            unsigned index = tail & *sq_mask_;
+            io_uring_sqe *sqe = &sqes_[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+
+            const char *dst = static_cast<const char *>(request.dst);
+            uint32_t length = clampLength(request.offset, request.length, limit_);
+            bool fixed_buffer = buf_base_ != nullptr && dst >= buf_base_ &&
+                                dst + length <= buf_base_ + buf_len_;
+
+            sqe->opcode = fixed_buffer ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe->fd = fixed_file_ ? 0 : fd_;
+            sqe->flags = fixed_file_ ? IOSQE_FIXED_FILE : 0;
+            sqe->off = base_ + request.offset;
+            sqe->addr = reinterpret_cast<uint64_t>(request.dst);
+            sqe->len = length;
+            sqe->buf_index = 0;
+            sqe->user_data = request.user_data;
+
+            sq_array_[index] = index;
+            tail++;
+        }
+
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        to_submit_ += n;
+        in_flight_ += n;
+
+        enter(0);
+        return n;
+    }
+
+    size_t reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) override {
+        size_t wanted = std::min({min_complete, max, in_flight_});
+        size_t n = 0;
+
+        while (true) {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+            while (head != tail && n < max) {
+                const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+                completions[n++] = {cqe.user_data, cqe.res};
+                head++;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+            if (n >= wanted) {
+                break;
+            }
+            if (enter(static_cast<unsigned>(wanted - n)) < 0 && errno != EINTR) {
+                break;
+            }
+        }
+
+        in_flight_ -= n;
+        return n;
+    }
+
+    size_t inFlight() const override { return in_flight_; }
+
+    const char *name() const override { return "io_uring"; }
+
+    bool registerBuffers(void *base, size_t length) override {
+        if (buf_base_ != nullptr) {
+            syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+            buf_base_ = nullptr;
+            buf_len_ = 0;
+        }
+
+        iovec iov{base, length};
+        if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, &iov, 1) != 0) {
+            // Usually RLIMIT_MEMLOCK; plain reads still work
+            return false;
+        }
+
+        buf_base_ = static_cast<const char *>(base);
+        buf_len_ = length;
+        return true;
+    }
+
+private:
+    IOUringChunkSource(int fd, int ring_fd, uint64_t base, uint64_t limit)
+            : fd_(fd), ring_fd_(ring_fd), base_(base), limit_(limit) {}
+
+    bool mapRings(const io_uring_params &params) {
+        sq_entries_ = params.sq_entries;
+        cq_entries_ = params.cq_entries;
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            return false;
+        }
+
+        if (single_mmap) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) {
+                return false;
+            }
+        }
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+        auto *sq = static_cast<char *>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        auto *cq = static_cast<char *>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Pushes queued SQEs to the kernel, optionally waiting for completions
+    int enter(unsigned min_complete) {
+        unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        if (to_submit_ == 0 && flags == 0) {
+            return 0;
+        }
+
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit_,
+                                           min_complete, flags, nullptr, 0));
+        if (ret >= 0) {
+            to_submit_ -= std::min<unsigned>(to_submit_, static_cast<unsigned>(ret));
+        }
+        return ret;
+    }
+
+    int fd_;
+    int ring_fd_;
+    uint64_t base_;
+    uint64_t limit_;
+    bool fixed_file_ = false;
+
+    void *sq_ptr_ = MAP_FAILED;
+    void *cq_ptr_ = MAP_FAILED;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+
+    unsigned sq_entries_ = 0;
+    unsigned cq_entries_ = 0;
+    unsigned to_submit_ = 0;
+    size_t in_flight_ = 0;
+
+    const char *buf_base_ = nullptr;
+    size_t buf_len_ = 0;
+};
+
+#endif // CHUNKSOURCE_HAS_IO_URING
+
+
+// ---------------------------------------------------------------------------------------------
+// pread pool over tiles
+// ---------------------------------------------------------------------------------------------
+
+TiledChunkSource::TiledChunkSource(const ChunkSourceOptions &options) : options_(options) {
+    uint32_t threads = std::max(1u, options.threads);
+    for (uint32_t i = 0; i < threads; i++) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+TiledChunkSource::~TiledChunkSource() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    for (const Tile &tile : tiles_) {
+        if (tile.fd >= 0) {
+            ::close(tile.fd);
+        }
+    }
+}
+
+bool TiledChunkSource::addTile(uint32_t tile, const ChunkFileRange &range) {
+    // Direct reads land on absolute file offsets, which are only aligned if the range is
+    if (tile >= kMaxTiles || (options_.direct_io && range.offset % PCD_PAYLOAD_ALIGNMENT != 0)) {
+        errno = EINVAL;
+        return false;
+    }
+    int fd = duplicateDescriptor(range, options_.direct_io);
+    if (fd < 0) {
+        return false;
+    }
+#if defined(F_NOCACHE) && !defined(O_DIRECT)
+    if (options_.direct_io) {
+        fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tile >= tiles_.size()) {
+        tiles_.resize(tile + 1);
+    }
+    if (tiles_[tile].fd >= 0) {
+        ::close(fd);
+        errno = EEXIST;
+        return false;
+    }
+    tiles_[tile] = {fd, range.offset, range.length > 0 ? range.length : UINT64_MAX};
+    open_tiles_++;
+    return true;
+}
+
+bool TiledChunkSource::hasTile(uint32_t tile) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tile < tiles_.size() && tiles_[tile].fd >= 0;
+}
+
+size_t TiledChunkSource::tileCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_tiles_;
+}
+
+size_t TiledChunkSource::submit(const ChunkReadRequest *requests, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.insert(pending_.end(), requests, requests + count);
+        in_flight_ += count;
+    }
+    work_cv_.notify_all();
+    return count;
+}
+
+size_t TiledChunkSource::reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t wanted = std::min(min_complete, in_flight_);
+    done_cv_.wait(lock, [&] { return done_.size() >= wanted; });
+
+    size_t n = std::min(max, done_.size());
+    for (size_t i = 0; i < n; i++) {
+        completions[i] = done_.front();
+        done_.pop_front();
+    }
+    in_flight_ -= n;
+    return n;
+}
+
+size_t TiledChunkSource::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_;
+}
+
+void TiledChunkSource::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+        if (stopping_) {
+            return;
+        }
+
+        ChunkReadRequest request = pending_.front();
+        pending_.pop_front();
+
+        // Tiles are never removed, so the copy stays good once the lock is dropped
+        uint32_t tile_id = offsetTile(request.offset);
+        Tile tile = tile_id < tiles_.size() ? tiles_[tile_id] : Tile();
+
+        lock.unlock();
+        int64_t result = -EBADF;
+        if (tile.fd >= 0) {
+            uint64_t offset = offsetInTile(request.offset);
+            result = preadFully(tile.fd, request.dst, clampLength(offset, request.length, tile.limit),
+                                tile.base + offset);
+        }
+        lock.lock();
+
+        done_.push_back({request.user_data, result});
+        done_cv_.notify_all();
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------
+// ChunkSource
+// ---------------------------------------------------------------------------------------------
+
+size_t ChunkSource::readBatch(const ChunkReadRequest *requests, size_t count,
+                              ChunkReadCompletion *completions) {
+    // Tag each request with its index so short reads can be told apart from full ones
+    std::vector<ChunkReadRequest> tagged(requests, requests + count);
+    for (size_t i = 0; i < count; i++) {
+        tagged[i].user_data = i;
+    }
+
+    std::vector<bool> seen(count, false);
+    size_t submitted = 0;
+    size_t reaped = 0;
+    size_t complete = 0;
+
+    while (reaped < count) {
+        if (submitted < count) {
+            submitted += submit(tagged.data() + submitted, count - submitted);
+        }
+
+        if (submitted == reaped) {
+            // Nothing accepted and nothing pending: the backend is wedged
+            break;
+        }
+
+        // A blocking reap that comes back empty means the backend failed (io_uring_enter with
+        // something other than EINTR); waiting again would spin forever
+        size_t n = reap(completions + reaped, count - reaped, 1);
+        if (n == 0) {
+            break;
+        }
+
+        // Completions left over from a batch that failed like this can still turn up; they
+        // aren't this batch's, so they're dropped
+        size_t end = reaped + n;
+        for (size_t i = reaped; i < end; i++) {
+            size_t index = completions[i].user_data;
+            if (index >= count || seen[index]) {
+                continue;
+            }
+            seen[index] = true;
+            if (completions[i].result == requests[index].length) {
+                complete++;
+            }
+            completions[reaped++] = {requests[index].user_data, completions[i].result};
+        }
+    }
+
+    for (size_t i = 0; i < count && reaped < count; i++) {
+        if (!seen[i]) {
+            completions[reaped++] = {requests[i].user_data, -EIO};
+        }
+    }
+
+    return complete;
+}
+
+// Takes ownership of @a fd
+static std::unique_ptr<ChunkSource> createSource(int fd, uint64_t base, uint64_t limit,
+                                                 ChunkSourceKind kind,
+                                                 const ChunkSourceOptions &options) {
+#if defined(F_NOCACHE) && !defined(O_DIRECT)
+    if (options.direct_io) {
+        fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+
+    switch (kind) {
+        case ChunkSourceKind::PRead:
+            return std::unique_ptr<ChunkSource>(new PReadChunkSource(fd, base, limit, options.threads));
+        case ChunkSourceKind::MMap:
+            return MMapChunkSource::create(fd, base, limit);
+        case ChunkSourceKind::IOUring:
+#ifdef CHUNKSOURCE_HAS_IO_URING
+            return IOUringChunkSource::create(fd, base, limit, options.queue_depth);
+#else
+            ::close(fd);
+            errno = ENOSYS;
+            return nullptr;
+#endif
+    }
+
+    ::close(fd);
+    return nullptr;
+}
+
+std::unique_ptr<ChunkSource> ChunkSource::open(const std::string &path, ChunkSourceKind kind,
+                                               const ChunkSourceOptions &options) {
+    // Page cache bypass makes no sense for a mapping
+    if (options.direct_io && kind == ChunkSourceKind::MMap) {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    int flags = O_RDONLY | O_CLOEXEC;
+#ifdef O_DIRECT
+    if (options.direct_io) {
+        flags |= O_DIRECT;
+    }
+#endif
+
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    return createSource(fd, 0, UINT64_MAX, kind, options);
+}
+
+std::unique_ptr<ChunkSource> ChunkSource::open(const ChunkFileRange &range, ChunkSourceKind kind,
+                                               const ChunkSourceOptions &options) {
+    // Direct reads land on absolute file offsets, which are only aligned if the range is
+    if (options.direct_io &&
+        (kind == ChunkSourceKind::MMap || range.offset % PCD_PAYLOAD_ALIGNMENT != 0)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    int fd = duplicateDescriptor(range, options.direct_io);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    return createSource(fd, range.offset, range.length > 0 ? range.length : UINT64_MAX, kind,
+                        options);
+}
+
+const char *ChunkSource::kindName(ChunkSourceKind kind) {
+    switch (kind) {
+        case ChunkSourceKind::PRead:
+            return "pread";
+        case ChunkSourceKind::MMap:
+            return "mmap";
+        case ChunkSourceKind::IOUring:
+            return "io_uring";
+    }
+    return "unknown";
+}
+
+bool ChunkSource::parseKind(const std::string &name, ChunkSourceKind &kind) {
+    if (name == "pread") {
+        kind = ChunkSourceKind::PRead;
+    } else if (name == "mmap") {
+        kind = ChunkSourceKind::MMap;
+    } else if (name == "io_uring" || name == "uring") {
+        kind = ChunkSourceKind::IOUring;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Reads a ChunkFileRange through a buffer, with seeking, so readPcdIndex() can follow the
+// index pointer wherever the current index is
+class RangeStreamBuf : public std::streambuf {
+public:
+    RangeStreamBuf(int fd, uint64_t base, uint64_t limit)
+            : fd_(fd), base_(base), limit_(limit), buffer_(64 * 1024) {}
+
+    // -errno of the read that failed, 0 if none did
+    [[nodiscard]] int error() const { return error_; }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        position_ += egptr() - eback();
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+        if (position_ >= limit_) {
+            return traits_type::eof();
+        }
+
+        auto length = static_cast<uint32_t>(std::min<uint64_t>(buffer_.size(), limit_ - position_));
+        int64_t n = preadFully(fd_, buffer_.data(), length, base_ + position_);
+        if (n <= 0) {
+            error_ = n < 0 ? static_cast<int>(n) : 0;
+            return traits_type::eof();
+        }
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        uint64_t current = position_ + (gptr() - eback());
+        off_type target = dir == std::ios_base::beg ? off
+                        : dir == std::ios_base::cur ? static_cast<off_type>(current) + off
+                                                    : static_cast<off_type>(limit_) + off;
+        return seekpos(target, which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode) override {
+        if (pos < 0 || static_cast<uint64_t>(pos) > limit_) {
+            return pos_type(off_type(-1));
+        }
+        position_ = static_cast<uint64_t>(pos);
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+        return pos;
+    }
+
+private:
+    int fd_;
+    uint64_t base_;
+    uint64_t limit_;
+    uint64_t position_ = 0;  // Range offset of the buffer's start
+    std::vector<char> buffer_;
+    int error_ = 0;
+};
+
+bool readPcdIndex(const ChunkFileRange &range, PcdIndex &index, std::string *error) {
+    uint64_t limit = range.length;
+    struct stat st{};
+    if (limit == 0) {
+        if (fstat(range.fd, &st) != 0) {
+            if (error != nullptr) {
+                *error = std::string("Failed to stat file: ") + std::strerror(errno);
+            }
+            return false;
+        }
+        limit = static_cast<uint64_t>(st.st_size) > range.offset ? st.st_size - range.offset : 0;
+    }
+
+    RangeStreamBuf buffer(range.fd, range.offset, limit);
+    std::istream in(&buffer);
+    if (readPcdIndex(in, index, error)) {
+        return true;
+    }
+    if (buffer.error() != 0 && error != nullptr) {
+        *error = std::string("Failed to read index: ") + std::strerror(-buffer.error());
+    }
+    return false;
+}
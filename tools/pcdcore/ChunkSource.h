@@ -0,0 +1,186 @@
+#ifndef CHUNKSOURCE_H
+#define CHUNKSOURCE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PcdFile.h"
+
+// A single read of a contiguous byte range of a .pcd file into caller-owned memory.
+// The destination must stay valid until the matching completion has been reaped.
+struct ChunkReadRequest {
+    uint64_t offset;     // Absolute file offset
+    uint32_t length;     // Bytes to read
+    void *dst;           // Destination buffer
+    uint64_t user_data;  // Echoed back in the completion
+};
+
+struct ChunkReadCompletion {
+    uint64_t user_data;
+    int64_t result;      // Bytes read, or -errno on failure
+};
+
+enum class ChunkSourceKind {
+    PRead,    // Blocking pread() on a pool of worker threads
+    MMap,     // Whole-file mapping, madvise(WILLNEED) per batch, memcpy out
+    IOUring   // Linux io_uring with registered file and buffers
+};
+
+/*!
+ * A .pcd stored as a byte range of a larger file, such as an uncompressed asset inside an APK
+ * (see AAsset_openFileDescriptor64) or an entry of any other container. Chunk offsets stay
+ * relative to the start of the .pcd, so the same index works wherever the file is embedded.
+ */
+struct ChunkFileRange {
+    int fd = -1;           // Not owned; sources keep their own duplicate
+    uint64_t offset = 0;   // Where the .pcd starts in the file
+    uint64_t length = 0;   // Bytes of the .pcd, 0 for up to the end of the file
+};
+
+struct ChunkSourceOptions {
+    uint32_t queue_depth = 32;  // Max requests in flight (io_uring ring size)
+    uint32_t threads = 4;       // Worker threads for the pread pool
+
+    // Bypass the page cache (O_DIRECT, F_NOCACHE on macOS). Every request's offset, length and
+    // destination must then be PCD_PAYLOAD_ALIGNMENT aligned: use a file written with aligned
+    // payloads and buffers from an AlignedBufferPool. Not supported by the mmap backend, nor
+    // for a ChunkFileRange that doesn't start on an alignment boundary.
+    bool direct_io = false;
+};
+
+/*!
+ * Batch read interface for chunk payloads. Requests are queued with submit() and their results
+ * harvested with reap(); completions can arrive in any order, so callers match them up through
+ * ChunkReadRequest::user_data. Instances are not thread-safe: one thread submits and reaps.
+ */
+class ChunkSource {
+public:
+    virtual ~ChunkSource() = default;
+
+    /*!
+     * Queues up to @a count requests.
+     * @return the number accepted; the rest must be resubmitted after reaping some completions
+     */
+    virtual size_t submit(const ChunkReadRequest *requests, size_t count) = 0;
+
+    /*!
+     * Harvests finished requests, blocking until at least @a min_complete are available (0 polls).
+     * @return the number of completions written to @a completions
+     */
+    virtual size_t reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) = 0;
+
+    virtual size_t inFlight() const = 0;
+
+    virtual const char *name() const = 0;
+
+    /*!
+     * Hints that reads will land in [base, base + length). io_uring pins the range and switches to
+     * fixed-buffer reads for requests that fall inside it; other backends ignore the hint.
+     */
+    virtual bool registerBuffers(void *base, size_t length) { return false; }
+
+    /*!
+     * Submits every request and waits for all of them, keeping the queue as full as the backend
+     * allows. Exactly @a count results are written to @a completions, in completion order;
+     * requests the backend never finished report -EIO.
+     * @return the number of requests that read their full length
+     */
+    size_t readBatch(const ChunkReadRequest *requests, size_t count,
+                     ChunkReadCompletion *completions);
+
+    /*!
+     * Opens @a path with the requested backend.
+     * @return the source, or null if the file can't be opened or the backend is unavailable
+     */
+    static std::unique_ptr<ChunkSource> open(const std::string &path, ChunkSourceKind kind,
+                                             const ChunkSourceOptions &options = {});
+
+    /*!
+     * Reads from @a range of an already open file. Request offsets are relative to the range's
+     * start, and reads past its end come back short. The source works on its own duplicate of
+     * the descriptor, so the caller can close theirs right away.
+     * @return the source, or null if the descriptor can't be duplicated or the backend is
+     *         unavailable
+     */
+    static std::unique_ptr<ChunkSource> open(const ChunkFileRange &range, ChunkSourceKind kind,
+                                             const ChunkSourceOptions &options = {});
+
+    static const char *kindName(ChunkSourceKind kind);
+
+    static bool parseKind(const std::string &name, ChunkSourceKind &kind);
+};
+
+/*!
+ * pread pool over the tiles of a tiled dataset (see TileManifest.h). A request names its tile in
+ * the top bits of its offset (tiledOffset()), so one ChunkLoader, with one queue and one set of
+ * caches, serves every tile, and reads from different tiles run side by side on the same
+ * workers. Tiles are added as they're opened; reads from a tile not yet added fail with -EBADF.
+ *
+ * addTile() may be called from any thread, including while another submits and reaps.
+ */
+class TiledChunkSource : public ChunkSource {
+public:
+    explicit TiledChunkSource(const ChunkSourceOptions &options = {});
+
+    ~TiledChunkSource() override;
+
+    TiledChunkSource(const TiledChunkSource&) = delete;
+    TiledChunkSource& operator=(const TiledChunkSource&) = delete;
+
+    /*!
+     * Serves reads of tile @a tile from @a range, on a duplicate of its descriptor (a fresh
+     * O_DIRECT one with direct_io). A tile can only be added once.
+     * @return false if the tile is already there, its id is out of range or the descriptor can't
+     *         be duplicated
+     */
+    bool addTile(uint32_t tile, const ChunkFileRange &range);
+
+    [[nodiscard]] bool hasTile(uint32_t tile) const;
+
+    [[nodiscard]] size_t tileCount() const;
+
+    size_t submit(const ChunkReadRequest *requests, size_t count) override;
+
+    size_t reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) override;
+
+    size_t inFlight() const override;
+
+    const char *name() const override { return "pread (tiled)"; }
+
+private:
+    struct Tile {
+        int fd = -1;
+        uint64_t base = 0;
+        uint64_t limit = 0;
+    };
+
+    void workerLoop();
+
+    ChunkSourceOptions options_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::vector<Tile> tiles_;  // By tile id
+    std::deque<ChunkReadRequest> pending_;
+    std::deque<ChunkReadCompletion> done_;
+    size_t in_flight_ = 0;
+    size_t open_tiles_ = 0;
+    bool stopping_ = false;
+};
+
+/*!
+ * readPcdIndex() for a .pcd embedded in a larger file.
+ * @return false if the range can't be read or doesn't hold a .pcd; @a error then says why
+ */
+bool readPcdIndex(const ChunkFileRange &range, PcdIndex &index, std::string *error = nullptr);
+
+#endif //CHUNKSOURCE_H
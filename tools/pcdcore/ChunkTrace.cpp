@@ -0,0 +1,102 @@
+#include "ChunkTrace.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "Morton.h"
+
+static bool setError(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+bool readChunkTrace(const std::string& path, ChunkTrace& trace, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        return setError(error, "Failed to open trace: " + path);
+    }
+
+    trace.depth = 0;
+    trace.loads.clear();
+
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+        std::istringstream in(line);
+        std::string first;
+        if (!(in >> first) || first[0] == '#') {
+            continue;
+        }
+
+        if (first == "depth") {
+            if (!(in >> trace.depth) || trace.depth < 1 || trace.depth > MORTON_MAX_DEPTH) {
+                return setError(error, path + ":" + std::to_string(line_number) + ": bad depth");
+            }
+            continue;
+        }
+
+        ChunkTraceEntry entry{};
+        std::istringstream frame(first);
+        if (!(frame >> entry.frame) || !(in >> entry.pos_code)) {
+            return setError(error, path + ":" + std::to_string(line_number) +
+                                   ": expected '<frame> <pos_code>'");
+        }
+        trace.loads.push_back(entry);
+    }
+
+    if (trace.depth == 0) {
+        return setError(error, path + ": missing 'depth' line");
+    }
+    return true;
+}
+
+bool ChunkTraceWriter::open(const std::string& path, int depth) {
+    file_.open(path, std::ios::out | std::ios::trunc);
+    if (!file_) {
+        return false;
+    }
+
+    file_ << "# frame pos_code\n" << "depth " << depth << "\n";
+    return file_.good();
+}
+
+void ChunkTraceWriter::record(uint32_t frame, uint32_t pos_code) {
+    if (!file_.is_open()) {
+        return;
+    }
+
+    // Apps are usually killed rather than shut down, so don't sit on more than a frame
+    if (frame != last_frame_) {
+        file_.flush();
+        last_frame_ = frame;
+    }
+    file_ << frame << ' ' << pos_code << '\n';
+}
+
+void ChunkTraceWriter::close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
+
+ChunkCodeMap::ChunkCodeMap(const PcdIndex& index, int depth) {
+    codes_.reserve(index.chunks.size());
+    sorted_.reserve(index.chunks.size());
+
+    for (uint32_t i = 0; i < index.chunks.size(); ++i) {
+        float cx, cy, cz;
+        index.chunks[i].bbox.getCenter(cx, cy, cz);
+        uint32_t code = mortonCell(cx, cy, cz, index.header.bounds, depth);
+        codes_.push_back(code);
+        sorted_.emplace_back(code, i);
+    }
+
+    std::sort(sorted_.begin(), sorted_.end());
+}
+
+uint32_t ChunkCodeMap::find(uint32_t pos_code) const {
+    auto it = std::lower_bound(sorted_.begin(), sorted_.end(),
+                               std::make_pair(pos_code, uint32_t(0)));
+    return it == sorted_.end() ? UINT32_MAX : it->second;
+}
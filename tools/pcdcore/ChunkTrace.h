@@ -0,0 +1,72 @@
+#ifndef CHUNKTRACE_H
+#define CHUNKTRACE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PcdFile.h"
+
+// One chunk load: the frame it was requested in and the octree cell code of the chunk
+struct ChunkTraceEntry {
+    uint32_t frame;
+    uint32_t pos_code;
+};
+
+/*!
+ * Chunk loads recorded by the runtime, used to optimize the file layout (pcd_layout). Stored as
+ * text so traces pulled off a device can be read and concatenated by hand:
+ *
+ *  # comment
+ *  depth 8
+ *  <frame> <pos_code>
+ *  ...
+ *
+ * pos_code is the Morton code (see Morton.h) of the chunk's octree leaf at the given depth. A
+ * leaf above that depth may be recorded by any cell inside it, normally its first.
+ */
+struct ChunkTrace {
+    int depth = 0;
+    std::vector<ChunkTraceEntry> loads;
+};
+
+bool readChunkTrace(const std::string& path, ChunkTrace& trace, std::string* error = nullptr);
+
+// Appends loads to a trace file as they happen
+class ChunkTraceWriter {
+public:
+    bool open(const std::string& path, int depth);
+
+    void record(uint32_t frame, uint32_t pos_code);
+
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return file_.is_open(); }
+
+private:
+    std::ofstream file_;
+    uint32_t last_frame_ = 0;
+};
+
+/*!
+ * Maps trace cell codes back to chunk indices. Each chunk is keyed by the cell holding its
+ * center, which lies inside its leaf; since a leaf covers a contiguous run of codes, the chunk
+ * for a code is the first one at or after it.
+ */
+class ChunkCodeMap {
+public:
+    ChunkCodeMap(const PcdIndex& index, int depth);
+
+    // Cell code of chunk @a chunk_id, as the runtime records it
+    [[nodiscard]] uint32_t code(uint32_t chunk_id) const { return codes_[chunk_id]; }
+
+    // The chunk recorded as @a pos_code, or UINT32_MAX if there is none
+    [[nodiscard]] uint32_t find(uint32_t pos_code) const;
+
+private:
+    std::vector<uint32_t> codes_;
+    std::vector<std::pair<uint32_t, uint32_t>> sorted_;  // (code, chunk), by code
+};
+
+#endif //CHUNKTRACE_H
@@ -0,0 +1,82 @@
+#include "CompressedChunkCache.h"
+
+CompressedChunkCache::CompressedChunkCache(size_t budget_bytes) : budget_(budget_bytes) {}
+
+void CompressedChunkCache::insert(uint32_t chunk_id, ChunkBlob blob) {
+    erase(chunk_id);
+
+    if (!blob || blob->size() > budget_) {
+        return;
+    }
+
+    evictTo(budget_ - blob->size());
+
+    bytes_ += blob->size();
+    lru_.push_front({chunk_id, std::move(blob)});
+    map_[chunk_id] = lru_.begin();
+}
+
+ChunkBlob CompressedChunkCache::find(uint32_t chunk_id) {
+    auto it = map_.find(chunk_id);
+    if (it == map_.end()) {
+        misses_++;
+        return nullptr;
+    }
+
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->blob;
+}
+
+ChunkBlob CompressedChunkCache::promote(uint32_t chunk_id) {
+    ChunkBlob blob = find(chunk_id);
+    if (!blob) {
+        return nullptr;
+    }
+
+    ChunkBlob& held = held_[chunk_id];
+    if (held) {
+        held_bytes_ -= held->size();
+    }
+    held = blob;
+    held_bytes_ += blob->size();
+    return blob;
+}
+
+bool CompressedChunkCache::retire(uint32_t chunk_id) {
+    auto it = held_.find(chunk_id);
+    if (it == held_.end()) {
+        return false;
+    }
+
+    ChunkBlob blob = std::move(it->second);
+    held_bytes_ -= blob->size();
+    held_.erase(it);
+
+    // Back in as most recently used, unless it's still there
+    if (!contains(chunk_id)) {
+        insert(chunk_id, std::move(blob));
+    }
+    return true;
+}
+
+void CompressedChunkCache::erase(uint32_t chunk_id) {
+    auto it = map_.find(chunk_id);
+    if (it == map_.end()) {
+        return;
+    }
+
+    bytes_ -= it->second->blob->size();
+    lru_.erase(it->second);
+    map_.erase(it);
+}
+
+void CompressedChunkCache::evictTo(size_t budget) {
+    while (bytes_ > budget && !lru_.empty()) {
+        const Entry& victim = lru_.back();
+        bytes_ -= victim.blob->size();
+        map_.erase(victim.chunk_id);
+        lru_.pop_back();
+        evictions_++;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef COMPRESSEDCHUNKCACHE_H
+#define COMPRESSEDCHUNKCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "ChunkCodec.h"
+
+/*!
+ * Middle tier between storage and the decoded ChunkCache: chunks evicted from the decoded set are
+ * kept here compressed (see encodeChunk) under a byte budget, so coming back to them costs a
+ * decode instead of a read from flash. Least recently used chunks are dropped first.
+ *
+ * Not thread-safe: owned by the thread that schedules loads. Blobs are shared, so a decode in
+ * flight keeps its blob alive even if the cache drops it.
+ */
+class CompressedChunkCache {
+public:
+    explicit CompressedChunkCache(size_t budget_bytes);
+
+    /*!
+     * Adds or replaces the compressed copy of @a chunk_id, dropping older chunks until it fits.
+     * Blobs larger than the whole budget aren't kept.
+     */
+    void insert(uint32_t chunk_id, ChunkBlob blob);
+
+    // The compressed copy of @a chunk_id, or null on a miss
+    ChunkBlob find(uint32_t chunk_id);
+
+    /*!
+     * find() for decoding @a chunk_id back into the decoded set. The blob is also held, outside
+     * the budget, until retire(), so the chunk leaves the decoded set as the bytes it came in
+     * as: decoded points are never encoded again, which would add to the codec's error each
+     * round trip.
+     */
+    ChunkBlob promote(uint32_t chunk_id);
+
+    /*!
+     * For @a chunk_id leaving the decoded set, or a promotion of it that didn't land: puts the
+     * blob it was promoted from back in the tier.
+     * @return true if there was one, in which case the chunk mustn't be demoted
+     */
+    bool retire(uint32_t chunk_id);
+
+    void erase(uint32_t chunk_id);
+
+    [[nodiscard]] bool contains(uint32_t chunk_id) const {
+        return map_.find(chunk_id) != map_.end();
+    }
+
+    [[nodiscard]] size_t bytes() const { return bytes_; }
+
+    [[nodiscard]] size_t budget() const { return budget_; }
+
+    [[nodiscard]] size_t size() const { return map_.size(); }
+
+    // Blobs of promoted chunks, and their bytes
+    [[nodiscard]] size_t held() const { return held_.size(); }
+
+    [[nodiscard]] size_t heldBytes() const { return held_bytes_; }
+
+    [[nodiscard]] uint64_t hits() const { return hits_; }
+
+    [[nodiscard]] uint64_t misses() const { return misses_; }
+
+    [[nodiscard]] uint64_t evictions() const { return evictions_; }
+
+private:
+    struct Entry {
+        uint32_t chunk_id;
+        ChunkBlob blob;
+    };
+
+    void evictTo(size_t budget);
+
+    size_t budget_;
+    size_t bytes_ = 0;
+
+    // Most recently used at the front
+    std::list<Entry> lru_;
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> map_;
+
+    std::unordered_map<uint32_t, ChunkBlob> held_;
+    size_t held_bytes_ = 0;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+#endif //COMPRESSEDCHUNKCACHE_H
@@ -0,0 +1,243 @@
+#include "Crc32c.h"
+
+#include <cstring>
+
+// Hardware CRC32C, compiled for its instruction set alone and picked at run time, so the
+// library still runs on CPUs without it
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE "sse4.2"
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+
+CRC32C_TARGET static inline uint32_t crcStep8(uint32_t crc, uint8_t value) {
+    return _mm_crc32_u8(crc, value);
+}
+
+#if defined(__x86_64__)
+CRC32C_TARGET static inline uint32_t crcStep64(uint32_t crc, uint64_t value) {
+    return static_cast<uint32_t>(_mm_crc32_u64(crc, value));
+}
+#else
+CRC32C_TARGET static inline uint32_t crcStep64(uint32_t crc, uint64_t value) {
+    crc = _mm_crc32_u32(crc, static_cast<uint32_t>(value));
+    return _mm_crc32_u32(crc, static_cast<uint32_t>(value >> 32));
+}
+#endif
+
+static bool hardwareSupported() {
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#define CRC32C_HARDWARE "armv8"
+#if defined(__ARM_FEATURE_CRC32)
+#define CRC32C_TARGET
+#elif defined(__clang__)
+#define CRC32C_TARGET __attribute__((target("crc")))
+#else
+#define CRC32C_TARGET __attribute__((target("+crc")))
+#endif
+
+CRC32C_TARGET static inline uint32_t crcStep8(uint32_t crc, uint8_t value) {
+    return __crc32cb(crc, value);
+}
+
+CRC32C_TARGET static inline uint32_t crcStep64(uint32_t crc, uint64_t value) {
+    return __crc32cd(crc, value);
+}
+
+// Optional in ARMv8.0, though every Android arm64 device has it
+static bool hardwareSupported() {
+#if defined(__ARM_FEATURE_CRC32)
+    return true;
+#elif defined(__linux__)
+    constexpr unsigned long kHwcapCrc32 = 1ul << 7;  // HWCAP_CRC32
+    return (getauxval(AT_HWCAP) & kHwcapCrc32) != 0;
+#else
+    return false;
+#endif
+}
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82f63b78;  // Castagnoli, bit reflected
+
+// Bytes each of the three streams covers per round; what's left goes through one stream
+constexpr size_t kLongStream = 8192;
+constexpr size_t kShortStream = 256;
+
+// a * b modulo the polynomial, both as bit reflected polynomials
+uint32_t multiplyModP(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+        }
+        b = (b & 1) ? (b >> 1) ^ kPolynomial : b >> 1;
+    }
+    return product;
+}
+
+// x^(8 * bytes) modulo the polynomial: what a CRC register is multiplied by when that many zero
+// bytes go through it
+uint32_t zeroBytesOperator(size_t bytes) {
+    uint32_t result = 1u << 31;  // x^0
+    uint32_t power = 1u << 30;   // x^1
+    for (int i = 0; i < 3; ++i) {
+        power = multiplyModP(power, power);
+    }
+    for (; bytes != 0; bytes >>= 1) {
+        if (bytes & 1) {
+            result = multiplyModP(power, result);
+        }
+        power = multiplyModP(power, power);
+    }
+    return result;
+}
+
+struct CrcTables {
+    uint32_t slice[8][256];       // Slicing by 8
+    uint32_t long_shift[4][256];  // Moves a register past kLongStream zero bytes, a byte at a time
+    uint32_t short_shift[4][256];
+
+    CrcTables() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t crc = n;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+            }
+            slice[0][n] = crc;
+        }
+        for (uint32_t n = 0; n < 256; ++n) {
+            for (int k = 1; k < 8; ++k) {
+                slice[k][n] = (slice[k - 1][n] >> 8) ^ slice[0][slice[k - 1][n] & 0xff];
+            }
+        }
+
+        uint32_t long_op = zeroBytesOperator(kLongStream);
+        uint32_t short_op = zeroBytesOperator(kShortStream);
+        for (uint32_t n = 0; n < 256; ++n) {
+            for (int k = 0; k < 4; ++k) {
+                long_shift[k][n] = multiplyModP(long_op, n << (8 * k));
+                short_shift[k][n] = multiplyModP(short_op, n << (8 * k));
+            }
+        }
+    }
+};
+
+const CrcTables& tables() {
+    static const CrcTables instance;
+    return instance;
+}
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+// Little endian only, like the file format
+uint32_t crc32cSoftware(const void* data, size_t size, uint32_t crc) {
+    const CrcTables& t = tables();
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint32_t c = ~crc;
+
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t v = load64(p) ^ c;
+        c = t.slice[7][v & 0xff] ^ t.slice[6][(v >> 8) & 0xff] ^ t.slice[5][(v >> 16) & 0xff] ^
+            t.slice[4][(v >> 24) & 0xff] ^ t.slice[3][(v >> 32) & 0xff] ^
+            t.slice[2][(v >> 40) & 0xff] ^ t.slice[1][(v >> 48) & 0xff] ^ t.slice[0][v >> 56];
+    }
+    for (; size > 0; ++p, --size) {
+        c = t.slice[0][(c ^ *p) & 0xff] ^ (c >> 8);
+    }
+    return ~c;
+}
+
+#ifdef CRC32C_HARDWARE
+
+static inline uint32_t shiftRegister(const uint32_t (&shift)[4][256], uint32_t crc) {
+    return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^ shift[2][(crc >> 16) & 0xff] ^
+           shift[3][crc >> 24];
+}
+
+// The instruction takes three cycles but a new one can start every cycle, so three independent
+// streams run at once. Each stream's register is then shifted past the bytes after it and
+// folded in, which CRCs being linear allows.
+CRC32C_TARGET static uint32_t crc32cHardware(const void* data, size_t size, uint32_t crc) {
+    const CrcTables& t = tables();
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint32_t c0 = ~crc;
+
+    for (; size > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; ++p, --size) {
+        c0 = crcStep8(c0, *p);
+    }
+
+    for (; size >= 3 * kLongStream; p += 3 * kLongStream, size -= 3 * kLongStream) {
+        uint32_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < kLongStream; i += 8) {
+            c0 = crcStep64(c0, load64(p + i));
+            c1 = crcStep64(c1, load64(p + kLongStream + i));
+            c2 = crcStep64(c2, load64(p + 2 * kLongStream + i));
+        }
+        c0 = shiftRegister(t.long_shift, c0) ^ c1;
+        c0 = shiftRegister(t.long_shift, c0) ^ c2;
+    }
+
+    for (; size >= 3 * kShortStream; p += 3 * kShortStream, size -= 3 * kShortStream) {
+        uint32_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < kShortStream; i += 8) {
+            c0 = crcStep64(c0, load64(p + i));
+            c1 = crcStep64(c1, load64(p + kShortStream + i));
+            c2 = crcStep64(c2, load64(p + 2 * kShortStream + i));
+        }
+        c0 = shiftRegister(t.short_shift, c0) ^ c1;
+        c0 = shiftRegister(t.short_shift, c0) ^ c2;
+    }
+
+    for (; size >= 8; p += 8, size -= 8) {
+        c0 = crcStep64(c0, load64(p));
+    }
+    for (; size > 0; ++p, --size) {
+        c0 = crcStep8(c0, *p);
+    }
+    return ~c0;
+}
+
+#endif
+
+namespace {
+
+struct CrcDispatch {
+    uint32_t (*fn)(const void*, size_t, uint32_t);
+    const char* name;
+};
+
+const CrcDispatch& dispatch() {
+    static const CrcDispatch chosen = [] {
+#ifdef CRC32C_HARDWARE
+        if (hardwareSupported()) {
+            return CrcDispatch{crc32cHardware, CRC32C_HARDWARE};
+        }
+#endif
+        return CrcDispatch{crc32cSoftware, "software"};
+    }();
+    return chosen;
+}
+
+}  // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    return dispatch().fn(data, size, crc);
+}
+
+const char* crc32cImplementation() {
+    return dispatch().name;
+}
@@ -0,0 +1,22 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * CRC32C (Castagnoli) of @a size bytes. Pass a previous result as @a crc to continue it:
+ * crc32c(b, nb, crc32c(a, na)) is the CRC of a followed by b.
+ *
+ * Uses the CPU's CRC32C instruction when it has one (SSE4.2, ARMv8 CRC), over three interleaved
+ * streams to hide its latency, which runs at several times flash read bandwidth.
+ */
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// Table driven (slicing by 8) version crc32c() falls back to, for comparison
+uint32_t crc32cSoftware(const void* data, size_t size, uint32_t crc = 0);
+
+// "sse4.2", "armv8" or "software": what crc32c() runs on this CPU
+const char* crc32cImplementation();
+
+#endif //CRC32C_H
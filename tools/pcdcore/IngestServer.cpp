@@ -0,0 +1,263 @@
+#include "IngestServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Points read from the stream per append()
+static constexpr size_t kReadPoints = 65536;
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool fail(std::string *error, const std::string &what) {
+    if (error) {
+        *error = what + ": " + std::strerror(errno);
+    }
+    return false;
+}
+
+IngestServer::IngestServer(const IngestOptions &options) : options_(options) {
+    buffer_.resize(kReadPoints);
+}
+
+IngestServer::~IngestServer() {
+    // Sequentially consistent with the ingest thread publishing the ingestor, so one of the two
+    // closes it: the consumer is going away, and nothing would make room for a blocked append()
+    stop_.store(true);
+    if (PointIngestor *ingestor = published_.load()) {
+        ingestor->close();
+    }
+    if (wake_fds_[1] >= 0) {
+        char byte = 0;
+        (void) ::write(wake_fds_[1], &byte, 1);
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    for (int fd : {listen_fd_, stream_fd_, wake_fds_[0], wake_fds_[1]}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (!unlink_path_.empty()) {
+        ::unlink(unlink_path_.c_str());
+    }
+}
+
+bool IngestServer::listen(const std::string &path, std::string *error) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        if (error) {
+            *error = "Bad socket path '" + path + "'";
+        }
+        return false;
+    }
+
+    bool abstract = path[0] == '@';
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    if (abstract) {
+        addr.sun_path[0] = '\0';
+    } else {
+        // Only a socket left behind by an earlier server is in the way; anything else at the
+        // path is someone's file
+        struct stat st{};
+        if (::lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                errno = EEXIST;
+                return fail(error, "listen " + path);
+            }
+            ::unlink(path.c_str());
+        }
+    }
+    auto length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + (abstract ? 0 : 1));
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        return fail(error, "socket");
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), length) != 0) {
+        return fail(error, "bind " + path);
+    }
+    if (!abstract) {
+        unlink_path_ = path;
+    }
+    if (::listen(listen_fd_, 1) != 0) {
+        return fail(error, "listen " + path);
+    }
+    return start(error);
+}
+
+bool IngestServer::attach(int fd, std::string *error) {
+    stream_fd_ = fd;
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    first_stream_ns_.store(nowNs(), std::memory_order_relaxed);
+    return start(error);
+}
+
+bool IngestServer::start(std::string *error) {
+    if (::pipe(wake_fds_) != 0) {
+        return fail(error, "pipe");
+    }
+    for (int fd : wake_fds_) {
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    thread_ = std::thread(&IngestServer::run, this);
+    return true;
+}
+
+size_t IngestServer::pollChunks(std::vector<IngestChunk> &chunks, size_t max) {
+    PointIngestor *ingestor = published_.load(std::memory_order_acquire);
+    return ingestor ? ingestor->pollChunks(chunks, max) : 0;
+}
+
+uint32_t IngestServer::openPoints(uint32_t cell, const Point *&points) const {
+    const PointIngestor *ingestor = published_.load(std::memory_order_acquire);
+    if (!ingestor) {
+        points = nullptr;
+        return 0;
+    }
+    return ingestor->openPoints(cell, points);
+}
+
+IngestServerStats IngestServer::stats() const {
+    IngestServerStats stats;
+    // Before the ingestor's counters, so a stream counted as ended has its last chunks counted
+    stats.streams_ended = streams_ended_.load(std::memory_order_acquire);
+    if (const PointIngestor *ingestor = published_.load(std::memory_order_acquire)) {
+        stats.ingest = ingestor->stats();
+    }
+    stats.bytes_in = bytes_in_.load(std::memory_order_relaxed);
+    stats.connections = connections_.load(std::memory_order_relaxed);
+    stats.bad_streams = bad_streams_.load(std::memory_order_relaxed);
+
+    int64_t first = first_stream_ns_.load(std::memory_order_relaxed);
+    int64_t last = last_read_ns_.load(std::memory_order_relaxed);
+    if (first > 0 && last > first) {
+        stats.seconds = double(last - first) * 1e-9;
+        stats.points_per_second = double(stats.ingest.points_in) / stats.seconds;
+    }
+    return stats;
+}
+
+void IngestServer::run() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        bool streaming = stream_fd_ >= 0;
+        if (!streaming && listen_fd_ < 0) {
+            return;
+        }
+
+        pollfd fds[2] = {{streaming ? stream_fd_ : listen_fd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+        // Wakes up now and then while cells are open, so a stream that goes quiet still has its
+        // stale cells sealed
+        int timeout = -1;
+        if (ingestor_ && options_.max_open_ms > 0) {
+            timeout = static_cast<int>(std::max(1u, options_.max_open_ms / 10));
+        }
+
+        int ready = ::poll(fds, 2, timeout);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        if (ready <= 0) {
+            if (ingestor_) {
+                ingestor_->sealStale();
+            }
+            continue;
+        }
+
+        if (!streaming) {
+            stream_fd_ = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (stream_fd_ >= 0) {
+                connections_.fetch_add(1, std::memory_order_relaxed);
+                int64_t expected = 0;
+                first_stream_ns_.compare_exchange_strong(expected, nowNs(), std::memory_order_relaxed);
+            }
+            continue;
+        }
+
+        if (!readStream()) {
+            endStream();
+            if (listen_fd_ < 0) {
+                return;
+            }
+        }
+    }
+}
+
+bool IngestServer::readStream() {
+    if (header_bytes_ < sizeof(header_)) {
+        ssize_t n = ::read(stream_fd_, reinterpret_cast<char *>(&header_) + header_bytes_,
+                           sizeof(header_) - header_bytes_);
+        if (n <= 0) {
+            return n < 0 && (errno == EINTR || errno == EAGAIN);
+        }
+        header_bytes_ += n;
+        bytes_in_.fetch_add(n, std::memory_order_relaxed);
+        if (header_bytes_ < sizeof(header_)) {
+            return true;
+        }
+
+        if (std::memcmp(header_.magic, PCD_STREAM_MAGIC, sizeof(PCD_STREAM_MAGIC)) != 0) {
+            bad_streams_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!ingestor_) {
+            IngestOptions options = options_;
+            if (options.bounds.min_x > options.bounds.max_x) {
+                options.bounds = header_.bounds;
+            }
+            ingestor_ = std::make_unique<PointIngestor>(options);
+            published_.store(ingestor_.get());
+            if (stop_.load()) {
+                ingestor_->close();
+            }
+        }
+        return true;
+    }
+
+    char *data = reinterpret_cast<char *>(buffer_.data());
+    ssize_t n = ::read(stream_fd_, data + buffer_bytes_, buffer_.size() * sizeof(Point) - buffer_bytes_);
+    if (n <= 0) {
+        return n < 0 && (errno == EINTR || errno == EAGAIN);
+    }
+    buffer_bytes_ += n;
+    bytes_in_.fetch_add(n, std::memory_order_relaxed);
+    last_read_ns_.store(nowNs(), std::memory_order_relaxed);
+
+    // Whole points go in; a partial one waits at the front of the buffer for the rest
+    size_t points = buffer_bytes_ / sizeof(Point);
+    if (ingestor_->append(buffer_.data(), points) < points) {
+        return false;
+    }
+    buffer_bytes_ -= points * sizeof(Point);
+    std::memmove(data, data + points * sizeof(Point), buffer_bytes_);
+    return true;
+}
+
+void IngestServer::endStream() {
+    if (ingestor_ && !stop_.load(std::memory_order_acquire)) {
+        ingestor_->flush();
+    }
+    ::close(stream_fd_);
+    stream_fd_ = -1;
+    header_bytes_ = 0;
+    buffer_bytes_ = 0;
+    streams_ended_.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,113 @@
+#ifndef INGESTSERVER_H
+#define INGESTSERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PointIngest.h"
+
+struct IngestServerStats {
+    IngestStats ingest;
+    uint64_t bytes_in = 0;
+    uint32_t connections = 0;    // Streams started, including a stream attached with attach()
+    uint32_t streams_ended = 0;  // Streams over, with their points all sealed
+    uint32_t bad_streams = 0;    // Closed for a wrong magic
+    double seconds = 0.0;        // From the first stream starting to the last bytes read
+    double points_per_second = 0.0;
+};
+
+/*!
+ * Reads point streams (see PointStreamHeader) from a UNIX socket or an already open descriptor
+ * such as a pipe, on a background thread that feeds a PointIngestor. Streams on the socket are
+ * taken one at a time: a sensor, or pcd_replay standing in for one, connects and sends until it
+ * closes, and the open cells are flushed when it does.
+ *
+ * If IngestOptions::bounds is empty, the ingestor is made from the first stream's header; until
+ * then pollChunks() finds nothing. While the consumer falls behind, the thread stops reading and
+ * the socket buffer fills, which blocks the sender rather than dropping points.
+ *
+ * pollChunks() and openPoints() are for one consumer thread; stats() may be called from any.
+ *
+ * ex:
+ *  IngestServer server(options);
+ *  server.listen("@rmus_ingest");
+ *  // every frame
+ *  server.pollChunks(chunks, 8);
+ */
+class IngestServer {
+public:
+    explicit IngestServer(const IngestOptions &options);
+
+    ~IngestServer();
+
+    IngestServer(const IngestServer &) = delete;
+    IngestServer &operator=(const IngestServer &) = delete;
+
+    /*!
+     * Accepts streams on a UNIX socket at @a path; a leading '@' names one in the abstract
+     * namespace, which leaves nothing behind on disk. A stale socket at @a path is replaced;
+     * anything else there is left alone and fails with EEXIST.
+     * @return false if the socket can't be set up; @a error then says why
+     */
+    bool listen(const std::string &path, std::string *error = nullptr);
+
+    /*!
+     * Reads a single stream from @a fd, which the server then owns, until it ends.
+     * @return false if the reader thread can't be started
+     */
+    bool attach(int fd, std::string *error = nullptr);
+
+    // PointIngestor::pollChunks(); nothing until the ingestor exists
+    size_t pollChunks(std::vector<IngestChunk> &chunks, size_t max);
+
+    // PointIngestor::openPoints()
+    uint32_t openPoints(uint32_t cell, const Point *&points) const;
+
+    // Null until the ingestor exists; see the class comment
+    [[nodiscard]] const PointIngestor *ingestor() const {
+        return published_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] IngestServerStats stats() const;
+
+private:
+    bool start(std::string *error);
+
+    void run();
+
+    // Reads what's available on the stream; false once it has ended
+    bool readStream();
+
+    void endStream();
+
+    IngestOptions options_;
+    std::unique_ptr<PointIngestor> ingestor_;  // Ingest thread only; consumers use published_
+    std::atomic<PointIngestor *> published_{nullptr};
+
+    int listen_fd_ = -1;
+    int stream_fd_ = -1;
+    int wake_fds_[2] = {-1, -1};  // Written by the destructor to interrupt poll()
+    std::string unlink_path_;     // Socket file to remove on destruction
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+
+    // Stream state, ingest thread only
+    PointStreamHeader header_{};
+    size_t header_bytes_ = 0;
+    std::vector<Point> buffer_;
+    size_t buffer_bytes_ = 0;  // Read into buffer_, including a partial last point
+
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<uint32_t> connections_{0};
+    std::atomic<uint32_t> bad_streams_{0};
+    std::atomic<uint32_t> streams_ended_{0};
+    std::atomic<int64_t> first_stream_ns_{0};
+    std::atomic<int64_t> last_read_ns_{0};
+};
+
+#endif //INGESTSERVER_H
@@ -0,0 +1,231 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// The pool the current thread works for, and its queue there
+static thread_local const JobSystem* tls_pool = nullptr;
+static thread_local uint32_t tls_queue = 0;
+
+CoreTopology detectCores() {
+    CoreTopology topology;
+    topology.cores = std::max(1u, std::thread::hardware_concurrency());
+    topology.big_cores = topology.cores;
+
+    std::vector<uint64_t> max_freq(topology.cores, 0);
+    for (uint32_t cpu = 0; cpu < topology.cores; ++cpu) {
+        std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                           "/cpufreq/cpuinfo_max_freq");
+        if (!(file >> max_freq[cpu])) {
+            return topology;
+        }
+    }
+
+    uint64_t fastest = *std::max_element(max_freq.begin(), max_freq.end());
+    for (uint32_t cpu = 0; cpu < topology.cores; ++cpu) {
+        if (max_freq[cpu] == fastest) {
+            topology.big_core_ids.push_back(static_cast<int>(cpu));
+        }
+    }
+    topology.big_cores = static_cast<uint32_t>(topology.big_core_ids.size());
+    return topology;
+}
+
+TaskGraph::TaskId TaskGraph::add(std::function<void()> fn) {
+    auto node = std::make_unique<Node>();
+    node->fn = std::move(fn);
+    nodes_.push_back(std::move(node));
+    return static_cast<TaskId>(nodes_.size() - 1);
+}
+
+void TaskGraph::precede(TaskId before, TaskId after) {
+    nodes_[before]->successors.push_back(after);
+    nodes_[after]->predecessors++;
+}
+
+JobSystem::JobSystem(uint32_t workers) {
+    CoreTopology topology = detectCores();
+    if (workers == kAutoWorkers) {
+        workers = topology.big_cores - 1;
+    }
+
+    for (uint32_t i = 0; i <= workers; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+
+    // Only worth it with a little cluster to stay off
+    std::vector<int> pin;
+    if (topology.big_cores < topology.cores) {
+        pin = topology.big_core_ids;
+    }
+
+    for (uint32_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this, i, pin] {
+#ifdef __linux__
+            if (!pin.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : pin) {
+                    CPU_SET(cpu, &set);
+                }
+                sched_setaffinity(0, sizeof(set), &set);
+            }
+#endif
+            workerLoop(i);
+        });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)>& fn) {
+    if (end <= begin) {
+        return;
+    }
+
+    size_t count = end - begin;
+    grain = std::max<size_t>(grain, 1);
+    // A few pieces per thread, so the ones that finish early have something left to steal
+    size_t pieces = std::min((count + grain - 1) / grain, size_t(concurrency()) * 4);
+    if (pieces <= 1 || workers_.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    std::atomic<size_t> pending{pieces};
+    size_t step = count / pieces, extra = count % pieces;
+    size_t first = begin;
+    for (size_t i = 0; i < pieces; ++i) {
+        size_t last = first + step + (i < extra ? 1 : 0);
+        push({[&fn, first, last] { fn(first, last); }, &pending});
+        first = last;
+    }
+    wait(pending);
+}
+
+void JobSystem::run(TaskGraph& graph) {
+    if (graph.nodes_.empty()) {
+        return;
+    }
+
+    std::atomic<size_t> pending{graph.nodes_.size()};
+    for (auto& node : graph.nodes_) {
+        node->waiting.store(node->predecessors, std::memory_order_relaxed);
+    }
+    for (TaskGraph::TaskId id = 0; id < graph.nodes_.size(); ++id) {
+        if (graph.nodes_[id]->predecessors == 0) {
+            spawnGraphNode(graph, id, pending);
+        }
+    }
+    wait(pending);
+}
+
+void JobSystem::spawnGraphNode(TaskGraph& graph, TaskGraph::TaskId id, std::atomic<size_t>& pending) {
+    push({[this, &graph, id, &pending] {
+        TaskGraph::Node& node = *graph.nodes_[id];
+        node.fn();
+        for (TaskGraph::TaskId next : node.successors) {
+            if (graph.nodes_[next]->waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                spawnGraphNode(graph, next, pending);
+            }
+        }
+    }, &pending});
+}
+
+void JobSystem::push(Task task) {
+    uint32_t index = tls_pool == this ? tls_queue : static_cast<uint32_t>(workers_.size());
+
+    // Counted before it's visible, so a thread taking it never sees the count go below zero
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders this with a worker checking queued_ before it sleeps
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_cv_.notify_one();
+}
+
+bool JobSystem::pop(uint32_t queue, Task& task) {
+    Queue& q = *queues_[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::steal(uint32_t thief, Task& task) {
+    auto count = static_cast<uint32_t>(queues_.size());
+    for (uint32_t i = 1; i < count; ++i) {
+        Queue& q = *queues_[(thief + i) % count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::runOne() {
+    uint32_t own = tls_pool == this ? tls_queue : static_cast<uint32_t>(workers_.size());
+    Task task;
+    if (!pop(own, task) && !steal(own, task)) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+void JobSystem::execute(Task& task) {
+    task.fn();
+    task.pending->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::wait(std::atomic<size_t>& pending) {
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!runOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    tls_pool = this;
+    tls_queue = index;
+
+    while (true) {
+        if (runOne()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_acquire) > 0; });
+        if (stop_) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPUs the process may run on, and how many of them are the fastest kind
+struct CoreTopology {
+    uint32_t cores = 1;
+    uint32_t big_cores = 1;  // Cores at the highest max frequency; equal to cores if all match
+    std::vector<int> big_core_ids;  // Empty if the frequencies couldn't be read
+};
+
+/*!
+ * Reads each CPU's max frequency from sysfs to tell big.LITTLE clusters apart. On hosts that
+ * don't expose cpufreq every core counts as big.
+ */
+CoreTopology detectCores();
+
+class JobSystem;
+
+/*!
+ * Tasks with dependencies between them, run by JobSystem::run(). A task starts once every task
+ * that precedes it has finished; tasks with no path between them may run in parallel.
+ *
+ * ex:
+ *  TaskGraph graph;
+ *  auto cull = graph.add([&] { cullChunks(); });
+ *  auto lod = graph.add([&] { selectLods(); });
+ *  graph.precede(cull, lod);
+ *  jobs.run(graph);
+ */
+class TaskGraph {
+public:
+    using TaskId = uint32_t;
+
+    TaskId add(std::function<void()> fn);
+
+    // @a before finishes before @a after starts
+    void precede(TaskId before, TaskId after);
+
+    [[nodiscard]] size_t size() const { return nodes_.size(); }
+
+private:
+    friend class JobSystem;
+
+    struct Node {
+        std::function<void()> fn;
+        std::vector<TaskId> successors;
+        uint32_t predecessors = 0;
+        std::atomic<uint32_t> waiting{0};
+    };
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+};
+
+/*!
+ * Work-stealing scheduler. Each worker owns a deque: it pushes and pops work at the back, and
+ * idle workers steal from the front of the others', so the oldest and usually largest pieces of
+ * work move. Threads outside the pool that submit work share one more deque, and help run tasks
+ * while they wait, so a parallelFor from the render thread uses it as one more core.
+ *
+ * By default the pool has a worker for each big core but one, the caller being the last, and on
+ * Linux the workers are kept on the big cores. Frame work split evenly finishes when its slowest
+ * piece does, so a piece landing on a little core would hold up the whole frame.
+ *
+ * Thread-safe: any thread, including a task, may submit work.
+ */
+class JobSystem {
+public:
+    static constexpr uint32_t kAutoWorkers = UINT32_MAX;
+
+    explicit JobSystem(uint32_t workers = kAutoWorkers);
+
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /*!
+     * Calls @a fn over [begin, end) split into ranges of at least @a grain items, and returns
+     * once every range is done. Ranges may run on any thread, in any order.
+     */
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+    // Runs every task of @a graph in dependency order, returning once all are done
+    void run(TaskGraph& graph);
+
+    // Threads work runs on: the workers and the caller
+    [[nodiscard]] uint32_t concurrency() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+    // Tasks taken from another thread's deque, since construction
+    [[nodiscard]] uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        std::atomic<size_t>* pending;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(uint32_t index);
+
+    void push(Task task);
+
+    // Runs one task from this thread's deque, or stolen from another
+    bool runOne();
+
+    bool pop(uint32_t queue, Task& task);
+
+    bool steal(uint32_t thief, Task& task);
+
+    void execute(Task& task);
+
+    // Helps run tasks until @a pending reaches zero
+    void wait(std::atomic<size_t>& pending);
+
+    void spawnGraphNode(TaskGraph& graph, TaskGraph::TaskId id, std::atomic<size_t>& pending);
+
+    // One queue per worker, then the one shared by outside threads
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<uint64_t> steals_{0};
+    bool stop_ = false;
+};
+
+#endif //JOBSYSTEM_H
@@ -0,0 +1,52 @@
+#include "Morton.h"
+
+#include <cmath>
+
+static uint32_t compactBits(uint32_t v) {
+    v &= 0x09249249;
+    v = (v | (v >> 2)) & 0x030c30c3;
+    v = (v | (v >> 4)) & 0x0300f00f;
+    v = (v | (v >> 8)) & 0xff0000ff;
+    v = (v | (v >> 16)) & 0x000003ff;
+    return v;
+}
+
+uint32_t mortonEncode(uint32_t x, uint32_t y, uint32_t z) {
+    return mortonSpreadBits(x) | (mortonSpreadBits(y) << 1) | (mortonSpreadBits(z) << 2);
+}
+
+MortonIndices mortonDecode(uint32_t code) {
+    return {compactBits(code), compactBits(code >> 1), compactBits(code >> 2)};
+}
+
+uint32_t mortonStep(uint32_t code, int axis, int delta, int depth) {
+    uint32_t mask = (1u << depth) - 1;
+    MortonIndices indices = mortonDecode(code);
+
+    uint32_t* index = axis == 0 ? &indices.x : (axis == 1 ? &indices.y : &indices.z);
+    *index = (*index + static_cast<uint32_t>(delta)) & mask;
+
+    return mortonEncode(indices.x, indices.y, indices.z);
+}
+
+static uint32_t cellIndex(float value, float min, float max, uint32_t cells) {
+    if (!(max > min)) {
+        return 0;
+    }
+
+    float cell = std::floor((value - min) / (max - min) * static_cast<float>(cells));
+    if (cell < 0.0f) {
+        return 0;
+    }
+    if (cell >= static_cast<float>(cells)) {
+        return cells - 1;
+    }
+    return static_cast<uint32_t>(cell);
+}
+
+uint32_t mortonCell(float x, float y, float z, const BoundingBox& bounds, int depth) {
+    uint32_t cells = 1u << depth;
+    return mortonEncode(cellIndex(x, bounds.min_x, bounds.max_x, cells),
+                        cellIndex(y, bounds.min_y, bounds.max_y, cells),
+                        cellIndex(z, bounds.min_z, bounds.max_z, cells));
+}
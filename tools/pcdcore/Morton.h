@@ -0,0 +1,51 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include <cstdint>
+
+#include "PointCloudData.h"
+
+// Octree cell codes. Each level contributes one octant (x = bit 0, y = bit 1, z = bit 2), with
+// the root level in the most significant bits, so for a tree of depth d the cell at integer
+// indices (ix, iy, iz) has code mortonEncode(ix, iy, iz) and level i sits at bits 3*(d-i-1).
+
+// 10 levels keep a code inside 30 bits
+constexpr int MORTON_MAX_DEPTH = 10;
+
+struct MortonIndices {
+    uint32_t x, y, z;
+};
+
+// Spreads the low 10 bits of v so there are two zero bits between each. Inline so loops over
+// many points can vectorize it.
+[[nodiscard]] inline uint32_t mortonSpreadBits(uint32_t v) {
+    v &= 0x000003ff;
+    v = (v | (v << 16)) & 0xff0000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+[[nodiscard]] uint32_t mortonEncode(uint32_t x, uint32_t y, uint32_t z);
+
+[[nodiscard]] MortonIndices mortonDecode(uint32_t code);
+
+/*!
+ * Moves a code @a delta cells along one axis, wrapping around modulo 2^depth.
+ * @param axis 0 -> x, 1 -> y, 2 -> z
+ */
+[[nodiscard]] uint32_t mortonStep(uint32_t code, int axis, int delta, int depth);
+
+/*!
+ * Code of the depth-level cell of @a bounds that contains the point. Points outside the
+ * bounds are clamped to the nearest cell.
+ */
+[[nodiscard]] uint32_t mortonCell(float x, float y, float z, const BoundingBox& bounds, int depth);
+
+// Octant of the code at the given level (0 = root)
+[[nodiscard]] inline uint32_t mortonOctant(uint32_t code, int level, int depth) {
+    return (code >> (3 * (depth - level - 1))) & 0b111;
+}
+
+#endif //MORTON_H
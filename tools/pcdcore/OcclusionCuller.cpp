@@ -0,0 +1,580 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "PcdFile.h"
+
+// Four float lanes: SSE2 on x86, NEON on ARM, plain arrays elsewhere. Only what the rasterizer
+// and the box test need.
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+struct Vec4f {
+    __m128 v;
+};
+using Mask4 = __m128;
+
+static inline Vec4f splat(float s) { return {_mm_set1_ps(s)}; }
+static inline Vec4f load(const float *p) { return {_mm_loadu_ps(p)}; }
+static inline void store(float *p, Vec4f a) { _mm_storeu_ps(p, a.v); }
+static inline Vec4f operator+(Vec4f a, Vec4f b) { return {_mm_add_ps(a.v, b.v)}; }
+static inline Vec4f operator*(Vec4f a, Vec4f b) { return {_mm_mul_ps(a.v, b.v)}; }
+static inline Vec4f min(Vec4f a, Vec4f b) { return {_mm_min_ps(a.v, b.v)}; }
+static inline Mask4 greaterEqual(Vec4f a, Vec4f b) { return _mm_cmpge_ps(a.v, b.v); }
+static inline Mask4 both(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+static inline Vec4f select(Mask4 m, Vec4f a, Vec4f b) {
+    return {_mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v))};
+}
+static inline bool any(Mask4 m) { return _mm_movemask_ps(m) != 0; }
+
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+
+struct Vec4f {
+    float32x4_t v;
+};
+using Mask4 = uint32x4_t;
+
+static inline Vec4f splat(float s) { return {vdupq_n_f32(s)}; }
+static inline Vec4f load(const float *p) { return {vld1q_f32(p)}; }
+static inline void store(float *p, Vec4f a) { vst1q_f32(p, a.v); }
+static inline Vec4f operator+(Vec4f a, Vec4f b) { return {vaddq_f32(a.v, b.v)}; }
+static inline Vec4f operator*(Vec4f a, Vec4f b) { return {vmulq_f32(a.v, b.v)}; }
+static inline Vec4f min(Vec4f a, Vec4f b) { return {vminq_f32(a.v, b.v)}; }
+static inline Mask4 greaterEqual(Vec4f a, Vec4f b) { return vcgeq_f32(a.v, b.v); }
+static inline Mask4 both(Mask4 a, Mask4 b) { return vandq_u32(a, b); }
+static inline Vec4f select(Mask4 m, Vec4f a, Vec4f b) { return {vbslq_f32(m, a.v, b.v)}; }
+static inline bool any(Mask4 m) {
+    uint32x2_t folded = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+    return (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0;
+}
+
+#else
+
+struct Vec4f {
+    float v[4];
+};
+struct Mask4 {
+    bool m[4];
+};
+
+static inline Vec4f splat(float s) { return {{s, s, s, s}}; }
+static inline Vec4f load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void store(float *p, Vec4f a) { std::memcpy(p, a.v, sizeof(a.v)); }
+static inline Vec4f operator+(Vec4f a, Vec4f b) {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+static inline Vec4f operator*(Vec4f a, Vec4f b) {
+    return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+static inline Vec4f min(Vec4f a, Vec4f b) {
+    return {{std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]),
+             std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3])}};
+}
+static inline Mask4 greaterEqual(Vec4f a, Vec4f b) {
+    return {{a.v[0] >= b.v[0], a.v[1] >= b.v[1], a.v[2] >= b.v[2], a.v[3] >= b.v[3]}};
+}
+static inline Mask4 both(Mask4 a, Mask4 b) {
+    return {{a.m[0] && b.m[0], a.m[1] && b.m[1], a.m[2] && b.m[2], a.m[3] && b.m[3]}};
+}
+static inline Vec4f select(Mask4 m, Vec4f a, Vec4f b) {
+    return {{m.m[0] ? a.v[0] : b.v[0], m.m[1] ? a.v[1] : b.v[1],
+             m.m[2] ? a.v[2] : b.v[2], m.m[3] ? a.v[3] : b.v[3]}};
+}
+static inline bool any(Mask4 m) { return m.m[0] || m.m[1] || m.m[2] || m.m[3]; }
+
+#endif
+
+// Lane offsets within a group of four pixels, at pixel centers
+static const float kLaneCenters[4] = {0.5f, 1.5f, 2.5f, 3.5f};
+
+static float axisMin(const BoundingBox &box, int axis) {
+    return axis == 0 ? box.min_x : (axis == 1 ? box.min_y : box.min_z);
+}
+
+static float axisMax(const BoundingBox &box, int axis) {
+    return axis == 0 ? box.max_x : (axis == 1 ? box.max_y : box.max_z);
+}
+
+// Distance from a point to the nearest point of a box; 0 inside it
+static float distanceToBox(const BoundingBox &box, const float p[3]) {
+    float d2 = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        float lo = axisMin(box, axis) - p[axis];
+        float hi = p[axis] - axisMax(box, axis);
+        float d = std::max({lo, hi, 0.0f});
+        d2 += d * d;
+    }
+    return std::sqrt(d2);
+}
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+        : width_((std::max(width, 4u) + 3) & ~3u), height_(std::max(height, 1u)),
+          depth_(size_t(width_) * height_, 1.0f) {}
+
+void OcclusionCuller::beginFrame(const float *view_proj, const float eye[3]) {
+    std::memcpy(view_proj_, view_proj, sizeof(view_proj_));
+    std::memcpy(eye_, eye, sizeof(eye_));
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+}
+
+void OcclusionCuller::transform(const float p[3], float clip[4]) const {
+    const float *m = view_proj_;
+    for (int row = 0; row < 4; ++row) {
+        clip[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+    }
+}
+
+void OcclusionCuller::addOccluderQuad(const float corners[4][3]) {
+    addPolygon(corners, 4);
+}
+
+void OcclusionCuller::addPolygon(const float (*corners)[3], int count) {
+    // Clip against the near plane (z >= -w) in clip space; each edge adds at most one vertex
+    float in[4][4];
+    for (int i = 0; i < count; ++i) {
+        transform(corners[i], in[i]);
+    }
+
+    float out[5][4];
+    int clipped = 0;
+    for (int i = 0; i < count; ++i) {
+        const float *a = in[i];
+        const float *b = in[(i + 1) % count];
+        float da = a[2] + a[3];
+        float db = b[2] + b[3];
+
+        if (da >= 0.0f) {
+            std::memcpy(out[clipped++], a, sizeof(float) * 4);
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float t = da / (da - db);
+            for (int c = 0; c < 4; ++c) {
+                out[clipped][c] = a[c] + t * (b[c] - a[c]);
+            }
+            clipped++;
+        }
+    }
+
+    if (clipped < 3) {
+        return;
+    }
+
+    ScreenVertex screen[5];
+    for (int i = 0; i < clipped; ++i) {
+        float w = out[i][3];
+        if (w <= 1e-6f) {
+            // Only reachable through rounding right at the plane
+            return;
+        }
+        screen[i] = {(out[i][0] / w * 0.5f + 0.5f) * static_cast<float>(width_),
+                     (out[i][1] / w * 0.5f + 0.5f) * static_cast<float>(height_),
+                     out[i][2] / w};
+    }
+
+    for (int i = 1; i + 1 < clipped; ++i) {
+        rasterizeTriangle(screen[0], screen[i], screen[i + 1]);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::fabs(area) < 1e-6f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    // Edge functions a*x + b*y + c, non-negative inside, sampled at pixel centers. Requiring
+    // full pixel coverage instead would leave a crack along every shared edge, and proxies are
+    // made of many small quads.
+    const ScreenVertex *v[3] = {&v0, &v1, &v2};
+    float ea[3], eb[3], ec[3];
+    for (int i = 0; i < 3; ++i) {
+        const ScreenVertex &a = *v[i];
+        const ScreenVertex &b = *v[(i + 1) % 3];
+        ea[i] = a.y - b.y;
+        eb[i] = b.x - a.x;
+        ec[i] = -(ea[i] * a.x + eb[i] * a.y);
+    }
+
+    // NDC depth is affine in screen space for a planar polygon. Writing the plane's farthest
+    // value within each pixel keeps the occluder from ever looking nearer than it is.
+    float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+    float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+    float z_slack = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+    float z_max = std::max({v0.z, v1.z, v2.z});
+
+    float min_x = std::min({v0.x, v1.x, v2.x});
+    float max_x = std::max({v0.x, v1.x, v2.x});
+    float min_y = std::min({v0.y, v1.y, v2.y});
+    float max_y = std::max({v0.y, v1.y, v2.y});
+
+    int x0 = std::max(0, static_cast<int>(std::floor(min_x))) & ~3;
+    int x1 = std::min(static_cast<int>(width_), static_cast<int>(std::ceil(max_x)));
+    int y0 = std::max(0, static_cast<int>(std::floor(min_y)));
+    int y1 = std::min(static_cast<int>(height_), static_cast<int>(std::ceil(max_y)));
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    triangles_drawn_++;
+
+    const Vec4f lane = load(kLaneCenters);
+    const Vec4f a0 = splat(ea[0]), a1 = splat(ea[1]), a2 = splat(ea[2]);
+    const Vec4f zero = splat(0.0f);
+    const Vec4f dz = splat(dzdx);
+    const Vec4f far_limit = splat(z_max);
+
+    for (int y = y0; y < y1; ++y) {
+        float cy = static_cast<float>(y) + 0.5f;
+        float *row = depth_.data() + size_t(y) * width_;
+
+        // Per-row constants: everything but the x term
+        Vec4f r0 = splat(eb[0] * cy + ec[0]);
+        Vec4f r1 = splat(eb[1] * cy + ec[1]);
+        Vec4f r2 = splat(eb[2] * cy + ec[2]);
+        Vec4f rz = splat(v0.z + dzdy * (cy - v0.y) - dzdx * v0.x + z_slack);
+
+        for (int x = x0; x < x1; x += 4) {
+            Vec4f cx = splat(static_cast<float>(x)) + lane;
+            Mask4 inside = both(both(greaterEqual(a0 * cx + r0, zero), greaterEqual(a1 * cx + r1, zero)),
+                                greaterEqual(a2 * cx + r2, zero));
+            if (!any(inside)) {
+                continue;
+            }
+
+            Vec4f z = min(dz * cx + rz, far_limit);
+            Vec4f current = load(row + x);
+            store(row + x, select(inside, min(current, z), current));
+        }
+    }
+}
+
+static float axisValue(const Point &p, int axis) {
+    return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+}
+
+OccluderProxy buildOccluderProxy(const Point *points, uint32_t count,
+                                 const OccluderOptions &options) {
+    OccluderProxy proxy;
+    proxy.up_axis = options.up_axis;
+    proxy.bounds = computeBounds(points, count);
+
+    int up = options.up_axis;
+    int u = (up + 1) % 3;
+    int v = (up + 2) % 3;
+    float min_u = axisMin(proxy.bounds, u), min_v = axisMin(proxy.bounds, v);
+    float extent_u = axisMax(proxy.bounds, u) - min_u;
+    float extent_v = axisMax(proxy.bounds, v) - min_v;
+    if (count == 0 || options.grid == 0 || !(extent_u > 0.0f) || !(extent_v > 0.0f)) {
+        return proxy;
+    }
+
+    // Coverage is tracked on a finer grid of bins; a cell is solid if all of its bins are hit
+    uint32_t grid = options.grid;
+    uint32_t bins = std::max(options.coverage_bins, 1u);
+    uint32_t fine = grid * bins;
+    std::vector<float> low(size_t(grid) * grid, INFINITY);
+    std::vector<float> high(size_t(grid) * grid, -INFINITY);
+    std::vector<uint32_t> points_in(size_t(grid) * grid, 0);
+    std::vector<bool> hit(size_t(fine) * fine, false);
+
+    float scale_u = static_cast<float>(fine) / extent_u;
+    float scale_v = static_cast<float>(fine) / extent_v;
+    for (uint32_t i = 0; i < count; ++i) {
+        auto fu = std::min(fine - 1, static_cast<uint32_t>((axisValue(points[i], u) - min_u) * scale_u));
+        auto fv = std::min(fine - 1, static_cast<uint32_t>((axisValue(points[i], v) - min_v) * scale_v));
+        hit[size_t(fv) * fine + fu] = true;
+
+        size_t cell = size_t(fv / bins) * grid + fu / bins;
+        float h = axisValue(points[i], up);
+        low[cell] = std::min(low[cell], h);
+        high[cell] = std::max(high[cell], h);
+        points_in[cell]++;
+    }
+
+    float cell_u = extent_u / static_cast<float>(grid);
+    float cell_v = extent_v / static_cast<float>(grid);
+    std::vector<float> spacing(size_t(grid) * grid, -1.0f);
+    bool any_solid = false;
+
+    for (uint32_t cv = 0; cv < grid; ++cv) {
+        for (uint32_t cu = 0; cu < grid; ++cu) {
+            size_t cell = size_t(cv) * grid + cu;
+            bool covered = true;
+            for (uint32_t bv = 0; bv < bins && covered; ++bv) {
+                for (uint32_t bu = 0; bu < bins && covered; ++bu) {
+                    covered = hit[size_t(cv * bins + bv) * fine + cu * bins + bu];
+                }
+            }
+            if (covered) {
+                spacing[cell] = std::sqrt(cell_u * cell_v / static_cast<float>(points_in[cell]));
+                any_solid = true;
+            }
+        }
+    }
+
+    if (any_solid) {
+        proxy.grid = grid;
+        proxy.low = std::move(low);
+        proxy.high = std::move(high);
+        proxy.spacing = std::move(spacing);
+    }
+    return proxy;
+}
+
+bool OcclusionCuller::addOccluder(const OccluderProxy &proxy, const OccluderOptions &options) {
+    if (proxy.empty()) {
+        return false;
+    }
+
+    int up = proxy.up_axis;
+    int u = (up + 1) % 3;
+    int v = (up + 2) % 3;
+    uint32_t grid = proxy.grid;
+    float min_u = axisMin(proxy.bounds, u), min_v = axisMin(proxy.bounds, v);
+    float cell_u = (axisMax(proxy.bounds, u) - min_u) / static_cast<float>(grid);
+    float cell_v = (axisMax(proxy.bounds, v) - min_v) / static_cast<float>(grid);
+
+    // Gaps between points open up closer to the eye, so judge opacity at the nearest point
+    float distance = std::max(distanceToBox(proxy.bounds, eye_), 1e-3f);
+    float max_spacing = options.max_spacing_px * distance / options.focal_length_px;
+    float min_side = std::min(cell_u, cell_v);
+    float half_diagonal = 0.5f * std::sqrt(cell_u * cell_u + cell_v * cell_v);
+
+    // Cells holding one surface that's opaque from here and seen from above. A slope spreads the
+    // points apart along it by up to sqrt(1 + slope^2).
+    std::vector<bool> &surface = surface_scratch_;
+    surface.assign(size_t(grid) * grid, false);
+    for (size_t cell = 0; cell < surface.size(); ++cell) {
+        float rise = proxy.high[cell] - proxy.low[cell];
+        float slope = rise / min_side;
+        surface[cell] = proxy.spacing[cell] >= 0.0f && slope <= options.max_slope &&
+                        proxy.spacing[cell] * std::sqrt(1.0f + slope * slope) <= max_spacing &&
+                        eye_[up] > proxy.high[cell];
+    }
+
+    // A surface is continuous across the cell's edges: each neighbour's heights meet its own,
+    // give or take the gap between points along the steepest slope allowed
+    auto cellAt = [grid](int cu, int cv) {
+        return cu >= 0 && cv >= 0 && cu < int(grid) && cv < int(grid) ? size_t(cv) * grid + cu : SIZE_MAX;
+    };
+    std::vector<bool> &opaque = opaque_scratch_;
+    opaque.assign(size_t(grid) * grid, false);
+    std::vector<float> &floor_height = floor_scratch_;
+    floor_height.assign(size_t(grid) * grid, INFINITY);
+    for (uint32_t cv = 0; cv < grid; ++cv) {
+        for (uint32_t cu = 0; cu < grid; ++cu) {
+            size_t cell = size_t(cv) * grid + cu;
+            if (!surface[cell]) {
+                continue;
+            }
+            bool continuous = true;
+            float lowest = proxy.low[cell];
+            for (int dv = -1; dv <= 1; ++dv) {
+                for (int du = -1; du <= 1; ++du) {
+                    size_t other = cellAt(int(cu) + du, int(cv) + dv);
+                    if (other == SIZE_MAX || !surface[other]) {
+                        continue;
+                    }
+                    float slack = options.max_slope * std::max(proxy.spacing[cell], proxy.spacing[other]);
+                    continuous &= std::max(proxy.low[cell], proxy.low[other]) <=
+                                  std::min(proxy.high[cell], proxy.high[other]) + slack;
+                    lowest = std::min(lowest, proxy.low[other]);
+                }
+            }
+            opaque[cell] = continuous;
+            floor_height[cell] = lowest;  // The mesh never drops below this within the cell
+        }
+    }
+    for (size_t cell = 0; cell < surface.size(); ++cell) {
+        surface[cell] = opaque[cell];
+    }
+
+    // A ray reaching a cell's mesh is below the surface there. It crossed the surface if, going
+    // back towards the eye over surface cells only, it gets above every point of the cell it's
+    // over; otherwise it may have come in under an edge. The walk covers a band a cell diagonal
+    // wide, since the ray can meet the mesh anywhere in the cell.
+    bool any_opaque = false;
+    float step = 0.25f * min_side;
+    const float sides[5] = {-1.0f, -0.5f, 0.0f, 0.5f, 1.0f};
+    for (uint32_t cv = 0; cv < grid; ++cv) {
+        for (uint32_t cu = 0; cu < grid; ++cu) {
+            size_t cell = size_t(cv) * grid + cu;
+            if (!surface[cell]) {
+                continue;
+            }
+
+            float center_u = min_u + cell_u * (static_cast<float>(cu) + 0.5f);
+            float center_v = min_v + cell_v * (static_cast<float>(cv) + 0.5f);
+            float to_u = eye_[u] - center_u, to_v = eye_[v] - center_v;
+            float run = std::sqrt(to_u * to_u + to_v * to_v);
+            if (run > 1e-6f) {
+                to_u /= run;
+                to_v /= run;
+            }
+            // Shallowest the ray can come in at, to the far side of the cell
+            float grade = (eye_[up] - floor_height[cell]) / (run + half_diagonal);
+
+            bool crossed = false;
+            for (float walked = 0.0f; walked <= run + half_diagonal && !crossed; walked += step) {
+                float top = -INFINITY;
+                for (float side : sides) {
+                    float pu = center_u + to_u * walked - to_v * side * half_diagonal;
+                    float pv = center_v + to_v * walked + to_u * side * half_diagonal;
+                    size_t other = cellAt(static_cast<int>(std::floor((pu - min_u) / cell_u)),
+                                          static_cast<int>(std::floor((pv - min_v) / cell_v)));
+                    if (other == SIZE_MAX || !surface[other]) {
+                        top = INFINITY;
+                        break;
+                    }
+                    top = std::max(top, proxy.high[other]);
+                }
+                if (top == INFINITY) {
+                    break;
+                }
+                crossed = floor_height[cell] + (walked - half_diagonal) * grade > top;
+            }
+            opaque[cell] = crossed;
+            any_opaque |= crossed;
+        }
+    }
+    if (!any_opaque) {
+        return false;
+    }
+
+    // Each grid corner sits at the lowest point of the opaque cells around it, so the mesh stays
+    // under the surface of every cell it spans and is never nearer than the points it stands
+    // for. Unlike flat boxes, the mesh keeps the slopes that do the occluding when the eye is low.
+    uint32_t corners_per_side = grid + 1;
+    std::vector<float> &corner_height = corner_scratch_;
+    corner_height.assign(size_t(corners_per_side) * corners_per_side, INFINITY);
+    for (uint32_t cv = 0; cv < grid; ++cv) {
+        for (uint32_t cu = 0; cu < grid; ++cu) {
+            size_t cell = size_t(cv) * grid + cu;
+            if (!opaque[cell]) {
+                continue;
+            }
+            for (uint32_t dv = 0; dv < 2; ++dv) {
+                for (uint32_t du = 0; du < 2; ++du) {
+                    float &h = corner_height[size_t(cv + dv) * corners_per_side + cu + du];
+                    h = std::min(h, proxy.low[cell]);
+                }
+            }
+        }
+    }
+
+    for (uint32_t cv = 0; cv < grid; ++cv) {
+        for (uint32_t cu = 0; cu < grid; ++cu) {
+            if (!opaque[size_t(cv) * grid + cu]) {
+                continue;
+            }
+
+            float corners[4][3];
+            const uint32_t du[4] = {0, 1, 1, 0};
+            const uint32_t dv[4] = {0, 0, 1, 1};
+            for (int i = 0; i < 4; ++i) {
+                corners[i][u] = min_u + cell_u * static_cast<float>(cu + du[i]);
+                corners[i][v] = min_v + cell_v * static_cast<float>(cv + dv[i]);
+                corners[i][up] = corner_height[size_t(cv + dv[i]) * corners_per_side + cu + du[i]];
+            }
+
+            // The corners needn't be coplanar, so each cell is two triangles
+            const float first[3][3] = {{corners[0][0], corners[0][1], corners[0][2]},
+                                       {corners[1][0], corners[1][1], corners[1][2]},
+                                       {corners[2][0], corners[2][1], corners[2][2]}};
+            const float second[3][3] = {{corners[0][0], corners[0][1], corners[0][2]},
+                                        {corners[2][0], corners[2][1], corners[2][2]},
+                                        {corners[3][0], corners[3][1], corners[3][2]}};
+            addPolygon(first, 3);
+            addPolygon(second, 3);
+        }
+    }
+    return true;
+}
+
+size_t OcclusionCuller::addOccluders(std::vector<const OccluderProxy *> &proxies,
+                                     const OccluderOptions &options) {
+    std::sort(proxies.begin(), proxies.end(), [this](const OccluderProxy *a, const OccluderProxy *b) {
+        return distanceToBox(a->bounds, eye_) < distanceToBox(b->bounds, eye_);
+    });
+
+    size_t drawn = 0;
+    for (const OccluderProxy *proxy : proxies) {
+        if (drawn >= options.max_occluders) {
+            break;
+        }
+        if (addOccluder(*proxy, options)) {
+            drawn++;
+        }
+    }
+    return drawn;
+}
+
+bool OcclusionCuller::isOccluded(const BoundingBox &bounds) const {
+    tests_++;
+
+    float min_x = INFINITY, max_x = -INFINITY, min_y = INFINITY, max_y = -INFINITY;
+    float min_z = INFINITY;
+    for (int i = 0; i < 8; ++i) {
+        const float p[3] = {i & 1 ? bounds.max_x : bounds.min_x,
+                            i & 2 ? bounds.max_y : bounds.min_y,
+                            i & 4 ? bounds.max_z : bounds.min_z};
+        float clip[4];
+        transform(p, clip);
+
+        // Crossing the near plane: can't be hidden by anything in front of it
+        if (clip[2] < -clip[3] || clip[3] <= 1e-6f) {
+            return false;
+        }
+
+        float x = (clip[0] / clip[3] * 0.5f + 0.5f) * static_cast<float>(width_);
+        float y = (clip[1] / clip[3] * 0.5f + 0.5f) * static_cast<float>(height_);
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        min_z = std::min(min_z, clip[2] / clip[3]);
+    }
+
+    int x0 = std::max(0, static_cast<int>(std::floor(min_x)));
+    int x1 = std::min(static_cast<int>(width_), static_cast<int>(std::ceil(max_x)));
+    int y0 = std::max(0, static_cast<int>(std::floor(min_y)));
+    int y1 = std::min(static_cast<int>(height_), static_cast<int>(std::ceil(max_y)));
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+
+    // Occluders are sampled at pixel centers, so their edges can claim up to half a pixel they
+    // don't cover. Also requiring the ring of pixels around the box erodes them by that much.
+    x0 = std::max(0, x0 - 1);
+    x1 = std::min(static_cast<int>(width_), x1 + 1);
+    y0 = std::max(0, y0 - 1);
+    y1 = std::min(static_cast<int>(height_), y1 + 1);
+
+    // Visible wherever the nearest corner is in front of the occluder depth
+    const Vec4f nearest = splat(min_z);
+    const Vec4f lane = load(kLaneCenters);
+    const Vec4f lo = splat(static_cast<float>(x0));
+    const Vec4f hi = splat(-static_cast<float>(x1));
+    const Vec4f negate = splat(-1.0f);
+
+    for (int y = y0; y < y1; ++y) {
+        const float *row = depth_.data() + size_t(y) * width_;
+        for (int x = x0 & ~3; x < x1; x += 4) {
+            // Lanes outside [x0, x1) are masked off
+            Vec4f cx = splat(static_cast<float>(x)) + lane;
+            Mask4 in_range = both(greaterEqual(cx, lo), greaterEqual(cx * negate, hi));
+            if (any(both(in_range, greaterEqual(load(row + x), nearest)))) {
+                return false;
+            }
+        }
+    }
+
+    occluded_++;
+    return true;
+}
@@ -0,0 +1,153 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PointCloudData.h"
+
+struct OccluderOptions {
+    // Axis the terrain's height runs along (the generator's terrain is y up): 0 -> x, 1 -> y, 2 -> z
+    int up_axis = 1;
+
+    // Proxy cells per side of a chunk's footprint, and coverage bins per side of a cell: a cell
+    // counts as solid only if every bin holds a point
+    uint32_t grid = 16;
+    uint32_t coverage_bins = 4;
+
+    // Steepest rise over run a cell's points may span and still be taken for one surface. Cells
+    // spanning more are slopes too steep to judge, or a column through something closed, like a
+    // sphere, with air above and below it.
+    float max_slope = 2.0f;
+
+    // Points are assumed to form an opaque surface only where their projected spacing is at
+    // most max_spacing_px on screen. focal_length_px is the screen height / (2 * tan(fovy / 2)).
+    float focal_length_px = 1000.0f;
+    float max_spacing_px = 2.0f;
+
+    // Proxies rasterized per frame, nearest chunks first
+    uint32_t max_occluders = 32;
+};
+
+/*!
+ * Heightfield occluder for one chunk, built from its points once they're loaded. The footprint
+ * is split into a grid; each cell the points cover densely and evenly becomes a solid cell that
+ * records the lowest and highest point above it. Which solid cells occlude depends on the eye,
+ * so that's left to OcclusionCuller::addOccluder.
+ */
+struct OccluderProxy {
+    BoundingBox bounds = BoundingBox::empty();
+    uint32_t grid = 0;
+    int up_axis = 1;
+
+    // Per cell, row major over the two footprint axes; empty if no cell is solid
+    std::vector<float> low;
+    std::vector<float> high;
+    std::vector<float> spacing;  // Average distance between points; negative if not solid
+
+    [[nodiscard]] bool empty() const { return low.empty(); }
+};
+
+OccluderProxy buildOccluderProxy(const Point *points, uint32_t count,
+                                 const OccluderOptions &options = {});
+
+/*!
+ * Masked software occlusion culling on a coarse depth buffer. Each frame the proxies of the
+ * nearest loaded chunks are rasterized, then chunk bounding boxes are tested against the result,
+ * so hidden chunks can be skipped for loading and drawing without a GPU round trip.
+ *
+ * Tests err towards visible: occluders write the farthest depth they reach inside a pixel, and a
+ * box is occluded only if every pixel of its screen rectangle, plus a one pixel ring to make up
+ * for sampling occluders at pixel centers, holds a nearer occluder. Rows are processed four pixels at a time with SSE2 or NEON where
+ * available.
+ *
+ * Matrices are column major with OpenGL clip conventions (glm's layout), so the app can pass
+ * glm::value_ptr(projection * view) straight through.
+ *
+ * ex:
+ *  culler.beginFrame(view_proj, eye);
+ *  culler.addOccluders(loaded_proxies, options);
+ *  if (!culler.isOccluded(chunk.bbox)) draw(chunk);
+ */
+class OcclusionCuller {
+public:
+    // The width is rounded up to a multiple of 4
+    explicit OcclusionCuller(uint32_t width = 256, uint32_t height = 128);
+
+    // Clears the depth buffer for a new view
+    void beginFrame(const float *view_proj, const float eye[3]);
+
+    /*!
+     * Rasterizes a planar, convex quad as an occluder. It's clipped against the near plane, so
+     * quads passing beside or under the camera still occlude what they can.
+     */
+    void addOccluderQuad(const float corners[4][3]);
+
+    /*!
+     * Rasterizes a proxy as a mesh under its solid cells. Nothing below the points is taken to
+     * be solid, since a point cloud is drawn as points: a cell is only drawn where every ray
+     * from the eye that reaches its mesh has crossed the points' surface on the way, within
+     * cells dense enough to be opaque from here.
+     * @return true if any cell was rasterized
+     */
+    bool addOccluder(const OccluderProxy &proxy, const OccluderOptions &options = {});
+
+    /*!
+     * Rasterizes the proxies nearest the eye, up to options.max_occluders. Reorders @a proxies.
+     * @return the number of proxies rasterized
+     */
+    size_t addOccluders(std::vector<const OccluderProxy *> &proxies,
+                        const OccluderOptions &options = {});
+
+    /*!
+     * True if the box is certainly hidden behind the occluders rasterized so far. Boxes crossing
+     * the near plane or entirely off screen are never reported occluded; frustum culling is the
+     * caller's job.
+     */
+    [[nodiscard]] bool isOccluded(const BoundingBox &bounds) const;
+
+    [[nodiscard]] uint32_t width() const { return width_; }
+
+    [[nodiscard]] uint32_t height() const { return height_; }
+
+    // Row-major NDC depth per pixel, row 0 at the bottom of the screen; 1 where nothing occludes
+    [[nodiscard]] const std::vector<float> &depth() const { return depth_; }
+
+    // Totals since construction
+    [[nodiscard]] uint64_t trianglesDrawn() const { return triangles_drawn_; }
+
+    [[nodiscard]] uint64_t tests() const { return tests_; }
+
+    [[nodiscard]] uint64_t occluded() const { return occluded_; }
+
+private:
+    struct ScreenVertex {
+        float x, y, z;
+    };
+
+    void transform(const float p[3], float clip[4]) const;
+
+    // Clips a convex, planar polygon of up to four vertices and rasterizes it
+    void addPolygon(const float (*corners)[3], int count);
+
+    void rasterizeTriangle(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2);
+
+    uint32_t width_;
+    uint32_t height_;
+    std::vector<float> depth_;
+
+    float view_proj_[16] = {};
+    float eye_[3] = {};
+
+    std::vector<bool> opaque_scratch_;
+    std::vector<bool> surface_scratch_;
+    std::vector<float> floor_scratch_;
+    std::vector<float> corner_scratch_;
+
+    uint64_t triangles_drawn_ = 0;
+    mutable uint64_t tests_ = 0;
+    mutable uint64_t occluded_ = 0;
+};
+
+#endif //OCCLUSIONCULLER_H
@@ -0,0 +1,286 @@
+#include "OctreeBuilder.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "JobSystem.h"
+#include "Morton.h"
+
+// Widest digit sorted per radix pass. Passes move every point, so fewer wider ones win until
+// the buckets being scattered into outgrow the caches.
+static constexpr int kMaxRadixBits = 12;
+
+// Runs fn for each of @a blocks, on the job system if there is one
+static void forBlocks(JobSystem* jobs, size_t blocks, const std::function<void(size_t)>& fn) {
+    if (jobs != nullptr) {
+        jobs->parallelFor(0, blocks, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; ++b) {
+                fn(b);
+            }
+        });
+    } else {
+        for (size_t b = 0; b < blocks; ++b) {
+            fn(b);
+        }
+    }
+}
+
+// Morton code of each point's cell at @a depth, for [first, last)
+static void computeCodes(const Point* points, size_t first, size_t last, const BoundingBox& bounds,
+                         int depth, uint32_t* codes) {
+    // The same arithmetic as mortonCell(), so the cells agree with it exactly. Truncating after
+    // clamping at 0 is floor(), and keeps the loop free of calls so it vectorizes.
+    const float cells = static_cast<float>(1u << depth);
+    const float top = cells - 1.0f;
+    const float min_x = bounds.min_x, min_y = bounds.min_y, min_z = bounds.min_z;
+    float extent_x = bounds.max_x - bounds.min_x, extent_y = bounds.max_y - bounds.min_y,
+          extent_z = bounds.max_z - bounds.min_z;
+    // A flat axis puts every point in cell 0
+    const float factor_x = extent_x > 0.0f ? cells : 0.0f, factor_y = extent_y > 0.0f ? cells : 0.0f,
+                factor_z = extent_z > 0.0f ? cells : 0.0f;
+    extent_x = extent_x > 0.0f ? extent_x : 1.0f;
+    extent_y = extent_y > 0.0f ? extent_y : 1.0f;
+    extent_z = extent_z > 0.0f ? extent_z : 1.0f;
+
+    for (size_t i = first; i < last; ++i) {
+        float fx = (points[i].x - min_x) / extent_x * factor_x;
+        float fy = (points[i].y - min_y) / extent_y * factor_y;
+        float fz = (points[i].z - min_z) / extent_z * factor_z;
+        auto ix = static_cast<uint32_t>(std::min(std::max(fx, 0.0f), top));
+        auto iy = static_cast<uint32_t>(std::min(std::max(fy, 0.0f), top));
+        auto iz = static_cast<uint32_t>(std::min(std::max(fz, 0.0f), top));
+        codes[i] = mortonSpreadBits(ix) | (mortonSpreadBits(iy) << 1) | (mortonSpreadBits(iz) << 2);
+    }
+}
+
+/*!
+ * Stable LSD radix sort of @a points by @a codes, in place. The points travel with their codes
+ * through every pass, so each pass streams through memory and nothing is gathered at random at
+ * the end. The one scratch array isn't zeroed, and the caller's arrays are the other half of the
+ * ping-pong, since at these sizes first touching fresh pages costs about as much as a pass.
+ *
+ * Each pass splits the array in @a blocks: every block counts its digits, a prefix sum over
+ * (digit, block) gives each block its own run of every bucket, and the blocks then scatter
+ * independently and in order, which keeps the sort stable. Digits every code shares are skipped;
+ * the high digits of a dataset shallower than max_depth often are.
+ */
+static void radixSort(std::vector<Point>& points, std::vector<uint32_t>& codes, int key_bits,
+                      JobSystem* jobs, size_t blocks) {
+    size_t n = points.size();
+    int passes = std::max(1, (key_bits + kMaxRadixBits - 1) / kMaxRadixBits);
+    int digit_bits = std::max(1, (key_bits + passes - 1) / passes);
+    size_t buckets = size_t(1) << digit_bits;
+    uint32_t mask = static_cast<uint32_t>(buckets - 1);
+    size_t block_size = (n + blocks - 1) / blocks;
+
+    // Digits that tell the codes apart
+    std::vector<int> shifts;
+    for (int shift = 0; shift < key_bits; shift += digit_bits) {
+        uint32_t digit = (codes[0] >> shift) & mask;
+        bool shared = std::all_of(codes.begin(), codes.end(), [&](uint32_t code) {
+            return ((code >> shift) & mask) == digit;
+        });
+        if (!shared) {
+            shifts.push_back(shift);
+        }
+    }
+    if (shifts.empty()) {
+        return;
+    }
+
+    std::unique_ptr<Point[]> scratch_points(new Point[n]);
+    std::unique_ptr<uint32_t[]> scratch_codes(new uint32_t[n]);
+    std::vector<size_t> counts(blocks * buckets);
+
+    Point* src_points = points.data();
+    uint32_t* src_codes = codes.data();
+    Point* dst_points = scratch_points.get();
+    uint32_t* dst_codes = scratch_codes.get();
+    for (int shift : shifts) {
+        std::fill(counts.begin(), counts.end(), 0);
+        forBlocks(jobs, blocks, [&](size_t b) {
+            size_t* count = &counts[b * buckets];
+            size_t first = b * block_size, last = std::min(n, first + block_size);
+            for (size_t i = first; i < last; ++i) {
+                count[(src_codes[i] >> shift) & mask]++;
+            }
+        });
+
+        size_t total = 0;
+        for (size_t digit = 0; digit < buckets; ++digit) {
+            for (size_t b = 0; b < blocks; ++b) {
+                size_t count = counts[b * buckets + digit];
+                counts[b * buckets + digit] = total;
+                total += count;
+            }
+        }
+
+        forBlocks(jobs, blocks, [&](size_t b) {
+            size_t* offset = &counts[b * buckets];
+            size_t first = b * block_size, last = std::min(n, first + block_size);
+            for (size_t i = first; i < last; ++i) {
+                size_t to = offset[(src_codes[i] >> shift) & mask]++;
+                dst_points[to] = src_points[i];
+                dst_codes[to] = src_codes[i];
+            }
+        });
+
+        std::swap(src_points, dst_points);
+        std::swap(src_codes, dst_codes);
+    }
+
+    // An odd number of passes leaves the result in scratch
+    if (src_points != points.data()) {
+        forBlocks(jobs, blocks, [&](size_t b) {
+            size_t first = b * block_size, last = std::min(n, first + block_size);
+            std::copy(src_points + first, src_points + last, points.data() + first);
+            std::copy(src_codes + first, src_codes + last, codes.data() + first);
+        });
+    }
+}
+
+// Splits the node holding sorted @a codes [first, last) into its leaves, in octant order. Above
+// totals->depth nodes are split by the dataset's counts, the points here being part of it.
+static void collectLeaves(const std::vector<uint32_t>& codes, size_t first, size_t last,
+                          uint32_t code, int depth, int max_depth, const OctreeBuildOptions& options,
+                          const OctreeCellCounts* totals, std::vector<OctreeChunkRange>& chunks) {
+    size_t count = last - first;
+    if (count == 0) {
+        return;
+    }
+
+    uint64_t total = totals != nullptr && depth < totals->depth ? totals->nodeCount(code, depth) : count;
+    if (total <= options.max_points_per_leaf || depth >= max_depth) {
+        if (total >= options.min_points) {
+            chunks.push_back({first, static_cast<uint32_t>(count), code, depth});
+        }
+        return;
+    }
+
+    // The children split the run where the next level's octant changes
+    int shift = 3 * (max_depth - depth - 1);
+    size_t begin = first;
+    for (uint32_t octant = 0; octant < 8; ++octant) {
+        size_t end = last;
+        if (octant < 7) {
+            uint32_t bound = ((code << 3) | (octant + 1)) << shift;
+            end = static_cast<size_t>(std::lower_bound(codes.begin() + begin, codes.begin() + last, bound) -
+                                      codes.begin());
+        }
+        collectLeaves(codes, begin, end, (code << 3) | octant, depth + 1, max_depth, options, totals,
+                      chunks);
+        begin = end;
+    }
+}
+
+static OctreeChunks buildRanges(std::vector<Point> points, const BoundingBox& bounds,
+                                const OctreeBuildOptions& options, const OctreeCellCounts* totals,
+                                JobSystem* jobs) {
+    OctreeChunks result;
+    if (points.empty()) {
+        return result;
+    }
+
+    size_t n = points.size();
+    int depth = std::clamp(options.max_depth, 0, MORTON_MAX_DEPTH);
+    // A few blocks per thread, so uneven ones even out
+    size_t blocks = jobs != nullptr ? std::min<size_t>(n, jobs->concurrency() * 4) : 1;
+    size_t block_size = (n + blocks - 1) / blocks;
+
+    std::vector<uint32_t> codes(n);
+    forBlocks(jobs, blocks, [&](size_t b) {
+        size_t first = b * block_size, last = std::min(n, first + block_size);
+        computeCodes(points.data(), first, last, bounds, depth, codes.data());
+    });
+
+    radixSort(points, codes, 3 * depth, jobs, blocks);
+
+    collectLeaves(codes, 0, n, 0, 0, depth, options, totals, result.chunks);
+    result.points = std::move(points);
+    return result;
+}
+
+OctreeChunks buildOctreeChunkRanges(std::vector<Point> points, const BoundingBox& bounds,
+                                    const OctreeBuildOptions& options, JobSystem* jobs) {
+    return buildRanges(std::move(points), bounds, options, nullptr, jobs);
+}
+
+OctreeChunks buildOctreePart(std::vector<Point> points, const BoundingBox& bounds,
+                             const OctreeBuildOptions& options, const OctreeCellCounts& totals,
+                             JobSystem* jobs) {
+    return buildRanges(std::move(points), bounds, options, &totals, jobs);
+}
+
+void OctreeCellCounts::reset(int cell_depth) {
+    depth = cell_depth;
+    prefix.assign((size_t(1) << (3 * depth)) + 1, 0);
+}
+
+void OctreeCellCounts::accumulate() {
+    for (size_t i = 1; i < prefix.size(); ++i) {
+        prefix[i] += prefix[i - 1];
+    }
+}
+
+// Adds the nodes collectLeaves() can't split further without the points, in Morton order: leaves
+// above totals.depth, and every non-empty cell at it that's still too big to be a leaf
+static void collectPartUnits(const OctreeCellCounts& totals, uint32_t code, int depth, int max_depth,
+                             const OctreeBuildOptions& options, std::vector<OctreePart>& units) {
+    uint64_t count = totals.nodeCount(code, depth);
+    if (count == 0) {
+        return;
+    }
+
+    bool leaf = count <= options.max_points_per_leaf || depth >= max_depth;
+    if (leaf || depth == totals.depth) {
+        int shift = 3 * (totals.depth - depth);
+        uint64_t max_chunks;
+        if (leaf) {
+            max_chunks = count >= options.min_points ? 1 : 0;
+        } else {
+            // Kept leaves hold at least min_points each, and there are only so many cells below
+            max_chunks = std::min<uint64_t>(count / std::max<uint32_t>(options.min_points, 1),
+                                            uint64_t(1) << (3 * (max_depth - depth)));
+        }
+        units.push_back({code << shift, (code + 1) << shift, count, static_cast<uint32_t>(max_chunks)});
+        return;
+    }
+
+    for (uint32_t octant = 0; octant < 8; ++octant) {
+        collectPartUnits(totals, (code << 3) | octant, depth + 1, max_depth, options, units);
+    }
+}
+
+std::vector<OctreePart> planOctreeParts(const OctreeCellCounts& totals, const OctreeBuildOptions& options,
+                                        uint64_t max_part_points) {
+    int max_depth = std::clamp(options.max_depth, 0, MORTON_MAX_DEPTH);
+    std::vector<OctreePart> units;
+    collectPartUnits(totals, 0, 0, max_depth, options, units);
+
+    std::vector<OctreePart> parts;
+    for (const auto& unit : units) {
+        if (parts.empty() || parts.back().points + unit.points > max_part_points) {
+            parts.push_back(unit);
+        } else {
+            parts.back().last_cell = unit.last_cell;
+            parts.back().points += unit.points;
+            parts.back().max_chunks += unit.max_chunks;
+        }
+    }
+    return parts;
+}
+
+std::vector<std::vector<Point>> buildOctreeChunks(const std::vector<Point>& points,
+                                                  const BoundingBox& bounds,
+                                                  const OctreeBuildOptions& options) {
+    OctreeChunks built = buildOctreeChunkRanges(points, bounds, options);
+
+    std::vector<std::vector<Point>> chunks;
+    chunks.reserve(built.chunks.size());
+    for (const auto& range : built.chunks) {
+        auto begin = built.points.begin() + static_cast<std::ptrdiff_t>(range.first);
+        chunks.emplace_back(begin, begin + range.count);
+    }
+    return chunks;
+}
@@ -0,0 +1,99 @@
+#ifndef OCTREEBUILDER_H
+#define OCTREEBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PointCloudData.h"
+
+class JobSystem;
+
+struct OctreeBuildOptions {
+    uint32_t max_points_per_leaf = 100000;
+    int max_depth = 8;           // At most MORTON_MAX_DEPTH
+    uint32_t min_points = 1000;  // Leaves with fewer points are dropped
+};
+
+struct OctreeChunkRange {
+    size_t first;    // Into OctreeChunks::points
+    uint32_t count;
+    uint32_t code;   // Morton code of the leaf at its own depth
+    int depth;
+};
+
+/*!
+ * Points per cell of a whole dataset at one depth, so the octree can be built a part at a time
+ * when the dataset doesn't fit in memory. Cells are indexed by Morton code at @a depth, computed
+ * like mortonCell() at max_depth and shifted down.
+ */
+struct OctreeCellCounts {
+    int depth = 0;
+    std::vector<uint64_t> prefix;  // Points in the cells before each code; 8^depth + 1 entries
+
+    // Sets up 8^depth empty cells
+    void reset(int cell_depth);
+
+    // Turns the per-cell counts accumulated in prefix[code + 1] into running totals
+    void accumulate();
+
+    // Points under the node at @a node_depth <= depth with code @a code
+    [[nodiscard]] uint64_t nodeCount(uint32_t code, int node_depth) const {
+        int shift = 3 * (depth - node_depth);
+        return prefix[size_t(code + 1) << shift] - prefix[size_t(code) << shift];
+    }
+};
+
+// Cells [first_cell, last_cell) of an OctreeCellCounts, built on their own
+struct OctreePart {
+    uint32_t first_cell;
+    uint32_t last_cell;
+    uint64_t points;
+    uint32_t max_chunks;  // Upper bound on the leaves the part keeps
+};
+
+// Octree leaves as ranges of one array of points
+struct OctreeChunks {
+    std::vector<Point> points;               // Every input point, in Morton order at max_depth
+    std::vector<OctreeChunkRange> chunks;    // Leaves in octant order; dropped ones aren't listed
+};
+
+/*!
+ * Builds the octree over @a bounds in bulk: every point's Morton code at max_depth is computed,
+ * the points are radix sorted by it, and each node is then the contiguous run of codes under its
+ * prefix. A node is split while it holds more than max_points_per_leaf points and is above
+ * max_depth, as if the points had been inserted one by one. Leaves come out in octant order
+ * (x = bit 0, y = bit 1, z = bit 2, depth first), which is Morton order, and the points inside
+ * each are in Morton order too.
+ * @param points sorted in place and returned as OctreeChunks::points; move them in to skip a copy
+ * @param jobs spreads the coding and sorting over its threads; null runs it all here
+ */
+OctreeChunks buildOctreeChunkRanges(std::vector<Point> points, const BoundingBox& bounds,
+                                    const OctreeBuildOptions& options, JobSystem* jobs = nullptr);
+
+/*!
+ * buildOctreeChunkRanges() for one part of a dataset, given the cells of planOctreeParts():
+ * nodes above totals.depth are split by the whole dataset's counts instead of the part's, so the
+ * part comes out as exactly the leaves the whole dataset would have there.
+ * @param totals depth at most options.max_depth
+ */
+OctreeChunks buildOctreePart(std::vector<Point> points, const BoundingBox& bounds,
+                             const OctreeBuildOptions& options, const OctreeCellCounts& totals,
+                             JobSystem* jobs = nullptr);
+
+/*!
+ * Splits a dataset into runs of cells of about @a max_part_points points each, in Morton order,
+ * never cutting through a leaf above totals.depth. A single cell holding more than
+ * @a max_part_points points still makes one part.
+ */
+std::vector<OctreePart> planOctreeParts(const OctreeCellCounts& totals, const OctreeBuildOptions& options,
+                                        uint64_t max_part_points);
+
+/*!
+ * buildOctreeChunkRanges() with each chunk copied out into its own array.
+ */
+std::vector<std::vector<Point>> buildOctreeChunks(const std::vector<Point>& points,
+                                                  const BoundingBox& bounds,
+                                                  const OctreeBuildOptions& options);
+
+#endif //OCTREEBUILDER_H
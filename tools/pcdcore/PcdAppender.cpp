@@ -0,0 +1,249 @@
+// 64-bit file offsets on 32-bit Android ABIs; datasets routinely exceed 2 GB
+#define _FILE_OFFSET_BITS 64
+
+#include "PcdAppender.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ChunkSource.h"
+#include "Crc32c.h"
+
+PcdAppender::~PcdAppender() {
+    close();
+}
+
+bool PcdAppender::open(const std::string& path) {
+    close();
+    path_ = path;
+    error_.clear();
+    bytes_written_ = 0;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        return fail("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+        return fail(path + " is locked by another appender");
+    }
+
+    // The header on disk still counts the chunks it was written with; the pointer follows them
+    FileHeader header{};
+    std::string error;
+    if (::pread(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        !readPcdIndex(ChunkFileRange{fd_, 0, 0}, index_, &error)) {
+        return fail(error.empty() ? "Failed to read " + path : error);
+    }
+    // Files from before the pointer slots would need the pointer after the header's index
+    // rewritten in place, where a crash can tear it
+    if (!(headerFlags(header) & PCD_FLAG_INDEX_POINTER) || !(headerFlags(header) & PCD_FLAG_POINTER_SLOTS)) {
+        return fail(path + " has no index pointer slots; rewrite it with the current tools first");
+    }
+    slots_offset_ = pcdPointerSlotsOffset(headerFlags(header), header.chunk_count, index_.bricks_per_chunk);
+
+    // Anything past the committed data is from an append that never committed. The header's
+    // index, its pointer and tables come before the slots; appended indexes keep their tables.
+    end_ = slots_offset_ + 2 * PCD_POINTER_SLOT_SIZE;
+    for (const auto& chunk : index_.chunks) {
+        end_ = std::max<uint64_t>(end_, chunk.file_offset + uint64_t(chunk.point_count) * sizeof(Point) +
+                                        payloadPadding(index_.header, chunk));
+    }
+    if (index_.generation > 0) {
+        end_ = std::max<uint64_t>(end_, index_.index_offset + indexBytes());
+    }
+
+    struct stat st{};
+    if (fstat(fd_, &st) == 0 && static_cast<uint64_t>(st.st_size) > end_ &&
+        ftruncate(fd_, static_cast<off_t>(end_)) != 0) {
+        return fail("Failed to truncate " + path + ": " + std::strerror(errno));
+    }
+    dirty_ = false;
+    return true;
+}
+
+bool PcdAppender::appendChunk(const Point* points, uint32_t count) {
+    return appendChunk(points, count, computeBounds(points, count));
+}
+
+bool PcdAppender::appendChunk(const Point* points, uint32_t count, const BoundingBox& bbox) {
+    ChunkMetadata meta{};
+    if (!writeChunk(points, count, bbox, meta)) {
+        return false;
+    }
+    index_.chunks.push_back(meta);
+    index_.header.chunk_count = static_cast<uint32_t>(index_.chunks.size());
+    index_.bricks.insert(index_.bricks.end(), bricks_.begin(), bricks_.end());
+    if (hasCrcs()) {
+        index_.chunk_crcs.push_back(crc_);
+    }
+    return true;
+}
+
+bool PcdAppender::replaceChunk(uint32_t chunk_id, const Point* points, uint32_t count) {
+    if (chunk_id >= index_.chunks.size()) {
+        return fail("No chunk " + std::to_string(chunk_id) + " to replace");
+    }
+
+    ChunkMetadata meta{};
+    uint32_t old_count = index_.chunks[chunk_id].point_count;
+    if (!writeChunk(points, count, computeBounds(points, count), meta)) {
+        return false;
+    }
+    index_.chunks[chunk_id] = meta;
+    index_.header.total_points -= old_count;
+    std::copy(bricks_.begin(), bricks_.end(), index_.bricks.begin() + size_t(chunk_id) * index_.bricks_per_chunk);
+    if (hasCrcs()) {
+        index_.chunk_crcs[chunk_id] = crc_;
+    }
+    return true;
+}
+
+bool PcdAppender::writeChunk(const Point* points, uint32_t count, const BoundingBox& bbox,
+                             ChunkMetadata& meta) {
+    if (fd_ < 0) {
+        return fail("Appender is not open");
+    }
+
+    uint64_t payload_size = uint64_t(count) * sizeof(Point);
+    bool aligned = headerFlags(index_.header) & PCD_FLAG_ALIGNED_PAYLOADS;
+
+    meta.bbox = bbox;
+    meta.point_count = count;
+    meta.file_offset = aligned ? alignUp(end_, PCD_PAYLOAD_ALIGNMENT) : end_;
+    if (aligned) {
+        meta.payload_padding = static_cast<uint32_t>(alignUp(payload_size, PCD_PAYLOAD_ALIGNMENT) - payload_size);
+    }
+
+    // Files with bricks keep every chunk grouped by brick
+    if (index_.bricks_per_chunk > 0) {
+        brick_points_.resize(count);
+        bricks_.resize(index_.bricks_per_chunk);
+        buildChunkBricks(points, count, bbox, index_.bricks_per_chunk, brick_points_.data(), bricks_.data());
+        points = brick_points_.data();
+    }
+
+    if (hasCrcs()) {
+        crc_ = crc32c(points, payload_size);
+    }
+
+    // The gap before an aligned payload and its padding are left as holes, which read as zeros
+    if (!writeAt(points, payload_size, meta.file_offset)) {
+        return false;
+    }
+
+    end_ = meta.file_offset + payload_size + meta.payload_padding;
+    index_.header.total_points += count;
+    index_.header.bounds.expand(bbox);
+    dirty_ = true;
+    return true;
+}
+
+bool PcdAppender::commit() {
+    if (fd_ < 0) {
+        return fail("Appender is not open");
+    }
+    if (!dirty_) {
+        return true;
+    }
+
+    // The index and its tables land after the payloads, and all of it reaches storage before
+    // the pointer names them
+    uint64_t index_offset = end_;
+    uint64_t offset = index_offset + index_.chunks.size() * sizeof(ChunkMetadata);
+    if (!writeAt(index_.chunks.data(), offset - index_offset, index_offset)) {
+        return false;
+    }
+    if (index_.bricks_per_chunk > 0) {
+        PcdBrickTable table{};
+        std::memcpy(table.magic, PCD_BRICK_TABLE_MAGIC, sizeof(PCD_BRICK_TABLE_MAGIC));
+        table.bricks_per_chunk = index_.bricks_per_chunk;
+        table.checksum = pcdBrickChecksum(index_.bricks.data(), index_.bricks.size(), table);
+        if (!writeAt(&table, sizeof(table), offset) ||
+            !writeAt(index_.bricks.data(), index_.bricks.size() * sizeof(PcdBrick), offset + sizeof(table))) {
+            return false;
+        }
+        offset += sizeof(table) + index_.bricks.size() * sizeof(PcdBrick);
+    }
+    if (hasCrcs()) {
+        PcdCrcTable table{};
+        std::memcpy(table.magic, PCD_CRC_TABLE_MAGIC, sizeof(PCD_CRC_TABLE_MAGIC));
+        table.chunk_count = static_cast<uint32_t>(index_.chunk_crcs.size());
+        table.checksum = pcdCrcTableChecksum(index_.chunk_crcs.data(), index_.chunk_crcs.size(), table);
+        if (!writeAt(&table, sizeof(table), offset) ||
+            !writeAt(index_.chunk_crcs.data(), index_.chunk_crcs.size() * sizeof(uint32_t), offset + sizeof(table))) {
+            return false;
+        }
+    }
+    // The padding after the last aligned payload is a hole until the file reaches past it
+    if (ftruncate(fd_, static_cast<off_t>(index_offset + indexBytes())) != 0 || fsync(fd_) != 0) {
+        return fail("Failed to sync " + path_ + ": " + std::strerror(errno));
+    }
+
+    PcdIndexPointer pointer{};
+    std::memcpy(pointer.magic, PCD_INDEX_POINTER_MAGIC, sizeof(PCD_INDEX_POINTER_MAGIC));
+    pointer.generation = index_.generation + 1;
+    pointer.index_offset = index_offset;
+    pointer.total_points = index_.header.total_points;
+    pointer.bounds = index_.header.bounds;
+    pointer.chunk_count = static_cast<uint32_t>(index_.chunks.size());
+    pointer.checksum = pcdIndexChecksum(index_.chunks.data(), index_.chunks.size(), pointer);
+
+    // Over the older slot, with one aligned write of the whole slot; the current pointer stays
+    // intact whatever happens to this one
+    std::vector<char> slot(PCD_POINTER_SLOT_SIZE, 0);
+    std::memcpy(slot.data(), &pointer, sizeof(pointer));
+    uint64_t slot_offset = slots_offset_ + (pointer.generation % 2) * PCD_POINTER_SLOT_SIZE;
+    if (::pwrite(fd_, slot.data(), slot.size(), static_cast<off_t>(slot_offset)) !=
+        static_cast<ssize_t>(slot.size()) || fsync(fd_) != 0) {
+        return fail("Failed to write the index pointer of " + path_ + ": " + std::strerror(errno));
+    }
+
+    index_.generation = pointer.generation;
+    index_.index_offset = index_offset;
+    end_ = index_offset + indexBytes();
+    dirty_ = false;
+    return true;
+}
+
+void PcdAppender::close() {
+    if (fd_ >= 0) {
+        // Closing the descriptor releases the lock
+        ::close(fd_);
+        fd_ = -1;
+    }
+    dirty_ = false;
+}
+
+uint64_t PcdAppender::indexBytes() const {
+    return index_.chunks.size() * sizeof(ChunkMetadata) +
+           pcdIndexTableBytes(headerFlags(index_.header), index_.chunks.size(), index_.bricks_per_chunk);
+}
+
+bool PcdAppender::writeAt(const void* data, size_t length, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pwrite(fd_, p + done, length - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail("Failed to write to " + path_ + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+    bytes_written_ += length;
+    return true;
+}
+
+bool PcdAppender::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
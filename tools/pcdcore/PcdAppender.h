@@ -0,0 +1,100 @@
+#ifndef PCDAPPENDER_H
+#define PCDAPPENDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PcdFile.h"
+
+/*!
+ * Adds and replaces chunks of an existing .pcd in place, without rewriting it. New payloads go
+ * at the end of the file; commit() then writes the whole new index after them and a pointer
+ * naming it into the older of the two pointer slots (see PCD_FLAG_POINTER_SLOTS). Nothing a
+ * committed index refers to is ever overwritten, so readers that loaded an older index keep
+ * reading valid chunks, and a crash at any point of a commit, the pointer write included, leaves
+ * the previous commit in place.
+ *
+ * Every commit leaves the previous index and any replaced payloads behind as dead space; a full
+ * rewrite (pcd_layout, or a fresh PcdWriter) compacts the file.
+ *
+ * Files with bricks (PCD_FLAG_BRICKS) get bricks for every chunk written, and a brick table
+ * after every index. Files with chunk CRCs (PCD_FLAG_CHUNK_CRCS) likewise get a CRC table.
+ *
+ * Holds an exclusive flock() on the file while open, so two appenders can't interleave.
+ *
+ * ex:
+ *  PcdAppender appender;
+ *  appender.open("scan.pcd");
+ *  appender.appendChunk(points.data(), points.size());
+ *  appender.commit();
+ */
+class PcdAppender {
+public:
+    PcdAppender() = default;
+
+    // Uncommitted chunks are dropped
+    ~PcdAppender();
+
+    PcdAppender(const PcdAppender&) = delete;
+    PcdAppender& operator=(const PcdAppender&) = delete;
+
+    /*!
+     * Opens @a path and reads its current index. Leftovers of an append that never committed are
+     * cut off the end of the file.
+     * @return false if it can't be opened, is locked by another appender, or was written without
+     *         index pointer slots
+     */
+    bool open(const std::string& path);
+
+    // Adds a chunk after the current ones; its bounding box is computed from the points
+    bool appendChunk(const Point* points, uint32_t count);
+
+    bool appendChunk(const Point* points, uint32_t count, const BoundingBox& bbox);
+
+    // Points chunk @a chunk_id at a new payload, keeping its id; the old payload stays for readers
+    bool replaceChunk(uint32_t chunk_id, const Point* points, uint32_t count);
+
+    /*!
+     * Makes the changes since open() or the last commit visible to readers that open the file
+     * from now on. The payloads and index are synced to storage before the pointer is rewritten.
+     */
+    bool commit();
+
+    void close();
+
+    // The index as of the next commit
+    [[nodiscard]] const PcdIndex& index() const { return index_; }
+
+    // Payload and index bytes written since open()
+    [[nodiscard]] uint64_t bytesWritten() const { return bytes_written_; }
+
+    [[nodiscard]] const std::string& error() const { return error_; }
+
+private:
+    bool writeChunk(const Point* points, uint32_t count, const BoundingBox& bbox, ChunkMetadata& meta);
+
+    bool writeAt(const void* data, size_t length, uint64_t offset);
+
+    // Size of the current index's entries and tables
+    [[nodiscard]] uint64_t indexBytes() const;
+
+    [[nodiscard]] bool hasCrcs() const { return headerFlags(index_.header) & PCD_FLAG_CHUNK_CRCS; }
+
+    bool fail(const std::string& message);
+
+    int fd_ = -1;
+    std::string path_;
+    PcdIndex index_;
+    uint64_t slots_offset_ = 0;    // Where the pointer slots start (PCD_FLAG_POINTER_SLOTS)
+    uint64_t end_ = 0;             // End of the data written so far
+    std::vector<PcdBrick> bricks_;     // Of the chunk last written
+    std::vector<Point> brick_points_;  // That chunk regrouped by brick
+    uint32_t crc_ = 0;                 // Of that chunk's payload
+    bool dirty_ = false;
+    uint64_t bytes_written_ = 0;
+    std::string error_;
+};
+
+#endif //PCDAPPENDER_H
@@ -0,0 +1,578 @@
+#include "PcdFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+
+#include "Crc32c.h"
+#include "Morton.h"
+
+static bool setError(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+bool readPcdIndex(const std::string& path, PcdIndex& index, std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return setError(error, "Failed to open file: " + path);
+    }
+    return readPcdIndex(file, index, error);
+}
+
+// Size of the stream, or 0 if it can't tell
+static uint64_t streamSize(std::istream& in) {
+    std::streampos start = in.tellg();
+    if (start < 0 || !in.seekg(0, std::ios::end)) {
+        in.clear();
+        return 0;
+    }
+    std::streampos end = in.tellg();
+    in.seekg(start);
+    return end < 0 ? 0 : static_cast<uint64_t>(end);
+}
+
+// Whether @a bytes fit between the stream's position and its end @a size; true if it's unknown
+static bool fitsInStream(std::istream& in, uint64_t size, uint64_t bytes) {
+    if (size == 0) {
+        return true;
+    }
+    std::streampos position = in.tellg();
+    return position >= 0 && static_cast<uint64_t>(position) <= size &&
+           bytes <= size - static_cast<uint64_t>(position);
+}
+
+// Reads the entries of an appended index and checks them against the pointer naming them
+static bool readAppendedIndex(std::istream& in, uint64_t size, const PcdIndexPointer& pointer,
+                              std::vector<ChunkMetadata>& chunks, std::string* error) {
+    std::string generation = std::to_string(pointer.generation);
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(pointer.index_offset));
+    if (!in || !fitsInStream(in, size, uint64_t(pointer.chunk_count) * sizeof(ChunkMetadata))) {
+        return setError(error, "File is too short for the index of generation " + generation);
+    }
+
+    chunks.resize(pointer.chunk_count);
+    if (!in.read(reinterpret_cast<char*>(chunks.data()),
+                 static_cast<std::streamsize>(chunks.size() * sizeof(ChunkMetadata)))) {
+        return setError(error, "File is too short for the index of generation " + generation);
+    }
+    if (pcdIndexChecksum(chunks.data(), chunks.size(), pointer) != pointer.checksum) {
+        return setError(error, "Index checksum mismatch in generation " + generation);
+    }
+    return true;
+}
+
+bool readPcdIndex(std::istream& in, PcdIndex& index, std::string* error) {
+    uint64_t size = streamSize(in);
+    FileHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(FileHeader))) {
+        return setError(error, "File is too short for a header");
+    }
+
+    if (std::string(header.magic, 7) != "PCLOUD1") {
+        return setError(error, "Invalid file format! Magic: " + std::string(header.magic, 7));
+    }
+
+    if (header.version == 0 || header.version > PCD_VERSION) {
+        return setError(error, "Unsupported format version " + std::to_string(header.version));
+    }
+
+    // A corrupt count mustn't turn into a huge allocation
+    if (!fitsInStream(in, size, uint64_t(header.chunk_count) * sizeof(ChunkMetadata))) {
+        return setError(error, "File is too short for " + std::to_string(header.chunk_count) +
+                               " index entries");
+    }
+    std::vector<ChunkMetadata> chunks(header.chunk_count);
+    if (!in.read(reinterpret_cast<char*>(chunks.data()),
+                 header.chunk_count * sizeof(ChunkMetadata))) {
+        return setError(error, "File is too short for " + std::to_string(header.chunk_count) +
+                               " index entries");
+    }
+
+    // Version 1 writers left these uninitialized
+    if (header.version < 2) {
+        header.flags = 0;
+        for (auto& chunk : chunks) {
+            chunk.payload_padding = 0;
+        }
+    }
+
+    uint64_t generation = 0;
+    uint64_t index_offset = sizeof(FileHeader);
+    if (header.flags & PCD_FLAG_INDEX_POINTER) {
+        PcdIndexPointer pointer{};
+        if (!in.read(reinterpret_cast<char*>(&pointer), sizeof(pointer))) {
+            return setError(error, "File is too short for the index pointer");
+        }
+        if (std::memcmp(pointer.magic, PCD_INDEX_POINTER_MAGIC, sizeof(PCD_INDEX_POINTER_MAGIC)) != 0) {
+            return setError(error, "Invalid index pointer");
+        }
+        std::streampos tables = in.tellg();
+
+        // The newest valid pointer slot names the current index; a slot torn by a crash fails
+        // its checksum and the other one, or generation 0, stands
+        bool appended = false;
+        if (header.flags & PCD_FLAG_POINTER_SLOTS) {
+            uint32_t bricks_per_chunk = 0;
+            if (header.flags & PCD_FLAG_BRICKS) {
+                PcdBrickTable table{};
+                if (!in.read(reinterpret_cast<char*>(&table), sizeof(table)) ||
+                    !validBricksPerChunk(table.bricks_per_chunk)) {
+                    return setError(error, "Invalid brick table");
+                }
+                bricks_per_chunk = table.bricks_per_chunk;
+            }
+
+            uint64_t slots = pcdPointerSlotsOffset(header.flags, header.chunk_count, bricks_per_chunk);
+            PcdIndexPointer slot[2]{};
+            for (int i = 0; i < 2; ++i) {
+                in.seekg(static_cast<std::streamoff>(slots + uint64_t(i) * PCD_POINTER_SLOT_SIZE));
+                if (!in.read(reinterpret_cast<char*>(&slot[i]), sizeof(slot[i]))) {
+                    return setError(error, "File is too short for the index pointer slots");
+                }
+            }
+
+            int newest = slot[1].generation > slot[0].generation ? 1 : 0;
+            std::vector<ChunkMetadata> slot_chunks;
+            for (int i : {newest, 1 - newest}) {
+                if (std::memcmp(slot[i].magic, PCD_INDEX_POINTER_MAGIC, sizeof(PCD_INDEX_POINTER_MAGIC)) == 0 &&
+                    slot[i].generation > 0 && readAppendedIndex(in, size, slot[i], slot_chunks, nullptr)) {
+                    pointer = slot[i];
+                    chunks = std::move(slot_chunks);
+                    appended = true;
+                    break;
+                }
+            }
+        } else if (pointer.generation > 0) {
+            // Files from before the slots rewrite the pointer after the header's index
+            if (!readAppendedIndex(in, size, pointer, chunks, error)) {
+                return false;
+            }
+            appended = true;
+        }
+
+        if (!appended) {
+            // Generation 0 is the index just read, and its tables follow the pointer
+            in.clear();
+            in.seekg(tables);
+            if (pcdIndexChecksum(chunks.data(), chunks.size(), pointer) != pointer.checksum) {
+                return setError(error, "Index checksum mismatch in generation 0");
+            }
+        }
+
+        header.chunk_count = pointer.chunk_count;
+        header.total_points = pointer.total_points;
+        header.bounds = pointer.bounds;
+        generation = pointer.generation;
+        index_offset = pointer.index_offset;
+    }
+
+    // The brick table follows whichever index was read last
+    uint32_t bricks_per_chunk = 0;
+    std::vector<PcdBrick> bricks;
+    if (header.flags & PCD_FLAG_BRICKS) {
+        if (!(header.flags & PCD_FLAG_INDEX_POINTER)) {
+            return setError(error, "Brick table without an index pointer");
+        }
+
+        PcdBrickTable table{};
+        if (!in.read(reinterpret_cast<char*>(&table), sizeof(table))) {
+            return setError(error, "File is too short for the brick table");
+        }
+        if (std::memcmp(table.magic, PCD_BRICK_TABLE_MAGIC, sizeof(PCD_BRICK_TABLE_MAGIC)) != 0 ||
+            !validBricksPerChunk(table.bricks_per_chunk)) {
+            return setError(error, "Invalid brick table");
+        }
+
+        bricks_per_chunk = table.bricks_per_chunk;
+        if (!fitsInStream(in, size, uint64_t(chunks.size()) * bricks_per_chunk * sizeof(PcdBrick))) {
+            return setError(error, "File is too short for " + std::to_string(chunks.size() * bricks_per_chunk) +
+                                   " bricks");
+        }
+        bricks.resize(chunks.size() * bricks_per_chunk);
+        if (!in.read(reinterpret_cast<char*>(bricks.data()),
+                     static_cast<std::streamsize>(bricks.size() * sizeof(PcdBrick)))) {
+            return setError(error, "File is too short for " + std::to_string(bricks.size()) + " bricks");
+        }
+        if (pcdBrickChecksum(bricks.data(), bricks.size(), table) != table.checksum) {
+            return setError(error, "Brick table checksum mismatch");
+        }
+
+        // Readers go straight from a brick to a byte range, so it has to stay inside its chunk
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            uint64_t next = 0;
+            for (uint32_t b = 0; b < bricks_per_chunk; ++b) {
+                const PcdBrick& brick = bricks[i * bricks_per_chunk + b];
+                if (brick.first_point != next) {
+                    return setError(error, "Bricks of chunk " + std::to_string(i) + " aren't contiguous");
+                }
+                next += brick.point_count;
+            }
+            if (next != chunks[i].point_count) {
+                return setError(error, "Bricks of chunk " + std::to_string(i) + " hold " +
+                                       std::to_string(next) + " of its " +
+                                       std::to_string(chunks[i].point_count) + " points");
+            }
+        }
+    }
+
+    // Then the CRC table, after the bricks
+    std::vector<uint32_t> chunk_crcs;
+    if (header.flags & PCD_FLAG_CHUNK_CRCS) {
+        if (!(header.flags & PCD_FLAG_INDEX_POINTER)) {
+            return setError(error, "Chunk CRCs without an index pointer");
+        }
+
+        PcdCrcTable table{};
+        if (!in.read(reinterpret_cast<char*>(&table), sizeof(table))) {
+            return setError(error, "File is too short for the CRC table");
+        }
+        if (std::memcmp(table.magic, PCD_CRC_TABLE_MAGIC, sizeof(PCD_CRC_TABLE_MAGIC)) != 0 ||
+            table.chunk_count != chunks.size()) {
+            return setError(error, "Invalid CRC table");
+        }
+        if (!fitsInStream(in, size, uint64_t(chunks.size()) * sizeof(uint32_t))) {
+            return setError(error, "File is too short for " + std::to_string(chunks.size()) + " chunk CRCs");
+        }
+
+        chunk_crcs.resize(chunks.size());
+        if (!in.read(reinterpret_cast<char*>(chunk_crcs.data()),
+                     static_cast<std::streamsize>(chunk_crcs.size() * sizeof(uint32_t)))) {
+            return setError(error, "File is too short for " + std::to_string(chunks.size()) + " chunk CRCs");
+        }
+        if (pcdCrcTableChecksum(chunk_crcs.data(), chunk_crcs.size(), table) != table.checksum) {
+            return setError(error, "CRC table checksum mismatch");
+        }
+    }
+
+    index.header = header;
+    index.chunks = std::move(chunks);
+    index.generation = generation;
+    index.index_offset = index_offset;
+    index.bricks_per_chunk = bricks_per_chunk;
+    index.bricks = std::move(bricks);
+    index.chunk_crcs = std::move(chunk_crcs);
+    return true;
+}
+
+static void fnv1a(uint32_t& hash, const void* data, size_t length) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+uint32_t pcdIndexChecksum(const ChunkMetadata* chunks, size_t count, const PcdIndexPointer& pointer) {
+    uint32_t hash = 2166136261u;
+    fnv1a(hash, chunks, count * sizeof(ChunkMetadata));
+    fnv1a(hash, &pointer, offsetof(PcdIndexPointer, checksum));
+    return hash;
+}
+
+uint32_t pcdBrickChecksum(const PcdBrick* bricks, size_t count, const PcdBrickTable& table) {
+    uint32_t hash = 2166136261u;
+    fnv1a(hash, bricks, count * sizeof(PcdBrick));
+    fnv1a(hash, &table, offsetof(PcdBrickTable, checksum));
+    return hash;
+}
+
+uint32_t pcdCrcTableChecksum(const uint32_t* crcs, size_t count, const PcdCrcTable& table) {
+    uint32_t hash = 2166136261u;
+    fnv1a(hash, crcs, count * sizeof(uint32_t));
+    fnv1a(hash, &table, offsetof(PcdCrcTable, checksum));
+    return hash;
+}
+
+uint64_t pcdIndexTableBytes(uint32_t flags, uint64_t chunk_count, uint32_t bricks_per_chunk) {
+    uint64_t bytes = 0;
+    if (flags & PCD_FLAG_BRICKS) {
+        bytes += sizeof(PcdBrickTable) + chunk_count * bricks_per_chunk * sizeof(PcdBrick);
+    }
+    if (flags & PCD_FLAG_CHUNK_CRCS) {
+        bytes += sizeof(PcdCrcTable) + chunk_count * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+uint64_t pcdPointerSlotsOffset(uint32_t flags, uint64_t chunk_count, uint32_t bricks_per_chunk) {
+    return alignUp(sizeof(FileHeader) + chunk_count * sizeof(ChunkMetadata) + sizeof(PcdIndexPointer) +
+                   pcdIndexTableBytes(flags, chunk_count, bricks_per_chunk),
+                   PCD_POINTER_SLOT_SIZE);
+}
+
+void buildChunkBricks(const Point* points, uint32_t count, const BoundingBox& bbox,
+                      uint32_t bricks_per_chunk, Point* out, PcdBrick* bricks) {
+    int depth = bricks_per_chunk == 64 ? 2 : 1;
+
+    // Counting sort by cell: count, turn counts into starts, then place
+    std::vector<uint32_t> cells(count);
+    uint32_t starts[64] = {};
+    for (uint32_t i = 0; i < count; ++i) {
+        cells[i] = mortonCell(points[i].x, points[i].y, points[i].z, bbox, depth);
+        starts[cells[i]]++;
+    }
+
+    uint32_t first = 0;
+    for (uint32_t b = 0; b < bricks_per_chunk; ++b) {
+        bricks[b] = {BoundingBox::empty(), first, starts[b]};
+        first += starts[b];
+        starts[b] = bricks[b].first_point;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        out[starts[cells[i]]++] = points[i];
+        bricks[cells[i]].bbox.expand(points[i].x, points[i].y, points[i].z);
+    }
+}
+
+BoundingBox computeBounds(const Point* points, size_t count) {
+    BoundingBox bounds = BoundingBox::empty();
+    for (size_t i = 0; i < count; ++i) {
+        bounds.expand(points[i].x, points[i].y, points[i].z);
+    }
+    return bounds;
+}
+
+bool PcdWriter::open(const std::string& path, uint32_t max_chunks, const PcdWriteOptions& options) {
+    path_ = path;
+    options_ = options;
+    max_chunks_ = max_chunks;
+    chunks_.clear();
+    chunks_.reserve(max_chunks);
+    bricks_.clear();
+    crcs_.clear();
+    bounds_ = BoundingBox::empty();
+    explicit_bounds_ = false;
+    index_order_.clear();
+    total_points_ = 0;
+    error_.clear();
+
+    if (options.bricks_per_chunk != 0 && !validBricksPerChunk(options.bricks_per_chunk)) {
+        return fail("Bricks per chunk must be 8 or 64, not " + std::to_string(options.bricks_per_chunk));
+    }
+
+    file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file_) {
+        return fail("Failed to open output file: " + path);
+    }
+
+    // Placeholder header, index, index pointer and tables, rewritten by finish(), then the empty
+    // pointer slots. Fewer chunks than reserved only move the slots closer to the header.
+    uint64_t index_end = pcdPointerSlotsOffset(flags(), max_chunks, options.bricks_per_chunk) +
+                         2 * PCD_POINTER_SLOT_SIZE;
+    next_offset_ = options.align_payloads ? alignUp(index_end, PCD_PAYLOAD_ALIGNMENT) : index_end;
+
+    const std::vector<char> zeros(64 * 1024, 0);
+    for (uint64_t written = 0; written < next_offset_;) {
+        auto n = static_cast<std::streamsize>(std::min<uint64_t>(zeros.size(), next_offset_ - written));
+        file_.write(zeros.data(), n);
+        written += n;
+    }
+
+    return file_.good() || fail("Failed to write to " + path);
+}
+
+bool PcdWriter::writeChunk(const Point* points, uint32_t count) {
+    return writeChunk(points, count, computeBounds(points, count));
+}
+
+bool PcdWriter::writeChunk(const Point* points, uint32_t count, const BoundingBox& bbox) {
+    if (!file_.is_open()) {
+        return fail("Writer is not open");
+    }
+    if (chunks_.size() >= max_chunks_) {
+        return fail("More than the " + std::to_string(max_chunks_) + " chunks reserved");
+    }
+
+    ChunkMetadata meta{};
+    meta.bbox = bbox;
+    meta.point_count = count;
+    meta.file_offset = next_offset_;
+
+    uint64_t payload_size = uint64_t(count) * sizeof(Point);
+    if (options_.align_payloads) {
+        meta.payload_padding =
+                static_cast<uint32_t>(alignUp(payload_size, PCD_PAYLOAD_ALIGNMENT) - payload_size);
+    }
+
+    if (options_.bricks_per_chunk != 0) {
+        brick_points_.resize(count);
+        bricks_.resize(bricks_.size() + options_.bricks_per_chunk);
+        buildChunkBricks(points, count, bbox, options_.bricks_per_chunk, brick_points_.data(),
+                         &bricks_[bricks_.size() - options_.bricks_per_chunk]);
+        points = brick_points_.data();
+    }
+
+    if (options_.chunk_crcs) {
+        crcs_.push_back(crc32c(points, payload_size));
+    }
+
+    static const char zeros[PCD_PAYLOAD_ALIGNMENT] = {};
+    file_.write(reinterpret_cast<const char*>(points), static_cast<std::streamsize>(payload_size));
+    file_.write(zeros, meta.payload_padding);
+    if (!file_) {
+        return fail("Failed to write chunk " + std::to_string(chunks_.size()));
+    }
+
+    chunks_.push_back(meta);
+    if (!explicit_bounds_) {
+        bounds_.expand(bbox);
+    }
+    total_points_ += count;
+    next_offset_ += payload_size + meta.payload_padding;
+    return true;
+}
+
+bool PcdWriter::reserveChunk(const ChunkMetadata& chunk, const PcdBrick* bricks, uint32_t crc,
+                             uint64_t& offset) {
+    if (!file_.is_open()) {
+        return fail("Writer is not open");
+    }
+    if (chunks_.size() >= max_chunks_) {
+        return fail("More than the " + std::to_string(max_chunks_) + " chunks reserved");
+    }
+    if (options_.bricks_per_chunk != 0 && bricks == nullptr) {
+        return fail("Chunk " + std::to_string(chunks_.size()) + " has no bricks");
+    }
+
+    ChunkMetadata meta{};
+    meta.bbox = chunk.bbox;
+    meta.point_count = chunk.point_count;
+    meta.file_offset = next_offset_;
+
+    uint64_t payload_size = uint64_t(chunk.point_count) * sizeof(Point);
+    if (options_.align_payloads) {
+        meta.payload_padding =
+                static_cast<uint32_t>(alignUp(payload_size, PCD_PAYLOAD_ALIGNMENT) - payload_size);
+    }
+
+    if (options_.bricks_per_chunk != 0) {
+        bricks_.insert(bricks_.end(), bricks, bricks + options_.bricks_per_chunk);
+    }
+    if (options_.chunk_crcs) {
+        crcs_.push_back(crc);
+    }
+
+    // Skip over the payload; seeking flushes what's buffered, so nothing lands in it later
+    next_offset_ += payload_size + meta.payload_padding;
+    file_.seekp(static_cast<std::streamoff>(next_offset_));
+    if (!file_) {
+        return fail("Failed to reserve chunk " + std::to_string(chunks_.size()));
+    }
+
+    chunks_.push_back(meta);
+    if (!explicit_bounds_) {
+        bounds_.expand(chunk.bbox);
+    }
+    total_points_ += chunk.point_count;
+    offset = meta.file_offset;
+    return true;
+}
+
+void PcdWriter::setBounds(const BoundingBox& bounds) {
+    bounds_ = bounds;
+    explicit_bounds_ = true;
+}
+
+void PcdWriter::setIndexOrder(std::vector<uint32_t> entries) {
+    index_order_ = std::move(entries);
+}
+
+bool PcdWriter::finish() {
+    if (!file_.is_open()) {
+        return fail("Writer is not open");
+    }
+
+    if (!index_order_.empty()) {
+        if (index_order_.size() != chunks_.size()) {
+            return fail("Index order covers " + std::to_string(index_order_.size()) + " of " +
+                        std::to_string(chunks_.size()) + " chunks");
+        }
+
+        uint32_t k = options_.bricks_per_chunk;
+        std::vector<ChunkMetadata> ordered(chunks_.size());
+        std::vector<PcdBrick> ordered_bricks(bricks_.size());
+        std::vector<uint32_t> ordered_crcs(crcs_.size());
+        std::vector<bool> taken(chunks_.size(), false);
+        for (size_t i = 0; i < chunks_.size(); ++i) {
+            uint32_t entry = index_order_[i];
+            if (entry >= chunks_.size() || taken[entry]) {
+                return fail("Index order is not a permutation");
+            }
+            taken[entry] = true;
+            ordered[entry] = chunks_[i];
+            std::copy(bricks_.begin() + i * k, bricks_.begin() + (i + 1) * k, ordered_bricks.begin() + size_t(entry) * k);
+            if (!crcs_.empty()) {
+                ordered_crcs[entry] = crcs_[i];
+            }
+        }
+        chunks_ = std::move(ordered);
+        bricks_ = std::move(ordered_bricks);
+        crcs_ = std::move(ordered_crcs);
+        index_order_.clear();
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, "PCLOUD1", 8);
+    header.version = PCD_VERSION;
+    header.bounds = bounds_;
+    header.flags = flags();
+    header.total_points = total_points_;
+    header.chunk_count = static_cast<uint32_t>(chunks_.size());
+    header.chunk_size = options_.chunk_size;
+
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+    file_.write(reinterpret_cast<const char*>(chunks_.data()),
+                static_cast<std::streamsize>(chunks_.size() * sizeof(ChunkMetadata)));
+
+    PcdIndexPointer pointer{};
+    std::memcpy(pointer.magic, PCD_INDEX_POINTER_MAGIC, sizeof(PCD_INDEX_POINTER_MAGIC));
+    pointer.index_offset = sizeof(FileHeader);
+    pointer.total_points = header.total_points;
+    pointer.bounds = header.bounds;
+    pointer.chunk_count = header.chunk_count;
+    pointer.checksum = pcdIndexChecksum(chunks_.data(), chunks_.size(), pointer);
+    file_.write(reinterpret_cast<const char*>(&pointer), sizeof(pointer));
+
+    if (options_.bricks_per_chunk != 0) {
+        PcdBrickTable table{};
+        std::memcpy(table.magic, PCD_BRICK_TABLE_MAGIC, sizeof(PCD_BRICK_TABLE_MAGIC));
+        table.bricks_per_chunk = options_.bricks_per_chunk;
+        table.checksum = pcdBrickChecksum(bricks_.data(), bricks_.size(), table);
+        file_.write(reinterpret_cast<const char*>(&table), sizeof(table));
+        file_.write(reinterpret_cast<const char*>(bricks_.data()),
+                    static_cast<std::streamsize>(bricks_.size() * sizeof(PcdBrick)));
+    }
+
+    if (options_.chunk_crcs) {
+        PcdCrcTable table{};
+        std::memcpy(table.magic, PCD_CRC_TABLE_MAGIC, sizeof(PCD_CRC_TABLE_MAGIC));
+        table.chunk_count = static_cast<uint32_t>(crcs_.size());
+        table.checksum = pcdCrcTableChecksum(crcs_.data(), crcs_.size(), table);
+        file_.write(reinterpret_cast<const char*>(&table), sizeof(table));
+        file_.write(reinterpret_cast<const char*>(crcs_.data()),
+                    static_cast<std::streamsize>(crcs_.size() * sizeof(uint32_t)));
+    }
+    file_.close();
+
+    if (!file_) {
+        return fail("Failed to finish " + path_);
+    }
+    return true;
+}
+
+uint32_t PcdWriter::flags() const {
+    return PCD_FLAG_INDEX_POINTER | PCD_FLAG_POINTER_SLOTS | (options_.align_payloads ? PCD_FLAG_ALIGNED_PAYLOADS : 0) |
+           (options_.bricks_per_chunk != 0 ? PCD_FLAG_BRICKS : 0) |
+           (options_.chunk_crcs ? PCD_FLAG_CHUNK_CRCS : 0);
+}
+
+bool PcdWriter::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
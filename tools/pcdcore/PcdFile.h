@@ -0,0 +1,173 @@
+#ifndef PCDFILE_H
+#define PCDFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+
+// Header and chunk index of a .pcd file
+struct PcdIndex {
+    FileHeader header{};  // chunk_count, total_points and bounds describe the current index
+    std::vector<ChunkMetadata> chunks;
+    uint64_t generation = 0;    // Commits appended since the file was written
+    uint64_t index_offset = 0;  // Where the current index's entries start
+    uint32_t bricks_per_chunk = 0;  // 0 without PCD_FLAG_BRICKS
+    std::vector<PcdBrick> bricks;   // bricks_per_chunk per chunk, in chunk order
+    std::vector<uint32_t> chunk_crcs;  // CRC32C of each payload, empty without PCD_FLAG_CHUNK_CRCS
+
+    // The bricks of chunk @a chunk_id, or nullptr if the file has none
+    [[nodiscard]] const PcdBrick* chunkBricks(uint32_t chunk_id) const {
+        return bricks_per_chunk > 0 ? &bricks[size_t(chunk_id) * bricks_per_chunk] : nullptr;
+    }
+};
+
+/*!
+ * Reads and validates the header and the current chunk index, following the index pointer of
+ * files with appended chunks. Counts are checked against the file's size, when the stream can
+ * tell it, before anything is allocated for them.
+ * @return false if the file can't be read or isn't a .pcd; @a error then says why
+ */
+bool readPcdIndex(const std::string& path, PcdIndex& index, std::string* error = nullptr);
+
+// @a in has to be seekable when the file has appended chunks
+bool readPcdIndex(std::istream& in, PcdIndex& index, std::string* error = nullptr);
+
+// FNV-1a over the index entries, then the pointer's fields before its checksum
+uint32_t pcdIndexChecksum(const ChunkMetadata* chunks, size_t count, const PcdIndexPointer& pointer);
+
+// FNV-1a over the bricks, then the table's fields before its checksum
+uint32_t pcdBrickChecksum(const PcdBrick* bricks, size_t count, const PcdBrickTable& table);
+
+// FNV-1a over the CRCs, then the table's fields before its checksum
+uint32_t pcdCrcTableChecksum(const uint32_t* crcs, size_t count, const PcdCrcTable& table);
+
+/*!
+ * Bytes of the tables that follow an index of @a chunk_count entries (after its pointer, for the
+ * index after the header): the brick table and the CRC table, as @a flags call for.
+ */
+uint64_t pcdIndexTableBytes(uint32_t flags, uint64_t chunk_count, uint32_t bricks_per_chunk);
+
+/*!
+ * Where the pointer slots of a file with PCD_FLAG_POINTER_SLOTS start, for @a chunk_count entries
+ * in the index after its header: the first slot boundary past that index's pointer and tables.
+ */
+uint64_t pcdPointerSlotsOffset(uint32_t flags, uint64_t chunk_count, uint32_t bricks_per_chunk);
+
+// 8 or 64, the counts PCD_FLAG_BRICKS allows
+[[nodiscard]] inline bool validBricksPerChunk(uint32_t bricks_per_chunk) {
+    return bricks_per_chunk == 8 || bricks_per_chunk == 64;
+}
+
+/*!
+ * Groups a chunk's points by brick: the cells of a 2x2x2 (8 bricks) or 4x4x4 (64 bricks) grid
+ * over @a bbox, in Morton order. Stable, so points keep their order within a brick.
+ * @param out receives the @a count reordered points
+ * @param bricks receives @a bricks_per_chunk bricks
+ */
+void buildChunkBricks(const Point* points, uint32_t count, const BoundingBox& bbox,
+                      uint32_t bricks_per_chunk, Point* out, PcdBrick* bricks);
+
+// Bounds of an array of points; BoundingBox::empty() for an empty array
+BoundingBox computeBounds(const Point* points, size_t count);
+
+struct PcdWriteOptions {
+    bool align_payloads = false;  // Sets PCD_FLAG_ALIGNED_PAYLOADS
+    uint32_t chunk_size = 100000; // Stored in FileHeader::chunk_size
+    uint32_t bricks_per_chunk = 0; // 8 or 64 sets PCD_FLAG_BRICKS; 0 writes no brick table
+    bool chunk_crcs = false;       // Sets PCD_FLAG_CHUNK_CRCS
+};
+
+/*!
+ * Writes a .pcd one chunk at a time, so callers never need the whole dataset in memory. Space
+ * for the index and the index pointer is reserved up front and filled in by finish(), so chunks
+ * can later be appended with PcdAppender.
+ *
+ * ex:
+ *  PcdWriter writer;
+ *  writer.open("out.pcd", chunks.size(), options);
+ *  for (auto& chunk : chunks) writer.writeChunk(chunk.data(), chunk.size());
+ *  writer.finish();
+ */
+class PcdWriter {
+public:
+    /*!
+     * @param max_chunks upper bound on the number of chunks that will be written
+     */
+    bool open(const std::string& path, uint32_t max_chunks, const PcdWriteOptions& options);
+
+    // Appends a chunk; its bounding box is computed from the points. With bricks the points are
+    // written grouped by brick (see buildChunkBricks).
+    bool writeChunk(const Point* points, uint32_t count);
+
+    bool writeChunk(const Point* points, uint32_t count, const BoundingBox& bbox);
+
+    /*!
+     * Adds a chunk whose payload the caller writes into the file itself, e.g. copied out of
+     * another .pcd with copy_file_range. @a chunk gives its bounding box and point count; its
+     * @a bricks and @a crc have to describe the payload as written, and are only used when the
+     * options call for bricks or CRCs.
+     * @param offset receives where the payload goes, followed by its zero padding with
+     *               align_payloads; the writer never writes to those bytes
+     */
+    bool reserveChunk(const ChunkMetadata& chunk, const PcdBrick* bricks, uint32_t crc, uint64_t& offset);
+
+    // Overrides the header bounds, which otherwise are the union of the chunk boxes
+    void setBounds(const BoundingBox& bounds);
+
+    // Overrides PcdWriteOptions::chunk_size, e.g. once the largest chunk written is known
+    void setChunkSize(uint32_t chunk_size) { options_.chunk_size = chunk_size; }
+
+    /*!
+     * Decouples the index order from the payload order: the i-th chunk written becomes index
+     * entry @a entries[i]. Used to lay payloads out differently while chunk ids stay put.
+     * Checked by finish(), which fails unless it's a permutation of the chunks written.
+     */
+    void setIndexOrder(std::vector<uint32_t> entries);
+
+    // Writes the header and index and closes the file
+    bool finish();
+
+    [[nodiscard]] const std::vector<ChunkMetadata>& chunks() const { return chunks_; }
+
+    // bricks_per_chunk per chunk written, in the order written until finish()
+    [[nodiscard]] const std::vector<PcdBrick>& bricks() const { return bricks_; }
+
+    // CRC32C of each chunk's payload as written, with chunk_crcs; same order as bricks()
+    [[nodiscard]] const std::vector<uint32_t>& chunkCrcs() const { return crcs_; }
+
+    [[nodiscard]] uint64_t totalPoints() const { return total_points_; }
+
+    // Current end of file
+    [[nodiscard]] uint64_t fileSize() const { return next_offset_; }
+
+    [[nodiscard]] const std::string& error() const { return error_; }
+
+private:
+    // PCD_FLAG_* bits the options call for
+    [[nodiscard]] uint32_t flags() const;
+
+    bool fail(const std::string& message);
+
+    std::ofstream file_;
+    std::string path_;
+    PcdWriteOptions options_;
+    uint32_t max_chunks_ = 0;
+
+    std::vector<ChunkMetadata> chunks_;
+    std::vector<PcdBrick> bricks_;
+    std::vector<uint32_t> crcs_;
+    std::vector<Point> brick_points_;  // A chunk regrouped by brick, on its way to the file
+    BoundingBox bounds_ = BoundingBox::empty();
+    bool explicit_bounds_ = false;
+    std::vector<uint32_t> index_order_;
+    uint64_t total_points_ = 0;
+    uint64_t next_offset_ = 0;
+
+    std::string error_;
+};
+
+#endif //PCDFILE_H
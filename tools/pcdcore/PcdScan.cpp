@@ -0,0 +1,642 @@
+#include "PcdScan.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include "Crc32c.h"
+#include "JobSystem.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PCDSCAN_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static bool setError(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+void Log2Histogram::add(int exponent, uint64_t n) {
+    counts[std::clamp<int64_t>(int64_t(exponent) - kMinExp, 0, kBuckets - 1)] += n;
+}
+
+void Log2Histogram::merge(const Log2Histogram& other) {
+    for (int b = 0; b < kBuckets; ++b) {
+        counts[b] += other.counts[b];
+    }
+}
+
+uint64_t Log2Histogram::total() const {
+    uint64_t n = 0;
+    for (uint64_t count : counts) {
+        n += count;
+    }
+    return n;
+}
+
+double Log2Histogram::quantile(double fraction) const {
+    uint64_t n = total();
+    if (n == 0) {
+        return 0.0;
+    }
+    auto target = static_cast<uint64_t>(fraction * double(n));
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += counts[b];
+        if (seen > target) {
+            return bucketLow(b);
+        }
+    }
+    return bucketLow(kBuckets - 1);
+}
+
+double Log2Histogram::bucketLow(int bucket) {
+    return std::ldexp(1.0, kMinExp + bucket);
+}
+
+// floor(log2(d)) of a distance from its square, read off the float's exponent so the per-point
+// loop needs neither sqrt nor log. Zero and NaN go to the first bucket.
+static int log2Distance(float squared) {
+    if (!(squared > 0.0f)) {
+        return Log2Histogram::kMinExp;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &squared, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 127;
+    return exponent >= 0 ? exponent / 2 : -((1 - exponent) / 2);
+}
+
+static double volume(const BoundingBox& box) {
+    return double(box.max_x - box.min_x) * double(box.max_y - box.min_y) * double(box.max_z - box.min_z);
+}
+
+static inline bool finite(const Point& p) {
+    return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+}
+
+// A chunk's points sorted into cubic cells for nearest neighbour queries. Cells start at a point
+// each as if the points filled their box evenly, and shrink until occupied ones hold a few, so
+// surfaces get cells about as fine as volumes. One per worker, reused from chunk to chunk.
+class NeighborGrid {
+public:
+    void build(const Point* points, uint32_t count) {
+        float lo[3] = {INFINITY, INFINITY, INFINITY}, hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+        positions_.clear();
+        order_.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            const Point& p = points[i];
+            if (finite(p)) {
+                positions_.push_back({p.x, p.y, p.z});
+                order_.push_back(i);
+                for (int a = 0; a < 3; ++a) {
+                    lo[a] = std::min(lo[a], positions_.back()[a]);
+                    hi[a] = std::max(hi[a], positions_.back()[a]);
+                }
+            }
+        }
+        cells_.clear();
+        if (positions_.empty()) {
+            return;
+        }
+
+        // Flat dimensions don't spread the points out
+        double product = 1.0, largest = 0.0;
+        int dimensions = 0;
+        for (int a = 0; a < 3; ++a) {
+            origin_[a] = lo[a];
+            double extent = double(hi[a]) - double(lo[a]);
+            largest = std::max(largest, extent);
+            if (extent > 0.0) {
+                product *= extent;
+                dimensions++;
+            }
+        }
+        const double finest = largest / double(kMaxCells - 1);
+        const double n = double(positions_.size());
+        double cell = std::max(dimensions > 0 ? std::pow(product / n, 1.0 / dimensions) : 1.0, finest);
+
+        for (int pass = 0;; ++pass) {
+            cell_ = static_cast<float>(cell);
+            inverse_ = static_cast<float>(1.0 / cell);
+            bucket();
+            double per_cell = n / double(cells_.size());
+            if (per_cell <= kPointsPerCell || pass == kMaxPasses || cell <= finest) {
+                break;
+            }
+            // Points on a surface fill cells by their area
+            cell = std::max(cell * std::max(std::sqrt(kPointsPerCell / per_cell), 0.125), finest);
+        }
+        for (int a = 0; a < 3; ++a) {
+            last_[a] = cellIndex(hi[a], a);
+        }
+    }
+
+    /*!
+     * Calls @a visit with the squared distance from every @a stride th point of the chunk to the
+     * closest other one, cell by cell. Points alone in the chunk and NaNs are skipped.
+     */
+    template <typename Visit>
+    void forEachNearest(uint32_t stride, Visit visit) const {
+        const float reach = cell_ * cell_;
+        uint32_t around[27];
+        for (const Cell& cell : cells_) {
+            uint32_t sampled = cell.first;
+            while (sampled < cell.last && order_[sampled] % stride != 0) {
+                ++sampled;
+            }
+            if (sampled == cell.last) {
+                continue;
+            }
+            // Most points have a neighbour within a cell of them, so the 27 cells around are
+            // looked up once for all of them
+            int found = 0;
+            for (int64_t dz = -1; dz <= 1; ++dz) {
+                for (int64_t dy = -1; dy <= 1; ++dy) {
+                    for (int64_t dx = -1; dx <= 1; ++dx) {
+                        uint32_t c = find(cell.x + dx, cell.y + dy, cell.z + dz);
+                        if (c != UINT32_MAX) {
+                            around[found++] = c;
+                        }
+                    }
+                }
+            }
+            for (uint32_t i = sampled; i < cell.last; ++i) {
+                if (order_[i] % stride != 0) {
+                    continue;
+                }
+                float best = INFINITY;
+                for (int k = 0; k < found; ++k) {
+                    closest(cells_[around[k]], i, best);
+                }
+                if (best > reach) {
+                    best = farther(i, best);
+                }
+                if (best < INFINITY) {
+                    visit(best);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr int64_t kMaxCells = int64_t(1) << 21;  // Along each axis, so a key fits in 63 bits
+    static constexpr double kPointsPerCell = 8.0;
+    static constexpr int kMaxPasses = 3;
+
+    struct Cell {
+        int64_t x, y, z;
+        uint32_t first, last;  // Its run of positions_
+    };
+
+    [[nodiscard]] int64_t cellIndex(float v, int axis) const {
+        float f = (v - origin_[axis]) * inverse_;
+        return static_cast<int64_t>(std::min(std::max(f, 0.0f), float(kMaxCells - 1)));
+    }
+
+    static uint64_t key(int64_t x, int64_t y, int64_t z) {
+        return uint64_t(x) | uint64_t(y) << 21 | uint64_t(z) << 42;
+    }
+
+    [[nodiscard]] size_t hash(uint64_t k) const {
+        return static_cast<size_t>(((k + 1) * 0x9e3779b97f4a7c15ull) >> 32) & mask_;
+    }
+
+    // Groups positions_ by cell, in the order cells are first met, and indexes the occupied ones
+    void bucket() {
+        // Open addressing, never past half full even with a cell per point
+        size_t size = 16;
+        while (size < 2 * positions_.size()) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        slots_.assign(size, UINT32_MAX);
+
+        cells_.clear();
+        cell_of_.resize(positions_.size());
+        for (size_t i = 0; i < positions_.size(); ++i) {
+            const auto& p = positions_[i];
+            int64_t x = cellIndex(p[0], 0), y = cellIndex(p[1], 1), z = cellIndex(p[2], 2);
+            size_t slot = hash(key(x, y, z));
+            while (slots_[slot] != UINT32_MAX) {
+                const Cell& cell = cells_[slots_[slot]];
+                if (cell.x == x && cell.y == y && cell.z == z) {
+                    break;
+                }
+                slot = (slot + 1) & mask_;
+            }
+            if (slots_[slot] == UINT32_MAX) {
+                slots_[slot] = static_cast<uint32_t>(cells_.size());
+                cells_.push_back({x, y, z, 0, 0});
+            }
+            cells_[slots_[slot]].last++;
+            cell_of_[i] = slots_[slot];
+        }
+
+        uint32_t first = 0;
+        for (Cell& cell : cells_) {
+            uint32_t count = cell.last;
+            cell.first = cell.last = first;
+            first += count;
+        }
+        scratch_.resize(positions_.size());
+        scratch_order_.resize(order_.size());
+        for (size_t i = 0; i < positions_.size(); ++i) {
+            uint32_t to = cells_[cell_of_[i]].last++;
+            scratch_[to] = positions_[i];
+            scratch_order_[to] = order_[i];
+        }
+        positions_.swap(scratch_);
+        order_.swap(scratch_order_);
+    }
+
+    // Index into cells_, UINT32_MAX if the cell is empty or off the grid
+    [[nodiscard]] uint32_t find(int64_t x, int64_t y, int64_t z) const {
+        if (x < 0 || y < 0 || z < 0 || x >= kMaxCells || y >= kMaxCells || z >= kMaxCells) {
+            return UINT32_MAX;
+        }
+        for (size_t slot = hash(key(x, y, z)); slots_[slot] != UINT32_MAX; slot = (slot + 1) & mask_) {
+            const Cell& cell = cells_[slots_[slot]];
+            if (cell.x == x && cell.y == y && cell.z == z) {
+                return slots_[slot];
+            }
+        }
+        return UINT32_MAX;
+    }
+
+    void closest(const Cell& cell, uint32_t i, float& best) const {
+        const auto& p = positions_[i];
+        for (uint32_t j = cell.first; j < cell.last && best > 0.0f; ++j) {
+            if (j != i) {
+                const auto& q = positions_[j];
+                float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+                best = std::min(best, dx * dx + dy * dy + dz * dz);
+            }
+        }
+    }
+
+    // The rest of the search for a point with nothing within a cell of it: shells of cells further
+    // out until one can't hold anything closer than @a best
+    [[nodiscard]] float farther(uint32_t i, float best) const {
+        const float v[3] = {positions_[i][0], positions_[i][1], positions_[i][2]};
+        int64_t c[3];
+        for (int a = 0; a < 3; ++a) {
+            c[a] = cellIndex(v[a], a);
+        }
+        for (int64_t r = 2;; ++r) {
+            float inside = float(r - 1) * cell_;
+            bool everywhere = r - 1 >= std::max(c[0], last_[0] - c[0]) && r - 1 >= std::max(c[1], last_[1] - c[1]) &&
+                              r - 1 >= std::max(c[2], last_[2] - c[2]);
+            if (best <= inside * inside || everywhere) {
+                return best;
+            }
+            // Past the occupied cells' count, walking shells costs more than checking every cell
+            if ((2 * r + 1) * (2 * r + 1) * (2 * r + 1) > int64_t(cells_.size())) {
+                for (const Cell& cell : cells_) {
+                    if (distanceSquared(cell, v) < best) {
+                        closest(cell, i, best);
+                    }
+                }
+                return best;
+            }
+            for (int64_t dz = -r; dz <= r; ++dz) {
+                for (int64_t dy = -r; dy <= r; ++dy) {
+                    bool face = dz == -r || dz == r || dy == -r || dy == r;
+                    for (int64_t dx = -r; dx <= r; dx += face ? 1 : 2 * r) {
+                        uint32_t found = find(c[0] + dx, c[1] + dy, c[2] + dz);
+                        if (found != UINT32_MAX) {
+                            closest(cells_[found], i, best);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // From @a v to the nearest point of @a cell's box
+    [[nodiscard]] float distanceSquared(const Cell& cell, const float* v) const {
+        const int64_t index[3] = {cell.x, cell.y, cell.z};
+        float sum = 0.0f;
+        for (int a = 0; a < 3; ++a) {
+            float lo = origin_[a] + float(index[a]) * cell_;
+            float gap = std::max(std::max(lo - v[a], v[a] - (lo + cell_)), 0.0f);
+            sum += gap * gap;
+        }
+        return sum;
+    }
+
+    float origin_[3] = {};
+    float cell_ = 1.0f;
+    float inverse_ = 1.0f;
+    int64_t last_[3] = {};  // Cell holding the far corner
+    std::vector<std::array<float, 3>> positions_;  // Finite points, by cell once built
+    std::vector<uint32_t> order_;  // Where each of positions_ is in the chunk
+    std::vector<std::array<float, 3>> scratch_;
+    std::vector<uint32_t> scratch_order_;
+    std::vector<uint32_t> cell_of_;
+    std::vector<Cell> cells_;  // Occupied
+    std::vector<uint32_t> slots_;
+    size_t mask_ = 0;
+};
+
+// Points per chunk measured for the spacing histogram, each counting for the ones skipped. Their
+// neighbours are searched among all of the chunk's points.
+constexpr uint32_t kSpacingSamples = 1024;
+
+static PcdChunkScan scanChunk(const Point* points, const ChunkMetadata& chunk, const PcdBrick* bricks,
+                              uint32_t bricks_per_chunk, const uint32_t* crc, NeighborGrid& grid,
+                              Log2Histogram& spacing) {
+    PcdChunkScan scan;
+    const BoundingBox& box = chunk.bbox;
+    for (uint32_t i = 0; i < chunk.point_count; ++i) {
+        const Point& p = points[i];
+        scan.outside += !box.contains(p.x, p.y, p.z);
+        scan.tight.expand(p.x, p.y, p.z);
+    }
+
+    grid.build(points, chunk.point_count);
+    uint32_t stride = std::max<uint32_t>(chunk.point_count / kSpacingSamples, 1);
+    grid.forEachNearest(stride, [&](float squared) { spacing.add(log2Distance(squared), stride); });
+
+    // readPcdIndex already checked that the bricks tile the payload
+    for (uint32_t b = 0; bricks != nullptr && b < bricks_per_chunk; ++b) {
+        const PcdBrick& brick = bricks[b];
+        for (uint32_t i = brick.first_point; i < brick.first_point + brick.point_count; ++i) {
+            scan.brick_outside += !brick.bbox.contains(points[i].x, points[i].y, points[i].z);
+        }
+    }
+
+    scan.crc_mismatch = crc != nullptr && crc32c(points, chunk.point_count * sizeof(Point)) != *crc;
+
+    double stored = volume(box);
+    if (stored > 0.0) {
+        scan.tightness = static_cast<float>(volume(scan.tight) / stored);
+    }
+    return scan;
+}
+
+namespace {
+
+// Bytes something live in the file refers to
+struct ByteRange {
+    uint64_t begin;
+    uint64_t end;
+    uint32_t owner;  // Chunk id, or kIndexOwner
+};
+
+constexpr uint32_t kIndexOwner = UINT32_MAX;
+
+std::string describe(uint32_t owner) {
+    return owner == kIndexOwner ? "the index" : "chunk " + std::to_string(owner);
+}
+
+void addProblem(PcdScanReport& report, const std::string& problem) {
+    if (report.problems.size() < PcdScanReport::kMaxProblems) {
+        report.problems.push_back(problem);
+    }
+}
+
+void addGap(PcdScanReport& report, uint64_t bytes) {
+    report.gaps++;
+    report.gap_bytes += bytes;
+    report.largest_gap = std::max(report.largest_gap, bytes);
+}
+
+}  // namespace
+
+static void checkRanges(const FileHeader& first, const PcdIndex& index, PcdScanReport& report) {
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
+    auto indexBytes = [&](uint64_t count) {
+        return count * sizeof(ChunkMetadata) +
+               pcdIndexTableBytes(headerFlags(index.header), count, index.bricks_per_chunk);
+    };
+
+    // The header and the index as first written, then the current one if appends replaced it
+    std::vector<ByteRange> ranges;
+    uint64_t first_end = sizeof(FileHeader) + indexBytes(first.chunk_count);
+    if (headerFlags(first) & PCD_FLAG_INDEX_POINTER) {
+        first_end += sizeof(PcdIndexPointer);
+    }
+    if (headerFlags(first) & PCD_FLAG_POINTER_SLOTS) {
+        first_end = pcdPointerSlotsOffset(headerFlags(first), first.chunk_count, index.bricks_per_chunk) +
+                    2 * PCD_POINTER_SLOT_SIZE;
+    }
+    ranges.push_back({0, first_end, kIndexOwner});
+    if (index.generation > 0) {
+        ranges.push_back({index.index_offset, index.index_offset + indexBytes(chunks.size()), kIndexOwner});
+    }
+
+    uint64_t total_points = 0;
+    for (uint32_t i = 0; i < chunks.size(); ++i) {
+        const ChunkMetadata& chunk = chunks[i];
+        total_points += chunk.point_count;
+        uint64_t payload_end = chunk.file_offset + uint64_t(chunk.point_count) * sizeof(Point);
+        if (payload_end > report.file_size) {
+            report.past_end++;
+            addProblem(report, describe(i) + " ends at byte " + std::to_string(payload_end) +
+                               ", past the end of the file");
+            continue;
+        }
+        if (chunk.point_count > 0) {
+            uint64_t end = payload_end + payloadPadding(index.header, chunk);
+            ranges.push_back({chunk.file_offset, std::min(end, report.file_size), i});
+        }
+    }
+
+    report.total_points_match = total_points == index.header.total_points;
+    if (!report.total_points_match) {
+        addProblem(report, "Chunks hold " + std::to_string(total_points) + " points, the header says " +
+                           std::to_string(index.header.total_points));
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange& a, const ByteRange& b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end < b.end;
+    });
+
+    uint64_t covered = 0;
+    uint32_t covered_by = kIndexOwner;
+    for (const ByteRange& range : ranges) {
+        if (range.begin < covered) {
+            report.overlaps++;
+            addProblem(report, describe(range.owner) + " overlaps " + describe(covered_by) +
+                               " at byte " + std::to_string(range.begin));
+        } else if (range.begin > covered) {
+            addGap(report, range.begin - covered);
+        }
+        if (range.end > covered) {
+            covered = range.end;
+            covered_by = range.owner;
+        }
+    }
+    if (report.file_size > covered) {
+        addGap(report, report.file_size - covered);
+    }
+}
+
+bool scanPcd(const std::string& path, const PcdIndex& index, JobSystem* jobs, PcdScanReport& report,
+             std::string* error) {
+    report = PcdScanReport{};
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return setError(error, "Failed to open file: " + path);
+    }
+    report.file_size = static_cast<uint64_t>(in.tellg());
+
+    // As first written; index.header describes the current index
+    FileHeader first{};
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(&first), sizeof(first))) {
+        return setError(error, "File is too short for a header");
+    }
+    if (first.version < 2) {
+        first.flags = 0;
+    }
+
+    checkRanges(first, index, report);
+
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
+    auto readable = [&](const ChunkMetadata& chunk) {
+        return chunk.point_count > 0 &&
+               chunk.file_offset + uint64_t(chunk.point_count) * sizeof(Point) <= report.file_size;
+    };
+
+#ifdef PCDSCAN_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return setError(error, "Failed to open file: " + path);
+    }
+    void* map = mmap(nullptr, report.file_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        return setError(error, "Failed to map " + path);
+    }
+    const char* base = static_cast<const char*>(map);
+    auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    // Each worker walks its share of the chunks in index order, which is file order unless
+    // pcd_layout moved them, so the kernel's readahead gets ahead of it
+    madvise(map, report.file_size, MADV_SEQUENTIAL);
+#endif
+
+    report.chunks.assign(chunks.size(), {});
+    std::mutex merge_mutex;
+
+    auto scanChunks = [&](size_t first_chunk, size_t last_chunk) {
+        Log2Histogram density, spacing;
+        NeighborGrid grid;
+        uint64_t points = 0, outside = 0, brick_outside = 0;
+        uint32_t chunks_outside = 0, loose = 0, flat = 0, crc_mismatches = 0;
+        std::vector<std::string> problems;  // Capped at kMaxProblems like the report's
+        auto problem = [&](const std::string& text) {
+            if (problems.size() < PcdScanReport::kMaxProblems) {
+                problems.push_back(text);
+            }
+        };
+#ifndef PCDSCAN_HAS_MMAP
+        std::ifstream file(path, std::ios::binary);
+        std::vector<Point> scratch;
+#endif
+
+        for (size_t i = first_chunk; i < last_chunk; ++i) {
+            const ChunkMetadata& chunk = chunks[i];
+            if (!readable(chunk)) {
+                continue;
+            }
+
+#ifdef PCDSCAN_HAS_MMAP
+            // Have the next payload on its way while this one is checked
+            for (size_t next = i + 1; next < last_chunk; ++next) {
+                if (readable(chunks[next])) {
+                    auto begin = reinterpret_cast<uintptr_t>(base + chunks[next].file_offset) & ~(page - 1);
+                    auto end = reinterpret_cast<uintptr_t>(base + chunks[next].file_offset +
+                                                           chunks[next].point_count * sizeof(Point));
+                    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+                    break;
+                }
+            }
+            const auto* payload = reinterpret_cast<const Point*>(base + chunk.file_offset);
+#else
+            scratch.resize(chunk.point_count);
+            file.seekg(static_cast<std::streamoff>(chunk.file_offset));
+            if (!file.read(reinterpret_cast<char*>(scratch.data()),
+                           static_cast<std::streamsize>(chunk.point_count * sizeof(Point)))) {
+                file.clear();
+                problem("Failed to read " + describe(static_cast<uint32_t>(i)));
+                continue;
+            }
+            const Point* payload = scratch.data();
+#endif
+
+            PcdChunkScan& scan = report.chunks[i];
+            scan = scanChunk(payload, chunk, index.chunkBricks(static_cast<uint32_t>(i)),
+                             index.bricks_per_chunk, index.chunk_crcs.empty() ? nullptr : &index.chunk_crcs[i],
+                             grid, spacing);
+            points += chunk.point_count;
+
+            if (scan.crc_mismatch) {
+                crc_mismatches++;
+                problem(describe(static_cast<uint32_t>(i)) + " doesn't match its CRC");
+            }
+            if (scan.outside > 0) {
+                outside += scan.outside;
+                chunks_outside++;
+                problem(describe(static_cast<uint32_t>(i)) + " has " + std::to_string(scan.outside) +
+                        " points outside its bbox");
+            }
+            if (scan.brick_outside > 0) {
+                brick_outside += scan.brick_outside;
+                problem(describe(static_cast<uint32_t>(i)) + " has " + std::to_string(scan.brick_outside) +
+                        " points outside their brick's bbox");
+            }
+            const BoundingBox& box = chunk.bbox;
+            loose += scan.tight.min_x > box.min_x || scan.tight.min_y > box.min_y ||
+                     scan.tight.min_z > box.min_z || scan.tight.max_x < box.max_x ||
+                     scan.tight.max_y < box.max_y || scan.tight.max_z < box.max_z;
+
+            double tight_volume = volume(scan.tight);
+            if (tight_volume > 0.0) {
+                density.add(std::ilogb(double(chunk.point_count) / tight_volume));
+            } else {
+                flat++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        report.density.merge(density);
+        report.spacing.merge(spacing);
+        report.points_scanned += points;
+        report.bytes_scanned += points * sizeof(Point);
+        report.points_outside += outside;
+        report.chunks_outside += chunks_outside;
+        report.brick_points_outside += brick_outside;
+        report.loose_chunks += loose;
+        report.flat_chunks += flat;
+        report.crc_mismatches += crc_mismatches;
+        for (const auto& text : problems) {
+            addProblem(report, text);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (jobs != nullptr) {
+        report.threads = jobs->concurrency();
+        jobs->parallelFor(0, chunks.size(), 1, scanChunks);
+    } else {
+        scanChunks(0, chunks.size());
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef PCDSCAN_HAS_MMAP
+    munmap(map, report.file_size);
+#endif
+    return true;
+}
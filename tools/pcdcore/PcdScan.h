@@ -0,0 +1,95 @@
+#ifndef PCDSCAN_H
+#define PCDSCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+
+class JobSystem;
+
+// Counts of values by power of two: bucket b holds [2^(kMinExp + b), 2^(kMinExp + b + 1)).
+// Values below the first bucket land in it, values above the last in the last.
+struct Log2Histogram {
+    static constexpr int kMinExp = -20;
+    static constexpr int kBuckets = 48;
+
+    uint64_t counts[kBuckets] = {};
+
+    void add(int exponent, uint64_t n = 1);
+
+    void merge(const Log2Histogram& other);
+
+    [[nodiscard]] uint64_t total() const;
+
+    // Lower edge of the bucket holding the value at @a fraction of the total, 0 if empty
+    [[nodiscard]] double quantile(double fraction) const;
+
+    [[nodiscard]] static double bucketLow(int bucket);
+};
+
+// What the scan found in one chunk's payload
+struct PcdChunkScan {
+    BoundingBox tight = BoundingBox::empty();  // Of its points
+    uint32_t outside = 0;        // Points outside the stored bbox, NaNs included
+    uint32_t brick_outside = 0;  // Points outside their brick's bbox
+    float tightness = 1.0f;      // Volume of the tight box over the stored one's; 1 if flat
+    bool crc_mismatch = false;   // Payload doesn't match its CRC (PCD_FLAG_CHUNK_CRCS)
+};
+
+struct PcdScanReport {
+    uint64_t file_size = 0;
+    uint64_t bytes_scanned = 0;  // Payload bytes
+    uint64_t points_scanned = 0;
+    double seconds = 0.0;
+    uint32_t threads = 1;
+
+    // Payload byte ranges, checked against each other, the live index structures and the file
+    uint32_t overlaps = 0;       // Ranges sharing bytes
+    uint32_t past_end = 0;       // Payloads running past the end of the file
+    uint32_t gaps = 0;           // Runs of bytes nothing live refers to: reserved index space,
+    uint64_t gap_bytes = 0;      // indexes replaced by appends, alignment before a payload
+    uint64_t largest_gap = 0;
+    bool total_points_match = true;  // Chunk point counts add up to the header's total
+
+    // Points
+    uint64_t points_outside = 0;
+    uint32_t chunks_outside = 0;
+    uint64_t brick_points_outside = 0;
+    uint32_t loose_chunks = 0;   // Stored bbox bigger than its points' in any direction
+    uint32_t crc_mismatches = 0;
+
+    std::vector<PcdChunkScan> chunks;  // In index order
+
+    Log2Histogram density;  // Chunks by points per unit^3 of their tight box
+    Log2Histogram spacing;  // Points by distance to their nearest neighbour in the chunk
+    uint32_t flat_chunks = 0;  // Tight box with no volume, left out of density
+
+    std::vector<std::string> problems;  // The first kMaxProblems, in words
+
+    static constexpr size_t kMaxProblems = 20;
+
+    [[nodiscard]] bool ok() const {
+        return overlaps == 0 && past_end == 0 && total_points_match && points_outside == 0 &&
+               brick_points_outside == 0 && crc_mismatches == 0;
+    }
+};
+
+/*!
+ * Reads every chunk payload of a .pcd and checks it against the index. The file is mapped (read
+ * into memory where mmap isn't available) and chunks are scanned in parallel on @a jobs.
+ *
+ * Spacing measures points against their nearest neighbour, found on a grid of the chunk's points,
+ * so it doesn't depend on the order they're stored in. Up to a thousand points a chunk are
+ * measured, each counting for its share. Neighbours in other chunks aren't seen, which only
+ * stretches the spacing of points along chunk faces.
+ * @param jobs nullptr scans on the calling thread
+ * @return false if the file can't be read; problems with its contents are in @a report
+ */
+bool scanPcd(const std::string& path, const PcdIndex& index, JobSystem* jobs, PcdScanReport& report,
+             std::string* error = nullptr);
+
+#endif //PCDSCAN_H
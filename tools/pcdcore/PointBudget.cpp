@@ -0,0 +1,66 @@
+#include "PointBudget.h"
+
+#include <algorithm>
+#include <cmath>
+
+PointBudgetScheduler::PointBudgetScheduler(const PointBudgetOptions& options) : options_(options) {}
+
+// Distance from the eye to the nearest point of the box; 0 inside it
+static float distanceToBox(const BoundingBox& box, const float eye[3]) {
+    float dx = std::max({box.min_x - eye[0], eye[0] - box.max_x, 0.0f});
+    float dy = std::max({box.min_y - eye[1], eye[1] - box.max_y, 0.0f});
+    float dz = std::max({box.min_z - eye[2], eye[2] - box.max_z, 0.0f});
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+const std::vector<BudgetAllocation>& PointBudgetScheduler::schedule(
+        const std::vector<BudgetCandidate>& candidates, const float eye[3]) {
+    allocations_.resize(candidates.size());
+    wanted_.resize(candidates.size());
+
+    for (uint32_t i = 0; i < candidates.size(); ++i) {
+        const BoundingBox& b = candidates[i].bounds;
+        float dx = b.max_x - b.min_x, dy = b.max_y - b.min_y, dz = b.max_z - b.min_z;
+        float diagonal = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        // Measured to the nearest point, so a chunk the eye is in or at covers the whole screen
+        float distance = std::max(distanceToBox(b, eye), 1e-3f);
+        allocations_[i] = {i, diagonal * options_.focal_length_px / distance, 0};
+    }
+
+    // Largest on screen first; ties go to the candidate listed first, so the order is stable
+    std::sort(allocations_.begin(), allocations_.end(),
+              [](const BudgetAllocation& a, const BudgetAllocation& b) {
+                  return a.screen_size != b.screen_size ? a.screen_size > b.screen_size
+                                                        : a.candidate < b.candidate;
+              });
+
+    requested_points_ = 0;
+    size_t kept = std::min<size_t>(allocations_.size(), options_.max_chunks);
+    for (size_t i = 0; i < kept; ++i) {
+        const BudgetAllocation& a = allocations_[i];
+        double area = double(a.screen_size) * a.screen_size;
+        double fits = area / std::max(options_.pixels_per_point, 1e-3f);
+        wanted_[i] = static_cast<uint32_t>(std::min<double>(candidates[a.candidate].point_count, fits));
+        requested_points_ += wanted_[i];
+    }
+
+    // One scale for everyone keeps density even across the screen
+    double scale = requested_points_ > options_.budget
+                   ? double(options_.budget) / double(requested_points_) : 1.0;
+
+    scheduled_points_ = 0;
+    scheduled_chunks_ = 0;
+    for (size_t i = 0; i < kept; ++i) {
+        auto points = static_cast<uint32_t>(double(wanted_[i]) * scale);
+        uint32_t floor = std::min(options_.min_chunk_points, candidates[allocations_[i].candidate].point_count);
+        if (points < floor || points == 0) {
+            continue;
+        }
+        allocations_[i].draw_points = points;
+        scheduled_points_ += points;
+        scheduled_chunks_++;
+    }
+
+    return allocations_;
+}
@@ -0,0 +1,87 @@
+#ifndef POINTBUDGET_H
+#define POINTBUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PointCloudData.h"
+
+struct PointBudgetOptions {
+    // Points drawn per frame, across all chunks
+    uint64_t budget = 2000000;
+
+    // Screen height / (2 * tan(fovy / 2)), to turn world sizes into pixels
+    float focal_length_px = 1000.0f;
+
+    // Screen area one point is worth. A chunk never asks for more points than its projected
+    // area holds at this density; more would land on pixels already covered.
+    float pixels_per_point = 1.0f;
+
+    // Chunks that would be cut below this many points are dropped instead
+    uint32_t min_chunk_points = 256;
+
+    // Chunks that can be streamed at once (render box slots, cache slots)
+    uint32_t max_chunks = UINT32_MAX;
+};
+
+// A chunk that could be drawn this frame
+struct BudgetCandidate {
+    BoundingBox bounds;
+    uint32_t point_count;
+};
+
+struct BudgetAllocation {
+    uint32_t candidate;    // Index into the candidates passed to schedule()
+    float screen_size;     // Projected size of the chunk's bounds in pixels
+    uint32_t draw_points;  // Points to draw, 0 if the chunk didn't make the cut
+};
+
+/*!
+ * Splits a per-frame point budget across candidate chunks by screen-space error. Chunks are
+ * ranked by the size their bounds project to, so near and large chunks come first. Each asks for
+ * as many points as its projected area can show, and when the asks add up to more than the
+ * budget every chunk is scaled down by the same factor, which keeps point density on screen even.
+ * Chunks that end up too thin, or past max_chunks, aren't streamed at all.
+ *
+ * ex:
+ *  PointBudgetScheduler scheduler(options);
+ *  for (const auto& a : scheduler.schedule(candidates, eye)) {
+ *      if (a.draw_points > 0) draw(a.candidate, a.draw_points);
+ *  }
+ */
+class PointBudgetScheduler {
+public:
+    explicit PointBudgetScheduler(const PointBudgetOptions& options = {});
+
+    /*!
+     * Ranks @a candidates as seen from @a eye and splits the budget between them.
+     * @return one allocation per candidate, highest screen size first; valid until the next call
+     */
+    const std::vector<BudgetAllocation>& schedule(const std::vector<BudgetCandidate>& candidates,
+                                                  const float eye[3]);
+
+    void setBudget(uint64_t budget) { options_.budget = budget; }
+
+    void setFocalLength(float focal_length_px) { options_.focal_length_px = focal_length_px; }
+
+    [[nodiscard]] const PointBudgetOptions& options() const { return options_; }
+
+    // From the last schedule(): points all candidates asked for, points handed out, chunks kept
+    [[nodiscard]] uint64_t requestedPoints() const { return requested_points_; }
+
+    [[nodiscard]] uint64_t scheduledPoints() const { return scheduled_points_; }
+
+    [[nodiscard]] uint32_t scheduledChunks() const { return scheduled_chunks_; }
+
+private:
+    PointBudgetOptions options_;
+    std::vector<BudgetAllocation> allocations_;
+    std::vector<uint32_t> wanted_;
+
+    uint64_t requested_points_ = 0;
+    uint64_t scheduled_points_ = 0;
+    uint32_t scheduled_chunks_ = 0;
+};
+
+#endif //POINTBUDGET_H
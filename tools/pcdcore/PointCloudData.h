@@ -0,0 +1,185 @@
+#ifndef POINTCLOUDDATA_H
+#define POINTCLOUDDATA_H
+
+#include <cstdint>
+#include <limits>
+
+struct Point {
+    float x, y, z;
+    uint8_t r, g, b;
+    uint8_t padding;
+};
+
+struct BoundingBox {
+    float min_x, min_y, min_z;
+    float max_x, max_y, max_z;
+    
+    [[nodiscard]] inline bool contains(float x, float y, float z) const {
+        return x >= min_x && x <= max_x &&
+               y >= min_y && y <= max_y &&
+               z >= min_z && z <= max_z;
+    }
+    
+    [[nodiscard]] inline float size() const {
+        float dx = max_x - min_x;
+        float dy = max_y - min_y;
+        float dz = max_z - min_z;
+        return dx > dy ? (dx > dz ? dx : dz) : (dy > dz ? dy : dz);
+    }
+    
+    [[nodiscard]] inline float maxDimension() const {
+        float dx = max_x - min_x;
+        float dy = max_y - min_y;
+        float dz = max_z - min_z;
+        return dx > dy ? (dx > dz ? dx : dz) : (dy > dz ? dy : dz);
+    }
+    
+    inline void getCenter(float& cx, float& cy, float& cz) const {
+        cx = (min_x + max_x) * 0.5f;
+        cy = (min_y + max_y) * 0.5f;
+        cz = (min_z + max_z) * 0.5f;
+    }
+    
+    // Inverted box that any expand() call overwrites
+    [[nodiscard]] static inline BoundingBox empty() {
+        return {
+            std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::lowest(),
+            std::numeric_limits<float>::lowest(),
+            std::numeric_limits<float>::lowest()
+        };
+    }
+    
+    inline void expand(float x, float y, float z) {
+        min_x = x < min_x ? x : min_x;
+        min_y = y < min_y ? y : min_y;
+        min_z = z < min_z ? z : min_z;
+        max_x = x > max_x ? x : max_x;
+        max_y = y > max_y ? y : max_y;
+        max_z = z > max_z ? z : max_z;
+    }
+    
+    inline void expand(const BoundingBox& other) {
+        expand(other.min_x, other.min_y, other.min_z);
+        expand(other.max_x, other.max_y, other.max_z);
+    }
+};
+
+// Version 2 keeps the version 1 layout but gives meaning to the two 4-byte alignment holes:
+// FileHeader::flags and ChunkMetadata::payload_padding. Version 1 writers left those bytes
+// uninitialized, so they must be ignored for version 1 files (see headerFlags/payloadPadding).
+constexpr uint32_t PCD_VERSION = 2;
+
+// Every chunk payload starts on a PCD_PAYLOAD_ALIGNMENT boundary and is zero padded up to the
+// next one, so each chunk is a whole number of pages (O_DIRECT reads, per-chunk madvise)
+constexpr uint32_t PCD_FLAG_ALIGNED_PAYLOADS = 1u << 0;
+
+constexpr uint32_t PCD_PAYLOAD_ALIGNMENT = 4096;
+
+// A PcdIndexPointer follows the index. Chunks can then be appended in place: each commit writes
+// the new payloads and a whole new index at the end of the file, then rewrites the pointer to
+// name it. The header and the index after it keep describing the file as first written, so
+// readers that don't know the flag still open it, without the appended chunks.
+constexpr uint32_t PCD_FLAG_INDEX_POINTER = 1u << 1;
+
+constexpr char PCD_INDEX_POINTER_MAGIC[8] = "PCDIDX1";
+
+// The current index of a file with PCD_FLAG_INDEX_POINTER; it sits right after the header's
+// chunk_count index entries, and at the start of each pointer slot (PCD_FLAG_POINTER_SLOTS).
+struct PcdIndexPointer {
+    char magic[8];           // "PCDIDX1\0"
+    uint64_t generation;     // 0 for the index after the header, one more per commit
+    uint64_t index_offset;   // Where the current index's entries start
+    uint64_t total_points;
+    BoundingBox bounds;
+    uint32_t chunk_count;
+    uint32_t checksum;       // pcdIndexChecksum() of the entries and the fields above
+};
+
+// Two PCD_POINTER_SLOT_SIZE slots for the pointers of appended indexes, starting at the first
+// slot boundary after the tables of the index after the header (pcdPointerSlotsOffset()). The
+// pointer after the header's index then always names generation 0 and is never rewritten.
+// Commit n writes slot n % 2, over the older of the two, so the current pointer is never written
+// over, and a slot is a whole storage sector: a crash can only tear the pointer being replaced,
+// which then fails its checksum. Readers take the valid slot with the highest generation, and
+// generation 0 when neither is. Requires PCD_FLAG_INDEX_POINTER.
+constexpr uint32_t PCD_FLAG_POINTER_SLOTS = 1u << 4;
+
+constexpr uint32_t PCD_POINTER_SLOT_SIZE = 4096;
+
+// A brick table follows each index, splitting every chunk into bricks_per_chunk spatial bricks
+// (8 or 64: the cells of a 2x2x2 or 4x4x4 grid over the chunk's bounding box). A chunk's points
+// are grouped by brick in the payload, so any run of consecutive bricks is one contiguous byte
+// range: a reader can cull bricks out of a draw, or read only the bricks a view needs. Requires
+// PCD_FLAG_INDEX_POINTER. The table of the index after the header starts right after the index
+// pointer; an appended index's table starts right after its entries.
+constexpr uint32_t PCD_FLAG_BRICKS = 1u << 2;
+
+constexpr char PCD_BRICK_TABLE_MAGIC[8] = "PCDBRK1";
+
+// Followed by bricks_per_chunk PcdBricks for each index entry, in entry order
+struct PcdBrickTable {
+    char magic[8];              // "PCDBRK1\0"
+    uint32_t bricks_per_chunk;
+    uint32_t checksum;          // pcdBrickChecksum() of the bricks
+};
+
+struct PcdBrick {
+    BoundingBox bbox;      // Of its points; BoundingBox::empty() if it has none
+    uint32_t first_point;  // Within the chunk's payload
+    uint32_t point_count;
+};
+
+// A CRC table follows each index, after its brick table if there is one: the CRC32C of every
+// chunk's payload bytes, padding excluded. Storage that hands back a corrupted read is caught
+// before the points reach the screen. Requires PCD_FLAG_INDEX_POINTER.
+constexpr uint32_t PCD_FLAG_CHUNK_CRCS = 1u << 3;
+
+constexpr char PCD_CRC_TABLE_MAGIC[8] = "PCDCRC1";
+
+// Followed by a uint32_t CRC32C for each index entry, in entry order
+struct PcdCrcTable {
+    char magic[8];         // "PCDCRC1\0"
+    uint32_t chunk_count;  // Entries covered, the index's chunk count
+    uint32_t checksum;     // pcdCrcTableChecksum() of the CRCs
+};
+
+struct ChunkMetadata {
+    BoundingBox bbox;
+    uint32_t point_count;
+    uint32_t payload_padding;  // Zero bytes after the payload (version 2+)
+    uint64_t file_offset;
+};
+
+struct FileHeader {
+    char magic[8];          // "PCLOUD1\0"
+    uint32_t version;       // Format version
+    BoundingBox bounds;     // Overall bounds
+    uint32_t flags;         // PCD_FLAG_* bits (version 2+)
+    uint64_t total_points;  // Total number of points
+    uint32_t chunk_count;   // Number of chunks
+    uint32_t chunk_size;    // Target points per chunk
+};
+
+static_assert(sizeof(ChunkMetadata) == 40, "ChunkMetadata layout must match version 1");
+static_assert(sizeof(FileHeader) == 56, "FileHeader layout must match version 1");
+static_assert(sizeof(PcdIndexPointer) == 64, "PcdIndexPointer layout is part of the format");
+static_assert(sizeof(PcdBrickTable) == 16, "PcdBrickTable layout is part of the format");
+static_assert(sizeof(PcdBrick) == 32, "PcdBrick layout is part of the format");
+static_assert(sizeof(PcdCrcTable) == 16, "PcdCrcTable layout is part of the format");
+
+[[nodiscard]] inline uint32_t headerFlags(const FileHeader& header) {
+    return header.version >= 2 ? header.flags : 0;
+}
+
+[[nodiscard]] inline uint32_t payloadPadding(const FileHeader& header, const ChunkMetadata& chunk) {
+    return header.version >= 2 ? chunk.payload_padding : 0;
+}
+
+[[nodiscard]] inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+#endif //POINTCLOUDDATA_H
@@ -0,0 +1,289 @@
+#include "PointDecimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+
+#include "Morton.h"
+
+// Index of the grid cell holding @a v along one axis, clamped to the grid. The same arithmetic
+// for every call, so chunks agree on where voxels start.
+static inline uint32_t gridIndex(float v, float origin, float inverse_spacing) {
+    float f = (v - origin) * inverse_spacing;
+    return static_cast<uint32_t>(std::min(std::max(f, 0.0f), float(kDecimationGridCells - 1)));
+}
+
+// Morton code of a cell of the 2^21 grid: three mortonSpreadBits() runs of up to 10 bits each
+static inline uint64_t voxelCode(uint32_t x, uint32_t y, uint32_t z) {
+    auto spread = [](uint32_t a, uint32_t b, uint32_t c) {
+        return uint64_t(mortonSpreadBits(a) | (mortonSpreadBits(b) << 1) | (mortonSpreadBits(c) << 2));
+    };
+    return spread(x >> 20, y >> 20, z >> 20) << 60 | spread(x >> 10, y >> 10, z >> 10) << 30 | spread(x, y, z);
+}
+
+static inline bool finite(const Point& p) {
+    return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+}
+
+static inline uint8_t average(uint64_t sum, uint64_t count) {
+    return static_cast<uint8_t>((sum + count / 2) / count);
+}
+
+static size_t voxelDecimate(const Point* points, size_t count, const DecimationOptions& options,
+                            std::vector<Point>& out) {
+    const float inverse = 1.0f / options.spacing;
+    std::vector<std::pair<uint64_t, uint32_t>> cells;
+    cells.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Point& p = points[i];
+        if (finite(p)) {
+            cells.emplace_back(voxelCode(gridIndex(p.x, options.origin[0], inverse),
+                                         gridIndex(p.y, options.origin[1], inverse),
+                                         gridIndex(p.z, options.origin[2], inverse)),
+                               static_cast<uint32_t>(i));
+        }
+    }
+    // By cell, then by position in the chunk, so the result doesn't depend on the sort
+    std::sort(cells.begin(), cells.end());
+
+    size_t before = out.size();
+    for (size_t first = 0; first < cells.size();) {
+        size_t last = first + 1;
+        while (last < cells.size() && cells[last].first == cells[first].first) {
+            ++last;
+        }
+
+        double x = 0.0, y = 0.0, z = 0.0;
+        uint64_t r = 0, g = 0, b = 0;
+        for (size_t k = first; k < last; ++k) {
+            const Point& p = points[cells[k].second];
+            x += p.x;
+            y += p.y;
+            z += p.z;
+            r += p.r;
+            g += p.g;
+            b += p.b;
+        }
+        auto n = static_cast<uint64_t>(last - first);
+        Point centroid{};
+        centroid.x = static_cast<float>(x / double(n));
+        centroid.y = static_cast<float>(y / double(n));
+        centroid.z = static_cast<float>(z / double(n));
+        centroid.r = average(r, n);
+        centroid.g = average(g, n);
+        centroid.b = average(b, n);
+        out.push_back(centroid);
+        first = last;
+    }
+    return out.size() - before;
+}
+
+void countVoxels(const Point* points, size_t count, const DecimationOptions& options, int levels,
+                 uint64_t* counts) {
+    const float inverse = 1.0f / options.spacing;
+    std::vector<uint64_t> codes;
+    codes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Point& p = points[i];
+        if (finite(p)) {
+            codes.push_back(voxelCode(gridIndex(p.x, options.origin[0], inverse),
+                                      gridIndex(p.y, options.origin[1], inverse),
+                                      gridIndex(p.z, options.origin[2], inverse)));
+        }
+    }
+    if (codes.empty()) {
+        return;
+    }
+    std::sort(codes.begin(), codes.end());
+
+    // Neighbouring codes are in different voxels at every level below their highest differing
+    // bit's: count each pair once at that level, then sum downwards
+    uint64_t first_at[21] = {};
+    for (size_t i = 1; i < codes.size(); ++i) {
+        uint64_t differ = codes[i] ^ codes[i - 1];
+        if (differ != 0) {
+            int level = 0;
+            while (level < 20 && (differ >> (3 * (level + 1))) != 0) {
+                ++level;
+            }
+            first_at[level]++;
+        }
+    }
+    uint64_t distinct = 1;
+    for (int level = 20; level >= 0; --level) {
+        distinct += first_at[level];
+        if (level < levels) {
+            counts[level] += distinct;
+        }
+    }
+}
+
+// Cells of side spacing, each holding a chain of the samples in it. Open addressing; the table
+// never fills past half.
+class SampleGrid {
+public:
+    explicit SampleGrid(size_t max_samples) {
+        size_t size = 16;
+        while (size < 2 * max_samples) {
+            size *= 2;
+        }
+        keys_.assign(size, 0);
+        heads_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // First sample in the cell, UINT32_MAX if none
+    [[nodiscard]] uint32_t find(uint64_t key) const {
+        for (size_t slot = hash(key);; slot = (slot + 1) & mask_) {
+            if (keys_[slot] == key) {
+                return heads_[slot];
+            }
+            if (keys_[slot] == 0) {
+                return UINT32_MAX;
+            }
+        }
+    }
+
+    // Makes @a sample the cell's first; returns the one it displaced, UINT32_MAX if none
+    uint32_t push(uint64_t key, uint32_t sample) {
+        size_t slot = hash(key);
+        while (keys_[slot] != 0 && keys_[slot] != key) {
+            slot = (slot + 1) & mask_;
+        }
+        uint32_t previous = keys_[slot] == key ? heads_[slot] : UINT32_MAX;
+        keys_[slot] = key;
+        heads_[slot] = sample;
+        return previous;
+    }
+
+private:
+    [[nodiscard]] size_t hash(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & mask_;
+    }
+
+    std::vector<uint64_t> keys_;  // Cell key + 1, so 0 is free
+    std::vector<uint32_t> heads_;
+    size_t mask_ = 0;
+};
+
+static size_t poissonDecimate(const Point* points, size_t count, const DecimationOptions& options,
+                              uint64_t seed, std::vector<Point>& out) {
+    // Dart throwing in a random order; a sample can only conflict with one in its own cell or
+    // the 26 around it. Most rejections hit the point's own cell, so it's checked first.
+    static const int kNeighbors[27][3] = {
+            {0, 0, 0},
+            {-1, -1, -1}, {0, -1, -1}, {1, -1, -1}, {-1, 0, -1}, {0, 0, -1}, {1, 0, -1},
+            {-1, 1, -1}, {0, 1, -1}, {1, 1, -1}, {-1, -1, 0}, {0, -1, 0}, {1, -1, 0},
+            {-1, 0, 0}, {1, 0, 0}, {-1, 1, 0}, {0, 1, 0}, {1, 1, 0},
+            {-1, -1, 1}, {0, -1, 1}, {1, -1, 1}, {-1, 0, 1}, {0, 0, 1}, {1, 0, 1},
+            {-1, 1, 1}, {0, 1, 1}, {1, 1, 1}};
+    const float inverse = 1.0f / options.spacing;
+    const float min_distance_squared = options.spacing * options.spacing;
+    const int64_t top = kDecimationGridCells - 1;
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (finite(points[i])) {
+            order.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    std::mt19937_64 random(options.seed ^ (seed * 0x9e3779b97f4a7c15ull));
+    std::shuffle(order.begin(), order.end(), random);
+
+    struct Sample {
+        uint32_t point;
+        uint32_t next;  // In the same cell
+        uint32_t r, g, b, covered;
+    };
+    std::vector<Sample> samples;
+    SampleGrid grid(order.size());
+
+    for (uint32_t i : order) {
+        const Point& p = points[i];
+        int64_t cx = gridIndex(p.x, options.origin[0], inverse);
+        int64_t cy = gridIndex(p.y, options.origin[1], inverse);
+        int64_t cz = gridIndex(p.z, options.origin[2], inverse);
+
+        uint32_t conflict = UINT32_MAX;
+        for (const auto& d : kNeighbors) {
+            int64_t nx = cx + d[0], ny = cy + d[1], nz = cz + d[2];
+            if (nx < 0 || ny < 0 || nz < 0 || nx > top || ny > top || nz > top) {
+                continue;
+            }
+            uint64_t key = (uint64_t(nx) | uint64_t(ny) << 21 | uint64_t(nz) << 42) + 1;
+            for (uint32_t s = grid.find(key); s != UINT32_MAX; s = samples[s].next) {
+                const Point& q = points[samples[s].point];
+                float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+                if (dx * dx + dy * dy + dz * dz < min_distance_squared) {
+                    conflict = s;
+                    break;
+                }
+            }
+            if (conflict != UINT32_MAX) {
+                break;
+            }
+        }
+
+        if (conflict != UINT32_MAX) {
+            Sample& sample = samples[conflict];
+            sample.r += p.r;
+            sample.g += p.g;
+            sample.b += p.b;
+            sample.covered++;
+            continue;
+        }
+
+        auto id = static_cast<uint32_t>(samples.size());
+        uint64_t key = (uint64_t(cx) | uint64_t(cy) << 21 | uint64_t(cz) << 42) + 1;
+        samples.push_back({i, grid.push(key, id), p.r, p.g, p.b, 1});
+    }
+
+    // Back in payload order, which keeps them spatially coherent
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.point < b.point; });
+    for (const Sample& sample : samples) {
+        Point kept = points[sample.point];
+        kept.r = average(sample.r, sample.covered);
+        kept.g = average(sample.g, sample.covered);
+        kept.b = average(sample.b, sample.covered);
+        out.push_back(kept);
+    }
+    return samples.size();
+}
+
+size_t decimatePoints(const Point* points, size_t count, const DecimationOptions& options, uint64_t seed,
+                      std::vector<Point>& out) {
+    if (!(options.spacing > 0.0f)) {
+        out.insert(out.end(), points, points + count);
+        return count;
+    }
+    switch (options.method) {
+        case DecimationMethod::Voxel:
+            return voxelDecimate(points, count, options, out);
+        case DecimationMethod::Poisson:
+            return poissonDecimate(points, count, options, seed, out);
+    }
+    return 0;
+}
+
+const char* decimationMethodName(DecimationMethod method) {
+    switch (method) {
+        case DecimationMethod::Voxel:
+            return "voxel";
+        case DecimationMethod::Poisson:
+            return "poisson";
+    }
+    return "unknown";
+}
+
+bool parseDecimationMethod(const std::string& name, DecimationMethod& method) {
+    if (name == "voxel") {
+        method = DecimationMethod::Voxel;
+    } else if (name == "poisson") {
+        method = DecimationMethod::Poisson;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef POINTDECIMATION_H
+#define POINTDECIMATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+
+enum class DecimationMethod {
+    Voxel,    // A point per occupied cell of a grid: the cell's centroid, with its average color
+    Poisson   // Points no closer than the spacing, picked in random order; each keeps the average
+              // color of the points it stands in for
+};
+
+struct DecimationOptions {
+    DecimationMethod method = DecimationMethod::Voxel;
+    float spacing = 0.1f;              // Voxel size, or the Poisson disk's minimum distance
+    float origin[3] = {0.0f, 0.0f, 0.0f};  // Grid corner, shared by every call so voxels line up
+    uint64_t seed = 0;                 // Poisson visiting order, mixed with each call's seed
+};
+
+// Cells a voxel grid can have along each axis
+constexpr uint32_t kDecimationGridCells = 1u << 21;
+
+/*!
+ * Thins out the points of one chunk, appending what's kept to @a out. Every call is independent,
+ * so chunks can be decimated in parallel and in any order; voxels are aligned to
+ * DecimationOptions::origin, so a voxel split between two chunks at most gets a point on each
+ * side, and Poisson spacing is only kept within a chunk.
+ *
+ * Voxel grids need the points to lie within kDecimationGridCells voxels of the origin; points
+ * further out share the last voxel.
+ * @param seed mixed into the Poisson visiting order, e.g. the chunk id, so results don't depend
+ *             on which thread did the work
+ * @return the number of points appended
+ */
+size_t decimatePoints(const Point* points, size_t count, const DecimationOptions& options, uint64_t seed,
+                      std::vector<Point>& out);
+
+/*!
+ * Occupied voxels of the grid of DecimationOptions::spacing and of the coarser grids that double
+ * it, all anchored at the origin: @a counts[k] is what a voxel decimation at spacing * 2^k keeps.
+ * One sort serves every level, since shifting a voxel's Morton code right by 3k gives the code
+ * of the voxel holding it k levels up. Adds to @a counts, so chunks can be summed.
+ * @param levels at most 21
+ */
+void countVoxels(const Point* points, size_t count, const DecimationOptions& options, int levels,
+                 uint64_t* counts);
+
+const char* decimationMethodName(DecimationMethod method);
+
+bool parseDecimationMethod(const std::string& name, DecimationMethod& method);
+
+#endif //POINTDECIMATION_H
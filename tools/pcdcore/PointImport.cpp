@@ -0,0 +1,989 @@
+#include "PointImport.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+
+#include "JobSystem.h"
+
+namespace {
+
+// Text is read this many bytes per expected point, and at least kMinTextBlock at a time
+constexpr size_t kTextBytesPerPoint = 32;
+constexpr size_t kMinTextBlock = 1 << 20;
+
+// Coordinates from about here out are shifted by PointShift::Auto: a float's spacing is 1/128
+// of a unit at 2^16, coarser than a centimetre for data in metres
+constexpr double kAutoShiftAbove = 65536.0;
+constexpr double kAutoShiftStep = 1000.0;
+
+// Pieces a block of text or records is split into per thread, so uneven ones even out
+constexpr size_t kPiecesPerThread = 4;
+
+// Exactly representable powers of ten
+constexpr double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool isDigit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline bool isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+/*!
+ * Parses a decimal number starting at @a p. Up to 19 significant digits are gathered into an
+ * integer and scaled by a power of ten from a table, which is exact for the usual 6-10 digit
+ * coordinates; anything longer or with a larger exponent goes through strtod.
+ * @return one past the number, or null if there isn't one
+ */
+const char* parseNumber(const char* p, const char* end, double& value) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    const char* digits_start = p;
+    for (; p < end && isDigit(*p); ++p) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        for (; p < end && isDigit(*p); ++p) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + uint64_t(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (p == digits_start || (p == digits_start + 1 && *digits_start == '.')) {
+        return nullptr;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negative_exponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negative_exponent = *q == '-';
+            ++q;
+        }
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); ++q) {
+                e = std::min(e * 10 + (*q - '0'), 100000);
+            }
+            exponent += negative_exponent ? -e : e;
+            p = q;
+        }
+    }
+
+    if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+        double v = static_cast<double>(mantissa);
+        v = exponent < 0 ? v / kPow10[-exponent] : v * kPow10[exponent];
+        value = negative ? -v : v;
+        return p;
+    }
+
+    // strtod needs a terminated string; numbers this long are rare
+    char buffer[64];
+    size_t length = std::min<size_t>(p - start, sizeof(buffer) - 1);
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    value = std::strtod(buffer, nullptr);
+    return p;
+}
+
+/*!
+ * Parses up to @a max whitespace, comma or semicolon separated numbers from a line.
+ * @return the count parsed, or -1 if a field isn't a number
+ */
+int parseFields(const char* p, const char* end, double* fields, int max) {
+    int n = 0;
+    while (n < max) {
+        while (p < end && isSeparator(*p)) {
+            ++p;
+        }
+        if (p == end) {
+            break;
+        }
+        const char* next = parseNumber(p, end, fields[n]);
+        if (next == nullptr || (next < end && !isSeparator(*next))) {
+            return -1;
+        }
+        p = next;
+        n++;
+    }
+    return n;
+}
+
+inline uint8_t colorByte(double value) {
+    return static_cast<uint8_t>(std::clamp(value + 0.5, 0.0, 255.0));
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    if (s.size() < suffix.size()) {
+        return false;
+    }
+    return std::equal(suffix.rbegin(), suffix.rend(), s.rbegin(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == b;
+    });
+}
+
+// Runs fn(first, last) over [0, count) in pieces, on the job system if there is one
+void forPieces(JobSystem* jobs, size_t count, const std::function<void(size_t, size_t, size_t)>& fn) {
+    size_t pieces = jobs != nullptr ? std::max<size_t>(1, std::min(count, jobs->concurrency() * kPiecesPerThread)) : 1;
+    if (pieces <= 1) {
+        fn(0, 0, count);
+        return;
+    }
+    size_t size = (count + pieces - 1) / pieces;
+    jobs->parallelFor(0, pieces, 1, [&](size_t first, size_t last) {
+        for (size_t piece = first; piece < last; ++piece) {
+            size_t begin = std::min(count, piece * size);
+            fn(piece, begin, std::min(count, begin + size));
+        }
+    });
+}
+
+/*!
+ * Text formats: the file is read a block at a time, cut after the block's last newline, and the
+ * block split into pieces at newlines, each parsed on its own and appended in order.
+ */
+class TextPointReader : public PointReader {
+public:
+    using PointReader::PointReader;
+
+    bool read(std::vector<Point>& points, size_t max_points, JobSystem* jobs) override {
+        if (!error_.empty() || (done_ && buffer_.empty())) {
+            return false;
+        }
+
+        // Top up the block, keeping the partial line left from the last one
+        size_t block = std::max(kMinTextBlock, max_points * kTextBytesPerPoint);
+        size_t have = buffer_.size();
+        if (!done_) {
+            buffer_.resize(have + block);
+            file_.read(buffer_.data() + have, static_cast<std::streamsize>(block));
+            auto n = static_cast<size_t>(file_.gcount());
+            bytes_read_ += n;
+            buffer_.resize(have + n);
+            if (n < block) {
+                if (file_.bad()) {
+                    return fail("Failed to read the input");
+                }
+                done_ = true;
+            }
+        }
+
+        // Whole lines only, unless that's the end of the file; then no further than the format
+        // says points go
+        const char* begin = buffer_.data();
+        const char* end = begin + buffer_.size();
+        if (!done_) {
+            const char* last = end;
+            while (last > begin && last[-1] != '\n') {
+                --last;
+            }
+            if (last == begin && buffer_.size() > 64 * block) {
+                return fail("A line is longer than " + std::to_string(64 * block) + " bytes");
+            }
+            end = last;
+        }
+        if (lines_left_ != UINT64_MAX) {
+            const char* p = begin;
+            uint64_t lines = 0;
+            for (; p < end && lines < lines_left_; ++lines) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                p = nl != nullptr ? nl + 1 : end;
+            }
+            lines_left_ -= lines;
+            if (lines_left_ == 0) {
+                done_ = true;
+                end = p;
+            }
+        }
+
+        if (!seen_point_) {
+            findFirstPoint(begin, end);
+        }
+
+        // Cut at the newline after each equal share
+        size_t pieces = jobs != nullptr ? jobs->concurrency() * kPiecesPerThread : 1;
+        std::vector<const char*> cuts{begin};
+        for (size_t i = 1; i < pieces; ++i) {
+            const char* at = std::max(cuts.back(), begin + (end - begin) * i / pieces);
+            const char* nl = static_cast<const char*>(std::memchr(at, '\n', end - at));
+            if (nl == nullptr) {
+                break;
+            }
+            cuts.push_back(nl + 1);
+        }
+        cuts.push_back(end);
+
+        std::vector<std::vector<Point>> parsed(cuts.size() - 1);
+        std::vector<uint64_t> skipped(cuts.size() - 1, 0);
+        auto parsePiece = [&](size_t piece) {
+            std::vector<Point>& out = parsed[piece];
+            const char* p = cuts[piece];
+            const char* stop = cuts[piece + 1];
+            out.reserve((stop - p) / kTextBytesPerPoint + 1);
+            while (p < stop) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', stop - p));
+                const char* line_end = nl != nullptr ? nl : stop;
+                double xyz[3];
+                Point point{};
+                point.r = point.g = point.b = 255;
+                if (parseLine(p, line_end, xyz, &point.r)) {
+                    point.x = static_cast<float>(xyz[0] - shift_[0]);
+                    point.y = static_cast<float>(xyz[1] - shift_[1]);
+                    point.z = static_cast<float>(xyz[2] - shift_[2]);
+                    out.push_back(point);
+                } else if (line_end > p && !(line_end - p == 1 && *p == '\r')) {
+                    skipped[piece]++;
+                }
+                p = line_end + 1;
+            }
+        };
+        if (jobs != nullptr && parsed.size() > 1) {
+            jobs->parallelFor(0, parsed.size(), 1, [&](size_t first, size_t last) {
+                for (size_t piece = first; piece < last; ++piece) {
+                    parsePiece(piece);
+                }
+            });
+        } else if (!parsed.empty()) {
+            parsePiece(0);
+        }
+
+        for (size_t i = 0; i < parsed.size(); ++i) {
+            points.insert(points.end(), parsed[i].begin(), parsed[i].end());
+            skipped_ += skipped[i];
+        }
+
+        buffer_.erase(buffer_.begin(), buffer_.begin() + (end - begin));
+        if (done_) {
+            buffer_.clear();
+        }
+        return true;
+    }
+
+protected:
+    // Sees the first line holding a point
+    virtual void firstLine(const char* begin, const char* end) {}
+
+    /*!
+     * Parses one line, without its newline.
+     * @param rgb left alone if the line has no color
+     * @return false if the line holds no point
+     */
+    virtual bool parseLine(const char* begin, const char* end, double* xyz, uint8_t* rgb) const = 0;
+
+    // Lines the point data is limited to; UINT64_MAX runs to the end of the file
+    uint64_t lines_left_ = UINT64_MAX;
+
+private:
+    void findFirstPoint(const char* begin, const char* end) {
+        for (const char* p = begin; p < end;) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            const char* line_end = nl != nullptr ? nl : end;
+            double xyz[3];
+            uint8_t rgb[3];
+            if (parseLine(p, line_end, xyz, rgb)) {
+                seen_point_ = true;
+                if (!shift_decided_) {
+                    decideShift(xyz[0], xyz[1], xyz[2]);
+                }
+                firstLine(p, line_end);
+                return;
+            }
+            p = line_end + 1;
+        }
+    }
+
+    std::vector<char> buffer_;
+    bool done_ = false;
+    bool seen_point_ = false;
+};
+
+// x y z [r g b], or x y z intensity r g b as PTS files have it
+class XyzReader : public TextPointReader {
+public:
+    explicit XyzReader(const PointImportOptions& options) : TextPointReader(options) {
+        format_ = PointFormat::Xyz;
+        description_ = "XYZ text";
+    }
+
+protected:
+    void firstLine(const char* begin, const char* end) override {
+        double fields[8];
+        int n = parseFields(begin, end, fields, 8);
+        has_color_ = n == 6 || n == 7;
+    }
+
+    bool parseLine(const char* begin, const char* end, double* xyz, uint8_t* rgb) const override {
+        double fields[8];
+        int n = parseFields(begin, end, fields, 8);
+        if (n < 3) {
+            return false;
+        }
+        xyz[0] = fields[0];
+        xyz[1] = fields[1];
+        xyz[2] = fields[2];
+        if (n == 6 || n == 7) {
+            for (int c = 0; c < 3; ++c) {
+                rgb[c] = colorByte(fields[n - 3 + c]);
+            }
+        }
+        return true;
+    }
+};
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+bool parsePlyType(const std::string& name, PlyType& type) {
+    static const std::pair<const char*, PlyType> kNames[] = {
+            {"char", PlyType::Int8},     {"int8", PlyType::Int8},       {"uchar", PlyType::UInt8},
+            {"uint8", PlyType::UInt8},   {"short", PlyType::Int16},     {"int16", PlyType::Int16},
+            {"ushort", PlyType::UInt16}, {"uint16", PlyType::UInt16},   {"int", PlyType::Int32},
+            {"int32", PlyType::Int32},   {"uint", PlyType::UInt32},     {"uint32", PlyType::UInt32},
+            {"float", PlyType::Float32}, {"float32", PlyType::Float32}, {"double", PlyType::Float64},
+            {"float64", PlyType::Float64}};
+    for (const auto& entry : kNames) {
+        if (name == entry.first) {
+            type = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t plyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8:
+        case PlyType::UInt8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+    }
+    return 0;
+}
+
+template <typename T>
+T loadScalar(const uint8_t* p, bool swap) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap) {
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+double loadPlyScalar(const uint8_t* p, PlyType type, bool swap) {
+    switch (type) {
+        case PlyType::Int8:
+            return static_cast<int8_t>(*p);
+        case PlyType::UInt8:
+            return *p;
+        case PlyType::Int16:
+            return loadScalar<int16_t>(p, swap);
+        case PlyType::UInt16:
+            return loadScalar<uint16_t>(p, swap);
+        case PlyType::Int32:
+            return loadScalar<int32_t>(p, swap);
+        case PlyType::UInt32:
+            return loadScalar<uint32_t>(p, swap);
+        case PlyType::Float32:
+            return loadScalar<float>(p, swap);
+        case PlyType::Float64:
+            return loadScalar<double>(p, swap);
+    }
+    return 0.0;
+}
+
+// 0-255 from a color property: 16 bit ones are scaled down, floating point ones up from 0-1
+double plyColorScale(PlyType type) {
+    switch (type) {
+        case PlyType::UInt16:
+            return 255.0 / 65535.0;
+        case PlyType::Float32:
+        case PlyType::Float64:
+            return 255.0;
+        default:
+            return 1.0;
+    }
+}
+
+// Where one of x, y, z, red, green, blue sits in a vertex
+struct PlyField {
+    int index = -1;     // Property number; -1 if the vertex doesn't have it
+    size_t offset = 0;  // Bytes into a binary record
+    PlyType type = PlyType::Float32;
+};
+
+struct PlyLayout {
+    bool binary = false;
+    bool big_endian = false;
+    uint64_t vertices = 0;
+    uint64_t skip_lines = 0;  // ASCII elements before the vertices
+    uint64_t skip_bytes = 0;  // Binary elements before the vertices
+    size_t stride = 0;        // Bytes per binary vertex
+    int properties = 0;
+    PlyField fields[6];       // x, y, z, red, green, blue
+};
+
+/*!
+ * Reads a PLY header up to end_header. Elements before the vertices are skipped; in binary files
+ * they can't have list properties, since their size would only be known by reading them.
+ */
+bool parsePlyHeader(std::istream& in, PlyLayout& layout, std::string& error) {
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, 3, "ply") != 0) {
+        error = "Not a PLY file";
+        return false;
+    }
+
+    static const char* const kNames[6][3] = {{"x", "x", "x"},
+                                             {"y", "y", "y"},
+                                             {"z", "z", "z"},
+                                             {"red", "r", "diffuse_red"},
+                                             {"green", "g", "diffuse_green"},
+                                             {"blue", "b", "diffuse_blue"}};
+
+    std::string element;
+    uint64_t element_count = 0;
+    size_t element_size = 0;
+    bool element_has_list = false;
+    bool seen_vertex = false, seen_format = false;
+
+    auto endElement = [&]() {
+        if (element.empty() || seen_vertex) {
+            return true;
+        }
+        if (element == "vertex") {
+            seen_vertex = true;
+            return true;
+        }
+        if (layout.binary && element_has_list) {
+            error = "PLY element '" + element + "' before the vertices has a list property";
+            return false;
+        }
+        layout.skip_lines += element_count;
+        layout.skip_bytes += element_count * element_size;
+        return true;
+    };
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format") {
+            std::string name;
+            words >> name;
+            if (name == "ascii") {
+                layout.binary = false;
+            } else if (name == "binary_little_endian") {
+                layout.binary = true;
+            } else if (name == "binary_big_endian") {
+                layout.binary = true;
+                layout.big_endian = true;
+            } else {
+                error = "Unknown PLY format '" + name + "'";
+                return false;
+            }
+            seen_format = true;
+        } else if (keyword == "element") {
+            if (!endElement()) {
+                return false;
+            }
+            words >> element >> element_count;
+            element_size = 0;
+            element_has_list = false;
+            if (element == "vertex" && !seen_vertex) {
+                layout.vertices = element_count;
+            }
+        } else if (keyword == "property") {
+            std::string type_name, name;
+            words >> type_name;
+            bool in_vertex = element == "vertex" && !seen_vertex;
+            if (type_name == "list") {
+                element_has_list = true;
+                if (in_vertex) {
+                    error = "PLY vertices with list properties aren't supported";
+                    return false;
+                }
+                continue;
+            }
+            PlyType type;
+            if (!parsePlyType(type_name, type)) {
+                error = "Unknown PLY property type '" + type_name + "'";
+                return false;
+            }
+            words >> name;
+            if (in_vertex) {
+                for (int f = 0; f < 6; ++f) {
+                    for (const char* candidate : kNames[f]) {
+                        if (name == candidate && layout.fields[f].index < 0) {
+                            layout.fields[f] = {layout.properties, element_size, type};
+                        }
+                    }
+                }
+                layout.properties++;
+            }
+            element_size += plyTypeSize(type);
+            if (in_vertex) {
+                layout.stride = element_size;
+            }
+        } else if (keyword == "end_header") {
+            if (!endElement()) {
+                return false;
+            }
+            if (!seen_format || !seen_vertex) {
+                error = "PLY header has no format or vertex element";
+                return false;
+            }
+            for (int f = 0; f < 3; ++f) {
+                if (layout.fields[f].index < 0) {
+                    error = "PLY vertices have no x, y and z";
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    error = "PLY header has no end_header";
+    return false;
+}
+
+bool plyHasColor(const PlyLayout& layout) {
+    return layout.fields[3].index >= 0 && layout.fields[4].index >= 0 && layout.fields[5].index >= 0;
+}
+
+class AsciiPlyReader : public TextPointReader {
+public:
+    AsciiPlyReader(const PointImportOptions& options, const PlyLayout& layout)
+            : TextPointReader(options), layout_(layout) {
+        format_ = PointFormat::Ply;
+        description_ = "PLY ascii";
+        expected_points_ = layout.vertices;
+        has_color_ = plyHasColor(layout);
+        lines_left_ = layout.vertices;
+        for (const auto& field : layout.fields) {
+            needed_ = std::max(needed_, field.index + 1);
+        }
+    }
+
+protected:
+    bool parseLine(const char* begin, const char* end, double* xyz, uint8_t* rgb) const override {
+        double fields[64];
+        int n = parseFields(begin, end, fields, std::min(needed_, 64));
+        if (n < needed_ || needed_ > 64) {
+            return false;
+        }
+        for (int f = 0; f < 3; ++f) {
+            xyz[f] = fields[layout_.fields[f].index];
+        }
+        if (has_color_) {
+            for (int c = 0; c < 3; ++c) {
+                const PlyField& field = layout_.fields[3 + c];
+                rgb[c] = colorByte(fields[field.index] * plyColorScale(field.type));
+            }
+        }
+        return true;
+    }
+
+private:
+    PlyLayout layout_;
+    int needed_ = 0;
+};
+
+/*!
+ * Binary formats: fixed size records, read a block at a time and decoded in pieces on the job
+ * system.
+ */
+class BinaryPointReader : public PointReader {
+public:
+    using PointReader::PointReader;
+
+    bool read(std::vector<Point>& points, size_t max_points, JobSystem* jobs) override {
+        if (!error_.empty() || records_left_ == 0) {
+            return false;
+        }
+
+        size_t n = static_cast<size_t>(std::min<uint64_t>(std::max<size_t>(max_points, 1), records_left_));
+        buffer_.resize(n * stride_);
+        file_.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        auto got = static_cast<size_t>(file_.gcount());
+        bytes_read_ += got;
+        n = got / stride_;
+        if (n == 0) {
+            uint64_t missing = records_left_;
+            records_left_ = 0;
+            return fail("The input ends " + std::to_string(missing) + " points early");
+        }
+        records_left_ -= n;
+
+        if (!shift_decided_) {
+            double xyz[3];
+            uint8_t rgb[3];
+            decode(buffer_.data(), xyz, rgb);
+            decideShift(xyz[0], xyz[1], xyz[2]);
+        }
+        prepare(buffer_.data(), n);
+
+        size_t first_point = points.size();
+        points.resize(first_point + n);
+        Point* out = points.data() + first_point;
+        forPieces(jobs, n, [&](size_t, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                double xyz[3];
+                Point& point = out[i];
+                point.r = point.g = point.b = 255;
+                point.padding = 0;
+                decode(buffer_.data() + i * stride_, xyz, &point.r);
+                point.x = static_cast<float>(xyz[0] - shift_[0]);
+                point.y = static_cast<float>(xyz[1] - shift_[1]);
+                point.z = static_cast<float>(xyz[2] - shift_[2]);
+            }
+        });
+
+        if (got < buffer_.size()) {
+            uint64_t missing = records_left_;
+            records_left_ = 0;
+            return fail("The input ends " + std::to_string(missing) + " points early");
+        }
+        return true;
+    }
+
+protected:
+    // Decodes a record; rgb is left alone if the format has no color
+    virtual void decode(const uint8_t* record, double* xyz, uint8_t* rgb) const = 0;
+
+    // Sees each block of records before it's decoded
+    virtual void prepare(const uint8_t* records, size_t count) {}
+
+    size_t stride_ = 0;
+    uint64_t records_left_ = 0;
+
+private:
+    std::vector<uint8_t> buffer_;
+};
+
+class BinaryPlyReader : public BinaryPointReader {
+public:
+    BinaryPlyReader(const PointImportOptions& options, const PlyLayout& layout)
+            : BinaryPointReader(options), layout_(layout) {
+        format_ = PointFormat::Ply;
+        description_ = layout.big_endian ? "PLY binary_big_endian" : "PLY binary_little_endian";
+        expected_points_ = layout.vertices;
+        has_color_ = plyHasColor(layout);
+        stride_ = layout.stride;
+        records_left_ = layout.vertices;
+        for (int c = 0; c < 3; ++c) {
+            color_scale_[c] = plyColorScale(layout.fields[3 + c].type);
+        }
+    }
+
+protected:
+    void decode(const uint8_t* record, double* xyz, uint8_t* rgb) const override {
+        for (int f = 0; f < 3; ++f) {
+            const PlyField& field = layout_.fields[f];
+            xyz[f] = loadPlyScalar(record + field.offset, field.type, layout_.big_endian);
+        }
+        if (has_color_) {
+            for (int c = 0; c < 3; ++c) {
+                const PlyField& field = layout_.fields[3 + c];
+                rgb[c] = colorByte(loadPlyScalar(record + field.offset, field.type, layout_.big_endian) *
+                                   color_scale_[c]);
+            }
+        }
+    }
+
+private:
+    PlyLayout layout_;
+    double color_scale_[3] = {1.0, 1.0, 1.0};
+};
+
+// The public header block of a LAS file, as far as reading points needs it
+struct LasHeader {
+    uint8_t version_minor = 0;
+    uint16_t header_size = 0;
+    uint32_t point_offset = 0;
+    uint8_t point_format = 0;
+    uint16_t record_length = 0;
+    uint64_t point_count = 0;
+    double scale[3] = {};
+    double offset[3] = {};
+    double min[3] = {};
+};
+
+template <typename T>
+T loadLittle(const uint8_t* p) {
+    return loadScalar<T>(p, false);
+}
+
+class LasReader : public BinaryPointReader {
+public:
+    LasReader(const PointImportOptions& options, const LasHeader& header, int rgb_offset)
+            : BinaryPointReader(options), header_(header), rgb_offset_(rgb_offset) {
+        format_ = PointFormat::Las;
+        description_ = "LAS 1." + std::to_string(header.version_minor) + ", point format " +
+                       std::to_string(header.point_format);
+        expected_points_ = header.point_count;
+        has_color_ = rgb_offset >= 0;
+        stride_ = header.record_length;
+        records_left_ = header.point_count;
+    }
+
+protected:
+    void decode(const uint8_t* record, double* xyz, uint8_t* rgb) const override {
+        for (int a = 0; a < 3; ++a) {
+            xyz[a] = loadLittle<int32_t>(record + 4 * a) * header_.scale[a] + header_.offset[a];
+        }
+        if (rgb_offset_ >= 0) {
+            for (int c = 0; c < 3; ++c) {
+                rgb[c] = static_cast<uint8_t>(loadLittle<uint16_t>(record + rgb_offset_ + 2 * c) >> color_shift_);
+            }
+        }
+    }
+
+    // The spec says 16 bit color, but plenty of writers store 0-255. Decided on the first block.
+    void prepare(const uint8_t* records, size_t count) override {
+        if (rgb_offset_ < 0 || color_decided_) {
+            return;
+        }
+        color_decided_ = true;
+        uint16_t brightest = 0;
+        for (size_t i = 0; i < count; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                brightest = std::max(brightest, loadLittle<uint16_t>(records + i * stride_ + rgb_offset_ + 2 * c));
+            }
+        }
+        color_shift_ = brightest > 255 ? 8 : 0;
+    }
+
+private:
+    LasHeader header_;
+    int rgb_offset_;
+    bool color_decided_ = false;
+    int color_shift_ = 8;
+};
+
+// Offsets of the LAS 1.4 public header fields read here
+constexpr size_t kLasVersionMinor = 25;
+constexpr size_t kLasHeaderSize = 94;
+constexpr size_t kLasPointOffset = 96;
+constexpr size_t kLasPointFormat = 104;
+constexpr size_t kLasRecordLength = 105;
+constexpr size_t kLasLegacyCount = 107;
+constexpr size_t kLasScale = 131;
+constexpr size_t kLasOffset = 155;
+constexpr size_t kLasMax = 179;      // max x, min x, max y, min y, max z, min z
+constexpr size_t kLasCount = 247;    // 1.4 only
+constexpr size_t kLasHeader12 = 227;
+constexpr size_t kLasHeader14 = 375;
+
+bool parseLasHeader(std::istream& in, LasHeader& header, int& rgb_offset, std::string& error) {
+    uint8_t bytes[kLasHeader14] = {};
+    in.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    auto got = static_cast<size_t>(in.gcount());
+    in.clear();
+    if (got < kLasHeader12 || std::memcmp(bytes, "LASF", 4) != 0) {
+        error = "Not a LAS file";
+        return false;
+    }
+
+    header.version_minor = bytes[kLasVersionMinor];
+    header.header_size = loadLittle<uint16_t>(bytes + kLasHeaderSize);
+    header.point_offset = loadLittle<uint32_t>(bytes + kLasPointOffset);
+    header.point_format = bytes[kLasPointFormat];
+    header.record_length = loadLittle<uint16_t>(bytes + kLasRecordLength);
+    header.point_count = loadLittle<uint32_t>(bytes + kLasLegacyCount);
+    if (header.version_minor >= 4 && got >= kLasHeader14 && header.header_size >= kLasHeader14) {
+        header.point_count = loadLittle<uint64_t>(bytes + kLasCount);
+    }
+    for (int a = 0; a < 3; ++a) {
+        header.scale[a] = loadLittle<double>(bytes + kLasScale + 8 * a);
+        header.offset[a] = loadLittle<double>(bytes + kLasOffset + 8 * a);
+        header.min[a] = loadLittle<double>(bytes + kLasMax + 16 * a + 8);
+    }
+
+    // LAZ marks its compressed records in the top bits of the format
+    if (header.point_format & 0xc0) {
+        error = "Compressed LAS (LAZ) isn't supported; decompress it first";
+        return false;
+    }
+
+    // Base record size and where RGB sits, by point format
+    static const int kBaseSize[] = {20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67};
+    static const int kRgbOffset[] = {-1, -1, 20, 28, -1, 28, -1, 30, 30, -1, 30};
+    if (header.point_format > 10) {
+        error = "Unknown LAS point format " + std::to_string(header.point_format);
+        return false;
+    }
+    if (header.record_length < kBaseSize[header.point_format]) {
+        error = "LAS records are shorter than point format " + std::to_string(header.point_format) + " needs";
+        return false;
+    }
+    rgb_offset = kRgbOffset[header.point_format];
+
+    in.seekg(header.point_offset);
+    if (!in) {
+        error = "LAS point data offset is past the end of the file";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+PointReader::PointReader(const PointImportOptions& options) : options_(options) {
+    if (options.shift_mode == PointShift::Fixed) {
+        std::copy(options.shift, options.shift + 3, shift_);
+        shift_decided_ = true;
+    } else if (options.shift_mode == PointShift::None) {
+        shift_decided_ = true;
+    }
+}
+
+void PointReader::decideShift(double x, double y, double z) {
+    shift_decided_ = true;
+    double xyz[3] = {x, y, z};
+    bool far = std::any_of(xyz, xyz + 3, [](double v) { return std::fabs(v) >= kAutoShiftAbove; });
+    for (int a = 0; a < 3 && far; ++a) {
+        shift_[a] = std::round(xyz[a] / kAutoShiftStep) * kAutoShiftStep + 0.0;  // No -0
+    }
+}
+
+bool PointReader::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
+
+std::unique_ptr<PointReader> PointReader::open(const std::string& path, const PointImportOptions& options,
+                                               std::string* error) {
+    auto setError = [&](const std::string& message) {
+        if (error != nullptr) {
+            *error = message;
+        }
+        return nullptr;
+    };
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return setError("Failed to open " + path);
+    }
+    file.seekg(0, std::ios::end);
+    auto size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    PointFormat format = options.format;
+    if (format == PointFormat::Auto) {
+        char magic[4] = {};
+        file.read(magic, sizeof(magic));
+        file.clear();
+        file.seekg(0);
+        if (std::memcmp(magic, "ply", 3) == 0 && (magic[3] == '\n' || magic[3] == '\r')) {
+            format = PointFormat::Ply;
+        } else if (std::memcmp(magic, "LASF", 4) == 0) {
+            format = PointFormat::Las;
+        } else if (endsWith(path, ".xyz") || endsWith(path, ".txt") || endsWith(path, ".pts") ||
+                   endsWith(path, ".csv") || endsWith(path, ".asc")) {
+            format = PointFormat::Xyz;
+        } else {
+            return setError("Can't tell the format of " + path + "; pass --format");
+        }
+    }
+
+    std::unique_ptr<PointReader> reader;
+    std::string message;
+    if (format == PointFormat::Ply) {
+        PlyLayout layout;
+        if (!parsePlyHeader(file, layout, message)) {
+            return setError(message);
+        }
+        if (layout.binary) {
+            file.seekg(static_cast<std::streamoff>(layout.skip_bytes), std::ios::cur);
+            reader = std::make_unique<BinaryPlyReader>(options, layout);
+        } else {
+            std::string line;
+            for (uint64_t i = 0; i < layout.skip_lines && std::getline(file, line); ++i) {
+            }
+            reader = std::make_unique<AsciiPlyReader>(options, layout);
+        }
+    } else if (format == PointFormat::Las) {
+        LasHeader header;
+        int rgb_offset = -1;
+        if (!parseLasHeader(file, header, rgb_offset, message)) {
+            return setError(message);
+        }
+        reader = std::make_unique<LasReader>(options, header, rgb_offset);
+    } else {
+        reader = std::make_unique<XyzReader>(options);
+    }
+
+    if (!file) {
+        return setError("Failed to read the header of " + path);
+    }
+    reader->bytes_read_ = static_cast<uint64_t>(file.tellg());
+    reader->file_size_ = size;
+    reader->file_ = std::move(file);
+    return reader;
+}
+
+const char* PointReader::formatName(PointFormat format) {
+    switch (format) {
+        case PointFormat::Auto:
+            return "auto";
+        case PointFormat::Ply:
+            return "ply";
+        case PointFormat::Xyz:
+            return "xyz";
+        case PointFormat::Las:
+            return "las";
+    }
+    return "unknown";
+}
+
+bool PointReader::parseFormat(const std::string& name, PointFormat& format) {
+    if (name == "auto") {
+        format = PointFormat::Auto;
+    } else if (name == "ply") {
+        format = PointFormat::Ply;
+    } else if (name == "xyz" || name == "txt" || name == "pts") {
+        format = PointFormat::Xyz;
+    } else if (name == "las") {
+        format = PointFormat::Las;
+    } else {
+        return false;
+    }
+    return true;
+}
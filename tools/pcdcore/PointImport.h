@@ -0,0 +1,117 @@
+#ifndef POINTIMPORT_H
+#define POINTIMPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+
+class JobSystem;
+
+enum class PointFormat {
+    Auto,  // From the file's first bytes, then its extension
+    Ply,   // PLY, ASCII or binary of either byte order
+    Xyz,   // Text, a point per line: x y z, optionally followed by r g b
+    Las    // ASPRS LAS 1.0-1.4, point formats 0-10, uncompressed
+};
+
+// What to subtract from every coordinate before it's narrowed to a float
+enum class PointShift {
+    Auto,   // The first point's position, rounded, if it's far enough out to lose precision
+    None,
+    Fixed   // PointImportOptions::shift
+};
+
+struct PointImportOptions {
+    PointFormat format = PointFormat::Auto;
+    PointShift shift_mode = PointShift::Auto;
+    double shift[3] = {0.0, 0.0, 0.0};
+};
+
+/*!
+ * Streams the points of a PLY, XYZ or LAS file a block at a time, so a file of any size can be
+ * converted in bounded memory. Text is split at line boundaries and parsed on the job system;
+ * binary records are decoded on it too.
+ *
+ * Coordinates are read as doubles and shifted before they become floats: LAS and survey data
+ * often sit millions of units from the origin, where a float can't tell centimetres apart.
+ * Points without color come out white.
+ *
+ * ex:
+ *  auto reader = PointReader::open("scan.ply", {}, &error);
+ *  std::vector<Point> block;
+ *  while (reader->read(block, 1 << 20, &jobs)) { ... block.clear(); }
+ *  if (!reader->error().empty()) ...
+ */
+class PointReader {
+public:
+    virtual ~PointReader() = default;
+
+    /*!
+     * Appends up to about @a max_points points to @a points.
+     * @param jobs null parses on the calling thread
+     * @return false once the input is exhausted or on an error, which error() then describes
+     */
+    virtual bool read(std::vector<Point>& points, size_t max_points, JobSystem* jobs) = 0;
+
+    [[nodiscard]] PointFormat format() const { return format_; }
+
+    // The format as the file declares it, e.g. "PLY binary_little_endian"
+    [[nodiscard]] const std::string& description() const { return description_; }
+
+    // Points the header promises; 0 if the format has no header that says
+    [[nodiscard]] uint64_t expectedPoints() const { return expected_points_; }
+
+    [[nodiscard]] bool hasColor() const { return has_color_; }
+
+    // Subtracted from every coordinate; decided by the first read() with PointShift::Auto
+    [[nodiscard]] const double* shift() const { return shift_; }
+
+    [[nodiscard]] uint64_t fileSize() const { return file_size_; }
+
+    [[nodiscard]] uint64_t bytesRead() const { return bytes_read_; }
+
+    // Lines or records skipped because they don't hold a point
+    [[nodiscard]] uint64_t skipped() const { return skipped_; }
+
+    [[nodiscard]] const std::string& error() const { return error_; }
+
+    /*!
+     * Opens @a path and reads its header.
+     * @return the reader, or null if the file can't be opened or its format isn't supported;
+     *         @a error then says why
+     */
+    static std::unique_ptr<PointReader> open(const std::string& path, const PointImportOptions& options,
+                                             std::string* error = nullptr);
+
+    static const char* formatName(PointFormat format);
+
+    static bool parseFormat(const std::string& name, PointFormat& format);
+
+protected:
+    explicit PointReader(const PointImportOptions& options);
+
+    // Applies the shift mode to the first point read
+    void decideShift(double x, double y, double z);
+
+    bool fail(const std::string& message);
+
+    PointImportOptions options_;
+    std::ifstream file_;
+    PointFormat format_ = PointFormat::Auto;
+    std::string description_;
+    uint64_t expected_points_ = 0;
+    bool has_color_ = false;
+    double shift_[3] = {0.0, 0.0, 0.0};
+    bool shift_decided_ = false;
+    uint64_t file_size_ = 0;
+    uint64_t bytes_read_ = 0;
+    uint64_t skipped_ = 0;
+    std::string error_;
+};
+
+#endif //POINTIMPORT_H
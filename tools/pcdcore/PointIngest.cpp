@@ -0,0 +1,212 @@
+#include "PointIngest.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "Morton.h"
+
+// How long a blocked append() sleeps between looks at the ring
+static constexpr auto kStallPoll = std::chrono::microseconds(200);
+
+PointIngestor::PointIngestor(const IngestOptions &options) : options_(options) {
+    options_.depth = std::clamp(options_.depth, 0, MORTON_MAX_DEPTH);
+    options_.chunk_points = std::max(1u, options_.chunk_points);
+    options_.max_pending_chunks = std::max(1u, options_.max_pending_chunks);
+    options_.max_open_cells = std::max(1u, options_.max_open_cells);
+
+    cells_ = std::vector<std::atomic<CellBuffer *>>(size_t(1) << (3 * options_.depth));
+    for (auto &cell : cells_) {
+        cell.store(nullptr, std::memory_order_relaxed);
+    }
+    ring_.resize(options_.max_pending_chunks);
+    last_stale_check_ = Clock::now();
+}
+
+PointIngestor::~PointIngestor() {
+    for (auto &cell : cells_) {
+        delete cell.load(std::memory_order_relaxed);
+    }
+}
+
+size_t PointIngestor::append(const Point *points, size_t count) {
+    // A full cell whose seal was interrupted is still open, with no room for another point
+    if (closed_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+
+    uint64_t dropped = 0;
+    size_t i = 0;
+    for (; i < count; ++i) {
+        const Point &p = points[i];
+        if (!options_.bounds.contains(p.x, p.y, p.z)) {
+            dropped++;
+            continue;
+        }
+
+        uint32_t code = mortonCell(p.x, p.y, p.z, options_.bounds, options_.depth);
+        CellBuffer *buffer = cells_[code].load(std::memory_order_relaxed);
+        if (buffer == nullptr) {
+            if (open_.size() >= options_.max_open_cells) {
+                // open_ is in opening order, so the front was opened longest ago
+                if (!seal(open_.front())) {
+                    break;
+                }
+            }
+
+            buffer = new CellBuffer();
+            buffer->points = std::make_unique<Point[]>(options_.chunk_points);
+            buffer->data = buffer->points.get();
+            buffer->opened = Clock::now();
+            buffer->open_index = static_cast<uint32_t>(open_.size());
+            open_.push_back(code);
+            open_cells_.store(static_cast<uint32_t>(open_.size()), std::memory_order_relaxed);
+            cells_[code].store(buffer, std::memory_order_release);
+        }
+
+        uint32_t n = buffer->count.load(std::memory_order_relaxed);
+        buffer->data[n] = p;
+        buffer->bbox.expand(p.x, p.y, p.z);
+        // Publishes the point to openPoints()
+        buffer->count.store(n + 1, std::memory_order_release);
+
+        if (n + 1 == options_.chunk_points && !seal(code)) {
+            ++i;
+            break;
+        }
+    }
+
+    points_in_.fetch_add(i - dropped, std::memory_order_relaxed);
+    points_dropped_.fetch_add(dropped, std::memory_order_relaxed);
+    open_points_.fetch_add(i - dropped, std::memory_order_relaxed);
+
+    sealStale();
+    return i;
+}
+
+void PointIngestor::sealStale() {
+    if (options_.max_open_ms == 0) {
+        return;
+    }
+
+    // Checking every cell per batch would cost more than the batch; a tenth of the age limit
+    // keeps cells within 10% of it
+    auto now = Clock::now();
+    auto max_age = std::chrono::milliseconds(options_.max_open_ms);
+    if (now - last_stale_check_ < max_age / 10) {
+        return;
+    }
+    last_stale_check_ = now;
+
+    // Oldest first, so stop at the first cell young enough to stay. Cells only age past the
+    // limit while the consumer is behind if it has chunks waiting, and sealing them then would
+    // just add more, smaller ones; so this leaves at least half the ring free.
+    while (!open_.empty()) {
+        CellBuffer *buffer = cells_[open_.front()].load(std::memory_order_relaxed);
+        uint64_t pending = tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire);
+        if (now - buffer->opened < max_age || pending >= ring_.size() / 2 || !seal(open_.front())) {
+            break;
+        }
+    }
+}
+
+void PointIngestor::flush() {
+    while (!open_.empty()) {
+        if (!seal(open_.front())) {
+            return;
+        }
+    }
+}
+
+void PointIngestor::close() {
+    closed_.store(true, std::memory_order_release);
+}
+
+bool PointIngestor::waitForRoom() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) < ring_.size()) {
+        return true;
+    }
+
+    stalls_.fetch_add(1, std::memory_order_relaxed);
+    auto start = Clock::now();
+    bool room = false;
+    while (!closed_.load(std::memory_order_acquire)) {
+        if (tail - head_.load(std::memory_order_acquire) < ring_.size()) {
+            room = true;
+            break;
+        }
+        std::this_thread::sleep_for(kStallPoll);
+    }
+    stall_ns_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start).count(), std::memory_order_relaxed);
+    return room;
+}
+
+bool PointIngestor::seal(uint32_t cell) {
+    if (!waitForRoom()) {
+        return false;
+    }
+
+    std::unique_ptr<CellBuffer> buffer(cells_[cell].load(std::memory_order_relaxed));
+    cells_[cell].store(nullptr, std::memory_order_release);
+
+    // Keep open_ in opening order; it's short, so shifting it is cheap
+    open_.erase(open_.begin() + buffer->open_index);
+    for (uint32_t i = buffer->open_index; i < open_.size(); ++i) {
+        cells_[open_[i]].load(std::memory_order_relaxed)->open_index = i;
+    }
+    open_cells_.store(static_cast<uint32_t>(open_.size()), std::memory_order_relaxed);
+
+    uint32_t count = buffer->count.load(std::memory_order_relaxed);
+    open_points_.fetch_sub(count, std::memory_order_relaxed);
+
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    Sealed &slot = ring_[tail % ring_.size()];
+    slot.chunk.cell = cell;
+    slot.chunk.bbox = buffer->bbox;
+    slot.chunk.point_count = count;
+    slot.chunk.points = std::move(buffer->points);
+    slot.buffer = std::move(buffer);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+size_t PointIngestor::pollChunks(std::vector<IngestChunk> &chunks, size_t max) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    size_t n = static_cast<size_t>(std::min<uint64_t>(tail - head, max));
+
+    for (size_t i = 0; i < n; ++i) {
+        Sealed &slot = ring_[(head + i) % ring_.size()];
+        chunks.push_back(std::move(slot.chunk));
+        slot.chunk = IngestChunk();
+        slot.buffer.reset();
+    }
+    head_.store(head + n, std::memory_order_release);
+    return n;
+}
+
+uint32_t PointIngestor::openPoints(uint32_t cell, const Point *&points) const {
+    const CellBuffer *buffer = cell < cells_.size() ? cells_[cell].load(std::memory_order_acquire)
+                                                    : nullptr;
+    if (buffer == nullptr) {
+        points = nullptr;
+        return 0;
+    }
+    points = buffer->data;
+    return buffer->count.load(std::memory_order_acquire);
+}
+
+IngestStats PointIngestor::stats() const {
+    IngestStats stats;
+    stats.points_in = points_in_.load(std::memory_order_relaxed);
+    stats.points_dropped = points_dropped_.load(std::memory_order_relaxed);
+    stats.chunks_taken = head_.load(std::memory_order_relaxed);
+    stats.chunks_sealed = tail_.load(std::memory_order_relaxed);
+    stats.stalls = stalls_.load(std::memory_order_relaxed);
+    stats.stall_seconds = stall_ns_.load(std::memory_order_relaxed) * 1e-9;
+    stats.open_cells = open_cells_.load(std::memory_order_relaxed);
+    stats.open_points = open_points_.load(std::memory_order_relaxed);
+    stats.pending_chunks = static_cast<uint32_t>(stats.chunks_sealed - stats.chunks_taken);
+    return stats;
+}
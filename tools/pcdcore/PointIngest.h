@@ -0,0 +1,166 @@
+#ifndef POINTINGEST_H
+#define POINTINGEST_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PointCloudData.h"
+
+// A live point stream is this header followed by Point records until the sender closes it
+struct PointStreamHeader {
+    char magic[8];       // "PCSTRM1\0"
+    BoundingBox bounds;  // Where the sender's points fall; points outside are dropped
+};
+
+constexpr char PCD_STREAM_MAGIC[8] = "PCSTRM1";
+
+struct IngestOptions {
+    BoundingBox bounds = BoundingBox::empty();  // Region binned into cells
+    int depth = 3;                      // Cells per axis: 2^depth, at most MORTON_MAX_DEPTH
+    uint32_t chunk_points = 4096;       // A cell is sealed into a chunk once it holds this many
+
+    // Sealed chunks the consumer hasn't taken yet. append() waits for room beyond this, which
+    // stops the ingest thread reading and pushes back on the sender.
+    uint32_t max_pending_chunks = 64;
+
+    // Cells being filled at once. Opening another seals the one open longest, so memory stays
+    // under max_open_cells * chunk_points points however the stream is spread. Below the number
+    // of cells a stream touches, a scattered stream seals chunks of a few points each.
+    uint32_t max_open_cells = 512;
+
+    // A cell with points in it for this long is sealed even if it isn't full, so sparse regions
+    // show up too, unless the consumer already has chunks to take. 0 waits for full cells and
+    // flush().
+    uint32_t max_open_ms = 250;
+};
+
+// Points sealed from one cell. They don't change once the chunk is handed out.
+struct IngestChunk {
+    uint32_t cell = 0;            // Morton code at IngestOptions::depth
+    BoundingBox bbox{};           // Of its points
+    uint32_t point_count = 0;
+    std::unique_ptr<Point[]> points;
+};
+
+struct IngestStats {
+    uint64_t points_in = 0;        // Appended and inside the bounds
+    uint64_t points_dropped = 0;   // Outside the bounds
+    uint64_t chunks_sealed = 0;
+    uint64_t chunks_taken = 0;
+    uint64_t stalls = 0;           // Times append() waited for the consumer
+    double stall_seconds = 0.0;
+    uint32_t open_cells = 0;
+    uint64_t open_points = 0;      // Appended but not sealed yet
+    uint32_t pending_chunks = 0;   // Sealed but not taken yet
+};
+
+/*!
+ * Bins a live point stream into octree cells and seals each cell into a chunk as it fills.
+ *
+ * One thread, the ingest thread, calls append() and flush(); one other thread, the consumer,
+ * calls pollChunks() and openPoints(). Neither ever takes a lock. Each cell's append buffer has
+ * a single writer that publishes its count with a release store, so the consumer can draw a
+ * cell's points while it's still filling. Sealed chunks go to the consumer through a fixed ring
+ * with one index per side.
+ *
+ * ex:
+ *  // ingest thread
+ *  ingestor.append(points, count);
+ *  // render thread, every frame
+ *  ingestor.pollChunks(chunks, 8);
+ */
+class PointIngestor {
+public:
+    explicit PointIngestor(const IngestOptions &options);
+
+    ~PointIngestor();
+
+    PointIngestor(const PointIngestor &) = delete;
+    PointIngestor &operator=(const PointIngestor &) = delete;
+
+    /*!
+     * Bins @a count points. Blocks while max_pending_chunks sealed chunks wait for the consumer,
+     * until they're taken or close() is called.
+     * @return the points consumed, fewer than @a count only after close()
+     */
+    size_t append(const Point *points, size_t count);
+
+    // Seals cells that have been open longer than max_open_ms; append() does this too
+    void sealStale();
+
+    // Seals every open cell, at the end of a stream. Blocks like append().
+    void flush();
+
+    // Wakes a blocked append() or flush() and makes them return; for shutting down
+    void close();
+
+    /*!
+     * Moves up to @a max sealed chunks to @a chunks, oldest first.
+     * @return the number moved
+     */
+    size_t pollChunks(std::vector<IngestChunk> &chunks, size_t max);
+
+    /*!
+     * Points appended to @a cell since it was last sealed, which the ingest thread may still be
+     * adding to. The pointer stays valid until the consumer next calls pollChunks().
+     */
+    uint32_t openPoints(uint32_t cell, const Point *&points) const;
+
+    // Consistent enough for metrics; the counters are read without stopping either thread
+    [[nodiscard]] IngestStats stats() const;
+
+    [[nodiscard]] const IngestOptions &options() const { return options_; }
+
+    [[nodiscard]] uint32_t cellCount() const { return static_cast<uint32_t>(cells_.size()); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // A cell's points since it was last sealed. The array becomes the chunk's storage when the
+    // cell is sealed, but the buffer itself goes along to the consumer to be freed, since
+    // openPoints() may be reading it right then.
+    struct CellBuffer {
+        std::unique_ptr<Point[]> points;
+        Point *data = nullptr;  // points.get(), kept after points is moved out
+        std::atomic<uint32_t> count{0};
+        BoundingBox bbox = BoundingBox::empty();
+        Clock::time_point opened;
+        uint32_t open_index = 0;  // Position in open_
+    };
+
+    // Hands the cell's buffer to the consumer as a chunk; false if close() interrupted the wait
+    bool seal(uint32_t cell);
+
+    // Waits for room in the ring
+    bool waitForRoom();
+
+    IngestOptions options_;
+    std::vector<std::atomic<CellBuffer *>> cells_;
+    std::vector<uint32_t> open_;  // Cells with a buffer, ingest thread only
+    Clock::time_point last_stale_check_;
+
+    struct Sealed {
+        IngestChunk chunk;
+        std::unique_ptr<CellBuffer> buffer;
+    };
+
+    // Sealed chunks: written at tail_ by the ingest thread, read at head_ by the consumer
+    std::vector<Sealed> ring_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+
+    std::atomic<bool> closed_{false};
+
+    std::atomic<uint64_t> points_in_{0};
+    std::atomic<uint64_t> points_dropped_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> stall_ns_{0};
+    std::atomic<uint64_t> open_points_{0};
+    std::atomic<uint32_t> open_cells_{0};
+};
+
+#endif //POINTINGEST_H
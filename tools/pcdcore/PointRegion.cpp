@@ -0,0 +1,286 @@
+#include "PointRegion.h"
+
+#include <algorithm>
+
+// Four float lanes: SSE2 on x86, NEON on ARM, plain arrays elsewhere. Points are deinterleaved
+// four at a time into x, y and z lanes; the color word is dropped.
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+struct Vec4f {
+    __m128 v;
+};
+using Mask4 = __m128;
+
+static inline Vec4f splat(float s) { return {_mm_set1_ps(s)}; }
+static inline Vec4f load(const float* p) { return {_mm_loadu_ps(p)}; }
+static inline void loadPoints(const Point* p, Vec4f& x, Vec4f& y, Vec4f& z) {
+    __m128 r0 = _mm_loadu_ps(&p[0].x);
+    __m128 r1 = _mm_loadu_ps(&p[1].x);
+    __m128 r2 = _mm_loadu_ps(&p[2].x);
+    __m128 r3 = _mm_loadu_ps(&p[3].x);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    x = {r0};
+    y = {r1};
+    z = {r2};
+}
+static inline Vec4f operator+(Vec4f a, Vec4f b) { return {_mm_add_ps(a.v, b.v)}; }
+static inline Vec4f operator-(Vec4f a, Vec4f b) { return {_mm_sub_ps(a.v, b.v)}; }
+static inline Vec4f operator*(Vec4f a, Vec4f b) { return {_mm_mul_ps(a.v, b.v)}; }
+static inline Mask4 greaterEqual(Vec4f a, Vec4f b) { return _mm_cmpge_ps(a.v, b.v); }
+static inline Mask4 lessEqual(Vec4f a, Vec4f b) { return _mm_cmple_ps(a.v, b.v); }
+static inline Mask4 both(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+static inline unsigned laneBits(Mask4 m) { return static_cast<unsigned>(_mm_movemask_ps(m)); }
+
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+
+struct Vec4f {
+    float32x4_t v;
+};
+using Mask4 = uint32x4_t;
+
+static inline Vec4f splat(float s) { return {vdupq_n_f32(s)}; }
+static inline Vec4f load(const float* p) { return {vld1q_f32(p)}; }
+static inline void loadPoints(const Point* p, Vec4f& x, Vec4f& y, Vec4f& z) {
+    float32x4x4_t v = vld4q_f32(&p[0].x);
+    x = {v.val[0]};
+    y = {v.val[1]};
+    z = {v.val[2]};
+}
+static inline Vec4f operator+(Vec4f a, Vec4f b) { return {vaddq_f32(a.v, b.v)}; }
+static inline Vec4f operator-(Vec4f a, Vec4f b) { return {vsubq_f32(a.v, b.v)}; }
+static inline Vec4f operator*(Vec4f a, Vec4f b) { return {vmulq_f32(a.v, b.v)}; }
+static inline Mask4 greaterEqual(Vec4f a, Vec4f b) { return vcgeq_f32(a.v, b.v); }
+static inline Mask4 lessEqual(Vec4f a, Vec4f b) { return vcleq_f32(a.v, b.v); }
+static inline Mask4 both(Mask4 a, Mask4 b) { return vandq_u32(a, b); }
+static inline unsigned laneBits(Mask4 m) {
+    static const uint32_t kLaneBit[4] = {1, 2, 4, 8};
+    uint32x4_t bits = vandq_u32(m, vld1q_u32(kLaneBit));
+    uint32x2_t folded = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+    return vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1);
+}
+
+#else
+
+struct Vec4f {
+    float v[4];
+};
+struct Mask4 {
+    bool m[4];
+};
+
+static inline Vec4f splat(float s) { return {{s, s, s, s}}; }
+static inline Vec4f load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void loadPoints(const Point* p, Vec4f& x, Vec4f& y, Vec4f& z) {
+    x = {{p[0].x, p[1].x, p[2].x, p[3].x}};
+    y = {{p[0].y, p[1].y, p[2].y, p[3].y}};
+    z = {{p[0].z, p[1].z, p[2].z, p[3].z}};
+}
+static inline Vec4f operator+(Vec4f a, Vec4f b) {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+static inline Vec4f operator-(Vec4f a, Vec4f b) {
+    return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+}
+static inline Vec4f operator*(Vec4f a, Vec4f b) {
+    return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+static inline Mask4 greaterEqual(Vec4f a, Vec4f b) {
+    return {{a.v[0] >= b.v[0], a.v[1] >= b.v[1], a.v[2] >= b.v[2], a.v[3] >= b.v[3]}};
+}
+static inline Mask4 lessEqual(Vec4f a, Vec4f b) {
+    return {{a.v[0] <= b.v[0], a.v[1] <= b.v[1], a.v[2] <= b.v[2], a.v[3] <= b.v[3]}};
+}
+static inline Mask4 both(Mask4 a, Mask4 b) {
+    return {{a.m[0] && b.m[0], a.m[1] && b.m[1], a.m[2] && b.m[2], a.m[3] && b.m[3]}};
+}
+static inline unsigned laneBits(Mask4 m) {
+    return unsigned(m.m[0]) | unsigned(m.m[1]) << 1 | unsigned(m.m[2]) << 2 | unsigned(m.m[3]) << 3;
+}
+
+#endif
+
+// The region tests. Everything that decides whether a point is in, classify() included, goes
+// through these, so rounding is the same for a chunk's corners as for its points.
+
+static inline Mask4 boxMask(const BoundingBox& box, Vec4f x, Vec4f y, Vec4f z) {
+    Mask4 m = both(greaterEqual(x, splat(box.min_x)), lessEqual(x, splat(box.max_x)));
+    m = both(m, both(greaterEqual(y, splat(box.min_y)), lessEqual(y, splat(box.max_y))));
+    return both(m, both(greaterEqual(z, splat(box.min_z)), lessEqual(z, splat(box.max_z))));
+}
+
+static inline Mask4 sphereMask(const float* center, float radius_squared, Vec4f x, Vec4f y, Vec4f z) {
+    Vec4f dx = x - splat(center[0]);
+    Vec4f dy = y - splat(center[1]);
+    Vec4f dz = z - splat(center[2]);
+    return lessEqual(dx * dx + dy * dy + dz * dz, splat(radius_squared));
+}
+
+static inline Mask4 planeMask(const float* plane, Vec4f x, Vec4f y, Vec4f z) {
+    Vec4f side = splat(plane[0]) * x + splat(plane[1]) * y + splat(plane[2]) * z + splat(plane[3]);
+    return greaterEqual(side, splat(0.0f));
+}
+
+static inline Mask4 frustumMask(const ViewFrustum& frustum, Vec4f x, Vec4f y, Vec4f z) {
+    Mask4 m = planeMask(frustum.planes[0], x, y, z);
+    for (int p = 1; p < 6; ++p) {
+        m = both(m, planeMask(frustum.planes[p], x, y, z));
+    }
+    return m;
+}
+
+// Copies the points @a test keeps, four at a time; the last few are padded to four
+template <typename Test>
+static size_t filterPoints(const Point* points, size_t count, Point* out, Test test) {
+    size_t n = 0;
+    size_t i = 0;
+    Vec4f x, y, z;
+    for (; i + 4 <= count; i += 4) {
+        loadPoints(points + i, x, y, z);
+        unsigned bits = laneBits(test(x, y, z));
+        if (bits == 0) {
+            continue;
+        }
+        // Branch free compaction: every lane is stored, only kept ones advance. Stores never
+        // pass the points still to be read, so filtering in place is fine.
+        for (int k = 0; k < 4; ++k) {
+            out[n] = points[i + k];
+            n += (bits >> k) & 1;
+        }
+    }
+
+    if (i < count) {
+        Point tail[4];
+        size_t rest = count - i;
+        for (size_t k = 0; k < 4; ++k) {
+            tail[k] = points[i + std::min(k, rest - 1)];
+        }
+        loadPoints(tail, x, y, z);
+        unsigned bits = laneBits(test(x, y, z)) & ((1u << rest) - 1);
+        for (size_t k = 0; k < rest; ++k) {
+            if (bits >> k & 1) {
+                out[n++] = points[i + k];
+            }
+        }
+    }
+    return n;
+}
+
+PointRegion PointRegion::box(const BoundingBox& box) {
+    PointRegion region;
+    region.kind_ = Kind::Box;
+    region.box_ = box;
+    return region;
+}
+
+PointRegion PointRegion::sphere(float x, float y, float z, float radius) {
+    PointRegion region;
+    region.kind_ = Kind::Sphere;
+    region.center_[0] = x;
+    region.center_[1] = y;
+    region.center_[2] = z;
+    region.radius_squared_ = radius * radius;
+    return region;
+}
+
+PointRegion PointRegion::frustum(const ViewFrustum& frustum) {
+    PointRegion region;
+    region.kind_ = Kind::Frustum;
+    region.frustum_ = frustum;
+    return region;
+}
+
+RegionOverlap PointRegion::classify(const BoundingBox& box) const {
+    if (box.min_x > box.max_x || box.min_y > box.max_y || box.min_z > box.max_z) {
+        return RegionOverlap::Outside;
+    }
+
+    // The eight corners, as two groups of four: bottom face, then top face
+    const float xs[4] = {box.min_x, box.max_x, box.min_x, box.max_x};
+    const float ys[4] = {box.min_y, box.min_y, box.max_y, box.max_y};
+    Vec4f cx = load(xs);
+    Vec4f cy = load(ys);
+    Vec4f bottom = splat(box.min_z);
+    Vec4f top = splat(box.max_z);
+
+    // Each region is convex and its test grows monotonically away from it along every axis, so a
+    // box is inside once all its corners are
+    auto allCorners = [&](auto test) {
+        return (laneBits(test(cx, cy, bottom)) & laneBits(test(cx, cy, top))) == 0xf;
+    };
+
+    switch (kind_) {
+        case Kind::Box: {
+            if (box.min_x > box_.max_x || box.max_x < box_.min_x || box.min_y > box_.max_y ||
+                box.max_y < box_.min_y || box.min_z > box_.max_z || box.max_z < box_.min_z) {
+                return RegionOverlap::Outside;
+            }
+            bool inside = allCorners([&](Vec4f x, Vec4f y, Vec4f z) { return boxMask(box_, x, y, z); });
+            return inside ? RegionOverlap::Inside : RegionOverlap::Partial;
+        }
+
+        case Kind::Sphere: {
+            // Outside if the box's point nearest the center is
+            Point nearest{};
+            nearest.x = std::min(std::max(center_[0], box.min_x), box.max_x);
+            nearest.y = std::min(std::max(center_[1], box.min_y), box.max_y);
+            nearest.z = std::min(std::max(center_[2], box.min_z), box.max_z);
+            if (!contains(nearest)) {
+                return RegionOverlap::Outside;
+            }
+            bool inside = allCorners([&](Vec4f x, Vec4f y, Vec4f z) {
+                return sphereMask(center_, radius_squared_, x, y, z);
+            });
+            return inside ? RegionOverlap::Inside : RegionOverlap::Partial;
+        }
+
+        case Kind::Frustum: {
+            // Outside if every corner is behind the same plane
+            for (const auto& plane : frustum_.planes) {
+                auto test = [&](Vec4f x, Vec4f y, Vec4f z) { return planeMask(plane, x, y, z); };
+                if ((laneBits(test(cx, cy, bottom)) | laneBits(test(cx, cy, top))) == 0) {
+                    return RegionOverlap::Outside;
+                }
+            }
+            bool inside = allCorners([&](Vec4f x, Vec4f y, Vec4f z) { return frustumMask(frustum_, x, y, z); });
+            return inside ? RegionOverlap::Inside : RegionOverlap::Partial;
+        }
+    }
+    return RegionOverlap::Partial;
+}
+
+bool PointRegion::contains(const Point& point) const {
+    Point kept;
+    return filter(&point, 1, &kept) == 1;
+}
+
+size_t PointRegion::filter(const Point* points, size_t count, Point* out) const {
+    switch (kind_) {
+        case Kind::Box:
+            return filterPoints(points, count, out, [this](Vec4f x, Vec4f y, Vec4f z) {
+                return boxMask(box_, x, y, z);
+            });
+        case Kind::Sphere:
+            return filterPoints(points, count, out, [this](Vec4f x, Vec4f y, Vec4f z) {
+                return sphereMask(center_, radius_squared_, x, y, z);
+            });
+        case Kind::Frustum:
+            return filterPoints(points, count, out, [this](Vec4f x, Vec4f y, Vec4f z) {
+                return frustumMask(frustum_, x, y, z);
+            });
+    }
+    return 0;
+}
+
+const char* PointRegion::kindName(Kind kind) {
+    switch (kind) {
+        case Kind::Box:
+            return "box";
+        case Kind::Sphere:
+            return "sphere";
+        case Kind::Frustum:
+            return "frustum";
+    }
+    return "?";
+}
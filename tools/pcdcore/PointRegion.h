@@ -0,0 +1,68 @@
+#ifndef POINTREGION_H
+#define POINTREGION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PointCloudData.h"
+#include "BrickCulling.h"
+
+// Where a bounding box lies relative to a PointRegion
+enum class RegionOverlap {
+    Outside,  // None of its points can be in the region
+    Partial,  // Some may be; test them one by one
+    Inside    // All of them are
+};
+
+/*!
+ * A region of space to cut a point cloud down to: an axis aligned box, a sphere or a view
+ * frustum. Bounding boxes are classified first so whole chunks and bricks can be kept or dropped
+ * without looking at their points; only the ones on the boundary are filtered point by point.
+ *
+ * classify() agrees with filter(): a box classified Inside has every point in it kept, and one
+ * classified Outside none, so a chunk whose stored bounding box is right never needs filtering.
+ * Frustums may classify boxes that only pass near the region's corners as Partial.
+ *
+ * ex:
+ *  PointRegion region = PointRegion::sphere(0, 0, 0, 50);
+ *  if (region.classify(chunk.bbox) == RegionOverlap::Partial)
+ *      kept = region.filter(points, count, out);
+ */
+class PointRegion {
+public:
+    enum class Kind { Box, Sphere, Frustum };
+
+    static PointRegion box(const BoundingBox& box);
+
+    static PointRegion sphere(float x, float y, float z, float radius);
+
+    static PointRegion frustum(const ViewFrustum& frustum);
+
+    [[nodiscard]] Kind kind() const { return kind_; }
+
+    [[nodiscard]] RegionOverlap classify(const BoundingBox& box) const;
+
+    [[nodiscard]] bool contains(const Point& point) const;
+
+    /*!
+     * Copies the points of @a points that are in the region to @a out, keeping their order. Tests
+     * four points at a time with SSE2 or NEON where available.
+     * @param out room for @a count points; may be @a points itself
+     * @return the number of points copied
+     */
+    size_t filter(const Point* points, size_t count, Point* out) const;
+
+    // "box", "sphere" or "frustum"
+    static const char* kindName(Kind kind);
+
+private:
+    PointRegion() = default;
+
+    Kind kind_ = Kind::Box;
+    BoundingBox box_{};          // Kind::Box
+    float center_[3] = {};       // Kind::Sphere
+    float radius_squared_ = 0.0f;
+    ViewFrustum frustum_{};      // Kind::Frustum
+};
+
+#endif //POINTREGION_H
@@ -0,0 +1,61 @@
+#include "QualityController.h"
+
+#include <algorithm>
+
+QualityController::QualityController(const QualityControllerOptions& options)
+        : options_(options),
+          quality_(std::clamp(options.initial_quality, options.min_quality, 1.0f)) {}
+
+bool QualityController::addFrame(float frame_ms) {
+    if (!primed_) {
+        smoothed_ms_ = frame_ms;
+        primed_ = true;
+    } else {
+        smoothed_ms_ += options_.smoothing * (frame_ms - smoothed_ms_);
+    }
+
+    if (ceiling_frames_ > 0 && --ceiling_frames_ == 0) {
+        ceiling_ = 1.0f;
+    }
+
+    if (settle_ > 0) {
+        settle_--;
+        return false;
+    }
+
+    float previous = quality_;
+    if (smoothed_ms_ > options_.target_ms * (1.0f + options_.deadband)) {
+        quality_ = std::max(quality_ * options_.decrease_factor, options_.min_quality);
+        if (quality_ < previous) {
+            // Remember what ran long so increases stop short of it for a while
+            ceiling_ = previous;
+            ceiling_frames_ = options_.probe_frames;
+            decreases_++;
+        }
+    } else if (smoothed_ms_ < options_.target_ms * (1.0f - options_.deadband)) {
+        float cap = ceiling_ < 1.0f ? ceiling_ - options_.increase_step : 1.0f;
+        quality_ = std::max(quality_, std::min(quality_ + options_.increase_step, cap));
+        if (quality_ > previous) {
+            increases_++;
+        }
+    }
+
+    if (quality_ == previous) {
+        return false;
+    }
+    settle_ = options_.settle_frames;
+    return true;
+}
+
+uint64_t QualityController::pointBudget() const {
+    double span = double(options_.max_budget) - double(options_.min_budget);
+    return options_.min_budget + static_cast<uint64_t>(span * quality_);
+}
+
+float QualityController::drawDistance() const {
+    return options_.min_draw_distance + (1.0f - options_.min_draw_distance) * quality_;
+}
+
+float QualityController::pointSize() const {
+    return options_.max_point_size + (options_.min_point_size - options_.max_point_size) * quality_;
+}
@@ -0,0 +1,98 @@
+#ifndef QUALITYCONTROLLER_H
+#define QUALITYCONTROLLER_H
+
+#include <cstdint>
+
+struct QualityControllerOptions {
+    // Frame time to hold, in milliseconds
+    float target_ms = 16.6f;
+
+    // Frame times within this fraction of the target are left alone
+    float deadband = 0.1f;
+
+    // Weight of the newest frame in the smoothed frame time
+    float smoothing = 0.25f;
+
+    // Frames to wait after a change before judging it; frame times lag a change by a frame or two
+    // and the smoothing needs a few more to catch up
+    uint32_t settle_frames = 8;
+
+    // AIMD steps: quality rises by increase_step at a time and is multiplied by decrease_factor
+    // when frames run long
+    float increase_step = 0.05f;
+    float decrease_factor = 0.75f;
+
+    // After a decrease, quality doesn't climb back past the level that ran long for this many
+    // frames; without it the controller keeps probing the same level and quality oscillates
+    uint32_t probe_frames = 300;
+
+    // The lowest quality the controller goes down to, and the level it starts at
+    float min_quality = 0.05f;
+    float initial_quality = 1.0f;
+
+    // Outputs at the lowest and at full quality
+    uint64_t min_budget = 200000;
+    uint64_t max_budget = 4000000;
+    float min_draw_distance = 0.4f;  // Fraction of the full draw distance
+    float max_point_size = 3.0f;     // Fewer points are drawn larger to cover the same area
+    float min_point_size = 1.0f;
+};
+
+/*!
+ * Holds a frame time target by trading quality for speed. Frame times are smoothed, and when they
+ * leave the deadband around the target a single quality level in [min_quality, 1] is adjusted:
+ * additive steps up, multiplicative steps down. The point budget, draw distance and point size
+ * all follow that level. Hysteresis comes from the deadband, from waiting settle_frames after
+ * every change, and from capping quality below the last level that ran long until probe_frames
+ * have passed.
+ *
+ * Not thread-safe: owned by the render thread.
+ *
+ * ex:
+ *  if (controller.addFrame(frame_ms)) {
+ *      scheduler.setBudget(controller.pointBudget());
+ *  }
+ */
+class QualityController {
+public:
+    explicit QualityController(const QualityControllerOptions& options = {});
+
+    /*!
+     * Feeds the time the last frame took, the longer of its CPU and GPU time.
+     * @return true if the quality level changed
+     */
+    bool addFrame(float frame_ms);
+
+    // Quality in [min_quality, 1]
+    [[nodiscard]] float quality() const { return quality_; }
+
+    [[nodiscard]] uint64_t pointBudget() const;
+
+    [[nodiscard]] float drawDistance() const;
+
+    [[nodiscard]] float pointSize() const;
+
+    [[nodiscard]] float smoothedFrameMs() const { return smoothed_ms_; }
+
+    [[nodiscard]] const QualityControllerOptions& options() const { return options_; }
+
+    // Totals since construction
+    [[nodiscard]] uint32_t increases() const { return increases_; }
+
+    [[nodiscard]] uint32_t decreases() const { return decreases_; }
+
+private:
+    QualityControllerOptions options_;
+    float quality_;
+    float smoothed_ms_ = 0.0f;
+    bool primed_ = false;
+
+    uint32_t settle_ = 0;
+    float ceiling_ = 1.0f;
+    uint32_t ceiling_frames_ = 0;
+
+    uint32_t increases_ = 0;
+    uint32_t decreases_ = 0;
+};
+
+#endif //QUALITYCONTROLLER_H
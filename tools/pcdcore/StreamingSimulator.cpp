@@ -0,0 +1,382 @@
+#include "StreamingSimulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <queue>
+
+#include "ChunkLoadQueue.h"
+
+enum class SimChunkState : uint8_t { Absent, Queued, Reading, Resident };
+
+struct SimChunk {
+    SimChunkState state = SimChunkState::Absent;
+    bool speculative = false;   // Requested as a prefetch and not in view since
+    int64_t last_used = -1;     // Last frame it was in view or prefetched
+    uint64_t loaded = 0;        // Order it landed in
+    double requested_at = 0.0;  // Seconds into the path
+};
+
+// A read finishing at a given time
+struct SimLanding {
+    double time;
+    uint32_t chunk;
+
+    bool operator>(const SimLanding& other) const {
+        return time != other.time ? time > other.time : chunk > other.chunk;
+    }
+};
+
+// An eviction candidate; the largest key goes first
+struct SimVictim {
+    double key;
+    double tie;
+    uint32_t chunk;
+
+    bool operator<(const SimVictim& other) const {
+        if (key != other.key) {
+            return key < other.key;
+        }
+        if (tie != other.tie) {
+            return tie < other.tie;
+        }
+        return chunk > other.chunk;
+    }
+};
+
+static bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+    return a.min_x <= b.max_x && a.max_x >= b.min_x &&
+           a.min_y <= b.max_y && a.max_y >= b.min_y &&
+           a.min_z <= b.max_z && a.max_z >= b.min_z;
+}
+
+static float distanceSquared(const BoundingBox& b, const float* p) {
+    float dx = std::max({b.min_x - p[0], p[0] - b.max_x, 0.0f});
+    float dy = std::max({b.min_y - p[1], p[1] - b.max_y, 0.0f});
+    float dz = std::max({b.min_z - p[2], p[2] - b.max_z, 0.0f});
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Read priority, as streaming_bench ranks them: the box's diagonal over its distance
+static float screenSize(const BoundingBox& b, const float* eye) {
+    float distance = std::max(std::sqrt(distanceSquared(b, eye)), 1e-3f);
+    float sx = b.max_x - b.min_x, sy = b.max_y - b.min_y, sz = b.max_z - b.min_z;
+    return std::sqrt(sx * sx + sy * sy + sz * sz) * 1000.0f / distance;
+}
+
+// The runtime's render box: a cube of side @a size level with the camera across its view and
+// reaching out in front of it
+static BoundingBox viewBox(const CameraPose& pose, float size) {
+    float d[3] = {pose.target[0] - pose.eye[0], pose.target[1] - pose.eye[1], pose.target[2] - pose.eye[2]};
+    float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    float half = 0.5f * size;
+    float c[3];
+    for (int i = 0; i < 3; ++i) {
+        c[i] = pose.eye[i] + (length > 0.0f ? d[i] / length * half : 0.0f);
+    }
+    return {c[0] - half, c[1] - half, c[2] - half, c[0] + half, c[1] + half, c[2] + half};
+}
+
+static ChunkLoadClock::time_point clockAt(double seconds) {
+    return ChunkLoadClock::time_point(std::chrono::duration_cast<ChunkLoadClock::duration>(
+            std::chrono::duration<double>(seconds)));
+}
+
+StreamingSimResult simulateStreaming(const std::vector<ChunkMetadata>& chunks, const CameraPath& path,
+                                     const StreamingSimOptions& options) {
+    StreamingSimResult result;
+    if (chunks.empty() || path.poses.empty() || !(options.fps > 0.0) || !(options.storage.bandwidth_mb_s > 0.0)) {
+        return result;
+    }
+
+    float view_size = options.view_size;
+    if (!(view_size > 0.0f)) {
+        BoundingBox bounds = BoundingBox::empty();
+        for (const ChunkMetadata& chunk : chunks) {
+            bounds.expand(chunk.bbox);
+        }
+        view_size = path.view_size > 0.0f ? path.view_size : 0.25f * bounds.maxDimension();
+    }
+    const float prefetch_size = view_size * (1.0f + std::max(options.prefetch_margin, 0.0f));
+    const bool prefetching = options.prefetch_margin > 0.0f || options.lookahead_frames > 0;
+
+    const double frame_seconds = 1.0 / options.fps;
+    const double latency = options.storage.latency_ms * 1e-3;
+    const double seconds_per_byte = 1.0 / (options.storage.bandwidth_mb_s * 1024.0 * 1024.0);
+    const auto deadline = std::chrono::duration_cast<ChunkLoadClock::duration>(
+            std::chrono::duration<double, std::milli>(options.deadline_ms));
+
+    const auto count = static_cast<uint32_t>(chunks.size());
+    std::vector<SimChunk> state(count);
+    std::vector<int64_t> wanted_frame(count, -1);
+    std::vector<int64_t> prefetch_frame(count, -1);
+    std::vector<uint32_t> resident_at(count, 0);  // Position in resident
+    std::vector<float> sizes(count, 0.0f);
+
+    std::vector<uint32_t> wanted, prefetch, queued, resident;
+    std::vector<SimVictim> victims;
+    std::vector<ChunkLoadPriority> priorities;
+    std::vector<ChunkLoadRequest> batch, expired, cancelled;
+    ChunkLoadQueue queue;
+    std::priority_queue<SimLanding, std::vector<SimLanding>, std::greater<>> landings;
+    std::vector<double> channel_free(std::max<uint32_t>(options.storage.queue_depth, 1), 0.0);
+    double bus_free = 0.0;
+
+    uint64_t held = 0;
+    uint64_t next_loaded = 0;
+    uint64_t landed = 0;
+    double read_seconds = 0.0;
+
+    auto bytesOf = [&chunks](uint32_t chunk_id) { return uint64_t(chunks[chunk_id].point_count) * sizeof(Point); };
+
+    auto release = [&](uint32_t chunk_id) {
+        held -= bytesOf(chunk_id);
+        state[chunk_id].state = SimChunkState::Absent;
+        state[chunk_id].speculative = false;
+    };
+
+    auto evict = [&](uint32_t chunk_id) {
+        uint32_t moved = resident.back();
+        resident[resident_at[chunk_id]] = moved;
+        resident_at[moved] = resident_at[chunk_id];
+        resident.pop_back();
+        if (state[chunk_id].speculative) {
+            result.wasted_prefetches++;
+        }
+        release(chunk_id);
+        result.evictions++;
+    };
+
+    for (int64_t frame = 0; frame < int64_t(path.poses.size()); ++frame) {
+        const double now = double(frame) * frame_seconds;
+        const CameraPose& pose = path.poses[frame];
+
+        // Land whatever finished since the last frame
+        while (!landings.empty() && landings.top().time <= now) {
+            SimLanding landing = landings.top();
+            landings.pop();
+            SimChunk& chunk = state[landing.chunk];
+            chunk.state = SimChunkState::Resident;
+            chunk.loaded = next_loaded++;
+            resident_at[landing.chunk] = static_cast<uint32_t>(resident.size());
+            resident.push_back(landing.chunk);
+            read_seconds += landing.time - chunk.requested_at;
+            landed++;
+        }
+
+        BoundingBox view = viewBox(pose, view_size);
+        wanted.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            if (overlaps(chunks[i].bbox, view)) {
+                wanted_frame[i] = frame;
+                wanted.push_back(i);
+            }
+        }
+
+        prefetch.clear();
+        if (prefetching) {
+            BoundingBox around = viewBox(pose, prefetch_size);
+
+            // Where the camera will be if it keeps going
+            CameraPose ahead = pose;
+            const CameraPose& before = path.poses[std::max<int64_t>(frame - options.lookahead_frames, 0)];
+            for (int i = 0; i < 3; ++i) {
+                ahead.eye[i] += pose.eye[i] - before.eye[i];
+                ahead.target[i] += pose.target[i] - before.target[i];
+            }
+            BoundingBox ahead_box = viewBox(ahead, prefetch_size);
+
+            for (uint32_t i = 0; i < count; ++i) {
+                if (wanted_frame[i] != frame &&
+                    (overlaps(chunks[i].bbox, around) ||
+                     (options.lookahead_frames > 0 && overlaps(chunks[i].bbox, ahead_box)))) {
+                    prefetch_frame[i] = frame;
+                    prefetch.push_back(i);
+                }
+            }
+        }
+
+        for (uint32_t chunk_id : wanted) {
+            state[chunk_id].last_used = frame;
+            state[chunk_id].speculative = false;
+            sizes[chunk_id] = screenSize(chunks[chunk_id].bbox, pose.eye);
+        }
+        for (uint32_t chunk_id : prefetch) {
+            state[chunk_id].last_used = frame;
+            sizes[chunk_id] = screenSize(chunks[chunk_id].bbox, pose.eye);
+        }
+
+        // Rerank what's still queued for this view, and cancel what fell out of it
+        priorities.clear();
+        size_t kept = 0;
+        for (uint32_t chunk_id : queued) {
+            if (state[chunk_id].state != SimChunkState::Queued) {
+                continue;
+            }
+            bool in_view = wanted_frame[chunk_id] == frame;
+            if (!in_view && prefetch_frame[chunk_id] != frame) {
+                cancelled.clear();
+                queue.cancel(chunk_id, cancelled);
+                release(chunk_id);
+                result.cancelled++;
+                continue;
+            }
+            priorities.push_back({chunk_id, sizes[chunk_id], !in_view});
+            queued[kept++] = chunk_id;
+        }
+        queued.resize(kept);
+        queue.reprioritize(priorities.data(), priorities.size());
+
+        // Draw what's resident
+        bool stalled = false;
+        for (uint32_t chunk_id : wanted) {
+            result.lookups++;
+            if (state[chunk_id].state == SimChunkState::Resident) {
+                result.hits++;
+            } else {
+                stalled = true;
+            }
+        }
+        result.stall_frames += stalled;
+
+        // Candidates are ranked once a frame, when the first one is needed; nothing they're
+        // ranked by changes before the next
+        bool ranked = false;
+        auto makeRoom = [&](uint64_t bytes) {
+            if (bytes > options.cache_bytes) {
+                return false;
+            }
+            while (held + bytes > options.cache_bytes) {
+                if (!ranked) {
+                    victims.clear();
+                    for (uint32_t chunk_id : resident) {
+                        const SimChunk& chunk = state[chunk_id];
+                        if (chunk.last_used == frame) {
+                            continue;
+                        }
+                        double age = double(frame - chunk.last_used);
+                        double loaded = -double(chunk.loaded);
+                        switch (options.policy) {
+                            case EvictionPolicy::Lru:
+                                victims.push_back({age, loaded, chunk_id});
+                                break;
+                            case EvictionPolicy::Fifo:
+                                victims.push_back({loaded, age, chunk_id});
+                                break;
+                            case EvictionPolicy::Farthest:
+                                victims.push_back({distanceSquared(chunks[chunk_id].bbox, pose.eye), age, chunk_id});
+                                break;
+                        }
+                    }
+                    std::sort(victims.begin(), victims.end());
+                    ranked = true;
+                }
+                if (victims.empty()) {
+                    return false;
+                }
+                evict(victims.back().chunk);
+                victims.pop_back();
+            }
+            return true;
+        };
+
+        auto request = [&](uint32_t chunk_id, bool speculative) {
+            uint64_t bytes = bytesOf(chunk_id);
+            if (!makeRoom(bytes)) {
+                return false;
+            }
+            held += bytes;
+            result.peak_bytes = std::max(result.peak_bytes, held);
+
+            SimChunk& chunk = state[chunk_id];
+            chunk.state = SimChunkState::Queued;
+            chunk.speculative = speculative;
+            chunk.requested_at = now;
+
+            ChunkLoadRequest read{chunks[chunk_id].file_offset, static_cast<uint32_t>(bytes), nullptr, chunk_id};
+            read.priority = sizes[chunk_id];
+            read.prefetch = speculative;
+            if (speculative) {
+                read.deadline = clockAt(now) + deadline;
+            }
+            queue.push(read);
+            queued.push_back(chunk_id);
+            return true;
+        };
+
+        // Misses largest on screen first, so a full cache turns away the least visible
+        auto bySize = [&sizes](uint32_t a, uint32_t b) { return sizes[a] != sizes[b] ? sizes[a] > sizes[b] : a < b; };
+        std::sort(wanted.begin(), wanted.end(), bySize);
+        for (uint32_t chunk_id : wanted) {
+            if (state[chunk_id].state == SimChunkState::Absent && !request(chunk_id, false)) {
+                result.dropped++;
+            }
+        }
+        std::sort(prefetch.begin(), prefetch.end(), bySize);
+        for (uint32_t chunk_id : prefetch) {
+            if (state[chunk_id].state == SimChunkState::Absent) {
+                request(chunk_id, true);
+            }
+        }
+
+        // Storage works through the queue until the next frame, best request first whenever a
+        // read finishes
+        const double frame_end = now + frame_seconds;
+        while (!queue.empty()) {
+            auto channel = std::min_element(channel_free.begin(), channel_free.end());
+            double start = std::max(*channel, now);
+            if (start >= frame_end) {
+                break;
+            }
+
+            batch.clear();
+            expired.clear();
+            queue.pop(1, 1, clockAt(start), batch, expired);
+            for (const ChunkLoadRequest& read : expired) {
+                release(static_cast<uint32_t>(read.user_data));
+                result.expired++;
+            }
+            for (const ChunkLoadRequest& read : batch) {
+                auto chunk_id = static_cast<uint32_t>(read.user_data);
+                state[chunk_id].state = SimChunkState::Reading;
+                double end = std::max(start + latency, bus_free) + double(read.length) * seconds_per_byte;
+                bus_free = end;
+                *channel = end;
+                landings.push({end, chunk_id});
+                result.reads++;
+                result.prefetch_reads += state[chunk_id].speculative;
+                result.bytes_read += read.length;
+            }
+        }
+    }
+
+    result.frames = path.poses.size();
+    result.mean_read_ms = landed > 0 ? 1000.0 * read_seconds / double(landed) : 0.0;
+    return result;
+}
+
+const char* evictionPolicyName(EvictionPolicy policy) {
+    switch (policy) {
+        case EvictionPolicy::Lru:
+            return "lru";
+        case EvictionPolicy::Fifo:
+            return "fifo";
+        case EvictionPolicy::Farthest:
+            return "farthest";
+    }
+    return "unknown";
+}
+
+bool parseEvictionPolicy(const std::string& name, EvictionPolicy& policy) {
+    if (name == "lru") {
+        policy = EvictionPolicy::Lru;
+    } else if (name == "fifo") {
+        policy = EvictionPolicy::Fifo;
+    } else if (name == "farthest") {
+        policy = EvictionPolicy::Farthest;
+    } else {
+        return false;
+    }
+    return true;
+}
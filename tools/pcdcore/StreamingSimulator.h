@@ -0,0 +1,90 @@
+#ifndef STREAMINGSIMULATOR_H
+#define STREAMINGSIMULATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "CameraPath.h"
+
+// Which resident chunk makes room for a new one. Chunks in view are never evicted.
+enum class EvictionPolicy {
+    Lru,      // Out of view the longest, like ChunkCache
+    Fifo,     // Loaded the longest ago
+    Farthest  // Farthest from the camera
+};
+
+/*!
+ * Storage as the simulator sees it: a read waits out the latency, then its payload moves at the
+ * bandwidth, which the reads in flight share one after another. Up to queue_depth reads are in
+ * flight at once, so latencies overlap but transfers don't.
+ */
+struct StorageModel {
+    double latency_ms = 0.5;
+    double bandwidth_mb_s = 500.0;
+    uint32_t queue_depth = 8;
+};
+
+struct StreamingSimOptions {
+    // Bytes of chunk payloads held, counting reads in flight
+    uint64_t cache_bytes = 256ull * 1024 * 1024;
+    EvictionPolicy policy = EvictionPolicy::Lru;
+
+    // Side of the box in front of the camera that chunks are streamed for; 0 takes the path's
+    // recorded one, or a quarter of the dataset's largest dimension if it has none
+    float view_size = 0.0f;
+
+    // Also prefetches the chunks in a box this much bigger, like streaming_bench --prefetch
+    float prefetch_margin = 0.0f;
+
+    // And the ones in view where the camera will be this many frames on, if it keeps moving the
+    // way it did over the last as many frames
+    int lookahead_frames = 0;
+
+    double fps = 60.0;
+
+    // Prefetches still queued this long after they were requested are dropped
+    double deadline_ms = 250.0;
+
+    StorageModel storage;
+};
+
+struct StreamingSimResult {
+    uint64_t frames = 0;
+    uint64_t lookups = 0;            // Chunks in view, summed over frames
+    uint64_t hits = 0;               // Of those, resident when drawn
+    uint64_t stall_frames = 0;       // Frames drawn with a chunk in view missing
+    uint64_t reads = 0;              // Sent to storage, prefetches included
+    uint64_t prefetch_reads = 0;
+    uint64_t wasted_prefetches = 0;  // Prefetched chunks evicted before they came into view
+    uint64_t bytes_read = 0;
+    uint64_t cancelled = 0;          // Queued reads for chunks that left the view
+    uint64_t expired = 0;            // Prefetches past their deadline
+    uint64_t dropped = 0;            // Chunks in view with no room in the cache
+    uint64_t evictions = 0;
+    uint64_t peak_bytes = 0;         // Resident and in flight
+    double mean_read_ms = 0.0;       // From request to landing
+
+    [[nodiscard]] double hitRate() const { return lookups > 0 ? double(hits) / double(lookups) : 1.0; }
+};
+
+/*!
+ * Replays @a path over a dataset's chunks without reading them: each frame the chunks in view
+ * are looked up in a modeled cache, misses and prefetches are queued in a ChunkLoadQueue the way
+ * the runtime queues them, and the queue drains into a StorageModel on the frame clock. Reads
+ * for chunks that leave the view are cancelled while queued, and the rest are reranked by screen
+ * size every frame.
+ *
+ * Deterministic and self-contained, so several can run on different threads over the same
+ * chunks and path.
+ */
+StreamingSimResult simulateStreaming(const std::vector<ChunkMetadata>& chunks, const CameraPath& path,
+                                     const StreamingSimOptions& options);
+
+// "lru", "fifo" or "farthest"
+const char* evictionPolicyName(EvictionPolicy policy);
+
+bool parseEvictionPolicy(const std::string& name, EvictionPolicy& policy);
+
+#endif //STREAMINGSIMULATOR_H
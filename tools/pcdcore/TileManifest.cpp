@@ -0,0 +1,299 @@
+#include "TileManifest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "Morton.h"
+#include "PcdFile.h"
+
+// Tiles per leaf of the index; testing a few boxes beats another level of nodes
+static constexpr uint32_t kLeafTiles = 4;
+
+static bool setError(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+    return false;
+}
+
+static bool readBox(std::istream& in, BoundingBox& box) {
+    return static_cast<bool>(in >> box.min_x >> box.min_y >> box.min_z >> box.max_x >> box.max_y >> box.max_z);
+}
+
+static bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+    return a.min_x <= b.max_x && a.max_x >= b.min_x &&
+           a.min_y <= b.max_y && a.max_y >= b.min_y &&
+           a.min_z <= b.max_z && a.max_z >= b.min_z;
+}
+
+uint64_t TileManifest::totalPoints() const {
+    uint64_t total = 0;
+    for (const TileEntry& tile : tiles) {
+        total += tile.total_points;
+    }
+    return total;
+}
+
+uint32_t TileManifest::tileOfChunk(uint32_t chunk_id) const {
+    // Last tile starting at or before the id; empty tiles share their first_chunk with the next
+    auto it = std::upper_bound(tiles.begin(), tiles.end(), chunk_id,
+                               [](uint32_t id, const TileEntry& tile) { return id < tile.first_chunk; });
+    while (it != tiles.begin()) {
+        --it;
+        if (chunk_id - it->first_chunk < it->chunk_count) {
+            return static_cast<uint32_t>(it - tiles.begin());
+        }
+        if (it->chunk_count > 0) {
+            break;
+        }
+    }
+    return UINT32_MAX;
+}
+
+bool TileManifest::assignChunkIds() {
+    uint64_t next = 0;
+    for (TileEntry& tile : tiles) {
+        if (next + tile.chunk_count > UINT32_MAX) {
+            return false;
+        }
+        tile.first_chunk = static_cast<uint32_t>(next);
+        next += tile.chunk_count;
+    }
+    return true;
+}
+
+bool readTileManifest(const std::string& path, TileManifest& manifest, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        return setError(error, "Failed to open manifest: " + path);
+    }
+    if (!readTileManifest(file, manifest, error)) {
+        if (error != nullptr) {
+            *error = path + ":" + *error;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool readTileManifest(std::istream& file, TileManifest& manifest, std::string* error) {
+    manifest = TileManifest();
+
+    bool versioned = false;
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream in(line);
+        std::string key;
+        if (!(in >> key) || key[0] == '#') {
+            continue;
+        }
+        std::string where = std::to_string(line_number) + ": ";
+
+        if (!versioned) {
+            int version = 0;
+            if (key != "pcdtiles" || !(in >> version)) {
+                return setError(error, where + "not a tile manifest");
+            }
+            if (version != 1) {
+                return setError(error, where + "unsupported manifest version " + std::to_string(version));
+            }
+            versioned = true;
+        } else if (key == "bounds") {
+            if (!readBox(in, manifest.bounds)) {
+                return setError(error, where + "bad bounds");
+            }
+        } else if (key == "depth") {
+            if (!(in >> manifest.depth) || manifest.depth < 1 || manifest.depth > MORTON_MAX_DEPTH) {
+                return setError(error, where + "bad depth");
+            }
+        } else if (key == "chunk_size") {
+            if (!(in >> manifest.chunk_size)) {
+                return setError(error, where + "bad chunk_size");
+            }
+        } else if (key == "flags") {
+            if (!(in >> manifest.flags)) {
+                return setError(error, where + "bad flags");
+            }
+        } else if (key == "bricks_per_chunk") {
+            if (!(in >> manifest.bricks_per_chunk) ||
+                (manifest.bricks_per_chunk != 0 && !validBricksPerChunk(manifest.bricks_per_chunk))) {
+                return setError(error, where + "bad bricks_per_chunk");
+            }
+        } else if (key == "tile") {
+            TileEntry tile;
+            if (!(in >> tile.chunk_count >> tile.total_points) || !readBox(in, tile.bounds) ||
+                !std::getline(in >> std::ws, tile.path) || tile.path.empty()) {
+                return setError(error, where + "expected 'tile <chunk_count> <total_points> <bounds> <path>'");
+            }
+            manifest.tiles.push_back(std::move(tile));
+        } else {
+            return setError(error, where + "unknown key '" + key + "'");
+        }
+    }
+
+    if (!versioned) {
+        return setError(error, " empty manifest");
+    }
+    if (manifest.depth == 0 || manifest.bounds.min_x > manifest.bounds.max_x) {
+        return setError(error, " missing 'bounds' or 'depth' line");
+    }
+    if (manifest.tiles.size() > kMaxTiles) {
+        return setError(error, " more than " + std::to_string(kMaxTiles) + " tiles");
+    }
+    if (!manifest.assignChunkIds()) {
+        return setError(error, " more than 2^32 chunks");
+    }
+    if ((manifest.flags & PCD_FLAG_BRICKS) && manifest.bricks_per_chunk == 0) {
+        return setError(error, " PCD_FLAG_BRICKS without bricks_per_chunk");
+    }
+    return true;
+}
+
+bool writeTileManifest(const std::string& path, const TileManifest& manifest, std::string* error) {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) {
+        return setError(error, "Failed to create manifest: " + path);
+    }
+
+    // Enough digits that the boxes read back bit for bit
+    file.precision(std::numeric_limits<float>::max_digits10);
+    auto box = [&file](const BoundingBox& b) {
+        file << b.min_x << ' ' << b.min_y << ' ' << b.min_z << ' ' << b.max_x << ' ' << b.max_y << ' ' << b.max_z;
+    };
+
+    file << "pcdtiles 1\n";
+    file << "# " << manifest.tiles.size() << " tiles, " << manifest.chunkCount() << " chunks, "
+         << manifest.totalPoints() << " points\n";
+    file << "bounds ";
+    box(manifest.bounds);
+    file << "\ndepth " << manifest.depth << "\n";
+    file << "chunk_size " << manifest.chunk_size << "\n";
+    file << "flags " << manifest.flags << "\n";
+    file << "bricks_per_chunk " << manifest.bricks_per_chunk << "\n";
+    file << "# tile <chunk_count> <total_points> <bounds> <path>\n";
+    for (const TileEntry& tile : manifest.tiles) {
+        file << "tile " << tile.chunk_count << ' ' << tile.total_points << ' ';
+        box(tile.bounds);
+        file << ' ' << tile.path << '\n';
+    }
+
+    file.close();
+    if (!file) {
+        return setError(error, "Failed to write manifest: " + path);
+    }
+    return true;
+}
+
+std::string tilePath(const std::string& manifest_path, const TileEntry& tile) {
+    if (!tile.path.empty() && tile.path[0] == '/') {
+        return tile.path;
+    }
+    size_t slash = manifest_path.find_last_of("/\\");
+    if (slash == std::string::npos) {
+        return tile.path;
+    }
+    return manifest_path.substr(0, slash + 1) + tile.path;
+}
+
+int chunkOctreeDepth(const BoundingBox& chunk, const BoundingBox& bounds) {
+    float x_ratio = (bounds.max_x - bounds.min_x) / (chunk.max_x - chunk.min_x);
+    float y_ratio = (bounds.max_y - bounds.min_y) / (chunk.max_y - chunk.min_y);
+    float z_ratio = (bounds.max_z - bounds.min_z) / (chunk.max_z - chunk.min_z);
+    float min_ratio = std::min({x_ratio, y_ratio, z_ratio});
+
+    // A single point, or a box as big as the bounds
+    if (!(min_ratio >= 1.0f)) {
+        return 0;
+    }
+    if (std::isinf(min_ratio)) {
+        return MORTON_MAX_DEPTH;
+    }
+    return std::min(static_cast<int>(std::floor(std::log2(min_ratio))), MORTON_MAX_DEPTH);
+}
+
+TileIndex::TileIndex(const TileManifest& manifest) {
+    auto count = static_cast<uint32_t>(manifest.tiles.size());
+    if (count == 0) {
+        return;
+    }
+
+    boxes_.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        boxes_.push_back(manifest.tiles[i].bounds);
+        tiles_.push_back(i);
+    }
+
+    nodes_.reserve(2 * (count / kLeafTiles + 1));
+    nodes_.push_back({});
+    build(0, 0, count);
+}
+
+void TileIndex::build(uint32_t node, uint32_t first, uint32_t count) {
+    BoundingBox bounds = BoundingBox::empty();
+    BoundingBox centers = BoundingBox::empty();
+    for (uint32_t i = first; i < first + count; i++) {
+        const BoundingBox& box = boxes_[tiles_[i]];
+        if (box.min_x <= box.max_x) {
+            bounds.expand(box);
+            float cx, cy, cz;
+            box.getCenter(cx, cy, cz);
+            centers.expand(cx, cy, cz);
+        }
+    }
+
+    if (count <= kLeafTiles) {
+        nodes_[node] = {bounds, first, count};
+        return;
+    }
+
+    // Split at the median center along the axis they spread out the most on
+    float spans[3] = {centers.max_x - centers.min_x, centers.max_y - centers.min_y, centers.max_z - centers.min_z};
+    int axis = static_cast<int>(std::max_element(spans, spans + 3) - spans);
+    auto center = [this, axis](uint32_t tile) {
+        const BoundingBox& box = boxes_[tile];
+        const float* lo = &box.min_x;
+        const float* hi = &box.max_x;
+        return lo[axis] + hi[axis];
+    };
+    uint32_t half = count / 2;
+    std::nth_element(tiles_.begin() + first, tiles_.begin() + first + half, tiles_.begin() + first + count,
+                     [&center](uint32_t a, uint32_t b) { return center(a) < center(b); });
+
+    auto children = static_cast<uint32_t>(nodes_.size());
+    nodes_.resize(nodes_.size() + 2);
+    nodes_[node] = {bounds, children, 0};
+    build(children, first, half);
+    build(children + 1, first + half, count - half);
+}
+
+void TileIndex::query(const BoundingBox& box, std::vector<uint32_t>& tiles) const {
+    if (nodes_.empty()) {
+        return;
+    }
+
+    uint32_t stack[64];
+    size_t depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        const Node& node = nodes_[stack[--depth]];
+        if (!overlaps(node.bounds, box)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[depth++] = node.first;
+            stack[depth++] = node.first + 1;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            if (overlaps(boxes_[tiles_[i]], box)) {
+                tiles.push_back(tiles_[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef TILEMANIFEST_H
+#define TILEMANIFEST_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+
+// One .pcd of a tiled dataset. Its chunks get the global ids first_chunk .. first_chunk +
+// chunk_count - 1, fixed by the manifest so they're known before the tile is ever opened.
+struct TileEntry {
+    std::string path;         // Relative to the manifest's directory
+    BoundingBox bounds;       // Of its chunks
+    uint32_t chunk_count = 0;
+    uint64_t total_points = 0;
+    uint32_t first_chunk = 0; // Filled in when the manifest is read or written
+};
+
+/*!
+ * A dataset split over several .pcd tiles, e.g. by pcd_tile. Stored as text so it can be read,
+ * edited and diffed by hand:
+ *
+ *  pcdtiles 1
+ *  # comment
+ *  bounds <min_x> <min_y> <min_z> <max_x> <max_y> <max_z>
+ *  depth <octree depth>
+ *  chunk_size <points>
+ *  flags <PCD_FLAG_* bits every tile has>
+ *  bricks_per_chunk <n>
+ *  tile <chunk_count> <total_points> <min_x> <min_y> <min_z> <max_x> <max_y> <max_z> <path>
+ *  ...
+ *
+ * bounds and depth describe the octree all the tiles' chunks belong to, so a reader can set it
+ * up before opening any tile. chunk_size is the largest of the tiles'. The path takes the rest
+ * of the line.
+ */
+struct TileManifest {
+    BoundingBox bounds = BoundingBox::empty();
+    int depth = 0;
+    uint32_t chunk_size = 0;
+    uint32_t flags = 0;
+    uint32_t bricks_per_chunk = 0;
+    std::vector<TileEntry> tiles;
+
+    [[nodiscard]] uint64_t chunkCount() const {
+        return tiles.empty() ? 0 : uint64_t(tiles.back().first_chunk) + tiles.back().chunk_count;
+    }
+
+    [[nodiscard]] uint64_t totalPoints() const;
+
+    // The tile holding global chunk @a chunk_id, or UINT32_MAX if there is none
+    [[nodiscard]] uint32_t tileOfChunk(uint32_t chunk_id) const;
+
+    // Numbers the tiles' chunks; false if there are more than fit in a uint32_t
+    bool assignChunkIds();
+};
+
+bool readTileManifest(const std::string& path, TileManifest& manifest, std::string* error = nullptr);
+
+// For manifests that don't live in a file of their own, such as an Android asset
+bool readTileManifest(std::istream& in, TileManifest& manifest, std::string* error = nullptr);
+
+bool writeTileManifest(const std::string& path, const TileManifest& manifest, std::string* error = nullptr);
+
+// Where a tile's path points, for a manifest at @a manifest_path
+std::string tilePath(const std::string& manifest_path, const TileEntry& tile);
+
+/*!
+ * Depth of the octree cell over @a bounds that a chunk's box fits in, by the smallest ratio of
+ * the spans: how the viewer's octree files chunks when it builds itself from their boxes.
+ */
+int chunkOctreeDepth(const BoundingBox& chunk, const BoundingBox& bounds);
+
+// Chunk reads of a tiled dataset name the tile in the top bits of the offset, so requests for
+// every tile share one loader and one queue. Tiles can then be up to 1 TB each.
+constexpr int kTileOffsetBits = 40;
+
+constexpr uint32_t kMaxTiles = 1u << (64 - kTileOffsetBits);
+
+[[nodiscard]] inline uint64_t tiledOffset(uint32_t tile, uint64_t offset) {
+    return uint64_t(tile) << kTileOffsetBits | offset;
+}
+
+[[nodiscard]] inline uint32_t offsetTile(uint64_t offset) {
+    return static_cast<uint32_t>(offset >> kTileOffsetBits);
+}
+
+[[nodiscard]] inline uint64_t offsetInTile(uint64_t offset) {
+    return offset & ((uint64_t(1) << kTileOffsetBits) - 1);
+}
+
+/*!
+ * Bounding volume hierarchy over the tiles' bounds, so finding the tiles near the camera doesn't
+ * walk all of them. Built once; queries are read-only and may run on several threads.
+ */
+class TileIndex {
+public:
+    TileIndex() = default;
+
+    explicit TileIndex(const TileManifest& manifest);
+
+    // Appends the tiles whose bounds overlap @a box, in no particular order
+    void query(const BoundingBox& box, std::vector<uint32_t>& tiles) const;
+
+    [[nodiscard]] size_t size() const { return tiles_.size(); }
+
+private:
+    struct Node {
+        BoundingBox bounds;
+        uint32_t first;  // Children, or a run of tiles_ for a leaf
+        uint32_t count;  // 0 for an inner node, whose children are first and first + 1
+    };
+
+    void build(uint32_t node, uint32_t first, uint32_t count);
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> tiles_;     // Tile ids, grouped by leaf
+    std::vector<BoundingBox> boxes_;  // By tile id
+};
+
+#endif //TILEMANIFEST_H
@@ -4,120 +4,78 @@
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <map>
 #include <memory>
-#include <cmath>
+#include <sstream>
+#include <string>
 
 #define M_PI 3.14159265358979323846
 
 #include "PointCloudData.h"
+#include "PcdFile.h"
+#include "OctreeBuilder.h"
+#include "JobSystem.h"
 
-// Octree node for spatial organization
-struct OctreeNode {
-    BoundingBox bbox;
-    std::vector<Point> points;
-    std::unique_ptr<OctreeNode> children[8];
-    bool is_leaf;
-    
-    OctreeNode(const BoundingBox& box) : bbox(box), is_leaf(true) {
-        for (int i = 0; i < 8; ++i) {
-            children[i] = nullptr;
-        }
-    }
-    
-    void insert(const Point& point, int max_points_per_leaf, int max_depth, int current_depth = 0) {
-        if (!bbox.contains(point.x, point.y, point.z)) {
-            return;
-        }
-        
-        if (is_leaf) {
-            points.push_back(point);
-            
-            if (points.size() > max_points_per_leaf && current_depth < max_depth) {
-                subdivide(max_points_per_leaf, max_depth, current_depth);
-            }
-        } else {
-            int octant = getOctant(point.x, point.y, point.z);
-            children[octant]->insert(point, max_points_per_leaf, max_depth, current_depth + 1);
-        }
+// std::mt19937's output is fixed by the standard but the std distributions aren't, and libstdc++
+// and libc++ map the same engine output to different values. These are spelled out so a seed
+// gives the same file with any standard library (and the same libm).
+struct Random {
+    std::mt19937 engine;
+
+    explicit Random(uint32_t seed) : engine(seed) {}
+
+    // [lo, hi), from the top 24 bits so every value is exact in a float
+    float uniform(float lo, float hi) {
+        return lo + (hi - lo) * static_cast<float>(engine() >> 8) * (1.0f / 16777216.0f);
     }
-    
-    int getOctant(float x, float y, float z) const {
-        float mid_x = (bbox.min_x + bbox.max_x) / 2.0f;
-        float mid_y = (bbox.min_y + bbox.max_y) / 2.0f;
-        float mid_z = (bbox.min_z + bbox.max_z) / 2.0f;
-        
-        int octant = 0;
-        if (x >= mid_x) octant |= 1;
-        if (y >= mid_y) octant |= 2;
-        if (z >= mid_z) octant |= 4;
-        
-        return octant;
+
+    // [lo, hi]; the modulo bias is negligible for the small ranges used here
+    int uniformInt(int lo, int hi) {
+        return lo + static_cast<int>(engine() % static_cast<uint32_t>(hi - lo + 1));
     }
-    
-    void subdivide(int max_points_per_leaf, int max_depth, int current_depth) {
-        float mid_x = (bbox.min_x + bbox.max_x) / 2.0f;
-        float mid_y = (bbox.min_y + bbox.max_y) / 2.0f;
-        float mid_z = (bbox.min_z + bbox.max_z) / 2.0f;
-        
-        BoundingBox child_boxes[8] = {
-            {bbox.min_x, bbox.min_y, bbox.min_z, mid_x, mid_y, mid_z}, // 0
-            {mid_x, bbox.min_y, bbox.min_z, bbox.max_x, mid_y, mid_z}, // 1
-            {bbox.min_x, mid_y, bbox.min_z, mid_x, bbox.max_y, mid_z}, // 2
-            {mid_x, mid_y, bbox.min_z, bbox.max_x, bbox.max_y, mid_z}, // 3
-            {bbox.min_x, bbox.min_y, mid_z, mid_x, mid_y, bbox.max_z}, // 4
-            {mid_x, bbox.min_y, mid_z, bbox.max_x, mid_y, bbox.max_z}, // 5
-            {bbox.min_x, mid_y, mid_z, mid_x, bbox.max_y, bbox.max_z}, // 6
-            {mid_x, mid_y, mid_z, bbox.max_x, bbox.max_y, bbox.max_z}  // 7
-        };
-        
-        for (int i = 0; i < 8; ++i) {
-            children[i] = std::make_unique<OctreeNode>(child_boxes[i]);
-        }
-        
-        for (const auto& point : points) {
-            int octant = getOctant(point.x, point.y, point.z);
-            children[octant]->insert(point, max_points_per_leaf, max_depth, current_depth + 1);
-        }
-        
-        points.clear();
-        points.shrink_to_fit();
-        is_leaf = false;
+
+    // Standard normal, by Box-Muller
+    float normal() {
+        float u = uniform(0.0f, 1.0f);
+        float v = uniform(0.0f, 1.0f);
+        return std::sqrt(-2.0f * std::log(1.0f - u)) * std::cos(2.0f * static_cast<float>(M_PI) * v);
     }
-    
-    void collectChunks(std::vector<std::vector<Point>>& chunks, int min_points = 100) {
-        if (is_leaf) {
-            if (!points.empty() && points.size() >= min_points) {
-                chunks.push_back(points);
-            }
-        } else {
-            for (int i = 0; i < 8; ++i) {
-                if (children[i]) {
-                    children[i]->collectChunks(chunks, min_points);
-                }
-            }
-        }
+
+    uint8_t color() { return static_cast<uint8_t>(uniformInt(0, 255)); }
+};
+
+// Parameters of one layer of a scenario, by name; get() falls back to the generator's default
+struct LayerParams {
+    std::map<std::string, float> values;
+
+    float get(const std::string& key, float fallback) const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : it->second;
     }
 };
 
 // Generate a terrain-like point cloud
-void generateTerrain(std::vector<Point>& points, int count, std::mt19937& rng) {
+void generateTerrain(std::vector<Point>& points, int count, Random& rng, const LayerParams& params) {
+    float size = params.get("size", 100.0f);
+    float amplitude = params.get("amplitude", 10.0f) / 10.0f;
+
+    // Create a grid of points centered on the origin
+    int grid_size = std::max(1, static_cast<int>(std::sqrt(count)));
     for (int i = 0; i < count; ++i) {
-        // Create a grid of points centered on the origin
-        int grid_size = static_cast<int>(std::sqrt(count));
-        if (grid_size == 0) {
-            grid_size = 1;
-        }
         int gx = i % grid_size;
         int gz = i / grid_size;
-        float x = (gx - grid_size / 2.0f) * (100.0f / grid_size);
-        float z = (gz - grid_size / 2.0f) * (100.0f / grid_size);
+        float x = (gx - grid_size / 2.0f) * (size / grid_size);
+        float z = (gz - grid_size / 2.0f) * (size / grid_size);
         
         // Multi-octave terrain
         float y = 0.0f;
         y += 10.0f * std::sin(z * 0.1f) * std::cos(x * 0.1f);
         y += 5.0f * std::sin(z * 0.3f) * std::cos(x * 0.3f);
         y += 2.5f * std::sin(z * 0.7f) * std::cos(x * 0.7f);
+        y *= amplitude;
         
         // Color based on height
         uint8_t r = static_cast<uint8_t>(std::max(0.0f, std::min(128 + y * 5, 255.0f)));
@@ -130,22 +88,24 @@ void generateTerrain(std::vector<Point>& points, int count, std::mt19937& rng) {
 }
 
 // Generate spherical objects
-void generateSpheres(std::vector<Point>& points, int num_spheres, std::mt19937& rng) {
-    std::uniform_real_distribution<float> pos_dist(-40.0f, 40.0f);
-    std::uniform_real_distribution<float> radius_dist(2.0f, 8.0f);
-    std::uniform_int_distribution<int> color_dist(0, 255);
+void generateSpheres(std::vector<Point>& points, int count, Random& rng, const LayerParams& params) {
+    float extent = params.get("extent", 40.0f);
+    float radius_min = params.get("radius_min", 2.0f);
+    float radius_max = params.get("radius_max", 8.0f);
+    int num_spheres = std::max(1, count / std::max(1, static_cast<int>(params.get("points_per_sphere", 10000))));
     
     for (int s = 0; s < num_spheres; ++s) {
-        float cx = pos_dist(rng);
-        float cy = pos_dist(rng);
-        float cz = pos_dist(rng);
-        float radius = radius_dist(rng);
+        float cx = rng.uniform(-extent, extent);
+        float cy = rng.uniform(-extent, extent);
+        float cz = rng.uniform(-extent, extent);
+        float radius = rng.uniform(radius_min, radius_max);
         
-        uint8_t r = color_dist(rng);
-        uint8_t g = color_dist(rng);
-        uint8_t b = color_dist(rng);
+        uint8_t r = rng.color();
+        uint8_t g = rng.color();
+        uint8_t b = rng.color();
         
-        int points_per_sphere = 10000;
+        // The first spheres take the remainder, so the layer gets exactly count points
+        int points_per_sphere = count / num_spheres + (s < count % num_spheres ? 1 : 0);
         for (int i = 0; i < points_per_sphere; ++i) {
             // Fibonacci sphere distribution
             float phi = std::acos(1.0f - 2.0f * (i + 0.5f) / points_per_sphere);
@@ -163,25 +123,22 @@ void generateSpheres(std::vector<Point>& points, int num_spheres, std::mt19937&
 }
 
 // Generate multiple point cloud spirals/helixes
-void generateHelix(std::vector<Point>& points, int count, std::mt19937& rng) {
-    std::uniform_real_distribution<float> pos_dist(-40.0f, 40.0f);
-    std::uniform_real_distribution<float> radius_dist(8.0f, 15.0f);
-    std::uniform_int_distribution<int> color_base_dist(0, 255);
-    
-    int num_helixes = 24;
-    int points_per_helix = count / num_helixes;
+void generateHelix(std::vector<Point>& points, int count, Random& rng, const LayerParams& params) {
+    float extent = params.get("extent", 40.0f);
+    int num_helixes = std::max(1, static_cast<int>(params.get("helixes", 24)));
     
     for (int h = 0; h < num_helixes; ++h) {
         // Random center position for each helix
-        float center_x = pos_dist(rng);
-        float center_z = pos_dist(rng);
-        float base_radius = radius_dist(rng);
+        float center_x = rng.uniform(-extent, extent);
+        float center_z = rng.uniform(-extent, extent);
+        float base_radius = rng.uniform(8.0f, 15.0f);
         
         // Random color scheme for each helix
-        uint8_t color_offset_r = color_base_dist(rng);
-        uint8_t color_offset_g = color_base_dist(rng);
-        uint8_t color_offset_b = color_base_dist(rng);
+        uint8_t color_offset_r = rng.color();
+        uint8_t color_offset_g = rng.color();
+        uint8_t color_offset_b = rng.color();
         
+        int points_per_helix = count / num_helixes + (h < count % num_helixes ? 1 : 0);
         for (int i = 0; i < points_per_helix; ++i) {
             float t = i * 0.01f;
             float radius = base_radius + 3.0f * std::sin(t * 3.0f);
@@ -202,186 +159,366 @@ void generateHelix(std::vector<Point>& points, int count, std::mt19937& rng) {
 }
 
 // Generate random scattered points
-void generateRandom(std::vector<Point>& points, int count, std::mt19937& rng) {
-    std::uniform_real_distribution<float> pos_dist(-50.0f, 50.0f);
-    std::uniform_int_distribution<int> color_dist(0, 255);
+void generateRandom(std::vector<Point>& points, int count, Random& rng, const LayerParams& params) {
+    float extent = params.get("extent", 50.0f);
     
     for (int i = 0; i < count; ++i) {
-        float x = pos_dist(rng);
-        float y = pos_dist(rng);
-        float z = pos_dist(rng);
+        float x = rng.uniform(-extent, extent);
+        float y = rng.uniform(-extent, extent);
+        float z = rng.uniform(-extent, extent);
         
-        uint8_t r = color_dist(rng);
-        uint8_t g = color_dist(rng);
-        uint8_t b = color_dist(rng);
+        uint8_t r = rng.color();
+        uint8_t g = rng.color();
+        uint8_t b = rng.color();
         
         points.push_back({x, y, z, r, g, b, 0});
     }
 }
 
+// Tight gaussian blobs. Small enough that the octree reaches max_depth inside them with leaves
+// still over max_points_per_leaf, so their chunks come out larger than the header's chunk_size
+// and the app's slots, which cut them short.
+void generateClusters(std::vector<Point>& points, int count, Random& rng, const LayerParams& params) {
+    float extent = params.get("extent", 40.0f);
+    float radius = params.get("radius", 0.05f);
+    int num_clusters = std::max(1, static_cast<int>(params.get("clusters", 4)));
+
+    for (int c = 0; c < num_clusters; ++c) {
+        float cx = rng.uniform(-extent, extent);
+        float cy = rng.uniform(-extent, extent);
+        float cz = rng.uniform(-extent, extent);
+        uint8_t r = rng.color();
+        uint8_t g = rng.color();
+        uint8_t b = rng.color();
+
+        int points_per_cluster = count / num_clusters + (c < count % num_clusters ? 1 : 0);
+        for (int i = 0; i < points_per_cluster; ++i) {
+            points.push_back({cx + radius * rng.normal(), cy + radius * rng.normal(),
+                              cz + radius * rng.normal(), r, g, b, 0});
+        }
+    }
+}
+
+// Long, thin segments in random directions, whose bounding boxes span many cells while holding
+// few points in each
+void generateLines(std::vector<Point>& points, int count, Random& rng, const LayerParams& params) {
+    float extent = params.get("extent", 40.0f);
+    float length = params.get("length", 100.0f);
+    float thickness = params.get("thickness", 0.01f);
+    int num_lines = std::max(1, static_cast<int>(params.get("lines", 8)));
+
+    for (int l = 0; l < num_lines; ++l) {
+        float cx = rng.uniform(-extent, extent);
+        float cy = rng.uniform(-extent, extent);
+        float cz = rng.uniform(-extent, extent);
+        float dx = rng.normal(), dy = rng.normal(), dz = rng.normal();
+        float norm = std::max(1e-6f, std::sqrt(dx * dx + dy * dy + dz * dz));
+        dx /= norm;
+        dy /= norm;
+        dz /= norm;
+        uint8_t r = rng.color();
+        uint8_t g = rng.color();
+        uint8_t b = rng.color();
+
+        int points_per_line = count / num_lines + (l < count % num_lines ? 1 : 0);
+        for (int i = 0; i < points_per_line; ++i) {
+            float t = length * (rng.uniform(0.0f, 1.0f) - 0.5f);
+            points.push_back({cx + t * dx + thickness * rng.normal(),
+                              cy + t * dy + thickness * rng.normal(),
+                              cz + t * dz + thickness * rng.normal(), r, g, b, 0});
+        }
+    }
+}
+
+using LayerGenerator = void (*)(std::vector<Point>&, int, Random&, const LayerParams&);
+
+struct LayerKind {
+    const char* name;
+    LayerGenerator generate;
+};
+
+const LayerKind kLayerKinds[] = {
+        {"terrain", generateTerrain},
+        {"spheres", generateSpheres},
+        {"helix", generateHelix},
+        {"uniform", generateRandom},
+        {"cluster", generateClusters},
+        {"line", generateLines},
+};
+
+struct Layer {
+    const LayerKind* kind;
+    double weight;  // Share of the points, relative to the other layers
+    LayerParams params;
+};
+
+// What to generate: a weighted mix of layers, boxes left empty, and the octree settings
+struct Scenario {
+    bool has_seed = false;
+    uint32_t seed = 0;
+    int64_t points = 10000000;
+    std::vector<Layer> layers;
+    std::vector<BoundingBox> empty;
+    OctreeBuildOptions octree;
+};
+
+// The mix the generator has always made
+Scenario defaultScenario() {
+    Scenario scenario;
+    scenario.layers = {{&kLayerKinds[0], 0.5, {}}, {&kLayerKinds[1], 0.25, {}}, {&kLayerKinds[2], 0.25, {}}};
+    return scenario;
+}
+
+/*!
+ * Reads a scenario file: one directive per line, '#' starts a comment.
+ *  seed N | points N | leaf_points N | max_depth N | min_points N
+ *  <terrain|spheres|helix|uniform|cluster|line> WEIGHT [KEY VALUE]...
+ *  empty MIN_X MIN_Y MIN_Z MAX_X MAX_Y MAX_Z
+ */
+bool readScenario(const std::string& path, Scenario& scenario, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Failed to open scenario " + path;
+        return false;
+    }
+
+    scenario.layers.clear();
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string directive;
+        if (!(in >> directive)) {
+            continue;
+        }
+
+        auto bad = [&](const std::string& what) {
+            error = path + ":" + std::to_string(line_number) + ": " + what;
+            return false;
+        };
+
+        if (directive == "seed") {
+            if (!(in >> scenario.seed)) return bad("seed needs a number");
+            scenario.has_seed = true;
+        } else if (directive == "points") {
+            if (!(in >> scenario.points) || scenario.points <= 0) return bad("points needs a positive number");
+        } else if (directive == "leaf_points") {
+            if (!(in >> scenario.octree.max_points_per_leaf)) return bad("leaf_points needs a number");
+        } else if (directive == "max_depth") {
+            if (!(in >> scenario.octree.max_depth)) return bad("max_depth needs a number");
+        } else if (directive == "min_points") {
+            if (!(in >> scenario.octree.min_points)) return bad("min_points needs a number");
+        } else if (directive == "empty") {
+            BoundingBox box{};
+            if (!(in >> box.min_x >> box.min_y >> box.min_z >> box.max_x >> box.max_y >> box.max_z)) {
+                return bad("empty needs min and max corners");
+            }
+            scenario.empty.push_back(box);
+        } else {
+            const LayerKind* kind = nullptr;
+            for (const auto& candidate : kLayerKinds) {
+                if (directive == candidate.name) {
+                    kind = &candidate;
+                }
+            }
+            if (kind == nullptr) return bad("unknown directive '" + directive + "'");
+
+            Layer layer{kind, 0.0, {}};
+            if (!(in >> layer.weight) || layer.weight < 0.0) return bad(directive + " needs a weight");
+            std::string key;
+            float value;
+            while (in >> key) {
+                if (!(in >> value)) return bad(key + " needs a value");
+                layer.params.values[key] = value;
+            }
+            scenario.layers.push_back(layer);
+        }
+    }
+
+    if (scenario.layers.empty()) {
+        error = path + " has no layers";
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     // Parse command line arguments
-    int total_points = 10000000; // Default 10M points
+    Scenario scenario = defaultScenario();
+    int64_t total_points = -1;  // From the scenario unless given
     std::string output_file = "pointcloud.pcd";
-    
-    if (argc > 1) {
-        total_points = std::atoi(argv[1]);
+    std::string scenario_file;
+    bool align_payloads = false;
+    uint32_t bricks_per_chunk = 8;
+    bool chunk_crcs = true;
+    bool has_seed = false;
+    uint32_t seed = 0;
+    
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--align") {
+            align_payloads = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            has_seed = true;
+        } else if (arg == "--scenario" && i + 1 < argc) {
+            scenario_file = argv[++i];
+        } else if (arg == "--bricks" && i + 1 < argc) {
+            bricks_per_chunk = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--no-crc") {
+            chunk_crcs = false;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0]
+                      << " [num_points] [output_file] [--align] [--seed N] [--scenario FILE] [--bricks 0|8|64] [--no-crc]" << std::endl;
+            return 1;
+        } else if (positional == 0 && arg.find_first_not_of("0123456789") == std::string::npos) {
+            total_points = std::atoll(arg.c_str());
+            positional++;
+        } else if (positional <= 1) {
+            // The point count can be left to the scenario: a lone name is the output file
+            output_file = arg;
+            positional = 2;
+        }
+    }
+
+    if (!scenario_file.empty()) {
+        std::string error;
+        if (!readScenario(scenario_file, scenario, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
     }
-    if (argc > 2) {
-        output_file = argv[2];
+    if (total_points < 0) {
+        total_points = scenario.points;
+    }
+    if (!has_seed) {
+        has_seed = scenario.has_seed;
+        seed = scenario.has_seed ? scenario.seed : std::random_device()();
     }
     
     std::cout << "Generating point cloud with " << total_points << " points..." << std::endl;
+    std::cout << "Seed: " << seed << " (pass --seed " << seed << " to generate this file again)" << std::endl;
     
-    // Random number generator
-    std::random_device rd;
-    std::mt19937 rng(rd());
+    Random rng(seed);
     
     // Generate points
     std::vector<Point> all_points;
     all_points.reserve(total_points);
 	
-	// Distribute point count
-	int terrain_points = (int)(total_points * 0.5);
-	int helix_points = (int)(total_points * 0.25);
-	int sphere_points = (int)(total_points * 0.25);
-	int leftover_points = total_points - terrain_points - helix_points - sphere_points;
-	terrain_points += leftover_points;
-    
-    std::cout << "Generating terrain..." << std::endl;
-    generateTerrain(all_points, terrain_points, rng);
-    
-    std::cout << "Generating spheres..." << std::endl;
-	int num_spheres = (int)(sphere_points / 10000); // 10000 points per sphere
-    generateSpheres(all_points, num_spheres, rng);
-    
-    std::cout << "Generating helix..." << std::endl;
-    generateHelix(all_points, helix_points, rng);
+	// Distribute point count by weight; the first layer takes what rounding leaves over
+	double total_weight = 0.0;
+	for (const auto& layer : scenario.layers) {
+	    total_weight += layer.weight;
+	}
+	std::vector<int> layer_points;
+	int64_t assigned = 0;
+	for (const auto& layer : scenario.layers) {
+	    layer_points.push_back(total_weight > 0.0 ? static_cast<int>(total_points * layer.weight / total_weight) : 0);
+	    assigned += layer_points.back();
+	}
+	layer_points[0] += static_cast<int>(total_points - assigned);
+    
+    for (size_t i = 0; i < scenario.layers.size(); ++i) {
+        if (layer_points[i] > 0) {
+            std::cout << "Generating " << scenario.layers[i].kind->name << " (" << layer_points[i]
+                      << " points)..." << std::endl;
+            scenario.layers[i].kind->generate(all_points, layer_points[i], rng, scenario.layers[i].params);
+        }
+    }
     
-    //std::cout << "Generating random scatter..." << std::endl;
-    //generateRandom(all_points, total_points / 4, rng);
+    if (!scenario.empty.empty()) {
+        size_t before = all_points.size();
+        all_points.erase(std::remove_if(all_points.begin(), all_points.end(), [&](const Point& p) {
+            return std::any_of(scenario.empty.begin(), scenario.empty.end(), [&](const BoundingBox& box) {
+                return box.contains(p.x, p.y, p.z);
+            });
+        }), all_points.end());
+        std::cout << "Emptied " << scenario.empty.size() << " regions, removing "
+                  << (before - all_points.size()) << " points" << std::endl;
+    }
     
     std::cout << "Total points generated: " << all_points.size() << std::endl;
     
     // Calculate overall bounds
-    BoundingBox bounds = {
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::lowest(),
-        std::numeric_limits<float>::lowest(),
-        std::numeric_limits<float>::lowest()
-    };
-    
-    for (const auto& point : all_points) {
-        bounds.min_x = std::min(bounds.min_x, point.x);
-        bounds.min_y = std::min(bounds.min_y, point.y);
-        bounds.min_z = std::min(bounds.min_z, point.z);
-        bounds.max_x = std::max(bounds.max_x, point.x);
-        bounds.max_y = std::max(bounds.max_y, point.y);
-        bounds.max_z = std::max(bounds.max_z, point.z);
-    }
+    BoundingBox bounds = computeBounds(all_points.data(), all_points.size());
     
     std::cout << "Bounds: (" << bounds.min_x << ", " << bounds.min_y << ", " << bounds.min_z 
               << ") to (" << bounds.max_x << ", " << bounds.max_y << ", " << bounds.max_z << ")" << std::endl;
     
     // Build octree for spatial organization
     std::cout << "Building octree..." << std::endl;
-    OctreeNode root(bounds);
-    int max_points_per_leaf = 100000; // 100k points per leaf
-    int max_depth = 8;
+    // 100k points per leaf, max depth 8, minimum 1000 points per chunk unless the scenario says
+    const OctreeBuildOptions& octree_options = scenario.octree;
     
-    for (const auto& point : all_points) {
-        root.insert(point, max_points_per_leaf, max_depth);
-    }
+    // Sorted by Morton code in one pass across cores; each chunk is a run of the sorted points
+    JobSystem jobs;
+    auto build_start = std::chrono::steady_clock::now();
+    OctreeChunks octree = buildOctreeChunkRanges(std::move(all_points), bounds, octree_options, &jobs);
+    double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+    const std::vector<OctreeChunkRange>& chunks = octree.chunks;
     
-    // Collect chunks from octree
-    std::cout << "Collecting chunks..." << std::endl;
-    std::vector<std::vector<Point>> chunks;
-    root.collectChunks(chunks, 1000); // Minimum 1000 points per chunk
-    
-    std::cout << "Total chunks: " << chunks.size() << std::endl;
-    
-    // Prepare file header
-    FileHeader header;
-    std::memcpy(header.magic, "PCLOUD1", 8);
-    header.version = 1;
-    header.bounds = bounds;
-    header.total_points = all_points.size();
-    header.chunk_count = chunks.size();
-    header.chunk_size = max_points_per_leaf;
-    
-    // Prepare chunk metadata
-    std::vector<ChunkMetadata> chunk_metadata;
-    chunk_metadata.reserve(chunks.size());
-    
-    // Calculate file offsets and chunk bounding boxes
-    uint64_t current_offset = sizeof(FileHeader) + chunks.size() * sizeof(ChunkMetadata);
-    
-    for (const auto& chunk : chunks) {
-        ChunkMetadata meta;
-        meta.point_count = chunk.size();
-        meta.file_offset = current_offset;
-        
-        // Calculate chunk bounds
-        meta.bbox = {
-            std::numeric_limits<float>::max(),
-            std::numeric_limits<float>::max(),
-            std::numeric_limits<float>::max(),
-            std::numeric_limits<float>::lowest(),
-            std::numeric_limits<float>::lowest(),
-            std::numeric_limits<float>::lowest()
-        };
-        
-        for (const auto& point : chunk) {
-            meta.bbox.min_x = std::min(meta.bbox.min_x, point.x);
-            meta.bbox.min_y = std::min(meta.bbox.min_y, point.y);
-            meta.bbox.min_z = std::min(meta.bbox.min_z, point.z);
-            meta.bbox.max_x = std::max(meta.bbox.max_x, point.x);
-            meta.bbox.max_y = std::max(meta.bbox.max_y, point.y);
-            meta.bbox.max_z = std::max(meta.bbox.max_z, point.z);
-        }
-        
-        chunk_metadata.push_back(meta);
-        current_offset += chunk.size() * sizeof(Point);
-    }
+    std::cout << "Total chunks: " << chunks.size() << " (octree built in " << build_seconds << " s on "
+              << jobs.concurrency() << " threads)" << std::endl;
     
     // Write to file
     std::cout << "Writing to file: " << output_file << std::endl;
-    std::ofstream file(output_file, std::ios::binary);
-    
-    if (!file) {
-        std::cerr << "Failed to open output file!" << std::endl;
+    PcdWriteOptions write_options;
+    write_options.align_payloads = align_payloads;
+    write_options.chunk_size = octree_options.max_points_per_leaf;
+    write_options.bricks_per_chunk = bricks_per_chunk;
+    write_options.chunk_crcs = chunk_crcs;
+    
+    PcdWriter writer;
+    if (!writer.open(output_file, chunks.size(), write_options)) {
+        std::cerr << writer.error() << std::endl;
         return 1;
     }
+    writer.setBounds(bounds);
     
-    // Write header
-    file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
-    
-    // Write chunk metadata
-    file.write(reinterpret_cast<const char*>(chunk_metadata.data()), 
-               chunk_metadata.size() * sizeof(ChunkMetadata));
+    // Chunk boxes are independent, so they're computed across cores ahead of the serial writes
+    std::vector<BoundingBox> chunk_bounds(chunks.size());
+    jobs.parallelFor(0, chunks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            chunk_bounds[i] = computeBounds(&octree.points[chunks[i].first], chunks[i].count);
+        }
+    });
     
-    // Write chunk data
     for (size_t i = 0; i < chunks.size(); ++i) {
-        file.write(reinterpret_cast<const char*>(chunks[i].data()), 
-                   chunks[i].size() * sizeof(Point));
+        if (!writer.writeChunk(&octree.points[chunks[i].first], chunks[i].count, chunk_bounds[i])) {
+            std::cerr << writer.error() << std::endl;
+            return 1;
+        }
         
         if (i % 100 == 0) {
             std::cout << "Progress: " << (i * 100 / chunks.size()) << "%" << std::endl;
         }
     }
     
-    file.close();
+    // Header and index go in last, once every chunk's offset is known
+    if (!writer.finish()) {
+        std::cerr << writer.error() << std::endl;
+        return 1;
+    }
     
     // Print statistics
-    uint64_t file_size = current_offset;
+    uint64_t file_size = writer.fileSize();
     std::cout << "\n=== Generation Complete ===" << std::endl;
     std::cout << "Output file: " << output_file << std::endl;
+    if (align_payloads) {
+        std::cout << "Payload alignment: " << PCD_PAYLOAD_ALIGNMENT << " bytes" << std::endl;
+    }
+    if (bricks_per_chunk > 0) {
+        std::cout << "Bricks per chunk: " << bricks_per_chunk << std::endl;
+    }
+    if (chunk_crcs) {
+        std::cout << "Chunk CRCs: CRC32C" << std::endl;
+    }
     std::cout << "File size: " << (file_size / 1024 / 1024) << " MB" << std::endl;
-    std::cout << "Total points: " << all_points.size() << std::endl;
+    std::cout << "Total points: " << writer.totalPoints() << std::endl;
     std::cout << "Total chunks: " << chunks.size() << std::endl;
-    std::cout << "Avg points/chunk: " << (all_points.size() / chunks.size()) << std::endl;
+    std::cout << "Avg points/chunk: " << (writer.totalPoints() / chunks.size()) << std::endl;
     
     return 0;
 }
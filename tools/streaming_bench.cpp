@@ -0,0 +1,688 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "ChunkCache.h"
+#include "CompressedChunkCache.h"
+#include "ChunkLoader.h"
+#include "ChunkTrace.h"
+#include "Morton.h"
+#include "PointBudget.h"
+#include "QualityController.h"
+#include "TileManifest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Camera flies a closed loop through the dataset, visiting every region and coming back around
+struct CameraPath {
+    BoundingBox bounds;
+    int frames;
+
+    void position(int frame, float& x, float& y, float& z) const {
+        float cx, cy, cz;
+        bounds.getCenter(cx, cy, cz);
+        float t = 2.0f * 3.14159265f * static_cast<float>(frame) / static_cast<float>(frames);
+
+        x = cx + 0.4f * (bounds.max_x - bounds.min_x) * std::cos(t);
+        y = cy + 0.2f * (bounds.max_y - bounds.min_y) * std::sin(2.0f * t);
+        z = cz + 0.4f * (bounds.max_z - bounds.min_z) * std::sin(t);
+    }
+};
+
+// Adds a fixed cost to every read, like slow flash or a network mount, so reads queue up the way
+// they do on a phone instead of coming straight out of the page cache
+class SlowSource : public ChunkSource {
+public:
+    SlowSource(std::unique_ptr<ChunkSource> inner, double read_ms)
+            : inner_(std::move(inner)),
+              delay_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double, std::milli>(read_ms))) {}
+
+    size_t submit(const ChunkReadRequest* requests, size_t count) override {
+        return inner_->submit(requests, count);
+    }
+
+    size_t reap(ChunkReadCompletion* completions, size_t max, size_t min_complete) override {
+        // One at a time, so a batch's reads finish one after another instead of all at once
+        size_t n = inner_->reap(completions, std::min<size_t>(max, 1), min_complete);
+        std::this_thread::sleep_for(delay_ * n);
+        return n;
+    }
+
+    size_t inFlight() const override { return inner_->inFlight(); }
+
+    const char* name() const override { return inner_->name(); }
+
+    bool registerBuffers(void* base, size_t length) override {
+        return inner_->registerBuffers(base, length);
+    }
+
+private:
+    std::unique_ptr<ChunkSource> inner_;
+    std::chrono::steady_clock::duration delay_;
+};
+
+bool intersectsCube(const BoundingBox& box, float x, float y, float z, float half) {
+    return box.max_x >= x - half && box.min_x <= x + half &&
+           box.max_y >= y - half && box.min_y <= y + half &&
+           box.max_z >= z - half && box.min_z <= z + half;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    bool direct_io = false;
+    double fps = 0.0;
+    size_t compressed_mb = 0;
+    std::string trace_path;
+    uint64_t point_budget = 0;
+    float target_ms = 0.0f;
+    double ns_per_point = 8.0;
+    int throttle_at = 0;
+    bool adapt = true;
+    bool fifo = false;
+    float prefetch_margin = 0.0f;
+    double deadline_ms = 250.0;
+    double read_ms = 0.0;
+    uint32_t batch_size = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--direct") {
+            direct_io = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            fps = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--compressed-mb" && i + 1 < argc) {
+            compressed_mb = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--point-budget" && i + 1 < argc) {
+            point_budget = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--target-ms" && i + 1 < argc) {
+            target_ms = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--ns-per-point" && i + 1 < argc) {
+            ns_per_point = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--throttle-at" && i + 1 < argc) {
+            throttle_at = std::atoi(argv[++i]);
+        } else if (arg == "--no-adapt") {
+            adapt = false;
+        } else if (arg == "--fifo") {
+            fifo = true;
+        } else if (arg == "--prefetch" && i + 1 < argc) {
+            prefetch_margin = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--deadline-ms" && i + 1 < argc) {
+            deadline_ms = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--read-ms" && i + 1 < argc) {
+            read_ms = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_size = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <pointcloud_file|manifest.tiles> [frames] [cache_slots] [view_fraction] [pread|mmap|io_uring]"
+                  << " [--direct] [--fps N] [--compressed-mb N] [--trace out.txt]"
+                  << " [--point-budget N] [--target-ms T [--ns-per-point N] [--throttle-at F] [--no-adapt]]"
+                  << " [--fifo] [--prefetch M [--deadline-ms N]] [--read-ms N] [--batch N]" << std::endl;
+        return 1;
+    }
+
+    std::string filename = args[0];
+    int frames = (args.size() > 1) ? std::atoi(args[1].c_str()) : 600;
+    uint32_t slots = (args.size() > 2) ? std::strtoul(args[2].c_str(), nullptr, 10) : 64;
+    float view_fraction = (args.size() > 3) ? std::strtof(args[3].c_str(), nullptr) : 0.25f;
+    std::string backend = (args.size() > 4) ? args[4] : "pread";
+
+    if (frames <= 0 || slots == 0) {
+        std::cerr << "frames and cache_slots must be positive" << std::endl;
+        return 1;
+    }
+
+    if (target_ms > 0.0f && point_budget == 0) {
+        std::cerr << "--target-ms needs --point-budget, the budget at full quality" << std::endl;
+        return 1;
+    }
+
+    ChunkSourceKind kind;
+    if (!ChunkSource::parseKind(backend, kind)) {
+        std::cerr << "Unknown backend: " << backend << std::endl;
+        return 1;
+    }
+
+    // A tile manifest (see pcd_tile) stands in for the .pcd the way it does in the app: the index
+    // covers every tile's chunks, and each tile's chunks fill in as the camera nears it
+    bool tiled = filename.size() > 6 && filename.compare(filename.size() - 6, 6, ".tiles") == 0;
+    TileManifest manifest;
+    TileIndex tile_index;
+    std::vector<bool> tile_opened;
+
+    PcdIndex index;
+    std::string error;
+    if (tiled) {
+        if (!readTileManifest(filename, manifest, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        if (!trace_path.empty()) {
+            std::cerr << "--trace needs a single .pcd; pcd_layout reorders one file" << std::endl;
+            return 1;
+        }
+        if (kind != ChunkSourceKind::PRead) {
+            std::cout << "Tiled datasets are read with pread, ignoring " << backend << std::endl;
+        }
+        tile_index = TileIndex(manifest);
+        tile_opened.assign(manifest.tiles.size(), false);
+
+        // Chunks of tiles not opened yet have empty boxes, so they're never in view
+        index.header.version = PCD_VERSION;
+        index.header.bounds = manifest.bounds;
+        index.header.flags = manifest.flags;
+        index.header.total_points = manifest.totalPoints();
+        index.header.chunk_count = static_cast<uint32_t>(manifest.chunkCount());
+        index.header.chunk_size = manifest.chunk_size;
+        index.chunks.assign(manifest.chunkCount(), {BoundingBox::empty(), 0, 0, 0});
+        if (manifest.flags & PCD_FLAG_CHUNK_CRCS) {
+            index.chunk_crcs.assign(manifest.chunkCount(), 0);
+        }
+    } else if (!readPcdIndex(filename, index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    const FileHeader& header = index.header;
+    const std::vector<ChunkMetadata>& chunks = index.chunks;
+    if (chunks.empty()) {
+        std::cerr << "No chunks found!" << std::endl;
+        return 1;
+    }
+
+    if (direct_io && !(headerFlags(header) & PCD_FLAG_ALIGNED_PAYLOADS)) {
+        std::cerr << "--direct needs a file generated with --align" << std::endl;
+        return 1;
+    }
+
+    uint32_t slot_points = header.chunk_size;
+    for (const auto& chunk : chunks) {
+        slot_points = std::max(slot_points, chunk.point_count);
+    }
+
+    ChunkSourceOptions source_options;
+    source_options.direct_io = direct_io;
+    std::unique_ptr<ChunkSource> source;
+    TiledChunkSource* tiled_source = nullptr;
+    if (tiled) {
+        auto tiles = std::make_unique<TiledChunkSource>(source_options);
+        tiled_source = tiles.get();
+        source = std::move(tiles);
+    } else {
+        source = ChunkSource::open(filename, kind, source_options);
+    }
+    if (!source) {
+        std::cerr << "Failed to open " << filename << " with " << backend << ": "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    if (read_ms > 0.0) {
+        source = std::make_unique<SlowSource>(std::move(source), read_ms);
+    }
+
+    ChunkLoaderOptions loader_options;
+    if (batch_size > 0) {
+        loader_options.batch_size = batch_size;
+    }
+    loader_options.direct_io = direct_io;
+    loader_options.max_read_length = slot_points * sizeof(Point);
+    ChunkLoader loader(std::move(source), loader_options);
+    if (!loader.valid()) {
+        std::cerr << "Failed to allocate staging buffers" << std::endl;
+        return 1;
+    }
+
+    // Disk reads, recorded the way the app records them, for pcd_layout
+    ChunkTraceWriter trace;
+    ChunkCodeMap codes(index, MORTON_MAX_DEPTH);
+    if (!trace_path.empty() && !trace.open(trace_path, MORTON_MAX_DEPTH)) {
+        std::cerr << "Failed to open trace " << trace_path << std::endl;
+        return 1;
+    }
+
+    // Reads a tile's index and hands the tile to the loader, the way the app's openTile() does.
+    // A tile that can't be used stays closed, and its chunks out of view.
+    uint32_t tiles_failed = 0;
+    auto openTile = [&](uint32_t tile) {
+        const TileEntry& entry = manifest.tiles[tile];
+        tile_opened[tile] = true;
+
+        std::string path = tilePath(filename, entry);
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        ChunkFileRange file{fd, 0, 0};
+        PcdIndex tile_pcd;
+        std::string tile_error;
+        bool usable = fd >= 0 && readPcdIndex(file, tile_pcd, &tile_error);
+        if (!usable) {
+            tile_error = fd < 0 ? std::strerror(errno) : tile_error;
+        } else if (tile_pcd.chunks.size() != entry.chunk_count ||
+                   (headerFlags(tile_pcd.header) & manifest.flags) != manifest.flags) {
+            tile_error = "doesn't match the manifest";
+            usable = false;
+        } else if (!tiled_source->addTile(tile, file)) {
+            tile_error = std::strerror(errno);
+            usable = false;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (!usable) {
+            std::cerr << "Skipping tile " << path << ": " << tile_error << std::endl;
+            tiles_failed++;
+            return;
+        }
+
+        for (uint32_t i = 0; i < entry.chunk_count; ++i) {
+            ChunkMetadata chunk = tile_pcd.chunks[i];
+            chunk.file_offset = tiledOffset(tile, chunk.file_offset);
+            index.chunks[entry.first_chunk + i] = chunk;
+        }
+        if (!index.chunk_crcs.empty()) {
+            std::copy(tile_pcd.chunk_crcs.begin(), tile_pcd.chunk_crcs.end(),
+                      index.chunk_crcs.begin() + entry.first_chunk);
+        }
+    };
+    std::vector<uint32_t> near_tiles;
+
+    ChunkCache cache(slots, slot_points);
+    CompressedChunkCache compressed(compressed_mb * 1024 * 1024);
+    CameraPath path{header.bounds, frames};
+    float half = 0.5f * view_fraction * header.bounds.maxDimension();
+
+    // Without --point-budget every visible chunk is streamed and drawn in full
+    PointBudgetOptions budget_options;
+    budget_options.budget = point_budget;
+    budget_options.max_chunks = slots;
+    PointBudgetScheduler scheduler(budget_options);
+    std::vector<BudgetCandidate> candidates;
+
+    // With --target-ms the controller moves the budget and the view distance, against a frame
+    // time modeled as the frame's CPU time plus a fixed cost per point drawn. --throttle-at
+    // doubles that cost part way through, the way a phone slows down once it heats up.
+    // --no-adapt models the same frame times at full quality, for comparison.
+    QualityControllerOptions quality_options;
+    quality_options.target_ms = target_ms;
+    quality_options.max_budget = point_budget;
+    quality_options.min_budget = std::min(quality_options.min_budget, point_budget);
+    QualityController controller(quality_options);
+    std::vector<float> frame_ms;
+
+    // Reads are ranked by how large their chunk is on screen and reranked every frame; reads for
+    // chunks that dropped out of view are cancelled. --fifo serves them in request order instead.
+    // --prefetch also requests the chunks in a margin around the view, as speculative reads that
+    // give way to visible ones and are dropped if still queued after --deadline-ms.
+    auto screenSize = [](const BoundingBox& b, float x, float y, float z) {
+        float dx = std::max({b.min_x - x, x - b.max_x, 0.0f});
+        float dy = std::max({b.min_y - y, y - b.max_y, 0.0f});
+        float dz = std::max({b.min_z - z, z - b.max_z, 0.0f});
+        float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1e-3f);
+        float sx = b.max_x - b.min_x, sy = b.max_y - b.min_y, sz = b.max_z - b.min_z;
+        return std::sqrt(sx * sx + sy * sy + sz * sz) * 1000.0f / distance;
+    };
+    auto deadline = std::chrono::duration_cast<ChunkLoadClock::duration>(
+            std::chrono::duration<double, std::milli>(deadline_ms));
+    std::vector<int> chunk_wanted(chunks.size(), 0);
+    std::vector<int> chunk_prefetch(chunks.size(), 0);
+    std::vector<bool> slot_in_flight(slots, false);
+    std::vector<bool> slot_speculative(slots, false);
+    std::vector<uint32_t> in_flight;
+    std::vector<uint32_t> margin;
+    std::vector<ChunkLoadPriority> priorities;
+    uint64_t cancelled = 0, expired = 0, prefetched = 0;
+    uint64_t visible_waited = 0, visible_landed = 0, prefetch_landed = 0;
+    double size_wanted = 0.0, size_resident = 0.0;
+
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> wanted;
+    std::vector<uint32_t> draw_points(chunks.size(), 0);
+    std::vector<ChunkLoadResult> results;
+    std::vector<CompressedChunk> demoted;
+    uint64_t requested = 0, promoted = 0, loaded = 0, failed = 0, bytes = 0;
+    uint64_t visible_total = 0, streamed_total = 0, resident_total = 0, dropped = 0;
+    uint64_t drawn_max = 0;
+    double drawn_sum = 0.0, drawn_sq_sum = 0.0;
+
+    std::cout << "Streaming " << frames << " frames over " << chunks.size() << " chunks, "
+              << slots << " cache slots, view cube " << std::fixed << std::setprecision(1)
+              << (2.0f * half) << " units, " << loader.sourceName()
+              << (direct_io ? " (direct)" : "") << std::endl;
+    if (tiled) {
+        std::cout << "Tiled dataset: " << manifest.tiles.size() << " tiles, opened as the camera nears them"
+                  << std::endl;
+    }
+    if (point_budget > 0) {
+        std::cout << "Point budget: " << point_budget << " per frame" << std::endl;
+    }
+    if (compressed_mb > 0) {
+        std::cout << "Compressed tier: " << compressed_mb << " MB" << std::endl;
+    }
+
+    auto landResults = [&]() {
+        results.clear();
+        loader.poll(results);
+        for (const auto& result : results) {
+            auto slot = static_cast<uint32_t>(result.user_data);
+            slot_in_flight[slot] = false;
+            uint32_t expected = chunks[cache.slotChunk(slot)].point_count;
+            if (result.result == int64_t(expected) * int64_t(sizeof(Point))) {
+                cache.markLoaded(slot, expected);
+                loaded++;
+                bytes += result.result;
+                if (slot_speculative[slot]) {
+                    prefetch_landed++;
+                } else {
+                    visible_landed++;
+                }
+            } else if (result.result == -ECANCELED || result.result == -ETIMEDOUT) {
+                compressed.retire(cache.slotChunk(slot));
+                cache.release(slot);
+                (result.result == -ECANCELED ? cancelled : expired)++;
+            } else {
+                compressed.retire(cache.slotChunk(slot));
+                cache.release(slot);
+                failed++;
+            }
+        }
+
+        demoted.clear();
+        loader.pollCompressed(demoted);
+        for (auto& chunk : demoted) {
+            compressed.insert(chunk.chunk_id, std::move(chunk.blob));
+        }
+    };
+
+    // Without --fps frames run back to back, which measures scheduling cost rather than how far
+    // reads fall behind a real frame rate
+    auto frame_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(fps > 0.0 ? 1.0 / fps : 0.0));
+    auto start = std::chrono::steady_clock::now();
+
+    auto requestChunk = [&](uint32_t chunk_id, uint32_t slot, uint32_t evicted, int frame,
+                            float priority, bool speculative) {
+        const ChunkMetadata& chunk = chunks[chunk_id];
+        ChunkLoadRequest request{chunk.file_offset, chunk.point_count * uint32_t(sizeof(Point)),
+                                 cache.slotData(slot), slot};
+        if (!fifo) {
+            request.priority = priority;
+            request.prefetch = speculative;
+            if (speculative) {
+                request.deadline = ChunkLoadClock::now() + deadline;
+            }
+        }
+
+        if (compressed.budget() > 0) {
+            // Keep the evicted chunk around compressed, and promote this one if we have it.
+            // Chunks are immutable, so one already in the tier needn't be encoded again, and one
+            // decoded from it goes back as its original blob rather than being encoded twice.
+            if (evicted != ChunkCache::kNoSlot && !compressed.retire(evicted) &&
+                !compressed.contains(evicted)) {
+                request.demote_chunk = evicted;
+                request.demote_points = chunks[evicted].point_count;
+            }
+            request.compressed = compressed.promote(chunk_id);
+        }
+
+        if (!request.compressed && !index.chunk_crcs.empty()) {
+            request.verify = true;
+            request.crc = index.chunk_crcs[chunk_id];
+        }
+
+        if (request.compressed) {
+            promoted++;
+        } else {
+            requested++;
+            trace.record(frame, codes.code(chunk_id));
+        }
+        slot_speculative[slot] = speculative;
+        if (!slot_in_flight[slot]) {
+            slot_in_flight[slot] = true;
+            in_flight.push_back(slot);
+        }
+        loader.request(request);
+    };
+
+    for (int frame = 1; frame <= frames; ++frame) {
+        if (fps > 0.0) {
+            std::this_thread::sleep_until(start + frame_time * frame);
+        }
+
+
+        auto frame_start = std::chrono::steady_clock::now();
+
+        // Land whatever finished since the last frame
+        landResults();
+
+        float x, y, z;
+        path.position(frame, x, y, z);
+
+        float view_half = target_ms > 0.0f ? half * controller.drawDistance() : half;
+
+        // Tiles reaching into the view or the prefetch margin around it
+        if (tiled) {
+            float reach = view_half * (1.0f + prefetch_margin);
+            near_tiles.clear();
+            tile_index.query({x - reach, y - reach, z - reach, x + reach, y + reach, z + reach},
+                             near_tiles);
+            for (uint32_t tile : near_tiles) {
+                if (!tile_opened[tile]) {
+                    openTile(tile);
+                }
+            }
+        }
+        visible.clear();
+        for (uint32_t i = 0; i < chunks.size(); ++i) {
+            if (intersectsCube(chunks[i].bbox, x, y, z, view_half)) {
+                visible.push_back(i);
+            }
+        }
+
+        // The scheduler picks which visible chunks to stream, largest on screen first, and how
+        // many of their points to draw
+        wanted.clear();
+        if (point_budget > 0) {
+            candidates.clear();
+            for (uint32_t chunk_id : visible) {
+                candidates.push_back({chunks[chunk_id].bbox, chunks[chunk_id].point_count});
+            }
+            float eye[3] = {x, y, z};
+            for (const auto& a : scheduler.schedule(candidates, eye)) {
+                if (a.draw_points > 0) {
+                    wanted.push_back(visible[a.candidate]);
+                    draw_points[visible[a.candidate]] = a.draw_points;
+                }
+            }
+        } else {
+            for (uint32_t chunk_id : visible) {
+                wanted.push_back(chunk_id);
+                draw_points[chunk_id] = chunks[chunk_id].point_count;
+            }
+        }
+
+        for (uint32_t chunk_id : wanted) {
+            chunk_wanted[chunk_id] = frame;
+        }
+
+        margin.clear();
+        if (prefetch_margin > 0.0f) {
+            float prefetch_half = view_half * (1.0f + prefetch_margin);
+            for (uint32_t i = 0; i < chunks.size(); ++i) {
+                if (chunk_wanted[i] != frame && intersectsCube(chunks[i].bbox, x, y, z, prefetch_half)) {
+                    chunk_prefetch[i] = frame;
+                    margin.push_back(i);
+                }
+            }
+        }
+
+        // Rerank what's still queued for this view, and cancel what fell out of it
+        if (!fifo) {
+            priorities.clear();
+            size_t kept = 0;
+            for (uint32_t slot : in_flight) {
+                if (!slot_in_flight[slot]) {
+                    continue;
+                }
+                uint32_t chunk_id = cache.slotChunk(slot);
+                bool speculative = chunk_wanted[chunk_id] != frame;
+                if (speculative && chunk_prefetch[chunk_id] != frame) {
+                    loader.cancel(slot);
+                } else {
+                    priorities.push_back({slot, screenSize(chunks[chunk_id].bbox, x, y, z), speculative});
+                    slot_speculative[slot] = speculative;
+                }
+                in_flight[kept++] = slot;
+            }
+            in_flight.resize(kept);
+            loader.reprioritize(priorities.data(), priorities.size());
+        }
+
+        uint64_t drawn = 0;
+        for (uint32_t chunk_id : wanted) {
+            float size = screenSize(chunks[chunk_id].bbox, x, y, z);
+            size_wanted += size;
+
+            uint32_t slot = cache.lookup(chunk_id, frame);
+            if (slot == ChunkCache::kNoSlot) {
+                uint32_t evicted;
+                slot = cache.allocate(chunk_id, frame, &evicted);
+                if (slot == ChunkCache::kNoSlot) {
+                    // Working set is bigger than the cache
+                    dropped++;
+                    continue;
+                }
+                requestChunk(chunk_id, slot, evicted, frame, size, false);
+            } else if (cache.isLoaded(slot)) {
+                resident_total++;
+                size_resident += size;
+                drawn += draw_points[chunk_id];
+            } else {
+                visible_waited++;
+            }
+        }
+
+        for (uint32_t chunk_id : margin) {
+            if (cache.isResident(chunk_id)) {
+                continue;
+            }
+            uint32_t evicted;
+            uint32_t slot = cache.allocate(chunk_id, frame, &evicted);
+            if (slot != ChunkCache::kNoSlot) {
+                requestChunk(chunk_id, slot, evicted, frame, screenSize(chunks[chunk_id].bbox, x, y, z), true);
+                prefetched++;
+            }
+        }
+        visible_total += visible.size();
+        streamed_total += wanted.size();
+        drawn_sum += double(drawn);
+        drawn_sq_sum += double(drawn) * double(drawn);
+        drawn_max = std::max(drawn_max, drawn);
+
+        if (target_ms > 0.0f) {
+            double cpu_ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - frame_start).count();
+            double per_point = (throttle_at > 0 && frame >= throttle_at) ? 2.0 * ns_per_point : ns_per_point;
+            auto ms = static_cast<float>(cpu_ms + double(drawn) * per_point * 1e-6);
+            frame_ms.push_back(ms);
+            if (adapt && controller.addFrame(ms)) {
+                scheduler.setBudget(controller.pointBudget());
+            }
+        }
+    }
+
+    loader.waitIdle();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    landResults();
+
+    uint64_t lookups = cache.hits() + cache.misses();
+    std::cout << "\n=== Streaming Results ===" << std::endl;
+    std::cout << "Time: " << std::setprecision(3) << seconds << " s ("
+              << std::setprecision(1) << (frames / seconds) << " frames/s)" << std::endl;
+    std::cout << "Visible chunks per frame: " << (double(visible_total) / frames) << std::endl;
+    if (point_budget > 0) {
+        std::cout << "Scheduled chunks per frame: " << (double(streamed_total) / frames) << std::endl;
+    }
+    std::cout << "Resident when drawn: " << (100.0 * resident_total / std::max<uint64_t>(streamed_total, 1))
+              << "%" << std::endl;
+    double drawn_mean = drawn_sum / frames;
+    double drawn_stddev = std::sqrt(std::max(0.0, drawn_sq_sum / frames - drawn_mean * drawn_mean));
+    std::cout << "Points drawn per frame: mean " << std::setprecision(0) << drawn_mean
+              << ", max " << drawn_max << ", stddev " << drawn_stddev << std::setprecision(1)
+              << std::endl;
+    if (target_ms > 0.0f) {
+        // Skip the first second while the controller finds its level
+        size_t skip = std::min<size_t>(frame_ms.size(), 60);
+        std::vector<float> settled(frame_ms.begin() + skip, frame_ms.end());
+        std::sort(settled.begin(), settled.end());
+        double mean = 0.0;
+        size_t over = 0;
+        for (float ms : settled) {
+            mean += ms;
+            over += ms > target_ms * (1.0f + quality_options.deadband);
+        }
+        mean /= std::max<size_t>(settled.size(), 1);
+        float p95 = settled.empty() ? 0.0f : settled[settled.size() * 95 / 100];
+
+        std::cout << "Modeled frame time: mean " << std::setprecision(2) << mean << " ms, p95 "
+                  << p95 << " ms, " << std::setprecision(1)
+                  << (100.0 * over / std::max<size_t>(settled.size(), 1)) << "% of frames over "
+                  << target_ms << " ms +" << (100.0f * quality_options.deadband) << "%" << std::endl;
+        std::cout << "Quality changes: " << controller.increases() << " up, "
+                  << controller.decreases() << " down; final quality " << std::setprecision(2)
+                  << controller.quality() << ", budget " << controller.pointBudget()
+                  << ", view distance x" << controller.drawDistance() << ", point size "
+                  << controller.pointSize() << std::setprecision(1) << std::endl;
+    }
+    std::cout << "Resident when drawn, by screen size: "
+              << (100.0 * size_resident / std::max(size_wanted, 1e-9)) << "%" << std::endl;
+    std::cout << "Visible chunks waiting on a read: " << (double(visible_waited) / frames)
+              << " per frame" << std::endl;
+    std::cout << "Cache hit rate: " << (100.0 * cache.hits() / std::max<uint64_t>(lookups, 1))
+              << "%" << std::endl;
+    std::cout << "Chunk loads: " << (requested + promoted) << " (" << loaded << " ok, " << failed
+              << " failed, " << (bytes / 1024 / 1024) << " MB)" << std::endl;
+    if (!index.chunk_crcs.empty()) {
+        std::cout << "CRC checked: " << (loader.bytesVerified() / 1024 / 1024) << " MB, "
+                  << loader.crcMismatches() << " mismatches, " << loader.crcRejected() << " rejected"
+                  << std::endl;
+    }
+    std::cout << "  From disk: " << requested << std::endl;
+    if (tiled) {
+        std::cout << "Tiles opened: " << tiled_source->tileCount() << " of " << manifest.tiles.size()
+                  << (tiles_failed > 0 ? ", " + std::to_string(tiles_failed) + " skipped" : "")
+                  << std::endl;
+    }
+    if (compressed.budget() > 0) {
+        std::cout << "  From compressed tier: " << promoted << " ("
+                  << compressed.size() << " chunks, " << (compressed.bytes() / 1024 / 1024)
+                  << " MB held at the end, " << compressed.held() << " promoted ones kept, "
+                  << (compressed.heldBytes() / 1024 / 1024) << " MB)" << std::endl;
+    }
+    if (prefetch_margin > 0.0f) {
+        std::cout << "  Prefetches: " << prefetched << " (" << prefetch_landed << " landed, "
+                  << expired << " past deadline)" << std::endl;
+    }
+    std::cout << "Cancelled (out of view): " << cancelled << std::endl;
+    std::cout << "Evictions: " << cache.evictions() << std::endl;
+    std::cout << "Dropped (cache full): " << dropped << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+#include "PcdFile.h"
+#include "CameraPath.h"
+#include "JobSystem.h"
+#include "StreamingSimulator.h"
+
+// Replays a recorded camera path (or streaming_bench's loop) over a dataset's chunk index and
+// simulates streaming it: selection, caching, eviction, prefetching and reads from a modeled
+// storage device, without touching a payload. Every combination of the comma separated values
+// given is simulated, in parallel, so cache budgets, policies and devices can be compared in
+// seconds instead of on a phone.
+
+using Clock = std::chrono::steady_clock;
+
+// Parses a comma separated list of non-negative numbers
+bool parseNumbers(const std::string& value, std::vector<double>& out) {
+    out.clear();
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        double v = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || !(v >= 0.0)) {
+            return false;
+        }
+        out.push_back(v);
+    }
+    return !out.empty();
+}
+
+bool parsePolicies(const std::string& value, std::vector<EvictionPolicy>& out) {
+    out.clear();
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        EvictionPolicy policy;
+        if (!parseEvictionPolicy(item, policy)) {
+            return false;
+        }
+        out.push_back(policy);
+    }
+    return !out.empty();
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    int frames = 600;
+    uint32_t threads = 0;
+    std::string csv_path;
+    StreamingSimOptions base;
+    std::vector<double> cache_mb = {256.0};
+    std::vector<EvictionPolicy> policies = {EvictionPolicy::Lru};
+    std::vector<double> margins = {0.0};
+    std::vector<double> lookaheads = {0.0};
+    std::vector<double> latencies = {base.storage.latency_ms};
+    std::vector<double> bandwidths = {base.storage.bandwidth_mb_s};
+    std::vector<double> depths = {double(base.storage.queue_depth)};
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+            usage |= frames <= 0;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            base.fps = std::strtod(argv[++i], nullptr);
+            usage |= !(base.fps > 0.0);
+        } else if (arg == "--view" && i + 1 < argc) {
+            base.view_size = std::strtof(argv[++i], nullptr);
+            usage |= !(base.view_size > 0.0f);
+        } else if (arg == "--deadline-ms" && i + 1 < argc) {
+            base.deadline_ms = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            usage |= !parseNumbers(argv[++i], cache_mb);
+        } else if (arg == "--policy" && i + 1 < argc) {
+            usage |= !parsePolicies(argv[++i], policies);
+        } else if (arg == "--prefetch" && i + 1 < argc) {
+            usage |= !parseNumbers(argv[++i], margins);
+        } else if (arg == "--lookahead" && i + 1 < argc) {
+            usage |= !parseNumbers(argv[++i], lookaheads);
+        } else if (arg == "--latency-ms" && i + 1 < argc) {
+            usage |= !parseNumbers(argv[++i], latencies);
+        } else if (arg == "--bandwidth-mb" && i + 1 < argc) {
+            usage |= !parseNumbers(argv[++i], bandwidths);
+            usage |= std::find(bandwidths.begin(), bandwidths.end(), 0.0) != bandwidths.end();
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            usage |= !parseNumbers(argv[++i], depths);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (usage || args.empty() || args.size() > 2) {
+        std::cerr << "Usage: " << argv[0] << " <pointcloud_file> [camera_path.txt] [--frames N] [--fps N]"
+                  << " [--view S] [--deadline-ms N] [--cache-mb A,B,..] [--policy lru,fifo,farthest]"
+                  << " [--prefetch M,..] [--lookahead F,..] [--latency-ms A,..] [--bandwidth-mb A,..]"
+                  << " [--queue-depth A,..] [--threads N] [--csv out.csv]" << std::endl;
+        return 1;
+    }
+
+    PcdIndex index;
+    std::string error;
+    if (!readPcdIndex(args[0], index, &error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (index.chunks.empty()) {
+        std::cerr << "No chunks found!" << std::endl;
+        return 1;
+    }
+
+    // Without a recorded path the camera flies streaming_bench's loop, --frames long
+    CameraPath path;
+    if (args.size() > 1) {
+        if (!readCameraPath(args[1], path, &error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    } else {
+        path = loopCameraPath(index.header.bounds, frames);
+    }
+    if (!(base.view_size > 0.0f)) {
+        base.view_size = path.view_size > 0.0f ? path.view_size : 0.25f * index.header.bounds.maxDimension();
+    }
+
+    // Every combination, the last option varying fastest
+    std::vector<StreamingSimOptions> grid;
+    for (double mb : cache_mb) {
+        for (EvictionPolicy policy : policies) {
+            for (double margin : margins) {
+                for (double lookahead : lookaheads) {
+                    for (double latency : latencies) {
+                        for (double bandwidth : bandwidths) {
+                            for (double depth : depths) {
+                                StreamingSimOptions options = base;
+                                options.cache_bytes = static_cast<uint64_t>(mb * 1024.0 * 1024.0);
+                                options.policy = policy;
+                                options.prefetch_margin = static_cast<float>(margin);
+                                options.lookahead_frames = static_cast<int>(lookahead);
+                                options.storage.latency_ms = latency;
+                                options.storage.bandwidth_mb_s = bandwidth;
+                                options.storage.queue_depth = std::max<uint32_t>(static_cast<uint32_t>(depth), 1);
+                                grid.push_back(options);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    JobSystem jobs(threads > 0 ? threads - 1 : JobSystem::kAutoWorkers);
+    std::cout << "Simulating " << grid.size() << " configurations over " << path.poses.size() << " frames at "
+              << base.fps << " fps, " << index.chunks.size() << " chunks, view box " << std::fixed
+              << std::setprecision(1) << base.view_size << " units, on " << jobs.concurrency() << " threads"
+              << std::endl;
+
+    auto start = Clock::now();
+    std::vector<StreamingSimResult> results(grid.size());
+    jobs.parallelFor(0, grid.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            results[i] = simulateStreaming(index.chunks, path, grid[i]);
+        }
+    });
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "\n" << std::setw(8) << "cache_mb" << std::setw(10) << "policy" << std::setw(10) << "prefetch"
+              << std::setw(10) << "lookahead" << std::setw(11) << "latency_ms" << std::setw(10) << "bw_mb_s"
+              << std::setw(6) << "qd" << " |" << std::setw(8) << "hit%" << std::setw(8) << "stalls"
+              << std::setw(10) << "read_mb" << std::setw(8) << "reads" << std::setw(10) << "wasted_pf"
+              << std::setw(9) << "peak_mb" << std::setw(9) << "read_ms" << std::endl;
+    for (size_t i = 0; i < grid.size(); ++i) {
+        const StreamingSimOptions& o = grid[i];
+        const StreamingSimResult& r = results[i];
+        std::cout << std::setprecision(0) << std::setw(8) << o.cache_bytes / mb << std::setw(10)
+                  << evictionPolicyName(o.policy) << std::setprecision(2) << std::setw(10) << o.prefetch_margin
+                  << std::setw(10) << o.lookahead_frames << std::setw(11) << o.storage.latency_ms
+                  << std::setprecision(0) << std::setw(10) << o.storage.bandwidth_mb_s << std::setw(6)
+                  << o.storage.queue_depth << " |" << std::setprecision(1) << std::setw(8) << 100.0 * r.hitRate()
+                  << std::setw(8) << r.stall_frames << std::setw(10) << r.bytes_read / mb << std::setw(8) << r.reads
+                  << std::setw(10) << r.wasted_prefetches << std::setw(9) << r.peak_bytes / mb
+                  << std::setprecision(2) << std::setw(9) << r.mean_read_ms << std::endl;
+    }
+    std::cout << "\nSimulated in " << std::setprecision(2) << seconds << " s" << std::endl;
+
+    if (!csv_path.empty()) {
+        std::ofstream csv(csv_path, std::ios::out | std::ios::trunc);
+        csv << "cache_mb,policy,prefetch,lookahead,latency_ms,bandwidth_mb_s,queue_depth,frames,lookups,hits,"
+               "hit_rate,stall_frames,reads,prefetch_reads,wasted_prefetches,bytes_read,cancelled,expired,"
+               "dropped,evictions,peak_bytes,mean_read_ms\n";
+        csv << std::setprecision(6) << std::defaultfloat;
+        for (size_t i = 0; i < grid.size(); ++i) {
+            const StreamingSimOptions& o = grid[i];
+            const StreamingSimResult& r = results[i];
+            csv << o.cache_bytes / mb << ',' << evictionPolicyName(o.policy) << ',' << o.prefetch_margin << ','
+                << o.lookahead_frames << ',' << o.storage.latency_ms << ',' << o.storage.bandwidth_mb_s << ','
+                << o.storage.queue_depth << ',' << r.frames << ',' << r.lookups << ',' << r.hits << ','
+                << r.hitRate() << ',' << r.stall_frames << ',' << r.reads << ',' << r.prefetch_reads << ','
+                << r.wasted_prefetches << ',' << r.bytes_read << ',' << r.cancelled << ',' << r.expired << ','
+                << r.dropped << ',' << r.evictions << ',' << r.peak_bytes << ',' << r.mean_read_ms << '\n';
+        }
+        csv.close();
+        if (!csv) {
+            std::cerr << "Failed to write " << csv_path << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << csv_path << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "TestHarness.h"
+#include "ChunkCache.h"
+#include "CompressedChunkCache.h"
+
+// Loads @a chunk_id into a fresh slot, as the loader would once its read lands
+static uint32_t load(ChunkCache& cache, uint32_t chunk_id, uint64_t frame, uint32_t* evicted = nullptr) {
+    uint32_t slot = cache.allocate(chunk_id, frame, evicted);
+    if (slot != ChunkCache::kNoSlot) {
+        cache.markLoaded(slot, 10);
+    }
+    return slot;
+}
+
+TEST(ChunkCacheEvictsLeastRecentlyUsed) {
+    ChunkCache cache(3, 16);
+    load(cache, 1, 1);
+    load(cache, 2, 2);
+    load(cache, 3, 3);
+    CHECK(cache.lookup(1, 4) != ChunkCache::kNoSlot);
+
+    uint32_t evicted = ChunkCache::kNoSlot;
+    REQUIRE(load(cache, 4, 5, &evicted) != ChunkCache::kNoSlot);
+    CHECK_EQ(evicted, 2u);
+    CHECK(!cache.isResident(2));
+    CHECK(cache.isResident(1));
+    CHECK_EQ(cache.evictions(), uint64_t(1));
+
+    REQUIRE(load(cache, 5, 6, &evicted) != ChunkCache::kNoSlot);
+    CHECK_EQ(evicted, 3u);
+}
+
+TEST(ChunkCacheKeepsLoadingSlots) {
+    ChunkCache cache(2, 16);
+    uint32_t loading = cache.allocate(1, 1);
+    load(cache, 2, 1);
+
+    // Chunk 2 is the only one that can go, loaded but older than this frame
+    uint32_t evicted = ChunkCache::kNoSlot;
+    uint32_t slot = load(cache, 3, 2, &evicted);
+    CHECK(slot != ChunkCache::kNoSlot && slot != loading);
+    CHECK_EQ(evicted, 2u);
+
+    // Now one slot is loading and the other was used this frame
+    CHECK_EQ(cache.allocate(4, 2), ChunkCache::kNoSlot);
+    cache.markLoaded(loading, 10);
+    CHECK(cache.allocate(4, 3) != ChunkCache::kNoSlot);
+}
+
+TEST(ChunkCacheKeepsCurrentFrame) {
+    ChunkCache cache(2, 16);
+    load(cache, 1, 7);
+    load(cache, 2, 7);
+    CHECK_EQ(cache.allocate(3, 7), ChunkCache::kNoSlot);
+    CHECK(cache.lookup(1, 8) != ChunkCache::kNoSlot);
+    uint32_t evicted = ChunkCache::kNoSlot;
+    CHECK(load(cache, 3, 8, &evicted) != ChunkCache::kNoSlot);
+    CHECK_EQ(evicted, 2u);
+}
+
+TEST(ChunkCacheReleaseFreesSlot) {
+    ChunkCache cache(1, 16);
+    uint32_t slot = cache.allocate(1, 1);
+    cache.release(slot);
+    CHECK(!cache.isResident(1));
+    uint32_t evicted = 0;
+    CHECK_EQ(cache.allocate(2, 1, &evicted), slot);
+    CHECK_EQ(evicted, ChunkCache::kNoSlot);
+    CHECK_EQ(cache.lookup(1, 2), ChunkCache::kNoSlot);
+    CHECK_EQ(cache.misses(), uint64_t(1));
+}
+
+static ChunkBlob blobOf(size_t bytes, uint8_t fill) {
+    return std::make_shared<const std::vector<uint8_t>>(bytes, fill);
+}
+
+TEST(CompressedChunkCacheBudget) {
+    CompressedChunkCache tier(300);
+    tier.insert(1, blobOf(100, 1));
+    tier.insert(2, blobOf(100, 2));
+    tier.insert(3, blobOf(100, 3));
+    CHECK(tier.find(1) != nullptr);
+
+    tier.insert(4, blobOf(100, 4));
+    CHECK(!tier.contains(2));
+    CHECK(tier.contains(1));
+    CHECK_EQ(tier.bytes(), size_t(300));
+
+    tier.insert(5, blobOf(400, 5));
+    CHECK(!tier.contains(5));
+}
+
+TEST(CompressedChunkCacheReturnsPromotedBlob) {
+    CompressedChunkCache tier(200);
+    tier.insert(1, blobOf(100, 1));
+    ChunkBlob promoted = tier.promote(1);
+    REQUIRE(promoted != nullptr);
+    CHECK(tier.promote(9) == nullptr);
+
+    // The tier moves on while chunk 1 is decoded...
+    tier.insert(2, blobOf(100, 2));
+    tier.insert(3, blobOf(100, 3));
+    CHECK(!tier.contains(1));
+    CHECK_EQ(tier.held(), size_t(1));
+    CHECK_EQ(tier.heldBytes(), size_t(100));
+
+    // ...and it comes back as the same bytes, not encoded from its decoded points
+    CHECK(tier.retire(1));
+    CHECK(tier.find(1) == promoted);
+    CHECK_EQ(tier.held(), size_t(0));
+    CHECK(!tier.retire(1));
+    CHECK(!tier.retire(2));
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "TestHarness.h"
+#include "ChunkCodec.h"
+#include "PcdFile.h"
+
+static void checkRoundTrip(const std::vector<Point>& points, int bits) {
+    ChunkCodecOptions options;
+    options.position_bits = bits;
+    std::vector<uint8_t> blob;
+    encodeChunk(points.data(), static_cast<uint32_t>(points.size()), blob, options);
+    CHECK_EQ(encodedPointCount(blob.data(), blob.size()), uint32_t(points.size()));
+
+    std::vector<Point> decoded(points.size());
+    REQUIRE(decodeChunk(blob.data(), blob.size(), decoded.data(), uint32_t(decoded.size())) ==
+            int64_t(points.size()));
+
+    // Half a quantization step per axis, plus float rounding in the encoder and decoder, which
+    // scales with the coordinates' magnitude rather than the step
+    BoundingBox bounds = computeBounds(points.data(), points.size());
+    double steps = double((uint64_t(1) << bits) - 1);
+    auto tolerance = [&](float min, float max) {
+        return (double(max) - double(min)) / steps * 0.5 +
+               4.0 * FLT_EPSILON * std::max(std::fabs(double(min)), std::fabs(double(max)));
+    };
+    double half_step[3] = {tolerance(bounds.min_x, bounds.max_x), tolerance(bounds.min_y, bounds.max_y),
+                           tolerance(bounds.min_z, bounds.max_z)};
+    auto close = [](float a, float b, double half) {
+        return std::fabs(double(a) - double(b)) <= half;
+    };
+    bool within = true, colors = true;
+    for (size_t i = 0; i < points.size(); ++i) {
+        within &= close(decoded[i].x, points[i].x, half_step[0]) && close(decoded[i].y, points[i].y, half_step[1]) &&
+                  close(decoded[i].z, points[i].z, half_step[2]);
+        colors &= decoded[i].r == points[i].r && decoded[i].g == points[i].g && decoded[i].b == points[i].b;
+    }
+    CHECK(within);
+    CHECK(colors);
+}
+
+// Runs of evenly stepped points along arcs, with a jump to the next run every 12, like the
+// generated datasets
+static std::vector<Point> arcRuns(uint32_t count) {
+    std::vector<Point> points(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        float run = static_cast<float>(i / 12);
+        float t = 0.1f * static_cast<float>(i % 12);
+        points[i] = {10.0f * std::sin(run) + std::cos(t), 0.3f * run + 0.05f * t, 10.0f * std::cos(run) + std::sin(t),
+                     static_cast<uint8_t>(100 + i % 12), static_cast<uint8_t>(run), 200, 0};
+    }
+    return points;
+}
+
+TEST(ChunkCodecRoundTrip) {
+    std::vector<Point> points = randomPoints(5000, 11);
+    checkRoundTrip(points, 8);
+    checkRoundTrip(points, 14);
+    checkRoundTrip(points, 16);
+    checkRoundTrip(points, 24);
+
+    checkRoundTrip(arcRuns(5000), 14);
+    checkRoundTrip(arcRuns(5000), 24);
+}
+
+TEST(ChunkCodecBlockBoundaries) {
+    for (uint32_t count : {63u, 64u, 65u, 128u, 129u}) {
+        checkRoundTrip(arcRuns(count), 16);
+        checkRoundTrip(randomPoints(count, count), 16);
+    }
+}
+
+TEST(ChunkCodecRatio) {
+    std::vector<Point> points = arcRuns(60000);
+    std::vector<uint8_t> blob;
+    encodeChunk(points.data(), 60000, blob);
+    CHECK(blob.size() * 3 < points.size() * sizeof(Point));
+}
+
+TEST(ChunkCodecEdgeCases) {
+    checkRoundTrip({}, 16);
+    checkRoundTrip(randomPoints(1, 3), 16);
+
+    // Every point in one place: a zero extent on every axis
+    std::vector<Point> same(100, randomPoints(1, 5)[0]);
+    checkRoundTrip(same, 12);
+}
+
+TEST(ChunkCodecRejectsCorrupt) {
+    std::vector<Point> points = randomPoints(100, 13);
+    std::vector<uint8_t> blob;
+    encodeChunk(points.data(), 100, blob);
+    std::vector<Point> decoded(100);
+
+    CHECK_EQ(decodeChunk(blob.data(), blob.size() / 2, decoded.data(), 100), int64_t(-1));
+    CHECK_EQ(decodeChunk(blob.data(), blob.size(), decoded.data(), 50), int64_t(-1));
+    CHECK_EQ(encodedPointCount(blob.data(), 3), 0u);
+}
@@ -0,0 +1,105 @@
+#include "TestHarness.h"
+#include "ChunkLoadQueue.h"
+
+static ChunkLoadRequest request(uint64_t user_data, float priority, bool prefetch = false) {
+    ChunkLoadRequest r{user_data * 4096, 4096, nullptr, user_data};
+    r.priority = priority;
+    r.prefetch = prefetch;
+    return r;
+}
+
+// Pops everything, one at a time, returning the user_data in the order served
+static std::vector<uint64_t> drain(ChunkLoadQueue& queue, ChunkLoadClock::time_point now,
+                                   std::vector<uint64_t>* expired_ids = nullptr) {
+    std::vector<uint64_t> order;
+    std::vector<ChunkLoadRequest> batch, expired;
+    while (!queue.empty()) {
+        batch.clear();
+        expired.clear();
+        queue.pop(1, 1, now, batch, expired);
+        for (const auto& r : batch) {
+            order.push_back(r.user_data);
+        }
+        for (const auto& r : expired) {
+            if (expired_ids != nullptr) {
+                expired_ids->push_back(r.user_data);
+            }
+        }
+    }
+    return order;
+}
+
+TEST(ChunkLoadQueueOrder) {
+    ChunkLoadQueue queue;
+    queue.push(request(1, 1.0f));
+    queue.push(request(2, 5.0f, true));
+    queue.push(request(3, 3.0f));
+    queue.push(request(4, 3.0f));
+    queue.push(request(5, 0.5f));
+
+    // Visible first by priority, ties in request order, prefetches last whatever their priority
+    std::vector<uint64_t> expected = {3, 4, 1, 5, 2};
+    CHECK(drain(queue, ChunkLoadClock::now()) == expected);
+}
+
+TEST(ChunkLoadQueuePrefetchBatch) {
+    ChunkLoadQueue queue;
+    for (uint64_t i = 0; i < 4; ++i) {
+        queue.push(request(i, 1.0f, true));
+    }
+    std::vector<ChunkLoadRequest> batch, expired;
+    queue.pop(8, 2, ChunkLoadClock::now(), batch, expired);
+    CHECK_EQ(batch.size(), size_t(2));
+
+    queue.push(request(9, 0.0f));
+    batch.clear();
+    queue.pop(8, 2, ChunkLoadClock::now(), batch, expired);
+    REQUIRE(!batch.empty());
+    CHECK_EQ(batch.front().user_data, uint64_t(9));
+}
+
+TEST(ChunkLoadQueueCancel) {
+    ChunkLoadQueue queue;
+    queue.push(request(1, 1.0f));
+    queue.push(request(2, 2.0f));
+    queue.push(request(3, 3.0f));
+
+    std::vector<ChunkLoadRequest> cancelled;
+    CHECK_EQ(queue.cancel(2, cancelled), size_t(1));
+    CHECK_EQ(queue.cancel(7, cancelled), size_t(0));
+    REQUIRE(cancelled.size() == 1);
+    CHECK_EQ(cancelled[0].user_data, uint64_t(2));
+
+    std::vector<uint64_t> expected = {3, 1};
+    CHECK(drain(queue, ChunkLoadClock::now()) == expected);
+}
+
+TEST(ChunkLoadQueueReprioritize) {
+    ChunkLoadQueue queue;
+    queue.push(request(1, 1.0f));
+    queue.push(request(2, 2.0f));
+    queue.push(request(3, 9.0f, true));
+
+    ChunkLoadPriority updates[] = {{1, 5.0f, false}, {3, 7.0f, false}, {8, 1.0f, false}};
+    CHECK_EQ(queue.reprioritize(updates, 3), size_t(2));
+    std::vector<uint64_t> expected = {3, 1, 2};
+    CHECK(drain(queue, ChunkLoadClock::now()) == expected);
+}
+
+TEST(ChunkLoadQueueDeadline) {
+    auto now = ChunkLoadClock::now();
+    ChunkLoadQueue queue;
+    ChunkLoadRequest late = request(1, 9.0f, true);
+    late.deadline = now - std::chrono::milliseconds(1);
+    ChunkLoadRequest on_time = request(2, 1.0f, true);
+    on_time.deadline = now + std::chrono::seconds(1);
+    queue.push(late);
+    queue.push(on_time);
+    queue.push(request(3, 0.0f));
+
+    std::vector<uint64_t> expired;
+    std::vector<uint64_t> expected = {3, 2};
+    CHECK(drain(queue, now, &expired) == expected);
+    REQUIRE(expired.size() == 1);
+    CHECK_EQ(expired[0], uint64_t(1));
+}
@@ -0,0 +1,125 @@
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include "TestHarness.h"
+#include "ChunkLoader.h"
+#include "Crc32c.h"
+
+static const uint32_t kChunkPoints = 50000;
+static const uint32_t kChunks = 8;
+
+// A file of kChunks chunks of kChunkPoints points, back to back
+static std::string writeChunks() {
+    std::string path = tempPath("loader.bin");
+    std::ofstream out(path, std::ios::binary);
+    for (uint32_t i = 0; i < kChunks; ++i) {
+        std::vector<Point> points = randomPoints(kChunkPoints, 300 + i);
+        out.write(reinterpret_cast<const char*>(points.data()),
+                  static_cast<std::streamsize>(points.size() * sizeof(Point)));
+    }
+    return path;
+}
+
+// Reads every chunk into slots still holding other chunks, each demoted first
+static void requestDemotingBatch(ChunkLoader& loader, std::vector<Point>& slots) {
+    std::vector<ChunkLoadRequest> requests(kChunks);
+    for (uint32_t i = 0; i < kChunks; ++i) {
+        ChunkLoadRequest& request = requests[i];
+        request.offset = uint64_t(i) * kChunkPoints * sizeof(Point);
+        request.length = kChunkPoints * sizeof(Point);
+        request.dst = slots.data() + size_t(i) * kChunkPoints;
+        request.user_data = i;
+        request.demote_chunk = 100 + i;
+        request.demote_points = kChunkPoints;
+    }
+    loader.request(requests.data(), requests.size());
+}
+
+static ChunkLoaderOptions demotingOptions() {
+    ChunkLoaderOptions options;
+    options.batch_size = kChunks;
+    options.decode_threads = 1;
+    return options;
+}
+
+TEST(ChunkLoaderDemotesBeforeReading) {
+    std::string path = writeChunks();
+    std::vector<Point> slots = randomPoints(kChunks * kChunkPoints, 400);
+    std::vector<Point> old = slots;
+
+    ChunkLoader loader(ChunkSource::open(path, ChunkSourceKind::PRead), demotingOptions());
+    REQUIRE(loader.valid());
+    requestDemotingBatch(loader, slots);
+    loader.waitIdle();
+
+    std::vector<ChunkLoadResult> results;
+    CHECK_EQ(loader.poll(results), size_t(kChunks));
+    for (const auto& result : results) {
+        CHECK_EQ(result.result, int64_t(kChunkPoints * sizeof(Point)));
+    }
+
+    // What each slot held before its read is what was compressed
+    std::vector<CompressedChunk> compressed;
+    CHECK_EQ(loader.pollCompressed(compressed), size_t(kChunks));
+    std::vector<Point> decoded(kChunkPoints);
+    for (const auto& chunk : compressed) {
+        REQUIRE(chunk.chunk_id >= 100 && chunk.chunk_id < 100 + kChunks);
+        const Point* before = old.data() + size_t(chunk.chunk_id - 100) * kChunkPoints;
+        CHECK_EQ(decodeChunk(chunk.blob->data(), chunk.blob->size(), decoded.data(), kChunkPoints),
+                 int64_t(kChunkPoints));
+        CHECK(decoded[0].x - before[0].x < 0.01f && before[0].x - decoded[0].x < 0.01f);
+    }
+}
+
+TEST(ChunkLoaderDestroyedWhileDemoting) {
+    std::string path = writeChunks();
+    std::vector<Point> slots = randomPoints(kChunks * kChunkPoints, 401);
+
+    // Destroyed at different points of the batch's demotions; none may hang
+    for (int delay_ms : {0, 1, 2, 5, 10, 20}) {
+        ChunkLoader loader(ChunkSource::open(path, ChunkSourceKind::PRead), demotingOptions());
+        REQUIRE(loader.valid());
+        requestDemotingBatch(loader, slots);
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    }
+}
+
+TEST(ChunkLoaderChecksCrcsOffTheIOThread) {
+    std::string path = writeChunks();
+    std::vector<Point> slots(kChunks * kChunkPoints);
+    std::vector<Point> expected(kChunkPoints);
+
+    ChunkLoaderOptions options;
+    options.batch_size = 2;  // Several batches, so checks overlap the reads after them
+    options.crc_rereads = 2;
+    ChunkLoader loader(ChunkSource::open(path, ChunkSourceKind::PRead), options);
+    REQUIRE(loader.valid());
+
+    // The last chunk's CRC is wrong, so it's read twice more and then rejected
+    std::vector<ChunkLoadRequest> requests(kChunks);
+    for (uint32_t i = 0; i < kChunks; ++i) {
+        expected = randomPoints(kChunkPoints, 300 + i);
+        ChunkLoadRequest& request = requests[i];
+        request.offset = uint64_t(i) * kChunkPoints * sizeof(Point);
+        request.length = kChunkPoints * sizeof(Point);
+        request.dst = slots.data() + size_t(i) * kChunkPoints;
+        request.user_data = i;
+        request.verify = true;
+        request.crc = crc32c(expected.data(), request.length) + (i == kChunks - 1 ? 1 : 0);
+    }
+    loader.request(requests.data(), requests.size());
+    loader.waitIdle();
+
+    std::vector<ChunkLoadResult> results;
+    CHECK_EQ(loader.poll(results), size_t(kChunks));
+    for (const auto& result : results) {
+        CHECK_EQ(result.result, result.user_data == kChunks - 1 ? int64_t(-EBADMSG)
+                                                                : int64_t(kChunkPoints * sizeof(Point)));
+    }
+    CHECK_EQ(loader.crcMismatches(), uint64_t(3));
+    CHECK_EQ(loader.crcRejected(), uint64_t(1));
+    CHECK_EQ(loader.bytesVerified(), uint64_t(kChunks + 2) * kChunkPoints * sizeof(Point));
+    CHECK_EQ(loader.pending(), size_t(0));
+}
@@ -0,0 +1,146 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "TestHarness.h"
+#include "ChunkSource.h"
+#include "TileManifest.h"
+
+// Accepts every request, completes the first @a completes of them, then reaps nothing, like
+// io_uring after io_uring_enter fails for good
+class StalledSource : public ChunkSource {
+public:
+    explicit StalledSource(size_t completes) : completes_(completes) {}
+
+    size_t submit(const ChunkReadRequest *requests, size_t count) override {
+        pending_.insert(pending_.end(), requests, requests + count);
+        return count;
+    }
+
+    size_t reap(ChunkReadCompletion *completions, size_t max, size_t min_complete) override {
+        size_t n = 0;
+        while (n < max && completes_ > 0 && !pending_.empty()) {
+            completions[n++] = {pending_.front().user_data, pending_.front().length};
+            pending_.erase(pending_.begin());
+            completes_--;
+        }
+        reaps_++;
+        return n;
+    }
+
+    size_t inFlight() const override { return pending_.size(); }
+
+    const char *name() const override { return "stalled"; }
+
+    size_t reaps_ = 0;
+
+private:
+    size_t completes_;
+    std::vector<ChunkReadRequest> pending_;
+};
+
+TEST(ChunkSourceFailedReapEndsBatch) {
+    char buffer[64];
+    std::vector<ChunkReadRequest> requests;
+    for (uint64_t i = 0; i < 4; ++i) {
+        requests.push_back({i * 16, 16, buffer + i * 16, 100 + i});
+    }
+
+    StalledSource source(1);
+    std::vector<ChunkReadCompletion> completions(4);
+    size_t complete = source.readBatch(requests.data(), 4, completions.data());
+    CHECK_EQ(complete, size_t(1));
+    CHECK(source.reaps_ < 4);
+
+    // The one that finished keeps its result and the rest fail, each reported once
+    CHECK_EQ(completions[0].user_data, uint64_t(100));
+    CHECK_EQ(completions[0].result, int64_t(16));
+    for (size_t i = 1; i < 4; ++i) {
+        CHECK_EQ(completions[i].user_data, uint64_t(100 + i));
+        CHECK_EQ(completions[i].result, int64_t(-EIO));
+    }
+}
+
+TEST(ChunkSourceReadBatch) {
+    std::string path = tempPath("source.bin");
+    std::vector<uint8_t> data(4096);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    auto source = ChunkSource::open(path, ChunkSourceKind::PRead);
+    REQUIRE(source != nullptr);
+    std::vector<uint8_t> buffer(data.size());
+    std::vector<ChunkReadRequest> requests;
+    for (uint64_t i = 0; i < 8; ++i) {
+        requests.push_back({i * 512, 512, buffer.data() + i * 512, i});
+    }
+    std::vector<ChunkReadCompletion> completions(8);
+    CHECK_EQ(source->readBatch(requests.data(), 8, completions.data()), size_t(8));
+    CHECK(std::memcmp(buffer.data(), data.data(), data.size()) == 0);
+}
+
+TEST(TiledChunkSourceReadsEachTile) {
+    // Two tiles in one file, the second from byte 1000 on, and a third in a file of its own
+    std::string shared = tempPath("tiles.bin");
+    std::string own = tempPath("tile2.bin");
+    std::vector<uint8_t> data(3000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 13 + i / 256);
+    }
+    {
+        std::ofstream out(shared, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(data.data()), 2000);
+        std::ofstream out2(own, std::ios::binary);
+        out2.write(reinterpret_cast<const char*>(data.data()) + 2000, 1000);
+    }
+    int shared_fd = ::open(shared.c_str(), O_RDONLY);
+    int own_fd = ::open(own.c_str(), O_RDONLY);
+    REQUIRE(shared_fd >= 0 && own_fd >= 0);
+
+    ChunkSourceOptions options;
+    options.threads = 2;
+    TiledChunkSource source(options);
+    CHECK(source.addTile(0, {shared_fd, 0, 1000}));
+    CHECK(source.addTile(1, {shared_fd, 1000, 1000}));
+    CHECK(source.addTile(7, {own_fd, 0, 0}));
+    CHECK(!source.addTile(1, {shared_fd, 0, 0}));
+    CHECK_EQ(errno, EEXIST);
+    CHECK(!source.addTile(kMaxTiles, {shared_fd, 0, 0}));
+    CHECK_EQ(errno, EINVAL);
+
+    // The source reads through descriptors of its own
+    ::close(shared_fd);
+    ::close(own_fd);
+    CHECK_EQ(source.tileCount(), size_t(3));
+    CHECK(source.hasTile(7) && !source.hasTile(2));
+
+    // Reads name their tile in the top bits of the offset; one past a tile's end is cut short
+    // and one from a tile that isn't there fails
+    std::vector<uint8_t> buffer(5 * 100);
+    std::vector<ChunkReadRequest> requests = {
+            {tiledOffset(0, 100), 100, buffer.data(), 0},
+            {tiledOffset(1, 100), 100, buffer.data() + 100, 1},
+            {tiledOffset(7, 900), 100, buffer.data() + 200, 2},
+            {tiledOffset(1, 950), 100, buffer.data() + 300, 3},
+            {tiledOffset(2, 0), 100, buffer.data() + 400, 4},
+    };
+    std::vector<ChunkReadCompletion> completions(requests.size());
+    CHECK_EQ(source.readBatch(requests.data(), requests.size(), completions.data()), size_t(3));
+
+    int64_t expected[] = {100, 100, 100, 50, -EBADF};
+    for (const auto& completion : completions) {
+        CHECK_EQ(completion.result, expected[completion.user_data]);
+    }
+    CHECK(std::memcmp(buffer.data(), data.data() + 100, 100) == 0);
+    CHECK(std::memcmp(buffer.data() + 100, data.data() + 1100, 100) == 0);
+    CHECK(std::memcmp(buffer.data() + 200, data.data() + 2900, 100) == 0);
+    CHECK(std::memcmp(buffer.data() + 300, data.data() + 1950, 50) == 0);
+}
@@ -0,0 +1,36 @@
+#include <cstring>
+
+#include "TestHarness.h"
+#include "Crc32c.h"
+
+TEST(Crc32cCheckValue) {
+    // The standard check value: CRC32C of the nine ASCII digits
+    const char* digits = "123456789";
+    CHECK_EQ(crc32c(digits, 9), 0xe3069283u);
+    CHECK_EQ(crc32cSoftware(digits, 9), 0xe3069283u);
+    CHECK_EQ(crc32c(nullptr, 0), 0u);
+}
+
+TEST(Crc32cHardwareMatchesSoftware) {
+    std::vector<Point> points = randomPoints(20000, 17);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(points.data());
+    size_t size = points.size() * sizeof(Point);
+
+    // Every alignment and a spread of lengths, across the interleaved streams' block sizes
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t length : {size_t(0), size_t(1), size_t(7), size_t(63), size_t(255), size_t(4096),
+                              size_t(12345), size - 16}) {
+            CHECK_EQ(crc32c(bytes + offset, length), crc32cSoftware(bytes + offset, length));
+        }
+    }
+}
+
+TEST(Crc32cContinues) {
+    const char* text = "The quick brown fox jumps over the lazy dog";
+    size_t length = std::strlen(text);
+    uint32_t whole = crc32c(text, length);
+    for (size_t split = 0; split <= length; ++split) {
+        CHECK_EQ(crc32c(text + split, length - split, crc32c(text, split)), whole);
+        CHECK_EQ(crc32cSoftware(text + split, length - split, crc32cSoftware(text, split)), whole);
+    }
+}
@@ -0,0 +1,39 @@
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TestHarness.h"
+#include "IngestServer.h"
+
+TEST(IngestServerKeepsFileAtSocketPath) {
+    // A dataset passed where the socket goes must survive
+    std::string path = tempPath("ingest_not_a_socket.pcd");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "PCD data";
+    }
+
+    IngestServer server(IngestOptions{});
+    std::string error;
+    CHECK(!server.listen(path, &error));
+    CHECK(error.find(path) != std::string::npos);
+
+    std::ifstream file(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CHECK(contents == "PCD data");
+}
+
+TEST(IngestServerReplacesStaleSocket) {
+    std::string path = tempPath("ingest_stale.sock");
+    // A server that died without cleaning up leaves its socket behind
+    REQUIRE(::mknod(path.c_str(), S_IFSOCK | 0600, 0) == 0);
+
+    IngestServer second(IngestOptions{});
+    std::string error;
+    CHECK(second.listen(path, &error));
+    struct stat st{};
+    CHECK(::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode));
+}
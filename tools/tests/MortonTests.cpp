@@ -0,0 +1,45 @@
+#include "TestHarness.h"
+#include "Morton.h"
+
+TEST(MortonEncodeDecode) {
+    for (uint32_t x = 0; x < 1024; x += 37) {
+        for (uint32_t y = 0; y < 1024; y += 53) {
+            for (uint32_t z = 0; z < 1024; z += 71) {
+                MortonIndices indices = mortonDecode(mortonEncode(x, y, z));
+                CHECK_EQ(indices.x, x);
+                CHECK_EQ(indices.y, y);
+                CHECK_EQ(indices.z, z);
+            }
+        }
+    }
+    CHECK_EQ(mortonEncode(1023, 1023, 1023), (1u << 30) - 1);
+}
+
+TEST(MortonBitLayout) {
+    // x in bit 0, y in bit 1, z in bit 2 of every octant
+    CHECK_EQ(mortonEncode(1, 0, 0), 1u);
+    CHECK_EQ(mortonEncode(0, 1, 0), 2u);
+    CHECK_EQ(mortonEncode(0, 0, 1), 4u);
+    CHECK_EQ(mortonEncode(2, 0, 0), 8u);
+    CHECK_EQ(mortonOctant(mortonEncode(2, 3, 1), 0, 2), 0b011u);
+    CHECK_EQ(mortonOctant(mortonEncode(2, 3, 1), 1, 2), 0b110u);
+}
+
+TEST(MortonStepWraps) {
+    const int depth = 3;
+    uint32_t code = mortonEncode(7, 2, 0);
+    MortonIndices stepped = mortonDecode(mortonStep(code, 0, 1, depth));
+    CHECK_EQ(stepped.x, 0u);
+    CHECK_EQ(stepped.y, 2u);
+    stepped = mortonDecode(mortonStep(code, 2, -1, depth));
+    CHECK_EQ(stepped.z, 7u);
+    CHECK_EQ(stepped.x, 7u);
+}
+
+TEST(MortonCellClamps) {
+    BoundingBox bounds{0, 0, 0, 8, 8, 8};
+    CHECK_EQ(mortonCell(0.5f, 0.5f, 0.5f, bounds, 3), mortonEncode(0, 0, 0));
+    CHECK_EQ(mortonCell(7.5f, 3.5f, 1.5f, bounds, 3), mortonEncode(7, 3, 1));
+    CHECK_EQ(mortonCell(8.0f, 8.0f, 8.0f, bounds, 3), mortonEncode(7, 7, 7));
+    CHECK_EQ(mortonCell(-5.0f, 100.0f, 4.0f, bounds, 3), mortonEncode(0, 7, 4));
+}
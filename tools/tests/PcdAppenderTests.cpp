@@ -0,0 +1,177 @@
+#include <cstring>
+#include <fstream>
+
+#include "TestHarness.h"
+#include "PcdAppender.h"
+#include "Crc32c.h"
+
+static bool writeBase(const std::string& path, const PcdWriteOptions& options, uint32_t chunks) {
+    PcdWriter writer;
+    if (!writer.open(path, chunks, options)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < chunks; ++i) {
+        std::vector<Point> points = randomPoints(500, 100 + i);
+        if (!writer.writeChunk(points.data(), 500)) {
+            return false;
+        }
+    }
+    return writer.finish();
+}
+
+static std::vector<Point> readPayload(const std::string& path, const ChunkMetadata& chunk) {
+    std::vector<Point> points(chunk.point_count);
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(chunk.file_offset));
+    in.read(reinterpret_cast<char*>(points.data()), static_cast<std::streamsize>(points.size() * sizeof(Point)));
+    return points;
+}
+
+TEST(PcdAppenderCommitReopen) {
+    std::string path = tempPath("append.pcd");
+    PcdWriteOptions options;
+    options.chunk_crcs = true;
+    options.bricks_per_chunk = 8;
+    REQUIRE(writeBase(path, options, 3));
+
+    std::vector<Point> added = randomPoints(700, 200);
+    std::vector<Point> replaced = randomPoints(300, 201);
+    {
+        PcdAppender appender;
+        REQUIRE(appender.open(path));
+        REQUIRE(appender.appendChunk(added.data(), 700));
+        REQUIRE(appender.replaceChunk(1, replaced.data(), 300));
+        REQUIRE(appender.commit());
+    }
+
+    PcdIndex index;
+    std::string error;
+    REQUIRE(readPcdIndex(path, index, &error));
+    CHECK_EQ(index.generation, uint64_t(1));
+    REQUIRE(index.chunks.size() == 4);
+    CHECK_EQ(index.header.total_points, uint64_t(500 + 300 + 500 + 700));
+    CHECK_EQ(index.chunks[1].point_count, 300u);
+    CHECK_EQ(index.chunks[3].point_count, 700u);
+    CHECK_EQ(index.bricks.size(), size_t(4 * 8));
+    for (uint32_t i = 0; i < 4; ++i) {
+        std::vector<Point> payload = readPayload(path, index.chunks[i]);
+        CHECK_EQ(index.chunk_crcs[i], crc32c(payload.data(), payload.size() * sizeof(Point)));
+    }
+
+    // A second commit on the reopened file builds on the first
+    {
+        PcdAppender appender;
+        REQUIRE(appender.open(path));
+        CHECK_EQ(appender.index().chunks.size(), size_t(4));
+        REQUIRE(appender.appendChunk(added.data(), 100));
+        REQUIRE(appender.commit());
+    }
+    REQUIRE(readPcdIndex(path, index, &error));
+    CHECK_EQ(index.generation, uint64_t(2));
+    CHECK_EQ(index.chunks.size(), size_t(5));
+}
+
+TEST(PcdAppenderDropsUncommitted) {
+    std::string path = tempPath("uncommitted.pcd");
+    REQUIRE(writeBase(path, PcdWriteOptions{}, 2));
+    {
+        PcdAppender appender;
+        REQUIRE(appender.open(path));
+        std::vector<Point> points = randomPoints(400, 300);
+        REQUIRE(appender.appendChunk(points.data(), 400));
+    }
+
+    PcdIndex index;
+    REQUIRE(readPcdIndex(path, index));
+    CHECK_EQ(index.generation, uint64_t(0));
+    CHECK_EQ(index.chunks.size(), size_t(2));
+
+    PcdAppender appender;
+    REQUIRE(appender.open(path));
+    CHECK_EQ(appender.index().chunks.size(), size_t(2));
+}
+
+TEST(PcdAppenderLocksFile) {
+    std::string path = tempPath("locked.pcd");
+    REQUIRE(writeBase(path, PcdWriteOptions{}, 1));
+    PcdAppender first, second;
+    REQUIRE(first.open(path));
+    CHECK(!second.open(path));
+}
+
+// Overwrites the pointer slot generation @a generation went to with garbage, as a crash partway
+// through writing it would leave it
+static void tearSlot(const std::string& path, uint64_t generation) {
+    PcdIndex index;
+    REQUIRE(readPcdIndex(path, index));
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    uint64_t slots = pcdPointerSlotsOffset(header.flags, header.chunk_count, index.bricks_per_chunk);
+    file.seekp(static_cast<std::streamoff>(slots + (generation % 2) * PCD_POINTER_SLOT_SIZE + 20));
+    file.write("torn torn torn torn torn", 24);
+}
+
+TEST(PcdAppenderSurvivesTornPointer) {
+    std::string path = tempPath("torn.pcd");
+    PcdWriteOptions options;
+    options.bricks_per_chunk = 64;
+    options.chunk_crcs = true;
+    REQUIRE(writeBase(path, options, 2));
+
+    std::vector<Point> added = randomPoints(250, 400);
+    for (int commit = 0; commit < 2; ++commit) {
+        PcdAppender appender;
+        REQUIRE(appender.open(path));
+        REQUIRE(appender.appendChunk(added.data(), 250));
+        REQUIRE(appender.commit());
+    }
+
+    // Generation 2 torn: generation 1, in the other slot, stands
+    tearSlot(path, 2);
+    PcdIndex index;
+    std::string error;
+    REQUIRE(readPcdIndex(path, index, &error));
+    CHECK_EQ(index.generation, uint64_t(1));
+    CHECK_EQ(index.chunks.size(), size_t(3));
+    CHECK_EQ(index.bricks.size(), size_t(3 * 64));
+    CHECK_EQ(index.chunk_crcs.size(), size_t(3));
+
+    // The next commit redoes generation 2 over the torn slot
+    {
+        PcdAppender appender;
+        REQUIRE(appender.open(path));
+        REQUIRE(appender.appendChunk(added.data(), 250));
+        REQUIRE(appender.commit());
+    }
+    REQUIRE(readPcdIndex(path, index, &error));
+    CHECK_EQ(index.generation, uint64_t(2));
+    CHECK_EQ(index.chunks.size(), size_t(4));
+
+    // With both slots torn only the index written with the file is left
+    tearSlot(path, 1);
+    tearSlot(path, 2);
+    REQUIRE(readPcdIndex(path, index, &error));
+    CHECK_EQ(index.generation, uint64_t(0));
+    CHECK_EQ(index.chunks.size(), size_t(2));
+    CHECK_EQ(index.bricks.size(), size_t(2 * 64));
+}
+
+TEST(PcdAppenderRejectsFilesWithoutSlots) {
+    std::string path = tempPath("noslots.pcd");
+    REQUIRE(writeBase(path, PcdWriteOptions{}, 1));
+
+    // As written before the pointer slots: still readable, but not appendable
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    header.flags &= ~PCD_FLAG_POINTER_SLOTS;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+
+    PcdIndex index;
+    CHECK(readPcdIndex(path, index));
+    PcdAppender appender;
+    CHECK(!appender.open(path));
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+#include "TestHarness.h"
+#include "PcdFile.h"
+#include "Crc32c.h"
+#include "PcdScan.h"
+
+// Writes @a chunks chunks of @a points each and reads the file back through readPcdIndex
+static bool writeFile(const std::string& path, const PcdWriteOptions& options,
+                      const std::vector<std::vector<Point>>& chunks) {
+    PcdWriter writer;
+    if (!writer.open(path, static_cast<uint32_t>(chunks.size()), options)) {
+        return false;
+    }
+    for (const auto& chunk : chunks) {
+        if (!writer.writeChunk(chunk.data(), static_cast<uint32_t>(chunk.size()))) {
+            return false;
+        }
+    }
+    return writer.finish();
+}
+
+static std::vector<Point> readPayload(const std::string& path, const ChunkMetadata& chunk) {
+    std::vector<Point> points(chunk.point_count);
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(chunk.file_offset));
+    in.read(reinterpret_cast<char*>(points.data()), static_cast<std::streamsize>(points.size() * sizeof(Point)));
+    return points;
+}
+
+static bool samePoints(std::vector<Point> a, std::vector<Point> b) {
+    auto less = [](const Point& p, const Point& q) { return std::memcmp(&p, &q, sizeof(Point)) < 0; };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(Point)) == 0;
+}
+
+static void checkRoundTrip(const PcdWriteOptions& options, const std::string& name) {
+    std::vector<std::vector<Point>> chunks;
+    for (uint32_t i = 0; i < 5; ++i) {
+        chunks.push_back(randomPoints(1000 + 337 * i, i + 1));
+    }
+    std::string path = tempPath(name);
+    REQUIRE(writeFile(path, options, chunks));
+
+    PcdIndex index;
+    std::string error;
+    REQUIRE(readPcdIndex(path, index, &error));
+    REQUIRE(index.chunks.size() == chunks.size());
+
+    uint32_t flags = headerFlags(index.header);
+    CHECK(flags & PCD_FLAG_INDEX_POINTER);
+    CHECK(flags & PCD_FLAG_POINTER_SLOTS);
+    CHECK_EQ(bool(flags & PCD_FLAG_ALIGNED_PAYLOADS), options.align_payloads);
+    CHECK_EQ(bool(flags & PCD_FLAG_BRICKS), options.bricks_per_chunk > 0);
+    CHECK_EQ(bool(flags & PCD_FLAG_CHUNK_CRCS), options.chunk_crcs);
+    CHECK_EQ(index.header.chunk_size, options.chunk_size);
+    CHECK_EQ(index.bricks_per_chunk, options.bricks_per_chunk);
+    CHECK_EQ(index.generation, uint64_t(0));
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < chunks.size(); ++i) {
+        const ChunkMetadata& chunk = index.chunks[i];
+        total += chunk.point_count;
+        CHECK_EQ(chunk.point_count, uint32_t(chunks[i].size()));
+        BoundingBox bounds = computeBounds(chunks[i].data(), chunks[i].size());
+        CHECK(std::memcmp(&bounds, &chunk.bbox, sizeof(bounds)) == 0);
+        if (options.align_payloads) {
+            CHECK_EQ(chunk.file_offset % PCD_PAYLOAD_ALIGNMENT, uint64_t(0));
+            CHECK_EQ((chunk.point_count * sizeof(Point) + chunk.payload_padding) % PCD_PAYLOAD_ALIGNMENT, size_t(0));
+        }
+
+        std::vector<Point> payload = readPayload(path, chunk);
+        if (options.bricks_per_chunk > 0) {
+            // Regrouped by brick: the same points, and each brick a run of the payload within its box
+            CHECK(samePoints(payload, chunks[i]));
+            const PcdBrick* bricks = index.chunkBricks(i);
+            uint32_t next = 0;
+            for (uint32_t b = 0; b < index.bricks_per_chunk; ++b) {
+                CHECK_EQ(bricks[b].first_point, next);
+                for (uint32_t p = 0; p < bricks[b].point_count; ++p) {
+                    const Point& point = payload[bricks[b].first_point + p];
+                    CHECK(bricks[b].bbox.contains(point.x, point.y, point.z));
+                }
+                next += bricks[b].point_count;
+            }
+            CHECK_EQ(next, chunk.point_count);
+        } else {
+            CHECK(std::memcmp(payload.data(), chunks[i].data(), payload.size() * sizeof(Point)) == 0);
+        }
+        if (options.chunk_crcs) {
+            CHECK_EQ(index.chunk_crcs[i], crc32c(payload.data(), payload.size() * sizeof(Point)));
+        }
+    }
+    CHECK_EQ(index.header.total_points, total);
+}
+
+TEST(PcdRoundTripPlain) {
+    checkRoundTrip(PcdWriteOptions{}, "plain.pcd");
+}
+
+TEST(PcdRoundTripAligned) {
+    PcdWriteOptions options;
+    options.align_payloads = true;
+    checkRoundTrip(options, "aligned.pcd");
+}
+
+TEST(PcdRoundTripBricks) {
+    PcdWriteOptions options;
+    options.bricks_per_chunk = 8;
+    checkRoundTrip(options, "bricks8.pcd");
+    options.bricks_per_chunk = 64;
+    checkRoundTrip(options, "bricks64.pcd");
+}
+
+TEST(PcdRoundTripCrcs) {
+    PcdWriteOptions options;
+    options.chunk_crcs = true;
+    checkRoundTrip(options, "crcs.pcd");
+}
+
+TEST(PcdRoundTripAllFlags) {
+    PcdWriteOptions options;
+    options.align_payloads = true;
+    options.bricks_per_chunk = 64;
+    options.chunk_crcs = true;
+    options.chunk_size = 4096;
+    checkRoundTrip(options, "all.pcd");
+}
+
+TEST(PcdRejectsCorruptIndex) {
+    std::string path = tempPath("corrupt.pcd");
+    PcdWriteOptions options;
+    options.chunk_crcs = true;
+    REQUIRE(writeFile(path, options, {randomPoints(100, 7)}));
+
+    // Flip a byte of the only index entry; the pointer's checksum covers it
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(sizeof(FileHeader) + 2);
+    file.put('\x7f');
+    file.close();
+
+    PcdIndex index;
+    std::string error;
+    CHECK(!readPcdIndex(path, index, &error));
+    CHECK(!error.empty());
+}
+
+TEST(PcdRejectsOversizedCounts) {
+    std::string path = tempPath("oversized.pcd");
+    REQUIRE(writeFile(path, PcdWriteOptions{}, {randomPoints(100, 8)}));
+
+    // A count that would take 160 GB of entries, in a file of a few KB
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    uint32_t count = 0xffffffffu;
+    file.seekp(offsetof(FileHeader, chunk_count));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.close();
+
+    PcdIndex index;
+    std::string error;
+    CHECK(!readPcdIndex(path, index, &error));
+    CHECK(error.find("too short") != std::string::npos);
+}
+
+TEST(PcdScanSpacingIsNearestNeighbour) {
+    // A 20x20x10 lattice of pitch 0.01, stored so consecutive points are far apart
+    std::vector<Point> lattice;
+    for (int i = 0; i < 4000; ++i) {
+        int k = (i * 2999) % 4000;
+        Point p{};
+        p.x = 1.0f + 0.01f * float(k % 20);
+        p.y = 2.0f + 0.01f * float(k / 20 % 20);
+        p.z = 3.0f + 0.01f * float(k / 400);
+        lattice.push_back(p);
+    }
+    std::string path = tempPath("spacing.pcd");
+    REQUIRE(writeFile(path, PcdWriteOptions{}, {lattice, randomPoints(1, 9)}));
+
+    PcdIndex index;
+    REQUIRE(readPcdIndex(path, index));
+    PcdScanReport report;
+    REQUIRE(scanPcd(path, index, nullptr, report));
+
+    // Sampled points stand in for the rest; the lone point has no neighbour
+    uint64_t total = report.spacing.total();
+    CHECK(total > 3900 && total < 4100);
+    CHECK_EQ(report.spacing.counts[-7 - Log2Histogram::kMinExp], total);
+    CHECK(report.ok());
+}
@@ -0,0 +1,71 @@
+#ifndef TESTHARNESS_H
+#define TESTHARNESS_H
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PointCloudData.h"
+
+/*!
+ * Just enough of a test framework for pcdcore's tests, so they build anywhere the tools do with
+ * nothing to download. Each TEST registers itself; a failed CHECK reports the file and line and
+ * fails the test, and the rest of it still runs.
+ *
+ * ex:
+ *  TEST(MortonRoundTrip) {
+ *      CHECK_EQ(mortonDecode(mortonEncode(1, 2, 3)).y, 2u);
+ *  }
+ */
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& testRegistry();
+
+// Called by the CHECK macros when a condition doesn't hold
+void testFailed(const char* file, int line, const std::string& message);
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*run)()) { testRegistry().push_back({name, run}); }
+};
+
+#define TEST(name) \
+    static void test_##name(); \
+    static TestRegistrar registrar_##name(#name, &test_##name); \
+    static void test_##name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) testFailed(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        auto&& check_a_ = (a); \
+        auto&& check_b_ = (b); \
+        if (!(check_a_ == check_b_)) { \
+            testFailed(__FILE__, __LINE__, "CHECK_EQ(" #a ", " #b "): " + std::to_string(check_a_) + \
+                                           " != " + std::to_string(check_b_)); \
+        } \
+    } while (0)
+
+// Fails the test and leaves it: for setup steps the rest of the test depends on
+#define REQUIRE(condition) \
+    do { \
+        if (!(condition)) { \
+            testFailed(__FILE__, __LINE__, "REQUIRE(" #condition ")"); \
+            return; \
+        } \
+    } while (0)
+
+// A path in the system's temporary directory, unique to this run and @a name; removed at exit
+std::string tempPath(const std::string& name);
+
+// @a count points spread over a 100 unit cube, the same ones for the same @a seed
+std::vector<Point> randomPoints(uint32_t count, uint32_t seed);
+
+#endif //TESTHARNESS_H
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+
+#include "TestHarness.h"
+
+// Runs every registered test, or those whose names contain the first argument
+
+static int failures_ = 0;
+static std::vector<std::string> temp_paths_;
+
+std::vector<TestCase>& testRegistry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void testFailed(const char* file, int line, const std::string& message) {
+    std::cerr << "  " << file << ":" << line << ": " << message << std::endl;
+    failures_++;
+}
+
+std::string tempPath(const std::string& name) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("pcdcore_tests_" + std::to_string(std::random_device{}()) + "_" + name);
+    temp_paths_.push_back(path.string());
+    return path.string();
+}
+
+std::vector<Point> randomPoints(uint32_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+    std::uniform_int_distribution<int> color(0, 255);
+    std::vector<Point> points(count);
+    for (Point& p : points) {
+        p.x = position(random);
+        p.y = position(random);
+        p.z = position(random);
+        p.r = static_cast<uint8_t>(color(random));
+        p.g = static_cast<uint8_t>(color(random));
+        p.b = static_cast<uint8_t>(color(random));
+        p.padding = 0;
+    }
+    return points;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+
+    int run = 0, failed = 0;
+    for (const TestCase& test : testRegistry()) {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        int before = failures_;
+        test.run();
+        run++;
+        if (failures_ != before) {
+            failed++;
+            std::cout << "FAIL " << test.name << std::endl;
+        } else {
+            std::cout << "ok   " << test.name << std::endl;
+        }
+    }
+
+    for (const std::string& path : temp_paths_) {
+        std::remove(path.c_str());
+    }
+
+    std::cout << run - failed << " of " << run << " tests passed" << std::endl;
+    return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+#include "TestHarness.h"
+#include "TileManifest.h"
+
+// Tiles on a grid of unit cubes, @a per_tile chunks each except every fourth, which is empty
+static TileManifest gridManifest(uint32_t side, uint32_t per_tile) {
+    TileManifest manifest;
+    manifest.bounds = {0.0f, 0.0f, 0.0f, float(side), 1.0f, float(side)};
+    manifest.depth = 6;
+    manifest.chunk_size = 1000;
+    for (uint32_t x = 0; x < side; ++x) {
+        for (uint32_t z = 0; z < side; ++z) {
+            TileEntry tile;
+            tile.path = "tile_" + std::to_string(x) + "_" + std::to_string(z) + ".pcd";
+            tile.chunk_count = (x * side + z) % 4 == 3 ? 0 : per_tile;
+            tile.total_points = uint64_t(tile.chunk_count) * 1000;
+            tile.bounds = tile.chunk_count == 0 ? BoundingBox::empty()
+                                                : BoundingBox{float(x), 0.0f, float(z),
+                                                              float(x + 1), 1.0f, float(z + 1)};
+            manifest.tiles.push_back(tile);
+        }
+    }
+    manifest.assignChunkIds();
+    return manifest;
+}
+
+static bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+    return a.min_x <= b.max_x && a.max_x >= b.min_x &&
+           a.min_y <= b.max_y && a.max_y >= b.min_y &&
+           a.min_z <= b.max_z && a.max_z >= b.min_z;
+}
+
+TEST(TileManifestRoundTrip) {
+    TileManifest manifest = gridManifest(3, 5);
+    manifest.tiles[4].path = "with spaces/tile 4.pcd";
+    std::string path = tempPath("round.tiles");
+    REQUIRE(writeTileManifest(path, manifest));
+
+    TileManifest read;
+    std::string error;
+    REQUIRE(readTileManifest(path, read, &error));
+    CHECK_EQ(read.depth, manifest.depth);
+    CHECK_EQ(read.chunk_size, manifest.chunk_size);
+    CHECK_EQ(read.chunkCount(), manifest.chunkCount());
+    CHECK_EQ(read.totalPoints(), manifest.totalPoints());
+    REQUIRE(read.tiles.size() == manifest.tiles.size());
+    for (size_t i = 0; i < read.tiles.size(); ++i) {
+        CHECK(read.tiles[i].path == manifest.tiles[i].path);
+        CHECK_EQ(read.tiles[i].first_chunk, manifest.tiles[i].first_chunk);
+        CHECK_EQ(read.tiles[i].bounds.max_z, manifest.tiles[i].bounds.max_z);
+    }
+    CHECK(tilePath("data/city.tiles", read.tiles[4]) == "data/with spaces/tile 4.pcd");
+    CHECK(tilePath("city.tiles", read.tiles[4]) == "with spaces/tile 4.pcd");
+}
+
+TEST(TileManifestRejectsBadInput) {
+    const char* bad[] = {
+        "",
+        "pcdtiles 2\nbounds 0 0 0 1 1 1\ndepth 4\n",
+        "pcdtiles 1\ndepth 4\n",
+        "pcdtiles 1\nbounds 0 0 0 1 1 1\ndepth 4\ntile 3 30 0 0 0 1 1 1\n",
+        "pcdtiles 1\nbounds 0 0 0 1 1 1\ndepth 4\nsize 12\n",
+        "pcdtiles 1\nbounds 0 0 0 1 1 1\ndepth 4\nflags 4\n",
+    };
+    for (const char* text : bad) {
+        std::istringstream in(text);
+        TileManifest manifest;
+        std::string error;
+        CHECK(!readTileManifest(in, manifest, &error));
+        CHECK(!error.empty());
+    }
+
+    // Comments, blank lines and CRLF line ends are fine
+    std::istringstream in("# made by hand\r\npcdtiles 1\r\n\r\nbounds 0 0 0 1 1 1\r\ndepth 4\r\n"
+                          "tile 2 20 0 0 0 1 1 1 a.pcd\r\n");
+    TileManifest manifest;
+    REQUIRE(readTileManifest(in, manifest));
+    CHECK(manifest.tiles[0].path == "a.pcd");
+}
+
+TEST(TileManifestTileOfChunk) {
+    TileManifest manifest = gridManifest(4, 3);
+    for (uint32_t tile = 0; tile < manifest.tiles.size(); ++tile) {
+        const TileEntry& entry = manifest.tiles[tile];
+        for (uint32_t i = 0; i < entry.chunk_count; ++i) {
+            CHECK_EQ(manifest.tileOfChunk(entry.first_chunk + i), tile);
+        }
+    }
+    CHECK_EQ(manifest.tileOfChunk(static_cast<uint32_t>(manifest.chunkCount())), UINT32_MAX);
+}
+
+TEST(TileIndexMatchesBruteForce) {
+    TileManifest manifest = gridManifest(16, 2);
+    TileIndex index(manifest);
+    CHECK_EQ(index.size(), manifest.tiles.size());
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-2.0f, 18.0f);
+    std::uniform_real_distribution<float> size(0.0f, 4.0f);
+    std::vector<uint32_t> found;
+    for (int query = 0; query < 200; ++query) {
+        float x = position(rng), z = position(rng), half = size(rng);
+        BoundingBox box = {x - half, 0.5f, z - half, x + half, 0.5f, z + half};
+
+        std::vector<uint32_t> expected;
+        for (uint32_t tile = 0; tile < manifest.tiles.size(); ++tile) {
+            if (overlaps(manifest.tiles[tile].bounds, box)) {
+                expected.push_back(tile);
+            }
+        }
+
+        found.clear();
+        index.query(box, found);
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+    }
+}
+
+TEST(TiledOffsetRoundTrip) {
+    uint64_t offsets[] = {0, 4096, (uint64_t(1) << kTileOffsetBits) - 1};
+    uint32_t tiles[] = {0, 1, 4097, kMaxTiles - 1};
+    for (uint32_t tile : tiles) {
+        for (uint64_t offset : offsets) {
+            uint64_t tiled = tiledOffset(tile, offset);
+            CHECK_EQ(offsetTile(tiled), tile);
+            CHECK_EQ(offsetInTile(tiled), offset);
+        }
+    }
+}